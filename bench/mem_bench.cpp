@@ -0,0 +1,114 @@
+/**
+ * CopyMem / SetMem Benchmark: Custom
+ *
+ * Measures CopyMem on disjoint and on overlapping buffers, and SetMem, from 16
+ * bytes to 64 MiB, next to the C library's memcpy, memmove and memset. Each size
+ * is repeated until about 256 MiB have been moved, and the best of five runs is
+ * reported in GiB/s.
+ *
+ *     g++ -std=c++17 -O2 -Iinclude bench/mem_bench.cpp src/lib/mem.cpp -o mem_bench
+ */
+
+#include <efi/mem.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define BENCH_MINIMUM_SIZE  16
+#define BENCH_MAXIMUM_SIZE  ((UINTN)64 << 20)
+#define BENCH_VOLUME        ((UINTN)256 << 20)
+#define BENCH_RUNS          5
+
+/**
+ * Keeps the compiler from dropping or merging the operations being timed
+ */
+static inline VOID BenchClobber (
+    IN VOID *Buffer
+) {
+    __asm__ volatile ("" : : "r" (Buffer) : "memory");
+}
+
+typedef VOID (*BENCH_OPERATION) (
+    IN UINT8    *Destination,
+    IN UINT8    *Source,
+    IN UINTN    Size
+);
+
+static VOID BenchCopyMem (UINT8 *Destination, UINT8 *Source, UINTN Size) { CopyMem(Destination, Source, Size); }
+static VOID BenchMemcpy (UINT8 *Destination, UINT8 *Source, UINTN Size) { memcpy(Destination, Source, Size); }
+static VOID BenchCopyMemOverlap (UINT8 *Destination, UINT8 *Source, UINTN Size) { (VOID)Destination; CopyMem(Source + 1, Source, Size); }
+static VOID BenchMemmoveOverlap (UINT8 *Destination, UINT8 *Source, UINTN Size) { (VOID)Destination; memmove(Source + 1, Source, Size); }
+static VOID BenchSetMem (UINT8 *Destination, UINT8 *Source, UINTN Size) { (VOID)Source; SetMem(Destination, Size, 0x5A); }
+static VOID BenchMemset (UINT8 *Destination, UINT8 *Source, UINTN Size) { (VOID)Source; memset(Destination, 0x5A, Size); }
+
+/**
+ * Returns the best throughput of Operation on Size bytes, in GiB/s
+ */
+static double BenchMeasure (
+    IN BENCH_OPERATION  Operation,
+    IN UINT8            *Destination,
+    IN UINT8            *Source,
+    IN UINTN            Size
+) {
+    UINTN Iterations = BENCH_VOLUME / Size;
+    if (Iterations == 0) {
+        Iterations = 1;
+    }
+
+    double Best = 0;
+    for (UINTN Run = 0; Run < BENCH_RUNS; Run++) {
+        auto Start = std::chrono::steady_clock::now();
+        for (UINTN Iteration = 0; Iteration < Iterations; Iteration++) {
+            Operation(Destination, Source, Size);
+            BenchClobber(Destination);
+            BenchClobber(Source);
+        }
+        double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+        double Rate = (double)Size * (double)Iterations / Seconds / (1 << 30);
+        if (Rate > Best) {
+            Best = Rate;
+        }
+    }
+    return Best;
+}
+
+int main (
+    VOID
+) {
+    //
+    // One spare byte after each buffer for the overlapping copy
+    //
+    UINT8 *Destination = (UINT8 *)aligned_alloc(64, BENCH_MAXIMUM_SIZE + 64);
+    UINT8 *Source = (UINT8 *)aligned_alloc(64, BENCH_MAXIMUM_SIZE + 64);
+    if (Destination == NULL || Source == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    memset(Destination, 0, BENCH_MAXIMUM_SIZE + 64);
+    memset(Source, 0xA5, BENCH_MAXIMUM_SIZE + 64);
+
+    printf("%10s %10s %10s %10s %10s %10s %10s\n", "size", "CopyMem", "memcpy", "overlap", "memmove", "SetMem", "memset");
+    for (UINTN Size = BENCH_MINIMUM_SIZE; Size <= BENCH_MAXIMUM_SIZE; Size *= 4) {
+        CHAR8 Label[16];
+        if (Size >= (1 << 20)) {
+            snprintf(Label, sizeof(Label), "%lu MiB", (unsigned long)(Size >> 20));
+        } else if (Size >= (1 << 10)) {
+            snprintf(Label, sizeof(Label), "%lu KiB", (unsigned long)(Size >> 10));
+        } else {
+            snprintf(Label, sizeof(Label), "%lu B", (unsigned long)Size);
+        }
+        printf("%10s %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n", Label,
+            BenchMeasure(BenchCopyMem, Destination, Source, Size),
+            BenchMeasure(BenchMemcpy, Destination, Source, Size),
+            BenchMeasure(BenchCopyMemOverlap, Destination, Source, Size),
+            BenchMeasure(BenchMemmoveOverlap, Destination, Source, Size),
+            BenchMeasure(BenchSetMem, Destination, Source, Size),
+            BenchMeasure(BenchMemset, Destination, Source, Size));
+    }
+
+    free(Destination);
+    free(Source);
+    return 0;
+}
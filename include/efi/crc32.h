@@ -0,0 +1,85 @@
+#pragma once
+/**
+ * CRC32 Library: Custom
+ *
+ * CRC-32 with the IEEE 802.3 polynomial, as used by EFI_TABLE_HEADER and GPT. The
+ * implementation is picked once at runtime: carry-less multiply folding on x86,
+ * the CRC32 instructions on AArch64, and slicing-by-8 everywhere else.
+ */
+
+#include "efi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Crc32Update: Custom
+ *
+ * Extends Crc, the finished CRC of some preceding data, over DataSize more bytes.
+ * Crc32Update(0, Data, DataSize) is the CRC of Data alone.
+ */
+UINT32 Crc32Update (
+    IN UINT32       Crc,
+    IN const VOID   *Data,
+    IN UINTN        DataSize
+);
+
+/**
+ * Crc32: Custom
+ */
+UINT32 Crc32 (
+    IN const VOID   *Data,
+    IN UINTN        DataSize
+);
+
+/**
+ * ValidateTableHeader: Custom
+ *
+ * Returns TRUE when Header carries Signature, a HeaderSize of at least the header
+ * itself, and a CRC32 that matches the HeaderSize bytes it covers.
+ */
+BOOLEAN ValidateTableHeader (
+    IN const EFI_TABLE_HEADER   *Header,
+    IN UINT64                   Signature
+);
+
+/**
+ * ValidateSystemTable: Custom
+ *
+ * Validates the system table header and those of the boot and runtime services
+ * tables it points to. BootServices may be NULL after ExitBootServices, while a
+ * NULL RuntimeServices makes the table invalid.
+ */
+BOOLEAN ValidateSystemTable (
+    IN const EFI_SYSTEM_TABLE *SystemTable
+);
+
+/**
+ * ValidateGptHeader: Custom
+ *
+ * Checks the signature, header size and header CRC of a GPT header read from a
+ * block of BlockSize bytes, and that the partition entry size is 128 * 2^n.
+ */
+BOOLEAN ValidateGptHeader (
+    IN const EFI_PARTITION_TABLE_HEADER *Header,
+    IN UINT32                           BlockSize
+);
+
+/**
+ * ValidateGptEntries: Custom
+ *
+ * Checks Entries, the partition entry array described by Header, against
+ * PartitionEntryArrayCRC32. Returns FALSE without reading Entries when the entry
+ * size is below 128 or not a multiple of 8, or when the array would not fit in
+ * the EntriesSize bytes of the buffer.
+ */
+BOOLEAN ValidateGptEntries (
+    IN const EFI_PARTITION_TABLE_HEADER *Header,
+    IN const VOID                       *Entries,
+    IN UINTN                            EntriesSize
+);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,229 @@
+#pragma once
+/**
+ * EFI_DEVICE_PATH_PROTOCOL Library: Custom
+ *
+ * Device paths are byte streams of nodes with unaligned 16-bit lengths, so nodes
+ * are only accessed through byte pointers. A path holds one or more instances
+ * separated by end-instance nodes and closed by an end-entire node.
+ */
+
+#include "efi.h"
+
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * DevicePathNodeLength: Custom
+ */
+static inline UINTN DevicePathNodeLength (
+    IN const EFI_DEVICE_PATH_PROTOCOL *Node
+) {
+    UINT16 Length;
+    memcpy(&Length, (const UINT8 *)Node + 2, sizeof(Length));
+    return Length;
+}
+
+/**
+ * SetDevicePathNodeLength: Custom
+ */
+static inline VOID SetDevicePathNodeLength (
+    OUT EFI_DEVICE_PATH_PROTOCOL    *Node,
+    IN UINTN                        Length
+) {
+    UINT16 Value = (UINT16)Length;
+    memcpy((UINT8 *)Node + 2, &Value, sizeof(Value));
+}
+
+/**
+ * NextDevicePathNode: Custom
+ */
+static inline EFI_DEVICE_PATH_PROTOCOL *NextDevicePathNode (
+    IN const EFI_DEVICE_PATH_PROTOCOL *Node
+) {
+    return (EFI_DEVICE_PATH_PROTOCOL *)((const UINT8 *)Node + DevicePathNodeLength(Node));
+}
+
+/**
+ * IsDevicePathEndType: Custom
+ *
+ * Returns TRUE for both end-instance and end-entire nodes.
+ */
+static inline BOOLEAN IsDevicePathEndType (
+    IN const EFI_DEVICE_PATH_PROTOCOL *Node
+) {
+    return ((const UINT8 *)Node)[0] == EFI_DEVICE_PATH_END;
+}
+
+/**
+ * IsDevicePathEnd: Custom
+ */
+static inline BOOLEAN IsDevicePathEnd (
+    IN const EFI_DEVICE_PATH_PROTOCOL *Node
+) {
+    const UINT8 *Header = (const UINT8 *)Node;
+    return Header[0] == EFI_DEVICE_PATH_END && Header[1] == EFI_DEVICE_PATH_END_ENTIRE;
+}
+
+/**
+ * SetDevicePathEndNode: Custom
+ */
+static inline VOID SetDevicePathEndNode (
+    OUT EFI_DEVICE_PATH_PROTOCOL *Node
+) {
+    UINT8 *Header = (UINT8 *)Node;
+    Header[0] = EFI_DEVICE_PATH_END;
+    Header[1] = EFI_DEVICE_PATH_END_ENTIRE;
+    SetDevicePathNodeLength(Node, sizeof(EFI_DEVICE_PATH_PROTOCOL));
+}
+
+/**
+ * IsDevicePathValid: Custom
+ *
+ * Returns TRUE when every node is at least a header long and the path ends in an
+ * end-entire node within MaxSize bytes. A MaxSize of 0 leaves the size unbounded,
+ * which is only safe for paths from trusted sources.
+ */
+BOOLEAN IsDevicePathValid (
+    IN const EFI_DEVICE_PATH_PROTOCOL   *DevicePath,
+    IN UINTN                            MaxSize
+);
+
+/**
+ * GetDevicePathSize: Custom
+ *
+ * Returns the size in bytes of the whole path including its end-entire node, or
+ * 0 when DevicePath is NULL or holds a node shorter than its header.
+ */
+UINTN GetDevicePathSize (
+    IN const EFI_DEVICE_PATH_PROTOCOL *DevicePath OPTIONAL
+);
+
+/**
+ * GetDevicePathInstanceSize: Custom
+ *
+ * Returns the size in bytes of the first instance of DevicePath, excluding the
+ * end node that closes it.
+ */
+UINTN GetDevicePathInstanceSize (
+    IN const EFI_DEVICE_PATH_PROTOCOL *DevicePath
+);
+
+/**
+ * CompareDevicePath: Custom
+ *
+ * Returns TRUE when both paths hold the same nodes.
+ */
+BOOLEAN CompareDevicePath (
+    IN const EFI_DEVICE_PATH_PROTOCOL *First,
+    IN const EFI_DEVICE_PATH_PROTOCOL *Second
+);
+
+/**
+ * HashDevicePathNode: Custom
+ *
+ * Mixes the type, subtype, length and data of one node. Equal nodes hash alike
+ * wherever they are stored; the low bits are suitable for indexing power of two
+ * tables.
+ */
+UINT64 HashDevicePathNode (
+    IN const EFI_DEVICE_PATH_PROTOCOL *Node
+);
+
+/**
+ * DuplicateDevicePath: Custom
+ *
+ * Copies DevicePath into pool memory of PoolType.
+ */
+EFI_STATUS DuplicateDevicePath (
+    IN EFI_BOOT_SERVICES                *BootServices,
+    IN EFI_MEMORY_TYPE                  PoolType,
+    IN const EFI_DEVICE_PATH_PROTOCOL   *DevicePath,
+    OUT EFI_DEVICE_PATH_PROTOCOL        **Copy
+);
+
+/**
+ * AppendDevicePath: Custom
+ *
+ * Returns in pool memory of PoolType the path First followed by Second, dropping
+ * the end-entire node of First. Either may be NULL; when both are, the result
+ * is an end node alone.
+ */
+EFI_STATUS AppendDevicePath (
+    IN EFI_BOOT_SERVICES                *BootServices,
+    IN EFI_MEMORY_TYPE                  PoolType,
+    IN const EFI_DEVICE_PATH_PROTOCOL   *First OPTIONAL,
+    IN const EFI_DEVICE_PATH_PROTOCOL   *Second OPTIONAL,
+    OUT EFI_DEVICE_PATH_PROTOCOL        **Result
+);
+
+/**
+ * AppendDevicePathNode: Custom
+ *
+ * Returns in pool memory of PoolType the path DevicePath with Node added before
+ * its end-entire node. Node is a single node, not a terminated path.
+ */
+EFI_STATUS AppendDevicePathNode (
+    IN EFI_BOOT_SERVICES                *BootServices,
+    IN EFI_MEMORY_TYPE                  PoolType,
+    IN const EFI_DEVICE_PATH_PROTOCOL   *DevicePath OPTIONAL,
+    IN const EFI_DEVICE_PATH_PROTOCOL   *Node OPTIONAL,
+    OUT EFI_DEVICE_PATH_PROTOCOL        **Result
+);
+
+/**
+ * DevicePathToText: Custom
+ *
+ * Writes the text form of DevicePath, UEFI Specification 2.10 Section 10.6, to
+ * Buffer in one pass without allocating. Nodes without a dedicated form, or with
+ * contents their form cannot carry, are written as Path(Type,SubType,Data) so that
+ * TextToDevicePath rebuilds exactly the same bytes. *BufferSize is in bytes and
+ * counts the terminator; EFI_BUFFER_TOO_SMALL returns the size needed.
+ */
+EFI_STATUS DevicePathToText (
+    IN const EFI_DEVICE_PATH_PROTOCOL   *DevicePath,
+    OUT CHAR16                          *Buffer OPTIONAL,
+    IN OUT UINTN                        *BufferSize
+);
+
+/**
+ * DevicePathToUtf8: Custom
+ *
+ * DevicePathToText writing UTF-8.
+ */
+EFI_STATUS DevicePathToUtf8 (
+    IN const EFI_DEVICE_PATH_PROTOCOL   *DevicePath,
+    OUT CHAR8                           *Buffer OPTIONAL,
+    IN OUT UINTN                        *BufferSize
+);
+
+/**
+ * TextToDevicePath: Custom
+ *
+ * Parses the text form of a device path into Buffer in one pass without allocating.
+ * Integers are decimal or 0x prefixed hexadecimal. *BufferSize is in bytes and
+ * EFI_BUFFER_TOO_SMALL returns the size needed; EFI_INVALID_PARAMETER means Text
+ * is malformed.
+ */
+EFI_STATUS TextToDevicePath (
+    IN const CHAR16                 *Text,
+    OUT EFI_DEVICE_PATH_PROTOCOL    *Buffer OPTIONAL,
+    IN OUT UINTN                    *BufferSize
+);
+
+/**
+ * Utf8ToDevicePath: Custom
+ *
+ * TextToDevicePath reading UTF-8.
+ */
+EFI_STATUS Utf8ToDevicePath (
+    IN const CHAR8                  *Text,
+    OUT EFI_DEVICE_PATH_PROTOCOL    *Buffer OPTIONAL,
+    IN OUT UINTN                    *BufferSize
+);
+
+#ifdef __cplusplus
+}
+#endif
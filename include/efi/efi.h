@@ -71,6 +71,14 @@ typedef struct EFI_BOOT_SERVICES EFI_BOOT_SERVICES;
 typedef struct EFI_RUNTIME_SERVICES EFI_RUNTIME_SERVICES;
 typedef struct EFI_CONFIGURATION_TABLE EFI_CONFIGURATION_TABLE;
 
+/**
+ * Structure Typedefs: UEFI Specification 2.10 Section 5
+ */
+typedef struct EFI_PARTITION_TABLE_HEADER EFI_PARTITION_TABLE_HEADER;
+typedef struct EFI_PARTITION_ENTRY EFI_PARTITION_ENTRY;
+typedef struct MBR_PARTITION_RECORD MBR_PARTITION_RECORD;
+typedef struct MASTER_BOOT_RECORD MASTER_BOOT_RECORD;
+
 /**
  * Structure Typedefs: UEFI Specification 2.10 Section 9
  */
@@ -1115,6 +1123,8 @@ struct __attribute__((__packed__)) EFI_LOAD_OPTION {
 
 /**
  * EFI_EXPANDED_LOAD_OPTION: Custom
+ *
+ * Lengths are in bytes. DescriptionLength counts the terminator.
  */
 typedef struct {
     UINTN LoadOptionLength;
@@ -1210,7 +1220,7 @@ struct EFI_BOOT_SERVICES {
     EFI_PROTOCOLS_PER_HANDLE                    ProtocolsPerHandle;
     EFI_LOCATE_HANDLE_BUFFER                    LocateHandleBuffer;
     EFI_LOCATE_PROTOCOL                         LocateProtocol;
-    EFI_UNINSTALL_MULTIPLE_PROTOCOL_INTERFACES  InstallMultipleProtocolInterfaces;
+    EFI_INSTALL_MULTIPLE_PROTOCOL_INTERFACES    InstallMultipleProtocolInterfaces;
     EFI_UNINSTALL_MULTIPLE_PROTOCOL_INTERFACES  UninstallMultipleProtocolInterfaces;
 
     EFI_CALCULATE_CRC32 CalculateCrc32;
@@ -1255,6 +1265,61 @@ struct EFI_CONFIGURATION_TABLE {
     VOID        *VendorTable;
 };
 
+/**
+ * MBR_PARTITION_RECORD: UEFI Specification 2.10 Section 5.2.1
+ */
+struct __attribute__((__packed__)) MBR_PARTITION_RECORD {
+    UINT8   BootIndicator;
+    UINT8   StartHead;
+    UINT8   StartSector;
+    UINT8   StartTrack;
+    UINT8   OSIndicator;
+    UINT8   EndHead;
+    UINT8   EndSector;
+    UINT8   EndTrack;
+    UINT8   StartingLBA[4];
+    UINT8   SizeInLBA[4];
+};
+
+/**
+ * MASTER_BOOT_RECORD: UEFI Specification 2.10 Section 5.2.1
+ */
+struct __attribute__((__packed__)) MASTER_BOOT_RECORD {
+    UINT8                   BootStrapCode[440];
+    UINT8                   UniqueMbrSignature[4];
+    UINT8                   Unknown[2];
+    MBR_PARTITION_RECORD    Partition[4];
+    UINT16                  Signature;
+};
+
+/**
+ * EFI_PARTITION_TABLE_HEADER: UEFI Specification 2.10 Section 5.3.2
+ */
+struct __attribute__((__packed__)) EFI_PARTITION_TABLE_HEADER {
+    EFI_TABLE_HEADER    Header;
+    EFI_LBA             MyLBA;
+    EFI_LBA             AlternateLBA;
+    EFI_LBA             FirstUsableLBA;
+    EFI_LBA             LastUsableLBA;
+    EFI_GUID            DiskGUID;
+    EFI_LBA             PartitionEntryLBA;
+    UINT32              NumberOfPartitionEntries;
+    UINT32              SizeOfPartitionEntry;
+    UINT32              PartitionEntryArrayCRC32;
+};
+
+/**
+ * EFI_PARTITION_ENTRY: UEFI Specification 2.10 Section 5.3.3
+ */
+struct __attribute__((__packed__)) EFI_PARTITION_ENTRY {
+    EFI_GUID    PartitionTypeGUID;
+    EFI_GUID    UniquePartitionGUID;
+    EFI_LBA     StartingLBA;
+    EFI_LBA     EndingLBA;
+    UINT64      Attributes;
+    CHAR16      PartitionName[36];
+};
+
 struct EFI_LOADED_IMAGE_PROTOCOL {
     UINT32              Revision;
     EFI_HANDLE          ParentHandle;
@@ -1400,6 +1465,34 @@ enum {
     FALSE = 0,
     TRUE = 1
 };
+/**
+ * EFI_TABLE_HEADER Revisions: UEFI Specification 2.10 Section 4.3.1
+ */
+#define EFI_2_100_SYSTEM_TABLE_REVISION ((2 << 16) | (100))
+#define EFI_SPECIFICATION_VERSION       EFI_2_100_SYSTEM_TABLE_REVISION
+#define EFI_SYSTEM_TABLE_REVISION       EFI_2_100_SYSTEM_TABLE_REVISION
+#define EFI_BOOT_SERVICES_REVISION      EFI_SPECIFICATION_VERSION
+#define EFI_RUNTIME_SERVICES_REVISION   EFI_SPECIFICATION_VERSION
+
+/**
+ * EFI_TABLE_HEADER Signatures: UEFI Specification 2.10 Section 4.3.1 / 4.4.1 / 4.5.1
+ */
+#define EFI_SYSTEM_TABLE_SIGNATURE      0x5453595320494249
+#define EFI_BOOT_SERVICES_SIGNATURE     0x56524553544f4f42
+#define EFI_RUNTIME_SERVICES_SIGNATURE  0x56524553544e5552
+
+/**
+ * EFI_PARTITION_TABLE_HEADER Signature: UEFI Specification 2.10 Section 5.3.2
+ */
+#define EFI_PTAB_HEADER_ID  0x5452415020494645
+
+/**
+ * MASTER_BOOT_RECORD Values: UEFI Specification 2.10 Section 5.2.1
+ */
+#define MBR_SIGNATURE       0xaa55
+#define PMBR_GPT_PARTITION  0xEE
+#define EFI_PARTITION       0xEF
+
 /**
  * EFI_EVENT: UEFI Specification 2.10 Section 7.1.1
  */
@@ -1420,6 +1513,40 @@ enum {
     TPL_HIGH_LEVEL = 31,
 };
 
+/**
+ * EFI_PAGE_SIZE: UEFI Specification 2.10 Section 7.2.1
+ */
+#define EFI_PAGE_SHIFT              12
+#define EFI_PAGE_SIZE               (1 << EFI_PAGE_SHIFT)
+#define EFI_PAGE_MASK               (EFI_PAGE_SIZE - 1)
+#define EFI_SIZE_TO_PAGES(Size)     (((Size) >> EFI_PAGE_SHIFT) + (((Size) & EFI_PAGE_MASK) ? 1 : 0))
+#define EFI_PAGES_TO_SIZE(Pages)    ((Pages) << EFI_PAGE_SHIFT)
+
+/**
+ * EFI_MEMORY_DESCRIPTOR Attributes: UEFI Specification 2.10 Section 7.2.3
+ */
+#define EFI_MEMORY_UC               0x0000000000000001
+#define EFI_MEMORY_WC               0x0000000000000002
+#define EFI_MEMORY_WT               0x0000000000000004
+#define EFI_MEMORY_WB               0x0000000000000008
+#define EFI_MEMORY_UCE              0x0000000000000010
+#define EFI_MEMORY_WP               0x0000000000001000
+#define EFI_MEMORY_RP               0x0000000000002000
+#define EFI_MEMORY_XP               0x0000000000004000
+#define EFI_MEMORY_NV               0x0000000000008000
+#define EFI_MEMORY_MORE_RELIABLE    0x0000000000010000
+#define EFI_MEMORY_RO               0x0000000000020000
+#define EFI_MEMORY_SP               0x0000000000040000
+#define EFI_MEMORY_CPU_CRYPTO       0x0000000000080000
+#define EFI_MEMORY_RUNTIME          0x8000000000000000
+#define EFI_MEMORY_ISA_VALID        0x4000000000000000
+#define EFI_MEMORY_ISA_MASK         0x0FFFF00000000000
+
+/**
+ * EFI_MEMORY_DESCRIPTOR_VERSION: UEFI Specification 2.10 Section 7.2.3
+ */
+#define EFI_MEMORY_DESCRIPTOR_VERSION 1
+
 /**
  * EFI_OPEN_PROTOCOL: UEFI Specification 2.10 Section 7.3.9
  */
@@ -1432,6 +1559,23 @@ enum {
     EFI_OPEN_PROTOCOL_EXCLUSIVE = 0x00000020
 };
 
+/**
+ * EFI_LOADED_IMAGE_PROTOCOL_REVISION: UEFI Specification 2.10 Section 9.1.1
+ */
+#define EFI_LOADED_IMAGE_PROTOCOL_REVISION 0x1000
+
+/**
+ * EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_REVISION: UEFI Specification 2.10 Section 13.4.1
+ */
+#define EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_REVISION 0x00010000
+
+/**
+ * EFI_FILE_PROTOCOL Revisions: UEFI Specification 2.10 Section 13.5.1
+ */
+#define EFI_FILE_PROTOCOL_REVISION          0x00010000
+#define EFI_FILE_PROTOCOL_REVISION2         0x00020000
+#define EFI_FILE_PROTOCOL_LATEST_REVISION   EFI_FILE_PROTOCOL_REVISION2
+
 /**
  * EFI_DEVICE_PATH_PROTOCOL Types: UEFI Specification 2.10 Section 10.3.1
  */
@@ -1444,6 +1588,72 @@ enum {
     EFI_DEVICE_PATH_END = 0x7F
 };
 
+/**
+ * EFI_DEVICE_PATH_PROTOCOL End SubTypes: UEFI Specification 2.10 Section 10.3.1
+ */
+enum {
+    EFI_DEVICE_PATH_END_INSTANCE = 0x01,
+    EFI_DEVICE_PATH_END_ENTIRE = 0xFF
+};
+
+/**
+ * EFI_DEVICE_PATH_PROTOCOL Hardware SubTypes: UEFI Specification 2.10 Section 10.3.2
+ */
+enum {
+    EFI_DEVICE_PATH_HARDWARE_PCI = 0x01,
+    EFI_DEVICE_PATH_HARDWARE_PCCARD = 0x02,
+    EFI_DEVICE_PATH_HARDWARE_MEMORY_MAPPED = 0x03,
+    EFI_DEVICE_PATH_HARDWARE_VENDOR = 0x04,
+    EFI_DEVICE_PATH_HARDWARE_CONTROLLER = 0x05,
+    EFI_DEVICE_PATH_HARDWARE_BMC = 0x06
+};
+
+/**
+ * EFI_DEVICE_PATH_PROTOCOL ACPI SubTypes: UEFI Specification 2.10 Section 10.3.3
+ */
+enum {
+    EFI_DEVICE_PATH_ACPI_ACPI = 0x01,
+    EFI_DEVICE_PATH_ACPI_EXPANDED = 0x02,
+    EFI_DEVICE_PATH_ACPI_ADR = 0x03,
+    EFI_DEVICE_PATH_ACPI_NVDIMM = 0x04
+};
+
+/**
+ * EFI_DEVICE_PATH_PROTOCOL Messaging SubTypes: UEFI Specification 2.10 Section 10.3.4
+ */
+enum {
+    EFI_DEVICE_PATH_MESSAGING_ATAPI = 0x01,
+    EFI_DEVICE_PATH_MESSAGING_SCSI = 0x02,
+    EFI_DEVICE_PATH_MESSAGING_FIBRE_CHANNEL = 0x03,
+    EFI_DEVICE_PATH_MESSAGING_1394 = 0x04,
+    EFI_DEVICE_PATH_MESSAGING_USB = 0x05,
+    EFI_DEVICE_PATH_MESSAGING_I2O = 0x06,
+    EFI_DEVICE_PATH_MESSAGING_INFINIBAND = 0x09,
+    EFI_DEVICE_PATH_MESSAGING_VENDOR = 0x0A,
+    EFI_DEVICE_PATH_MESSAGING_MAC = 0x0B,
+    EFI_DEVICE_PATH_MESSAGING_IPV4 = 0x0C,
+    EFI_DEVICE_PATH_MESSAGING_IPV6 = 0x0D,
+    EFI_DEVICE_PATH_MESSAGING_UART = 0x0E,
+    EFI_DEVICE_PATH_MESSAGING_USB_CLASS = 0x0F,
+    EFI_DEVICE_PATH_MESSAGING_USB_WWID = 0x10,
+    EFI_DEVICE_PATH_MESSAGING_LOGICAL_UNIT = 0x11,
+    EFI_DEVICE_PATH_MESSAGING_SATA = 0x12,
+    EFI_DEVICE_PATH_MESSAGING_ISCSI = 0x13,
+    EFI_DEVICE_PATH_MESSAGING_VLAN = 0x14,
+    EFI_DEVICE_PATH_MESSAGING_FIBRE_CHANNEL_EX = 0x15,
+    EFI_DEVICE_PATH_MESSAGING_SAS_EX = 0x16,
+    EFI_DEVICE_PATH_MESSAGING_NVME = 0x17,
+    EFI_DEVICE_PATH_MESSAGING_URI = 0x18,
+    EFI_DEVICE_PATH_MESSAGING_UFS = 0x19,
+    EFI_DEVICE_PATH_MESSAGING_SD = 0x1A,
+    EFI_DEVICE_PATH_MESSAGING_BLUETOOTH = 0x1B,
+    EFI_DEVICE_PATH_MESSAGING_WIFI = 0x1C,
+    EFI_DEVICE_PATH_MESSAGING_EMMC = 0x1D,
+    EFI_DEVICE_PATH_MESSAGING_BLUETOOTH_LE = 0x1E,
+    EFI_DEVICE_PATH_MESSAGING_DNS = 0x1F,
+    EFI_DEVICE_PATH_MESSAGING_NVDIMM = 0x20
+};
+
 /**
  * EFI_DEVICE_PATH_PROTOCOL Media SubTypes: UEFI Specification 2.10 Section 10.3.5
  */
@@ -1459,6 +1669,51 @@ enum {
     EFI_DEVICE_PATH_MEDIA_RAM = 0x09
 };
 
+/**
+ * EFI_LOAD_OPTION Attributes: UEFI Specification 2.10 Section 3.1.3
+ */
+#define LOAD_OPTION_ACTIVE              0x00000001
+#define LOAD_OPTION_FORCE_RECONNECT     0x00000002
+#define LOAD_OPTION_HIDDEN              0x00000008
+#define LOAD_OPTION_CATEGORY            0x00001F00
+#define LOAD_OPTION_CATEGORY_BOOT       0x00000000
+#define LOAD_OPTION_CATEGORY_APP        0x00000100
+
+/**
+ * EFI_VARIABLE Attributes: UEFI Specification 2.10 Section 8.2.1
+ */
+#define EFI_VARIABLE_NON_VOLATILE                           0x00000001
+#define EFI_VARIABLE_BOOTSERVICE_ACCESS                     0x00000002
+#define EFI_VARIABLE_RUNTIME_ACCESS                         0x00000004
+#define EFI_VARIABLE_HARDWARE_ERROR_RECORD                  0x00000008
+#define EFI_VARIABLE_AUTHENTICATED_WRITE_ACCESS             0x00000010
+#define EFI_VARIABLE_TIME_BASED_AUTHENTICATED_WRITE_ACCESS  0x00000020
+#define EFI_VARIABLE_APPEND_WRITE                           0x00000040
+#define EFI_VARIABLE_ENHANCED_AUTHENTICATED_ACCESS          0x00000080
+
+/**
+ * EFI_TIME TimeZone and Daylight: UEFI Specification 2.10 Section 8.3.1
+ */
+#define EFI_UNSPECIFIED_TIMEZONE    0x07FF
+#define EFI_TIME_ADJUST_DAYLIGHT    0x01
+#define EFI_TIME_IN_DAYLIGHT        0x02
+
+/**
+ * EFI_OPTIONAL_PTR: UEFI Specification 2.10 Section 8.4.2
+ */
+#define EFI_OPTIONAL_PTR 0x00000001
+
+/**
+ * Unicode Control Characters: UEFI Specification 2.10 Section 12.3.3
+ */
+enum {
+    CHAR_NULL = 0x0000,
+    CHAR_BACKSPACE = 0x0008,
+    CHAR_TAB = 0x0009,
+    CHAR_LINEFEED = 0x000A,
+    CHAR_CARRIAGE_RETURN = 0x000D,
+};
+
 /**
  * EFI_TEXT_ATTRIBUTE: UEFI Specification 2.10 Section 12.4.7
  */
@@ -1504,6 +1759,16 @@ enum {
 #define EFI_FILE_ARCHIVE         0x0000000000000020
 #define EFI_FILE_VALID_ATTR      0x0000000000000037
 
+/**
+ * SIZE_OF_EFI_FILE_INFO: UEFI Specification 2.10 Section 13.5.16
+ */
+#define SIZE_OF_EFI_FILE_INFO           __builtin_offsetof(EFI_FILE_INFO, FileName)
+
+/**
+ * SIZE_OF_EFI_FILE_SYSTEM_INFO: UEFI Specification 2.10 Section 13.5.17
+ */
+#define SIZE_OF_EFI_FILE_SYSTEM_INFO    __builtin_offsetof(EFI_FILE_SYSTEM_INFO, VolumeLabel)
+
 /**
  * EFI Scan Codes: UEFI Specification 2.10 Appendix B
  */
@@ -1587,22 +1852,100 @@ enum {
     EFI_WARN_RESET_REQUIRED = 7,
 };
 
+/**
+ * GUID Storage: Custom
+ *
+ * C++17 inline variables keep a single copy of each GUID per binary. C falls back
+ * to a copy per translation unit.
+ */
+#if defined(__cplusplus) && __cplusplus >= 201703L
+#define EFI_GUID_STORAGE inline
+#else
+#define EFI_GUID_STORAGE static __attribute__((unused))
+#endif
+
 /**
  * EFI_GLOBAL_VARIABLE_GUID: UEFI Specification 2.10 Section 3.3
  */
-static EFI_GUID EFI_GLOBAL_VARIABLE_GUID = { 0x8BE4DF61, 0x93CA, 0x11d2, 0xAA, 0x0D, { 0x00, 0xE0, 0x98, 0x03, 0x2B, 0x8C } };
+EFI_GUID_STORAGE EFI_GUID EFI_GLOBAL_VARIABLE_GUID = { 0x8BE4DF61, 0x93CA, 0x11d2, 0xAA, 0x0D, { 0x00, 0xE0, 0x98, 0x03, 0x2B, 0x8C } };
 
 /**
  * EFI_LOADED_IMAGE_PROTOCOL_GUID: UEFI Specification 2.10 Section 9.1.1
  */
-static EFI_GUID EFI_LOADED_IMAGE_PROTOCOL_GUID = { 0x5B1B31A1, 0x9562, 0x11d2, 0x8E, 0x3F, { 0x00, 0xA0, 0xC9, 0x69, 0x72, 0x3B } };
+EFI_GUID_STORAGE EFI_GUID EFI_LOADED_IMAGE_PROTOCOL_GUID = { 0x5B1B31A1, 0x9562, 0x11d2, 0x8E, 0x3F, { 0x00, 0xA0, 0xC9, 0x69, 0x72, 0x3B } };
+
+/**
+ * EFI_LOADED_IMAGE_DEVICE_PATH_PROTOCOL_GUID: UEFI Specification 2.10 Section 9.2
+ */
+EFI_GUID_STORAGE EFI_GUID EFI_LOADED_IMAGE_DEVICE_PATH_PROTOCOL_GUID = { 0xbc62157e, 0x3e33, 0x4fec, 0x99, 0x20, { 0x2d, 0x3b, 0x36, 0xd7, 0x50, 0xdf } };
 
 /**
  * EFI_DEVICE_PATH_PROTOCOL_GUID: UEFI Specification 2.10 Section 10.2
  */
-static EFI_GUID EFI_DEVICE_PATH_PROTOCOL_GUID = { 0x09576e91, 0x6d3f, 0x11d2, 0x8e, 0x39, { 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID_STORAGE EFI_GUID EFI_DEVICE_PATH_PROTOCOL_GUID = { 0x09576e91, 0x6d3f, 0x11d2, 0x8e, 0x39, { 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+
+/**
+ * EFI_LOAD_FILE_PROTOCOL_GUID: UEFI Specification 2.10 Section 13.1.1
+ */
+EFI_GUID_STORAGE EFI_GUID EFI_LOAD_FILE_PROTOCOL_GUID = { 0x56EC3091, 0x954C, 0x11d2, 0x8E, 0x3F, { 0x00, 0xA0, 0xC9, 0x69, 0x72, 0x3B } };
+
 /**
  * EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_GUID: UEFI Specification 2.10 Section 13.4.1
  */
-static EFI_GUID EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_GUID = { 0x0964e5b22, 0x6459, 0x11d2, 0x8e, 0x39, { 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID_STORAGE EFI_GUID EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_GUID = { 0x0964e5b22, 0x6459, 0x11d2, 0x8e, 0x39, { 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+
+/**
+ * EFI_PART_TYPE_EFI_SYSTEM_PART_GUID: UEFI Specification 2.10 Section 5.3.3
+ */
+EFI_GUID_STORAGE EFI_GUID EFI_PART_TYPE_EFI_SYSTEM_PART_GUID = { 0xc12a7328, 0xf81f, 0x11d2, 0xba, 0x4b, { 0x00, 0xa0, 0xc9, 0x3e, 0xc9, 0x3b } };
+
+/**
+ * EFI_FILE_INFO_ID: UEFI Specification 2.10 Section 13.5.16
+ */
+EFI_GUID_STORAGE EFI_GUID EFI_FILE_INFO_ID = { 0x09576e92, 0x6d3f, 0x11d2, 0x8e, 0x39, { 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+
+/**
+ * EFI_FILE_SYSTEM_INFO_ID: UEFI Specification 2.10 Section 13.5.17
+ */
+EFI_GUID_STORAGE EFI_GUID EFI_FILE_SYSTEM_INFO_ID = { 0x09576e93, 0x6d3f, 0x11d2, 0x8e, 0x39, { 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+
+/**
+ * EFI_FILE_SYSTEM_VOLUME_LABEL_ID: UEFI Specification 2.10 Section 13.5.18
+ */
+EFI_GUID_STORAGE EFI_GUID EFI_FILE_SYSTEM_VOLUME_LABEL_ID = { 0xdb47d7d3, 0xfe81, 0x11d3, 0x9a, 0x35, { 0x00, 0x90, 0x27, 0x3f, 0xc1, 0x4d } };
+
+/**
+ * EFI_SIMPLE_TEXT_INPUT_PROTOCOL_GUID: UEFI Specification 2.10 Section 12.3.1
+ */
+EFI_GUID_STORAGE EFI_GUID EFI_SIMPLE_TEXT_INPUT_PROTOCOL_GUID = { 0x387477c1, 0x69c7, 0x11d2, 0x8e, 0x39, { 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+
+/**
+ * EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL_GUID: UEFI Specification 2.10 Section 12.4.1
+ */
+EFI_GUID_STORAGE EFI_GUID EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL_GUID = { 0x387477c2, 0x69c7, 0x11d2, 0x8e, 0x39, { 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+
+/**
+ * EFI_EVENT_GROUP_EXIT_BOOT_SERVICES: UEFI Specification 2.10 Section 7.1.2
+ */
+EFI_GUID_STORAGE EFI_GUID EFI_EVENT_GROUP_EXIT_BOOT_SERVICES = { 0x27abf055, 0xb1b8, 0x4c26, 0x80, 0x48, { 0x74, 0x8f, 0x37, 0xba, 0xa2, 0xdf } };
+
+/**
+ * EFI_EVENT_GROUP_BEFORE_EXIT_BOOT_SERVICES: UEFI Specification 2.10 Section 7.1.2
+ */
+EFI_GUID_STORAGE EFI_GUID EFI_EVENT_GROUP_BEFORE_EXIT_BOOT_SERVICES = { 0x8be0e274, 0x3970, 0x4b44, 0x80, 0xc5, { 0x1a, 0xb9, 0x50, 0x2f, 0x3b, 0xfc } };
+
+/**
+ * EFI_EVENT_GROUP_VIRTUAL_ADDRESS_CHANGE: UEFI Specification 2.10 Section 7.1.2
+ */
+EFI_GUID_STORAGE EFI_GUID EFI_EVENT_GROUP_VIRTUAL_ADDRESS_CHANGE = { 0x13fa7698, 0xc831, 0x49c7, 0x87, 0xea, { 0x8f, 0x43, 0xfc, 0xc2, 0x51, 0x96 } };
+
+/**
+ * EFI_EVENT_GROUP_MEMORY_MAP_CHANGE: UEFI Specification 2.10 Section 7.1.2
+ */
+EFI_GUID_STORAGE EFI_GUID EFI_EVENT_GROUP_MEMORY_MAP_CHANGE = { 0x78bee926, 0x692f, 0x48fd, 0x9e, 0xdb, { 0x01, 0x42, 0x2e, 0xf0, 0xd7, 0xab } };
+
+/**
+ * EFI_EVENT_GROUP_READY_TO_BOOT: UEFI Specification 2.10 Section 7.1.2
+ */
+EFI_GUID_STORAGE EFI_GUID EFI_EVENT_GROUP_READY_TO_BOOT = { 0x7ce88fb3, 0x4bd7, 0x4679, 0x87, 0xa8, { 0xa8, 0xd8, 0xde, 0xe5, 0x0d, 0x2b } };
 
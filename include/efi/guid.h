@@ -0,0 +1,210 @@
+#pragma once
+/**
+ * EFI_GUID Library: Custom
+ *
+ * EFI_GUID is packed, so compilers fall back to byte-wise compares on it. These
+ * helpers treat a GUID as one 128-bit value instead.
+ */
+
+#include "efi.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/**
+ * EFI_GUID_ALIGNED: Custom
+ *
+ * EFI_GUID stored on a 16 byte boundary so that it can be loaded with one aligned access
+ */
+typedef union {
+    EFI_GUID    Guid;
+    UINT64      Qwords[2];
+} __attribute__((aligned(16))) EFI_GUID_ALIGNED;
+
+/**
+ * CompareGuid: Custom
+ *
+ * Returns TRUE when both GUIDs hold the same 128-bit value.
+ */
+static inline BOOLEAN CompareGuid (
+    IN const EFI_GUID *First,
+    IN const EFI_GUID *Second
+) {
+#if defined(__SSE2__)
+    __m128i Equal = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)First), _mm_loadu_si128((const __m128i *)Second));
+    return _mm_movemask_epi8(Equal) == 0xFFFF;
+#elif defined(__ARM_NEON)
+    uint8x16_t Equal = vceqq_u8(vld1q_u8((const uint8_t *)First), vld1q_u8((const uint8_t *)Second));
+    return vminvq_u8(Equal) == 0xFF;
+#else
+    UINT64 FirstQwords[2];
+    UINT64 SecondQwords[2];
+    memcpy(FirstQwords, First, sizeof(FirstQwords));
+    memcpy(SecondQwords, Second, sizeof(SecondQwords));
+    return ((FirstQwords[0] ^ SecondQwords[0]) | (FirstQwords[1] ^ SecondQwords[1])) == 0;
+#endif
+}
+
+/**
+ * CompareGuidAligned: Custom
+ */
+static inline BOOLEAN CompareGuidAligned (
+    IN const EFI_GUID_ALIGNED *First,
+    IN const EFI_GUID_ALIGNED *Second
+) {
+#if defined(__SSE2__)
+    __m128i Equal = _mm_cmpeq_epi8(_mm_load_si128((const __m128i *)First), _mm_load_si128((const __m128i *)Second));
+    return _mm_movemask_epi8(Equal) == 0xFFFF;
+#else
+    return ((First->Qwords[0] ^ Second->Qwords[0]) | (First->Qwords[1] ^ Second->Qwords[1])) == 0;
+#endif
+}
+
+/**
+ * CopyGuid: Custom
+ */
+static inline VOID CopyGuid (
+    OUT EFI_GUID        *Destination,
+    IN const EFI_GUID   *Source
+) {
+    memcpy(Destination, Source, sizeof(EFI_GUID));
+}
+
+/**
+ * IsZeroGuid: Custom
+ */
+static inline BOOLEAN IsZeroGuid (
+    IN const EFI_GUID *Guid
+) {
+    UINT64 Qwords[2];
+    memcpy(Qwords, Guid, sizeof(Qwords));
+    return (Qwords[0] | Qwords[1]) == 0;
+}
+
+/**
+ * HashGuid: Custom
+ *
+ * Mixes both halves of the GUID so that every output bit depends on every input
+ * bit. The low bits are suitable for indexing power of two tables.
+ */
+static inline UINT64 HashGuid (
+    IN const EFI_GUID *Guid
+) {
+    UINT64 Qwords[2];
+    memcpy(Qwords, Guid, sizeof(Qwords));
+
+    UINT64 Hash = Qwords[0] ^ (Qwords[1] * 0x9E3779B97F4A7C15);
+    Hash ^= Hash >> 29;
+    Hash *= 0xBF58476D1CE4E5B9;
+    Hash ^= Hash >> 32;
+    return Hash;
+}
+
+#if defined(__cplusplus) && __cplusplus >= 201402L
+/**
+ * GUID Literals: Custom
+ *
+ * "8BE4DF61-93CA-11D2-AA0D-00E098032B8C"_guid is parsed at compile time when
+ * used in a constant expression. A malformed literal, whether of the wrong length,
+ * with a misplaced dash or with any character that is not a hex digit, calls the
+ * non-constexpr GuidLiteralMalformed, which turns it into a compile error in that
+ * case and into the zero GUID otherwise.
+ */
+inline UINT8 GuidLiteralMalformed (
+    VOID
+) {
+    return 0;
+}
+
+constexpr UINT8 GuidLiteralNibble (
+    IN char Digit
+) {
+    return (Digit >= '0' && Digit <= '9') ? (UINT8)(Digit - '0') :
+        (Digit >= 'a' && Digit <= 'f') ? (UINT8)(Digit - 'a' + 10) :
+        (Digit >= 'A' && Digit <= 'F') ? (UINT8)(Digit - 'A' + 10) :
+        0xFF;
+}
+
+/**
+ * Checks the layout of a 36-character literal: dashes at 8, 13, 18 and 23 and hex
+ * digits everywhere else
+ */
+constexpr bool GuidLiteralWellFormed (
+    IN const char   *String,
+    IN size_t       Length
+) {
+    if (Length != 36) {
+        return false;
+    }
+    for (size_t Index = 0; Index < Length; Index++) {
+        bool Dash = Index == 8 || Index == 13 || Index == 18 || Index == 23;
+        if (Dash ? String[Index] != '-' : GuidLiteralNibble(String[Index]) == 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr UINT64 GuidLiteralField (
+    IN const char   *String,
+    IN size_t       Offset,
+    IN size_t       Digits
+) {
+    UINT64 Value = 0;
+    for (size_t Index = 0; Index < Digits; Index++) {
+        Value = (Value << 4) | GuidLiteralNibble(String[Offset + Index]);
+    }
+    return Value;
+}
+
+constexpr EFI_GUID operator""_guid (
+    IN const char   *String,
+    IN size_t       Length
+) {
+    if (!GuidLiteralWellFormed(String, Length)) {
+        GuidLiteralMalformed();
+        return EFI_GUID {};
+    }
+    return EFI_GUID {
+        (UINT32)GuidLiteralField(String, 0, 8),
+        (UINT16)GuidLiteralField(String, 9, 4),
+        (UINT16)GuidLiteralField(String, 14, 4),
+        (UINT8)GuidLiteralField(String, 19, 2),
+        (UINT8)GuidLiteralField(String, 21, 2),
+        {
+            (UINT8)GuidLiteralField(String, 24, 2),
+            (UINT8)GuidLiteralField(String, 26, 2),
+            (UINT8)GuidLiteralField(String, 28, 2),
+            (UINT8)GuidLiteralField(String, 30, 2),
+            (UINT8)GuidLiteralField(String, 32, 2),
+            (UINT8)GuidLiteralField(String, 34, 2),
+        }
+    };
+}
+
+/**
+ * CompareGuidConstant: Custom
+ *
+ * Field-wise compare that can be folded when both GUIDs are constant expressions
+ */
+constexpr BOOLEAN CompareGuidConstant (
+    IN const EFI_GUID &First,
+    IN const EFI_GUID &Second
+) {
+    if (First.TimeLow != Second.TimeLow || First.TimeMid != Second.TimeMid || First.TimeHighAndVersion != Second.TimeHighAndVersion ||
+        First.ClockSequenceHighAndReserved != Second.ClockSequenceHighAndReserved || First.ClockSequenceLow != Second.ClockSequenceLow) {
+        return FALSE;
+    }
+    for (size_t Index = 0; Index < sizeof(First.Node); Index++) {
+        if (First.Node[Index] != Second.Node[Index]) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+#endif
@@ -0,0 +1,275 @@
+#pragma once
+/**
+ * Hosted UEFI environment: Custom
+ *
+ * Builds a populated EFI_SYSTEM_TABLE, EFI_BOOT_SERVICES and EFI_RUNTIME_SERVICES
+ * inside a Linux process so that boot-path code can be exercised natively.
+ * Physical addresses handed out by the hosted services are host virtual addresses
+ * inside a reserved arena, so they can be dereferenced directly.
+ *
+ * The hosted environment is single threaded: the services must be called from the
+ * thread that called EfiHostInitialize.
+ */
+
+#include "efi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * EFI_HOST_RESET_HOOK: Custom
+ */
+typedef VOID (*EFI_HOST_RESET_HOOK) (
+    IN EFI_RESET_TYPE   ResetType,
+    IN EFI_STATUS       ResetStatus,
+    IN UINTN            DataSize,
+    IN VOID             *ResetData OPTIONAL
+);
+
+/**
+ * EFI_HOST_CONFIG: Custom
+ */
+typedef struct {
+    EFI_PHYSICAL_ADDRESS    ArenaBase;          // Preferred base of the page arena, 0 lets the host choose
+    UINTN                   ArenaSize;          // Size in bytes of the page arena
+    CHAR16                  *FirmwareVendor;
+    UINT32                  FirmwareRevision;
+    INT32                   ConsoleInFd;        // Host descriptor backing ConIn, -1 for none
+    INT32                   ConsoleOutFd;       // Host descriptor backing ConOut, -1 to discard
+    INT32                   StandardErrorFd;    // Host descriptor backing StdErr, -1 to discard; shares ConOut when the same terminal
+    BOOLEAN                 VirtualClock;       // Advance time only through Stall and idle waits
+    UINT64                  VariableStoreSize;  // Bytes reported by QueryVariableInfo
+    const CHAR8             *VariableStorePath; // Host file logging non-volatile variables, NULL keeps them in memory
+    UINT64                  ImageCacheSize;     // Bytes of files and laid out images LoadImage keeps for reuse, 0 disables the cache
+    EFI_HOST_RESET_HOOK     ResetHook;          // Called by ResetSystem, the process exits when NULL
+} EFI_HOST_CONFIG;
+
+/**
+ * EFI_HOST_POOL_STATS: Custom
+ */
+typedef struct {
+    UINT64  Allocations;        // Live pool allocations
+    UINT64  BytesInUse;         // Bytes held by live allocations, rounded up to their block size
+    UINT64  PeakBytesInUse;
+    UINT64  TotalAllocations;
+    UINT64  TotalFrees;
+    UINT64  SlabPages;          // Pages carved into small blocks
+    UINT64  LargePages;         // Pages held by allocations too large for a slab
+} EFI_HOST_POOL_STATS;
+
+/**
+ * EFI_HOST_IMAGE_STATS: Custom
+ */
+typedef struct {
+    UINT64  ImageSize;          // SizeOfImage of the loaded image
+    UINT64  SectionCopyTime;    // Nanoseconds spent laying out the headers and sections
+    UINT64  RelocationTime;     // Nanoseconds spent applying base relocations
+    UINT64  Relocations;        // Fixups applied, 0 when the image was placed where it was relocated for
+    BOOLEAN Cached;             // Copied from an earlier load of the same file instead of parsed and laid out
+} EFI_HOST_IMAGE_STATS;
+
+/**
+ * EFI_HOST_VARIABLE_INFO: Custom
+ */
+typedef struct {
+    UINT64      Size;           // Bytes of the entry including the terminated VariableName
+    EFI_GUID    VendorGuid;
+    UINT32      Attributes;
+    UINT32      DataSize;
+    CHAR16      VariableName [];
+} EFI_HOST_VARIABLE_INFO;
+
+/**
+ * SIZE_OF_EFI_HOST_VARIABLE_INFO: Custom
+ */
+#define SIZE_OF_EFI_HOST_VARIABLE_INFO  __builtin_offsetof(EFI_HOST_VARIABLE_INFO, VariableName)
+
+/**
+ * EfiHostGetDefaultConfig: Custom
+ */
+VOID EfiHostGetDefaultConfig (
+    OUT EFI_HOST_CONFIG *Config
+);
+
+/**
+ * EfiHostInitialize: Custom
+ *
+ * Creates the hosted environment and an image handle carrying an
+ * EFI_LOADED_IMAGE_PROTOCOL for the calling program.
+ */
+EFI_STATUS EfiHostInitialize (
+    IN EFI_HOST_CONFIG      *Config OPTIONAL,
+    OUT EFI_SYSTEM_TABLE    **SystemTable,
+    OUT EFI_HANDLE          *ImageHandle
+);
+
+/**
+ * EfiHostShutdown: Custom
+ *
+ * Releases every resource of the hosted environment. EfiHostInitialize may be
+ * called again afterwards to start a fresh boot flow.
+ */
+VOID EfiHostShutdown (
+    VOID
+);
+
+/**
+ * EfiHostGetSystemTable: Custom
+ */
+EFI_SYSTEM_TABLE *EfiHostGetSystemTable (
+    VOID
+);
+
+/**
+ * EfiHostGetPoolStats: Custom
+ *
+ * Reports the pool usage of one memory type since EfiHostInitialize.
+ */
+EFI_STATUS EfiHostGetPoolStats (
+    IN EFI_MEMORY_TYPE      PoolType,
+    OUT EFI_HOST_POOL_STATS *Stats
+);
+
+/**
+ * EfiHostGetImageStats: Custom
+ *
+ * Reports how long LoadImage took to lay out and relocate ImageHandle, which
+ * must be an image it loaded that has not been unloaded. Applications are
+ * unloaded when StartImage returns, so their statistics are read before.
+ */
+EFI_STATUS EfiHostGetImageStats (
+    IN EFI_HANDLE               ImageHandle,
+    OUT EFI_HOST_IMAGE_STATS    *Stats
+);
+
+/**
+ * EfiHostOpenDirectory: Custom
+ *
+ * Opens the host directory Path as the root directory of a volume whose files are
+ * host files. ReadEx, WriteEx and FlushEx are queued to the kernel through io_uring
+ * and signal Token->Event from the idle loop or RestoreTPL once they complete;
+ * where io_uring is unavailable they complete before returning. Paths opened
+ * beneath Root cannot climb above Path through "..". GetInfo answers from a copy
+ * of the host status that only changes made through the volume refresh.
+ */
+EFI_STATUS EfiHostOpenDirectory (
+    IN const CHAR8          *Path,
+    IN BOOLEAN              ReadOnly,
+    OUT EFI_FILE_PROTOCOL   **Root
+);
+
+/**
+ * EfiHostInstallFileSystem: Custom
+ *
+ * Installs an EFI_SIMPLE_FILE_SYSTEM_PROTOCOL on *Handle, creating the handle when
+ * it is NULL, whose volume is the host directory Path, as EfiHostOpenDirectory
+ * describes.
+ */
+EFI_STATUS EfiHostInstallFileSystem (
+    IN const CHAR8      *Path,
+    IN BOOLEAN          ReadOnly,
+    IN OUT EFI_HANDLE   *Handle
+);
+
+/**
+ * EfiHostReadDirectoryEntries: Custom
+ *
+ * Reads as many entries of Directory as fit in Buffer with one call, each an
+ * EFI_FILE_INFO as EFI_FILE_PROTOCOL.Read returns it, starting on an 8 byte
+ * boundary after the previous one. On return *BufferSize is the number of bytes
+ * used and *EntryCount the number of entries, both 0 at the end of the directory.
+ * EFI_BUFFER_TOO_SMALL means the next entry alone does not fit; *BufferSize is
+ * then the size it needs. When Read fails after some entries were read, those
+ * are returned with EFI_SUCCESS and the error is returned by the next call for
+ * Directory. Works with any EFI_FILE_PROTOCOL, though only closing a file of
+ * this host drops an error held for it.
+ */
+EFI_STATUS EfiHostReadDirectoryEntries (
+    IN EFI_FILE_PROTOCOL    *Directory,
+    IN OUT UINTN            *BufferSize,
+    OUT VOID                *Buffer,
+    OUT UINTN               *EntryCount
+);
+
+/**
+ * EfiHostMapFile: Custom
+ *
+ * Maps the bytes of File, a file opened from a volume of EfiHostOpenDirectory or
+ * EfiHostInstallFileSystem, from Offset into memory read-only and without copying,
+ * for large files such as kernels and initrds. *Length is the number of bytes
+ * wanted and on return the number mapped, which stops at the end of the file.
+ * The mapping belongs to the caller until EfiHostUnmapFile, and stays valid after
+ * File is closed. It is a view of the host file rather than a snapshot: changes
+ * made to the file later show through, and pages the file no longer reaches
+ * after it is truncated read as zeros instead of faulting.
+ */
+EFI_STATUS EfiHostMapFile (
+    IN EFI_FILE_PROTOCOL    *File,
+    IN UINT64               Offset,
+    IN OUT UINTN            *Length,
+    OUT const VOID          **Mapping
+);
+
+/**
+ * EfiHostUnmapFile: Custom
+ *
+ * Releases a mapping EfiHostMapFile returned. Mappings still held at
+ * EfiHostShutdown are released then.
+ */
+EFI_STATUS EfiHostUnmapFile (
+    IN const VOID *Mapping
+);
+
+/**
+ * EfiHostInstallFatFileSystem: Custom
+ *
+ * Installs a read-only EFI_SIMPLE_FILE_SYSTEM_PROTOCOL on *Handle, creating the
+ * handle when it is NULL, for the FAT12, FAT16 or FAT32 volume in the host image
+ * Path. The image may also be a whole disk, in which case its GPT EFI system
+ * partition or its first MBR FAT partition is used.
+ */
+EFI_STATUS EfiHostInstallFatFileSystem (
+    IN const CHAR8      *Path,
+    IN OUT EFI_HANDLE   *Handle
+);
+
+/**
+ * EfiHostGetVariables: Custom
+ *
+ * Lists every variable GetVariable could currently return, or only those of
+ * VendorGuid when it is not NULL, in one call: an EFI_HOST_VARIABLE_INFO per
+ * variable, each starting on an 8 byte boundary after the previous one, in the
+ * order GetNextVariableName visits them. The list is a consistent snapshot, so it
+ * is returned whole or not at all: EFI_BUFFER_TOO_SMALL sets *BufferSize to the
+ * size needed. On success *BufferSize is the number of bytes used and *EntryCount
+ * the number of entries.
+ */
+EFI_STATUS EfiHostGetVariables (
+    IN const EFI_GUID   *VendorGuid OPTIONAL,
+    IN OUT UINTN        *BufferSize,
+    OUT VOID            *Buffer OPTIONAL,
+    OUT UINTN           *EntryCount
+);
+
+/**
+ * EfiHostConvertPointers: Custom
+ *
+ * ConvertPointer applied to each of the Count pointers at Pointers, such as a
+ * protocol's function table, in one call. Like ConvertPointer it may only be used
+ * from EFI_EVENT_GROUP_VIRTUAL_ADDRESS_CHANGE notifications. Every pointer that
+ * can be converted is; the status is that of the first one that could not, which
+ * is left unchanged.
+ *
+ * The host itself runs in place: SetVirtualAddressMap remaps nothing and the
+ * tables and services the host provides keep their addresses.
+ */
+EFI_STATUS EfiHostConvertPointers (
+    IN UINTN    DebugDisposition,
+    IN UINTN    Count,
+    IN OUT VOID **Pointers
+);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,93 @@
+#pragma once
+/**
+ * EFI_LOAD_OPTION Library: Custom
+ *
+ * A load option is a packed header followed by a terminated CHAR16 Description,
+ * FilePathListLength bytes of device paths and OptionalData filling the rest. The
+ * parser points into the original buffer, whose fields are unaligned in general,
+ * so Description and FilePath must only be read through byte-wise accesses.
+ */
+
+#include "efi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * EFI_LOAD_OPTION_TYPE: Custom
+ */
+typedef enum {
+    LoadOptionTypeBoot,
+    LoadOptionTypeDriver,
+    LoadOptionTypeSysPrep,
+    LoadOptionTypePlatformRecovery,
+    LoadOptionTypeMax
+} EFI_LOAD_OPTION_TYPE;
+
+/**
+ * EFI_LOAD_OPTION_TYPE Masks: Custom
+ */
+#define LOAD_OPTION_TYPE_MASK(Type) (1U << (Type))
+#define LOAD_OPTION_TYPE_MASK_ALL   (LOAD_OPTION_TYPE_MASK(LoadOptionTypeMax) - 1)
+
+/**
+ * EFI_LOAD_OPTION_ENTRY: Custom
+ */
+typedef struct {
+    EFI_LOAD_OPTION_TYPE        Type;
+    UINT16                      OptionNumber;   // The #### of the variable name
+    UINT32                      Attributes;     // Attributes of the load option, not of the variable
+    EFI_EXPANDED_LOAD_OPTION    Option;
+} EFI_LOAD_OPTION_ENTRY;
+
+/**
+ * ParseLoadOption: Custom
+ *
+ * Fills Expanded with pointers into Buffer after checking that the Description is
+ * terminated, that FilePathList is whole device paths ending exactly at
+ * FilePathListLength, and that every length stays within Size. Nothing is copied.
+ * OptionalData is NULL when OptionalDataLength is 0.
+ */
+EFI_STATUS ParseLoadOption (
+    IN VOID                         *Buffer,
+    IN UINTN                        Size,
+    OUT EFI_EXPANDED_LOAD_OPTION    *Expanded
+);
+
+/**
+ * SerializeLoadOption: Custom
+ *
+ * The inverse of ParseLoadOption: writes Attributes and the Description, FilePath
+ * and OptionalData of Expanded, whose LoadOption fields are ignored, as one load
+ * option. *BufferSize is in bytes and EFI_BUFFER_TOO_SMALL returns the size needed.
+ */
+EFI_STATUS SerializeLoadOption (
+    IN UINT32                           Attributes,
+    IN const EFI_EXPANDED_LOAD_OPTION   *Expanded,
+    OUT VOID                            *Buffer OPTIONAL,
+    IN OUT UINTN                        *BufferSize
+);
+
+/**
+ * GetLoadOptions: Custom
+ *
+ * Reads every Boot####, Driver####, SysPrep#### or PlatformRecovery#### variable
+ * selected by TypeMask in one walk of the variable names and parses each into an
+ * entry. Entries are sorted by type then option number, and options that do not
+ * parse are skipped. *Entries is a single pool allocation of PoolType holding the
+ * entries and the option data they point into, released with one FreePool, or
+ * NULL when no option was found.
+ */
+EFI_STATUS GetLoadOptions (
+    IN EFI_BOOT_SERVICES        *BootServices,
+    IN EFI_RUNTIME_SERVICES     *RuntimeServices,
+    IN EFI_MEMORY_TYPE          PoolType,
+    IN UINT32                   TypeMask,
+    OUT EFI_LOAD_OPTION_ENTRY   **Entries,
+    OUT UINTN                   *EntryCount
+);
+
+#ifdef __cplusplus
+}
+#endif
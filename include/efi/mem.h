@@ -0,0 +1,39 @@
+#pragma once
+/**
+ * Memory Library: Custom
+ *
+ * Implementations of EFI_COPY_MEM and EFI_SET_MEM using the widest vector unit the
+ * processor offers, picked once on first use: AVX-512, AVX2 or SSE2 on x86, with
+ * rep movsb / rep stosb for large blocks when ERMS or FSRM is present, and NEON
+ * on AArch64.
+ */
+
+#include "efi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * CopyMem: Custom
+ *
+ * Copies Length bytes from Source to Destination. The buffers may overlap.
+ */
+VOID CopyMem (
+    OUT VOID        *Destination,
+    IN const VOID   *Source,
+    IN UINTN        Length
+);
+
+/**
+ * SetMem: Custom
+ */
+VOID SetMem (
+    OUT VOID    *Buffer,
+    IN UINTN    Size,
+    IN UINT8    Value
+);
+
+#ifdef __cplusplus
+}
+#endif
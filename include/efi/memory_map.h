@@ -0,0 +1,188 @@
+#pragma once
+/**
+ * EFI_MEMORY_DESCRIPTOR Library: Custom
+ */
+
+#include "efi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * EFI_MEMORY_MAP_SLACK_DESCRIPTORS: Custom
+ *
+ * Extra descriptors reserved when sizing a memory map buffer, covering the ranges
+ * the buffer allocation itself and pre-exit notifications may add
+ */
+#define EFI_MEMORY_MAP_SLACK_DESCRIPTORS 8
+
+/**
+ * ExitBootServicesWithMemoryMap: Custom
+ *
+ * Sizes and allocates a memory map buffer of BufferType, fetches the final map and
+ * exits boot services with its key. If the key goes stale during the pre-exit
+ * notifications, the map is fetched once more into the same buffer, which is the
+ * only recovery the specification allows after a failed ExitBootServices.
+ *
+ * On success *MemoryMap holds the final map and remains valid at runtime.
+ */
+EFI_STATUS ExitBootServicesWithMemoryMap (
+    IN EFI_BOOT_SERVICES        *BootServices,
+    IN EFI_HANDLE               ImageHandle,
+    IN EFI_MEMORY_TYPE          BufferType,
+    OUT EFI_MEMORY_DESCRIPTOR   **MemoryMap,
+    OUT UINTN                   *MemoryMapSize,
+    OUT UINTN                   *DescriptorSize,
+    OUT UINT32                  *DescriptorVersion
+);
+
+/**
+ * EFI_MEMORY_MAP_VIEW: Custom
+ *
+ * Describes a memory map in place. Descriptors are DescriptorSize bytes apart,
+ * which may exceed sizeof(EFI_MEMORY_DESCRIPTOR), so they must never be indexed
+ * as a plain array. None of the view functions allocate, which keeps them usable
+ * after ExitBootServices.
+ */
+typedef struct {
+    EFI_MEMORY_DESCRIPTOR   *Map;
+    UINTN                   MapSize;
+    UINTN                   DescriptorSize;
+    UINT32                  DescriptorVersion;
+} EFI_MEMORY_MAP_VIEW;
+
+/**
+ * MemoryMapViewInitialize: Custom
+ *
+ * Returns EFI_INVALID_PARAMETER when DescriptorSize is too small, MapSize is not a
+ * whole number of descriptors, and EFI_UNSUPPORTED for an unknown DescriptorVersion.
+ */
+EFI_STATUS MemoryMapViewInitialize (
+    OUT EFI_MEMORY_MAP_VIEW     *View,
+    IN EFI_MEMORY_DESCRIPTOR    *Map,
+    IN UINTN                    MapSize,
+    IN UINTN                    DescriptorSize,
+    IN UINT32                   DescriptorVersion
+);
+
+/**
+ * MemoryMapViewCount: Custom
+ */
+static inline UINTN MemoryMapViewCount (
+    IN const EFI_MEMORY_MAP_VIEW *View
+) {
+    return View->MapSize / View->DescriptorSize;
+}
+
+/**
+ * MemoryMapViewAt: Custom
+ */
+static inline EFI_MEMORY_DESCRIPTOR *MemoryMapViewAt (
+    IN const EFI_MEMORY_MAP_VIEW    *View,
+    IN UINTN                        Index
+) {
+    return (EFI_MEMORY_DESCRIPTOR *)((UINT8 *)View->Map + Index * View->DescriptorSize);
+}
+
+/**
+ * MemoryMapSort: Custom
+ *
+ * Sorts the descriptors by PhysicalStart in place. Maps that are already sorted,
+ * as firmware maps usually are, cost a single pass.
+ */
+VOID MemoryMapSort (
+    IN OUT EFI_MEMORY_MAP_VIEW *View
+);
+
+/**
+ * MemoryMapCoalesce: Custom
+ *
+ * Merges physically adjacent descriptors of the same Type and Attribute and
+ * shrinks View->MapSize to match. The view must be sorted. Returns the new
+ * descriptor count.
+ */
+UINTN MemoryMapCoalesce (
+    IN OUT EFI_MEMORY_MAP_VIEW *View
+);
+
+/**
+ * MemoryMapTotalPages: Custom
+ *
+ * Fills Pages[Type] with the number of pages of each memory type. Descriptors of
+ * types at or above EfiMaxMemoryType are not counted.
+ */
+VOID MemoryMapTotalPages (
+    IN const EFI_MEMORY_MAP_VIEW    *View,
+    OUT UINT64                      Pages[EfiMaxMemoryType]
+);
+
+/**
+ * MemoryMapLargestFreeBlock: Custom
+ *
+ * Finds the largest run of EfiConventionalMemory that lies at or below
+ * MaxAddress, clipping ranges that cross it. Adjacent free descriptors count as
+ * one run only after MemoryMapCoalesce. Returns EFI_NOT_FOUND if there is none.
+ */
+EFI_STATUS MemoryMapLargestFreeBlock (
+    IN const EFI_MEMORY_MAP_VIEW    *View,
+    IN EFI_PHYSICAL_ADDRESS         MaxAddress,
+    OUT EFI_PHYSICAL_ADDRESS        *Start,
+    OUT UINT64                      *Pages
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+/**
+ * EFI_MEMORY_MAP_ITERATOR: Custom
+ *
+ * Stride-aware iterator, so that a view can be walked with a range-based for
+ */
+class EFI_MEMORY_MAP_ITERATOR {
+public:
+    EFI_MEMORY_MAP_ITERATOR (
+        IN UINT8    *Position,
+        IN UINTN    Stride
+    ) : mPosition(Position), mStride(Stride) {}
+
+    EFI_MEMORY_DESCRIPTOR &operator* () const {
+        return *(EFI_MEMORY_DESCRIPTOR *)mPosition;
+    }
+
+    EFI_MEMORY_DESCRIPTOR *operator-> () const {
+        return (EFI_MEMORY_DESCRIPTOR *)mPosition;
+    }
+
+    EFI_MEMORY_MAP_ITERATOR &operator++ () {
+        mPosition += mStride;
+        return *this;
+    }
+
+    bool operator== (const EFI_MEMORY_MAP_ITERATOR &Other) const {
+        return mPosition == Other.mPosition;
+    }
+
+    bool operator!= (const EFI_MEMORY_MAP_ITERATOR &Other) const {
+        return mPosition != Other.mPosition;
+    }
+
+private:
+    UINT8   *mPosition;
+    UINTN   mStride;
+};
+
+inline EFI_MEMORY_MAP_ITERATOR begin (
+    IN const EFI_MEMORY_MAP_VIEW &View
+) {
+    return EFI_MEMORY_MAP_ITERATOR((UINT8 *)View.Map, View.DescriptorSize);
+}
+
+inline EFI_MEMORY_MAP_ITERATOR end (
+    IN const EFI_MEMORY_MAP_VIEW &View
+) {
+    return EFI_MEMORY_MAP_ITERATOR((UINT8 *)View.Map + MemoryMapViewCount(&View) * View.DescriptorSize, View.DescriptorSize);
+}
+#endif
@@ -0,0 +1,229 @@
+#pragma once
+/**
+ * PE/COFF Image Library: Custom
+ *
+ * UEFI images are PE32+ files, UEFI Specification 2.10 Section 2.1.1. The library
+ * checks an image file, lays it out at its section addresses and rebases it. The
+ * headers of a file buffer are unaligned in general, so they are only read
+ * through copies.
+ */
+
+#include "efi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * PE/COFF Signatures: Custom
+ */
+#define EFI_IMAGE_DOS_SIGNATURE             0x5A4D      // "MZ"
+#define EFI_IMAGE_NT_SIGNATURE              0x00004550  // "PE\0\0"
+#define EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC   0x010B
+#define EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC   0x020B
+
+/**
+ * PE32+ Machine Types: UEFI Specification 2.10 Section 2.1.1
+ */
+#define EFI_IMAGE_MACHINE_IA32          0x014C
+#define EFI_IMAGE_MACHINE_X64           0x8664
+#define EFI_IMAGE_MACHINE_ARM           0x01C2
+#define EFI_IMAGE_MACHINE_AARCH64       0xAA64
+#define EFI_IMAGE_MACHINE_RISCV64       0x5064
+#define EFI_IMAGE_MACHINE_LOONGARCH64   0x6264
+
+/**
+ * PE32+ Subsystem Types: UEFI Specification 2.10 Section 2.1.1
+ */
+#define EFI_IMAGE_SUBSYSTEM_EFI_APPLICATION         10
+#define EFI_IMAGE_SUBSYSTEM_EFI_BOOT_SERVICE_DRIVER 11
+#define EFI_IMAGE_SUBSYSTEM_EFI_RUNTIME_DRIVER      12
+
+/**
+ * EFI_IMAGE_FILE_HEADER Characteristics: Custom
+ */
+#define EFI_IMAGE_FILE_RELOCS_STRIPPED  0x0001
+
+/**
+ * EFI_IMAGE_OPTIONAL_HEADER64 Data Directories: Custom
+ */
+#define EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC         5
+#define EFI_IMAGE_NUMBER_OF_DIRECTORY_ENTRIES       16
+
+/**
+ * Base Relocation Types: Custom
+ */
+#define EFI_IMAGE_REL_BASED_ABSOLUTE    0
+#define EFI_IMAGE_REL_BASED_HIGH        1
+#define EFI_IMAGE_REL_BASED_LOW         2
+#define EFI_IMAGE_REL_BASED_HIGHLOW     3
+#define EFI_IMAGE_REL_BASED_DIR64       10
+
+/**
+ * EFI_IMAGE_DOS_HEADER: Custom
+ */
+typedef struct {
+    UINT16  Magic;
+    UINT16  Reserved[29];
+    UINT32  NewHeaderOffset;    // File offset of EFI_IMAGE_NT_HEADERS64
+} EFI_IMAGE_DOS_HEADER;
+
+/**
+ * EFI_IMAGE_FILE_HEADER: Custom
+ */
+typedef struct {
+    UINT16  Machine;
+    UINT16  NumberOfSections;
+    UINT32  TimeDateStamp;
+    UINT32  PointerToSymbolTable;
+    UINT32  NumberOfSymbols;
+    UINT16  SizeOfOptionalHeader;
+    UINT16  Characteristics;
+} EFI_IMAGE_FILE_HEADER;
+
+/**
+ * EFI_IMAGE_DATA_DIRECTORY: Custom
+ */
+typedef struct {
+    UINT32  VirtualAddress;
+    UINT32  Size;
+} EFI_IMAGE_DATA_DIRECTORY;
+
+/**
+ * EFI_IMAGE_OPTIONAL_HEADER64: Custom
+ */
+typedef struct {
+    UINT16                      Magic;
+    UINT8                       MajorLinkerVersion;
+    UINT8                       MinorLinkerVersion;
+    UINT32                      SizeOfCode;
+    UINT32                      SizeOfInitializedData;
+    UINT32                      SizeOfUninitializedData;
+    UINT32                      AddressOfEntryPoint;
+    UINT32                      BaseOfCode;
+    UINT64                      ImageBase;
+    UINT32                      SectionAlignment;
+    UINT32                      FileAlignment;
+    UINT16                      MajorOperatingSystemVersion;
+    UINT16                      MinorOperatingSystemVersion;
+    UINT16                      MajorImageVersion;
+    UINT16                      MinorImageVersion;
+    UINT16                      MajorSubsystemVersion;
+    UINT16                      MinorSubsystemVersion;
+    UINT32                      Win32VersionValue;
+    UINT32                      SizeOfImage;
+    UINT32                      SizeOfHeaders;
+    UINT32                      CheckSum;
+    UINT16                      Subsystem;
+    UINT16                      DllCharacteristics;
+    UINT64                      SizeOfStackReserve;
+    UINT64                      SizeOfStackCommit;
+    UINT64                      SizeOfHeapReserve;
+    UINT64                      SizeOfHeapCommit;
+    UINT32                      LoaderFlags;
+    UINT32                      NumberOfRvaAndSizes;
+    EFI_IMAGE_DATA_DIRECTORY    DataDirectory[EFI_IMAGE_NUMBER_OF_DIRECTORY_ENTRIES];
+} EFI_IMAGE_OPTIONAL_HEADER64;
+
+/**
+ * EFI_IMAGE_NT_HEADERS64: Custom
+ */
+typedef struct {
+    UINT32                      Signature;
+    EFI_IMAGE_FILE_HEADER       FileHeader;
+    EFI_IMAGE_OPTIONAL_HEADER64 OptionalHeader;
+} EFI_IMAGE_NT_HEADERS64;
+
+/**
+ * EFI_IMAGE_SECTION_HEADER: Custom
+ */
+typedef struct {
+    UINT8   Name[8];
+    UINT32  VirtualSize;
+    UINT32  VirtualAddress;
+    UINT32  SizeOfRawData;
+    UINT32  PointerToRawData;
+    UINT32  PointerToRelocations;
+    UINT32  PointerToLinenumbers;
+    UINT16  NumberOfRelocations;
+    UINT16  NumberOfLinenumbers;
+    UINT32  Characteristics;
+} EFI_IMAGE_SECTION_HEADER;
+
+/**
+ * EFI_IMAGE_BASE_RELOCATION: Custom
+ *
+ * Followed by (SizeOfBlock - 8) / 2 UINT16 entries, each a type in the top four
+ * bits and an offset from VirtualAddress in the low twelve.
+ */
+typedef struct {
+    UINT32  VirtualAddress;
+    UINT32  SizeOfBlock;
+} EFI_IMAGE_BASE_RELOCATION;
+
+/**
+ * EFI_PE_COFF_IMAGE_INFO: Custom
+ */
+typedef struct {
+    UINT16                      Machine;
+    UINT16                      Subsystem;
+    UINT16                      Characteristics;
+    UINT16                      NumberOfSections;
+    UINT32                      HeaderOffset;           // File offset of EFI_IMAGE_NT_HEADERS64
+    UINT32                      SectionTableOffset;     // File offset of the section headers
+    UINT32                      SizeOfHeaders;
+    UINT32                      SizeOfImage;
+    UINT32                      SectionAlignment;
+    UINT32                      AddressOfEntryPoint;
+    UINT64                      ImageBase;              // Preferred load address
+    EFI_IMAGE_DATA_DIRECTORY    Relocations;            // Zero when the image has none
+} EFI_PE_COFF_IMAGE_INFO;
+
+/**
+ * PeCoffGetImageInfo: Custom
+ *
+ * Checks that the SourceSize bytes at Source are a PE32+ image whose headers,
+ * sections, entry point and relocation directory all lie within the file and
+ * within SizeOfImage, with sections in ascending, non-overlapping order, and
+ * describes it in Info. Returns EFI_UNSUPPORTED for a well-formed PE32 image and
+ * EFI_LOAD_ERROR for anything malformed.
+ */
+EFI_STATUS PeCoffGetImageInfo (
+    IN const VOID               *Source,
+    IN UINTN                    SourceSize,
+    OUT EFI_PE_COFF_IMAGE_INFO  *Info
+);
+
+/**
+ * PeCoffLoadImage: Custom
+ *
+ * Lays out the image Info describes at Image, SizeOfImage bytes: the headers and
+ * each section's raw data are copied and every other byte is zeroed, each byte
+ * being written once. Source must be the buffer PeCoffGetImageInfo accepted.
+ */
+VOID PeCoffLoadImage (
+    IN const VOID                   *Source,
+    IN const EFI_PE_COFF_IMAGE_INFO *Info,
+    OUT VOID                        *Image
+);
+
+/**
+ * PeCoffRelocateImage: Custom
+ *
+ * Applies the base relocations of the image laid out at Image so that it runs at
+ * NewBase, and records NewBase as the ImageBase of its headers. Nothing is done
+ * when NewBase is the preferred base. *FixupCount, when given, receives the number
+ * of fixups written. Returns EFI_LOAD_ERROR for a relocation outside the image or
+ * an image without relocations that must move, and EFI_UNSUPPORTED for a
+ * relocation type other than ABSOLUTE, HIGH, LOW, HIGHLOW or DIR64.
+ */
+EFI_STATUS PeCoffRelocateImage (
+    IN OUT VOID                     *Image,
+    IN const EFI_PE_COFF_IMAGE_INFO *Info,
+    IN UINT64                       NewBase,
+    OUT UINTN                       *FixupCount OPTIONAL
+);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,99 @@
+#pragma once
+/**
+ * CHAR16 String Library: Custom
+ */
+
+#include "efi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * UTF Conversion Flags: Custom
+ */
+#define UTF_REPLACE_INVALID 0x00000001  // Emit U+FFFD instead of failing on malformed input
+
+/**
+ * StrLen: Custom
+ *
+ * Returns the number of CHAR16 code units before the terminator.
+ */
+UINTN StrLen (
+    IN const CHAR16 *String
+);
+
+/**
+ * StrSize: Custom
+ *
+ * Returns the size in bytes of String including its terminator.
+ */
+UINTN StrSize (
+    IN const CHAR16 *String
+);
+
+/**
+ * StrCmp: Custom
+ *
+ * Returns the difference of the first code units that differ, or 0 when the
+ * strings are equal.
+ */
+INTN StrCmp (
+    IN const CHAR16 *First,
+    IN const CHAR16 *Second
+);
+
+/**
+ * StriCmp: Custom
+ *
+ * StrCmp on the strings as CharToUpper folds them.
+ */
+INTN StriCmp (
+    IN const CHAR16 *First,
+    IN const CHAR16 *Second
+);
+
+/**
+ * CharToUpper: Custom
+ *
+ * Folds the ASCII and Latin-1 letters to upper case, which is how FAT compares
+ * names. Other code units are returned unchanged.
+ */
+CHAR16 CharToUpper (
+    IN CHAR16 Char
+);
+
+/**
+ * Char16ToUtf8: Custom
+ *
+ * Converts Length code units of String to UTF-8, pairing surrogates. No terminator
+ * is written. On return *Utf8Length holds the number of bytes the conversion needs,
+ * and EFI_BUFFER_TOO_SMALL is returned when that exceeds the input *Utf8Length.
+ */
+EFI_STATUS Char16ToUtf8 (
+    IN const CHAR16 *String,
+    IN UINTN        Length,
+    OUT CHAR8       *Utf8 OPTIONAL,
+    IN OUT UINTN    *Utf8Length,
+    IN UINT32       Flags
+);
+
+/**
+ * Utf8ToChar16: Custom
+ *
+ * Converts Length bytes of Utf8 to CHAR16 code units, producing surrogate pairs
+ * for supplementary code points. No terminator is written. On return *StringLength
+ * holds the number of code units the conversion needs, and EFI_BUFFER_TOO_SMALL is
+ * returned when that exceeds the input *StringLength.
+ */
+EFI_STATUS Utf8ToChar16 (
+    IN const CHAR8  *Utf8,
+    IN UINTN        Length,
+    OUT CHAR16      *String OPTIONAL,
+    IN OUT UINTN    *StringLength,
+    IN UINT32       Flags
+);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,209 @@
+#include "internal.h"
+
+#include <set>
+
+/**
+ * Number of block orders; order N holds free blocks of 2^N pages
+ */
+#define HOST_BUDDY_ORDERS 40
+
+/**
+ * Free blocks are tracked as page offsets from the arena base in one ordered set
+ * per order, which makes "highest free block below a ceiling" a single search.
+ */
+static std::set<UINT64>     mFreeBlocks[HOST_BUDDY_ORDERS];
+static EFI_PHYSICAL_ADDRESS mBuddyBase;
+static UINT64               mBuddyPages;
+
+static UINT32 HostBuddyOrderFor (
+    IN UINT64 Pages
+) {
+    UINT32 Order = 0;
+    while (((UINT64)1 << Order) < Pages) {
+        Order++;
+    }
+    return Order;
+}
+
+/**
+ * Returns a block to its free set, merging it with its buddy for as long as the
+ * buddy is free too
+ */
+static VOID HostBuddyFreeBlock (
+    IN UINT64 Offset,
+    IN UINT32 Order
+) {
+    while (Order + 1 < HOST_BUDDY_ORDERS) {
+        UINT64 Buddy = Offset ^ ((UINT64)1 << Order);
+        std::set<UINT64>::iterator It = mFreeBlocks[Order].find(Buddy);
+        if (It == mFreeBlocks[Order].end()) {
+            break;
+        }
+        mFreeBlocks[Order].erase(It);
+        Offset &= ~((UINT64)1 << Order);
+        Order++;
+    }
+    mFreeBlocks[Order].insert(Offset);
+}
+
+/**
+ * Frees [Offset, Offset + Pages) as the largest aligned blocks that tile it
+ */
+static VOID HostBuddyFreeOffsets (
+    IN UINT64 Offset,
+    IN UINT64 Pages
+) {
+    UINT64 End = Offset + Pages;
+    while (Offset < End) {
+        UINT32 Order = Offset == 0 ? HOST_BUDDY_ORDERS - 1 : (UINT32)__builtin_ctzll(Offset);
+        if (Order >= HOST_BUDDY_ORDERS) {
+            Order = HOST_BUDDY_ORDERS - 1;
+        }
+        while (Offset + ((UINT64)1 << Order) > End) {
+            Order--;
+        }
+        HostBuddyFreeBlock(Offset, Order);
+        Offset += (UINT64)1 << Order;
+    }
+}
+
+/**
+ * Takes the free block at (Offset, Order) and gives back everything outside [Start, End)
+ */
+static VOID HostBuddyCarve (
+    IN UINT64 Offset,
+    IN UINT32 Order,
+    IN UINT64 Start,
+    IN UINT64 End
+) {
+    UINT64 BlockEnd = Offset + ((UINT64)1 << Order);
+    mFreeBlocks[Order].erase(Offset);
+    if (Start > Offset) {
+        HostBuddyFreeOffsets(Offset, Start - Offset);
+    }
+    if (End < BlockEnd) {
+        HostBuddyFreeOffsets(End, BlockEnd - End);
+    }
+}
+
+VOID HostBuddyInitialize (
+    IN EFI_PHYSICAL_ADDRESS Base,
+    IN UINT64               Pages
+) {
+    for (std::set<UINT64> &Blocks : mFreeBlocks) {
+        Blocks.clear();
+    }
+    mBuddyBase = Base;
+    mBuddyPages = Pages;
+    HostBuddyFreeOffsets(0, Pages);
+}
+
+VOID HostBuddyShutdown (
+    VOID
+) {
+    for (std::set<UINT64> &Blocks : mFreeBlocks) {
+        Blocks.clear();
+    }
+    mBuddyBase = 0;
+    mBuddyPages = 0;
+}
+
+BOOLEAN HostBuddyAllocate (
+    IN UINT64                   Pages,
+    IN EFI_PHYSICAL_ADDRESS     Ceiling,
+    OUT EFI_PHYSICAL_ADDRESS    *Memory
+) {
+    if (Pages == 0 || Pages > mBuddyPages || Ceiling < mBuddyBase) {
+        return FALSE;
+    }
+
+    //
+    // Highest page offset the allocation may end at, exclusive
+    //
+    UINT64 Limit = mBuddyPages;
+    if (Ceiling - mBuddyBase < EFI_PAGES_TO_SIZE(mBuddyPages)) {
+        Limit = (Ceiling - mBuddyBase + 1) >> EFI_PAGE_SHIFT;
+    }
+    if (Limit < Pages) {
+        return FALSE;
+    }
+
+    //
+    // Best fit: the smallest order holding a block that can end at or below the
+    // limit, taking the highest such block so allocations grow down from the top
+    //
+    for (UINT32 Order = HostBuddyOrderFor(Pages); Order < HOST_BUDDY_ORDERS; Order++) {
+        std::set<UINT64> &Blocks = mFreeBlocks[Order];
+        std::set<UINT64>::iterator It = Blocks.upper_bound(Limit - Pages);
+        if (It == Blocks.begin()) {
+            continue;
+        }
+        --It;
+
+        UINT64 Offset = *It;
+        UINT64 End = Offset + ((UINT64)1 << Order);
+        if (End > Limit) {
+            End = Limit;
+        }
+        HostBuddyCarve(Offset, Order, End - Pages, End);
+        *Memory = mBuddyBase + EFI_PAGES_TO_SIZE(End - Pages);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * Finds the free block holding page Offset, which is unique since blocks are
+ * aligned to their size. Returns FALSE when the page is not free.
+ */
+static BOOLEAN HostBuddyFindBlock (
+    IN UINT64   Offset,
+    OUT UINT64  *Block,
+    OUT UINT32  *Order
+) {
+    for (UINT32 Candidate = 0; Candidate < HOST_BUDDY_ORDERS; Candidate++) {
+        UINT64 Start = Offset & ~(((UINT64)1 << Candidate) - 1);
+        if (mFreeBlocks[Candidate].count(Start) != 0) {
+            *Block = Start;
+            *Order = Candidate;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+BOOLEAN HostBuddyReserve (
+    IN EFI_PHYSICAL_ADDRESS Memory,
+    IN UINT64               Pages
+) {
+    if (Memory < mBuddyBase || Pages == 0 || Pages > mBuddyPages || (Memory - mBuddyBase) >> EFI_PAGE_SHIFT > mBuddyPages - Pages) {
+        return FALSE;
+    }
+    UINT64 Start = (Memory - mBuddyBase) >> EFI_PAGE_SHIFT;
+    UINT64 End = Start + Pages;
+
+    //
+    // Check that every page is free before taking any, so that a failure leaves
+    // the index as it was
+    //
+    UINT64 Offset;
+    UINT32 Order;
+    for (UINT64 Cursor = Start; Cursor < End; Cursor = Offset + ((UINT64)1 << Order)) {
+        if (!HostBuddyFindBlock(Cursor, &Offset, &Order)) {
+            return FALSE;
+        }
+    }
+    for (UINT64 Cursor = Start; Cursor < End; Cursor = Offset + ((UINT64)1 << Order)) {
+        HostBuddyFindBlock(Cursor, &Offset, &Order);
+        UINT64 BlockEnd = Offset + ((UINT64)1 << Order);
+        HostBuddyCarve(Offset, Order, Cursor, BlockEnd < End ? BlockEnd : End);
+    }
+    return TRUE;
+}
+
+VOID HostBuddyFree (
+    IN EFI_PHYSICAL_ADDRESS Memory,
+    IN UINT64               Pages
+) {
+    HostBuddyFreeOffsets((Memory - mBuddyBase) >> EFI_PAGE_SHIFT, Pages);
+}
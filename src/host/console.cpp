@@ -0,0 +1,922 @@
+#include "internal.h"
+
+#include <efi/string.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <string>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Text modes: 0 is the 80x25 mode every console supports and 1 the optional 80x50
+ */
+#define HOST_CONSOLE_MODES 2
+
+static const UINT32 mConsoleModes[HOST_CONSOLE_MODES][2] = { { 80, 25 }, { 80, 50 } };
+
+/**
+ * Least time between flushes driven by output alone, in 100ns units of the host's
+ * monotonic clock whatever VirtualClock says, since it bounds how late output
+ * reaches the terminal. Output held back is sent when the interval has passed at
+ * the next protocol call or TPL restore, and waiting for input or time flushes at
+ * once, so a screen drawn between two waits reaches the terminal as one frame.
+ */
+#define HOST_CONSOLE_FRAME_INTERVAL 166666
+
+/**
+ * Unchanged cells, in the terminal's current attribute, that a flush rewrites
+ * rather than jumping over them with a cursor sequence of about the same size
+ */
+#define HOST_CONSOLE_MAXIMUM_GAP 4
+
+/**
+ * A cell is its code point in the low 21 bits, so that a surrogate pair fills one
+ * cell, and its attribute above them
+ */
+#define HOST_CONSOLE_CELL(Char, Attribute)  ((UINT32)(Char) | ((UINT32)(Attribute) << 21))
+#define HOST_CONSOLE_CELL_CHAR(Cell)        ((UINT32)((Cell) & 0x1FFFFF))
+#define HOST_CONSOLE_CELL_ATTRIBUTE(Cell)   ((UINT8)((Cell) >> 21))
+#define HOST_CONSOLE_CELL_UNKNOWN           0xFFFFFFFF
+
+/**
+ * On a terminal, output goes to Shadow and reaches the descriptor only when
+ * flushed: the cells that differ from Screen, the last picture sent, are written
+ * in one batch. Terminal* is where the terminal's cursor and attribute were left,
+ * -1 when unknown. Any other descriptor, such as a pipe or a log file, gets the
+ * text alone as UTF-8 as it is output, with no control sequences.
+ */
+typedef struct {
+    EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL Protocol;
+    EFI_SIMPLE_TEXT_OUTPUT_MODE     Mode;
+    INT32                           Fd;
+    BOOLEAN                         Terminal;       // Fd is a terminal drawn from Shadow
+    CHAR16                          HighSurrogate;  // Last code unit output when it was a high surrogate, else 0
+    UINTN                           Columns;
+    UINTN                           Rows;
+    std::vector<UINT32>             Shadow;
+    std::vector<UINT32>             Screen;
+    BOOLEAN                         Painted;        // The terminal has been cleared and is tracked by Screen
+    BOOLEAN                         Dirty;
+    UINTN                           PendingScroll;  // Lines Shadow scrolled up since the last flush
+    INT32                           TerminalRow;
+    INT32                           TerminalColumn;
+    INT32                           TerminalAttribute;
+    BOOLEAN                         TerminalCursorVisible;
+    UINT64                          NextFlush;      // When output alone may flush again
+    std::string                     Output;
+} HOST_CONSOLE_OUT;
+
+typedef struct {
+    EFI_SIMPLE_TEXT_INPUT_PROTOCOL  Protocol;
+    INT32                           Fd;
+    std::string                     Pending;
+} HOST_CONSOLE_IN;
+
+static HOST_CONSOLE_IN  mConsoleIn;
+static HOST_CONSOLE_OUT mConsoleOut;
+static HOST_CONSOLE_OUT mStandardError;
+
+static UINT64 HostConsoleNow (
+    VOID
+) {
+    struct timespec Now;
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    return (UINT64)Now.tv_sec * 10000000 + (UINT64)Now.tv_nsec / 100;
+}
+
+static VOID HostConsoleWrite (
+    IN INT32        Fd,
+    IN const CHAR8  *Buffer,
+    IN UINTN        Length
+) {
+    if (Fd < 0) {
+        return;
+    }
+    while (Length != 0) {
+        ssize_t Written = write(Fd, Buffer, Length);
+        if (Written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        Buffer += Written;
+        Length -= (UINTN)Written;
+    }
+}
+
+static VOID HostConsoleAppendAttribute (
+    IN OUT HOST_CONSOLE_OUT *Console,
+    IN UINT8                Attribute
+) {
+    //
+    // EFI colors are in IRGB order, ANSI colors in BGR order
+    //
+    static const UINT8 AnsiColor[8] = { 0, 4, 2, 6, 1, 5, 3, 7 };
+
+    if (Console->TerminalAttribute == Attribute) {
+        return;
+    }
+    UINTN Foreground = Attribute & 0x0F;
+    UINTN Background = (Attribute >> 4) & 0x07;
+    CHAR8 Sequence[32];
+    INT32 Length = snprintf(Sequence, sizeof(Sequence), "\x1b[0;%u;%u%sm",
+        30 + AnsiColor[Foreground & 0x07], 40 + AnsiColor[Background], (Foreground & EFI_BRIGHT) != 0 ? ";1" : "");
+    Console->Output.append(Sequence, (UINTN)Length);
+    Console->TerminalAttribute = Attribute;
+}
+
+static VOID HostConsoleAppendMove (
+    IN OUT HOST_CONSOLE_OUT *Console,
+    IN UINTN                Row,
+    IN UINTN                Column
+) {
+    if (Console->TerminalRow == (INT32)Row && Console->TerminalColumn == (INT32)Column) {
+        return;
+    }
+    CHAR8 Sequence[32];
+    INT32 Length = snprintf(Sequence, sizeof(Sequence), "\x1b[%u;%uH", (UINT32)Row + 1, (UINT32)Column + 1);
+    Console->Output.append(Sequence, (UINTN)Length);
+    Console->TerminalRow = (INT32)Row;
+    Console->TerminalColumn = (INT32)Column;
+}
+
+/**
+ * Appends the code point Char, which is not a surrogate, to Output as UTF-8
+ */
+static VOID HostConsoleAppendUtf8 (
+    IN OUT std::string  &Output,
+    IN UINT32           Char
+) {
+    if (Char < 0x80) {
+        Output.push_back((CHAR8)Char);
+    } else if (Char < 0x800) {
+        Output.push_back((CHAR8)(0xC0 | (Char >> 6)));
+        Output.push_back((CHAR8)(0x80 | (Char & 0x3F)));
+    } else if (Char < 0x10000) {
+        Output.push_back((CHAR8)(0xE0 | (Char >> 12)));
+        Output.push_back((CHAR8)(0x80 | ((Char >> 6) & 0x3F)));
+        Output.push_back((CHAR8)(0x80 | (Char & 0x3F)));
+    } else {
+        Output.push_back((CHAR8)(0xF0 | (Char >> 18)));
+        Output.push_back((CHAR8)(0x80 | ((Char >> 12) & 0x3F)));
+        Output.push_back((CHAR8)(0x80 | ((Char >> 6) & 0x3F)));
+        Output.push_back((CHAR8)(0x80 | (Char & 0x3F)));
+    }
+}
+
+/**
+ * Writes the character of Cell at the terminal cursor as UTF-8, showing controls
+ * as spaces
+ */
+static VOID HostConsoleAppendCell (
+    IN OUT HOST_CONSOLE_OUT *Console,
+    IN UINT32               Cell
+) {
+    UINT32 Char = HOST_CONSOLE_CELL_CHAR(Cell);
+    if (Char < 0x20 || Char == 0x7F) {
+        Char = ' ';
+    }
+    HostConsoleAppendUtf8(Console->Output, Char);
+
+    //
+    // Terminals defer the wrap after the last column, and most draw characters
+    // beyond the BMP two columns wide, so in either case the cursor is then unknown
+    //
+    if (Console->TerminalColumn >= 0 && ((UINTN)++Console->TerminalColumn == Console->Columns || Char >= 0x10000)) {
+        Console->TerminalColumn = -1;
+    }
+}
+
+/**
+ * Replays the scrolling of Shadow on the terminal, so that text moving up the
+ * screen costs its new lines rather than a repaint
+ */
+static VOID HostConsoleFlushScroll (
+    IN OUT HOST_CONSOLE_OUT *Console
+) {
+    UINTN Scroll = Console->PendingScroll;
+    Console->PendingScroll = 0;
+    UINTN Cells = Console->Columns * Console->Rows;
+    if (Scroll >= Console->Rows) {
+        Console->Screen.assign(Cells, HOST_CONSOLE_CELL_UNKNOWN);
+        return;
+    }
+
+    //
+    // The new lines take the background of the terminal's attribute
+    //
+    HostConsoleAppendAttribute(Console, HOST_CONSOLE_CELL_ATTRIBUTE(Console->Shadow[Cells - 1]));
+    HostConsoleAppendMove(Console, Console->Rows - 1, 0);
+    Console->Output.append(Scroll, '\n');
+    Console->TerminalColumn = -1;
+
+    UINTN Moved = Scroll * Console->Columns;
+    memmove(Console->Screen.data(), Console->Screen.data() + Moved, (Cells - Moved) * sizeof(UINT32));
+    std::fill(Console->Screen.end() - (INTN)Moved, Console->Screen.end(), HOST_CONSOLE_CELL(' ', Console->TerminalAttribute));
+}
+
+/**
+ * Clears the terminal first when that leaves fewer cells to write than the
+ * changes alone, as after ClearScreen followed by a sparse redraw
+ */
+static VOID HostConsoleFlushClear (
+    IN OUT HOST_CONSOLE_OUT *Console
+) {
+    UINTN Cells = Console->Columns * Console->Rows;
+    UINT32 Blank = HOST_CONSOLE_CELL(' ', HOST_CONSOLE_CELL_ATTRIBUTE(Console->Shadow[Cells - 1]));
+    UINTN Changed = 0;
+    UINTN NotBlank = 0;
+    for (UINTN Index = 0; Index < Cells; Index++) {
+        Changed += Console->Shadow[Index] != Console->Screen[Index];
+        NotBlank += Console->Shadow[Index] != Blank;
+    }
+    if (NotBlank + 8 >= Changed) {
+        return;
+    }
+    HostConsoleAppendAttribute(Console, HOST_CONSOLE_CELL_ATTRIBUTE(Blank));
+    Console->Output.append("\x1b[2J");
+    Console->Screen.assign(Cells, Blank);
+}
+
+/**
+ * Sends the difference between Shadow and Screen to the descriptor in one write
+ */
+static VOID HostConsoleFlushOne (
+    IN OUT HOST_CONSOLE_OUT *Console
+) {
+    if (!Console->Dirty) {
+        return;
+    }
+    Console->Dirty = FALSE;
+    Console->NextFlush = HostConsoleNow() + HOST_CONSOLE_FRAME_INTERVAL;
+    if (!Console->Terminal) {
+        Console->Screen = Console->Shadow;
+        Console->PendingScroll = 0;
+        return;
+    }
+
+    std::string &Output = Console->Output;
+    Output.clear();
+    if (!Console->Painted) {
+        //
+        // Take over the screen: scrolling is confined to the console's rows, and
+        // nothing the terminal showed before is known
+        //
+        CHAR8 Sequence[32];
+        INT32 Length = snprintf(Sequence, sizeof(Sequence), "\x1b[1;%ur", (UINT32)Console->Rows);
+        Output.append(Sequence, (UINTN)Length);
+        Console->Screen.assign(Console->Columns * Console->Rows, HOST_CONSOLE_CELL_UNKNOWN);
+        Console->TerminalRow = -1;
+        Console->TerminalColumn = -1;
+        Console->TerminalAttribute = -1;
+        Console->TerminalCursorVisible = !Console->Mode.CursorVisible;
+        Console->PendingScroll = 0;
+        Console->Painted = TRUE;
+    } else if (Console->PendingScroll != 0) {
+        HostConsoleFlushScroll(Console);
+    }
+    HostConsoleFlushClear(Console);
+
+    const UINT32 *Shadow = Console->Shadow.data();
+    UINT32 *Screen = Console->Screen.data();
+    for (UINTN Row = 0; Row < Console->Rows; Row++) {
+        UINTN First = Row * Console->Columns;
+        if (memcmp(Shadow + First, Screen + First, Console->Columns * sizeof(UINT32)) == 0) {
+            continue;
+        }
+        for (UINTN Column = 0; Column < Console->Columns; Column++) {
+            UINTN Index = First + Column;
+            if (Shadow[Index] == Screen[Index]) {
+                continue;
+            }
+
+            //
+            // Bridge a short gap on the same row by rewriting it, when that needs no
+            // change of attribute
+            //
+            if (Console->TerminalRow == (INT32)Row && Console->TerminalColumn >= 0 && (UINTN)Console->TerminalColumn < Column &&
+                Column - (UINTN)Console->TerminalColumn <= HOST_CONSOLE_MAXIMUM_GAP) {
+                UINTN Gap = First + (UINTN)Console->TerminalColumn;
+                BOOLEAN Plain = TRUE;
+                for (UINTN Skipped = Gap; Skipped < Index && Plain; Skipped++) {
+                    Plain = HOST_CONSOLE_CELL_ATTRIBUTE(Shadow[Skipped]) == Console->TerminalAttribute && HOST_CONSOLE_CELL_CHAR(Shadow[Skipped]) < 0x80;
+                }
+                for (UINTN Skipped = Gap; Skipped < Index && Plain; Skipped++) {
+                    HostConsoleAppendCell(Console, Shadow[Skipped]);
+                }
+            }
+            HostConsoleAppendMove(Console, Row, Column);
+            HostConsoleAppendAttribute(Console, HOST_CONSOLE_CELL_ATTRIBUTE(Shadow[Index]));
+            HostConsoleAppendCell(Console, Shadow[Index]);
+            Screen[Index] = Shadow[Index];
+        }
+    }
+
+    if (Console->Mode.CursorVisible) {
+        HostConsoleAppendMove(Console, (UINTN)Console->Mode.CursorRow, (UINTN)Console->Mode.CursorColumn);
+    }
+    if (Console->TerminalCursorVisible != Console->Mode.CursorVisible) {
+        Output.append(Console->Mode.CursorVisible ? "\x1b[?25h" : "\x1b[?25l");
+        Console->TerminalCursorVisible = Console->Mode.CursorVisible;
+    }
+    HostConsoleWrite(Console->Fd, Output.data(), Output.size());
+}
+
+/**
+ * Marks Console changed and flushes it if a frame interval has passed since the
+ * last flush
+ */
+static VOID HostConsoleUpdate (
+    IN OUT HOST_CONSOLE_OUT *Console
+) {
+    Console->Dirty = TRUE;
+    if (HostConsoleNow() >= Console->NextFlush) {
+        HostConsoleFlushOne(Console);
+    }
+}
+
+/**
+ * Marks Console changed and holds the flush for a frame interval, for a blank
+ * screen that the next calls will most likely redraw
+ */
+static VOID HostConsoleUpdateLater (
+    IN OUT HOST_CONSOLE_OUT *Console
+) {
+    Console->Dirty = TRUE;
+    Console->NextFlush = HostConsoleNow() + HOST_CONSOLE_FRAME_INTERVAL;
+}
+
+VOID HostConsoleFlush (
+    VOID
+) {
+    HostConsoleFlushOne(&mConsoleOut);
+    HostConsoleFlushOne(&mStandardError);
+}
+
+VOID HostConsoleFlushDue (
+    VOID
+) {
+    if (!mConsoleOut.Dirty && !mStandardError.Dirty) {
+        return;
+    }
+    UINT64 Now = HostConsoleNow();
+    if (mConsoleOut.Dirty && Now >= mConsoleOut.NextFlush) {
+        HostConsoleFlushOne(&mConsoleOut);
+    }
+    if (mStandardError.Dirty && Now >= mStandardError.NextFlush) {
+        HostConsoleFlushOne(&mStandardError);
+    }
+}
+
+/**
+ * Moves the cursor to the next line, scrolling the shadow up at the bottom
+ */
+static VOID HostConsoleLineFeed (
+    IN OUT HOST_CONSOLE_OUT *Console
+) {
+    if ((UINTN)Console->Mode.CursorRow < Console->Rows - 1) {
+        Console->Mode.CursorRow++;
+        return;
+    }
+
+    //
+    // The top row leaves the shadow for good. It has reached the terminal when it
+    // matches the row of Screen that the pending scrolls bring to the top, and is
+    // flushed first otherwise, so that text scrolling past is never lost.
+    //
+    UINTN Cells = Console->Columns * Console->Rows;
+    UINTN Shown = Console->PendingScroll * Console->Columns;
+    if (Console->Terminal &&
+        (Shown >= Cells || memcmp(Console->Shadow.data(), Console->Screen.data() + Shown, Console->Columns * sizeof(UINT32)) != 0)) {
+        Console->Dirty = TRUE;
+        HostConsoleFlushOne(Console);
+    }
+    memmove(Console->Shadow.data(), Console->Shadow.data() + Console->Columns, (Cells - Console->Columns) * sizeof(UINT32));
+    std::fill(Console->Shadow.end() - (INTN)Console->Columns, Console->Shadow.end(), HOST_CONSOLE_CELL(' ', Console->Mode.Attribute));
+    if (Console->PendingScroll < Console->Rows) {
+        Console->PendingScroll++;
+    }
+}
+
+/**
+ * Switches Console to the geometry of ModeNumber with a blank screen
+ */
+static VOID HostConsoleSetGeometry (
+    IN OUT HOST_CONSOLE_OUT *Console,
+    IN UINTN                ModeNumber
+) {
+    Console->Columns = mConsoleModes[ModeNumber][0];
+    Console->Rows = mConsoleModes[ModeNumber][1];
+    Console->Shadow.assign(Console->Columns * Console->Rows, HOST_CONSOLE_CELL(' ', Console->Mode.Attribute));
+    Console->Screen.assign(Console->Columns * Console->Rows, HOST_CONSOLE_CELL_UNKNOWN);
+    Console->Mode.Mode = (INT32)ModeNumber;
+    Console->Mode.CursorColumn = 0;
+    Console->Mode.CursorRow = 0;
+    Console->Painted = FALSE;
+    Console->PendingScroll = 0;
+}
+
+/**
+ * Applies the code point Char to the shadow and cursor, and to the text pending
+ * for a descriptor that is not a terminal
+ */
+static VOID HostConsolePutChar (
+    IN OUT HOST_CONSOLE_OUT *Console,
+    IN UINT32               Char
+) {
+    EFI_SIMPLE_TEXT_OUTPUT_MODE *Mode = &Console->Mode;
+    if (!Console->Terminal) {
+        HostConsoleAppendUtf8(Console->Output, Char);
+    }
+    switch (Char) {
+    case CHAR_CARRIAGE_RETURN:
+        Mode->CursorColumn = 0;
+        break;
+    case CHAR_LINEFEED:
+        HostConsoleLineFeed(Console);
+        break;
+    case CHAR_BACKSPACE:
+        if (Mode->CursorColumn > 0) {
+            Mode->CursorColumn--;
+        }
+        break;
+    default:
+        Console->Shadow[(UINTN)Mode->CursorRow * Console->Columns + (UINTN)Mode->CursorColumn] = HOST_CONSOLE_CELL(Char, Mode->Attribute);
+        if ((UINTN)++Mode->CursorColumn == Console->Columns) {
+            Mode->CursorColumn = 0;
+            HostConsoleLineFeed(Console);
+        }
+        break;
+    }
+}
+
+static EFI_STATUS EFI_API HostTextOutputString (
+    IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  *This,
+    IN CHAR16                           *String
+) {
+    HOST_CONSOLE_OUT *Console = (HOST_CONSOLE_OUT *)This;
+    if (Console == NULL || String == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    //
+    // A surrogate pair is one character, even when split across two calls, and an
+    // unpaired surrogate shows as U+FFFD
+    //
+    if (!Console->Terminal) {
+        Console->Output.clear();
+    }
+    for (; *String != CHAR_NULL; String++) {
+        UINT32 Char = *String;
+        if (Console->HighSurrogate != 0) {
+            if (Char >= 0xDC00 && Char <= 0xDFFF) {
+                HostConsolePutChar(Console, 0x10000 + ((UINT32)(Console->HighSurrogate - 0xD800) << 10) + (Char - 0xDC00));
+                Console->HighSurrogate = 0;
+                continue;
+            }
+            HostConsolePutChar(Console, 0xFFFD);
+            Console->HighSurrogate = 0;
+        }
+        if (Char >= 0xD800 && Char <= 0xDBFF) {
+            Console->HighSurrogate = (CHAR16)Char;
+        } else {
+            HostConsolePutChar(Console, Char >= 0xDC00 && Char <= 0xDFFF ? 0xFFFD : Char);
+        }
+    }
+    if (!Console->Terminal) {
+        HostConsoleWrite(Console->Fd, Console->Output.data(), Console->Output.size());
+    }
+    HostConsoleUpdate(Console);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostTextTestString (
+    IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  *This,
+    IN CHAR16                           *String
+) {
+    if (This == NULL || String == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostTextQueryMode (
+    IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  *This,
+    IN UINTN                            ModeNumber,
+    OUT UINTN                           *Columns,
+    OUT UINTN                           *Rows
+) {
+    if (This == NULL || Columns == NULL || Rows == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (ModeNumber >= HOST_CONSOLE_MODES) {
+        return EFI_UNSUPPORTED;
+    }
+    *Columns = mConsoleModes[ModeNumber][0];
+    *Rows = mConsoleModes[ModeNumber][1];
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostTextClearScreen (
+    IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL *This
+) {
+    HOST_CONSOLE_OUT *Console = (HOST_CONSOLE_OUT *)This;
+    if (Console == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    std::fill(Console->Shadow.begin(), Console->Shadow.end(), HOST_CONSOLE_CELL(' ', Console->Mode.Attribute));
+    Console->Mode.CursorColumn = 0;
+    Console->Mode.CursorRow = 0;
+    HostConsoleUpdateLater(Console);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostTextSetMode (
+    IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  *This,
+    IN UINTN                            ModeNumber
+) {
+    HOST_CONSOLE_OUT *Console = (HOST_CONSOLE_OUT *)This;
+    if (Console == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (ModeNumber >= HOST_CONSOLE_MODES) {
+        return EFI_UNSUPPORTED;
+    }
+    HostConsoleSetGeometry(Console, ModeNumber);
+    HostConsoleUpdateLater(Console);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostTextSetAttribute (
+    IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  *This,
+    IN UINTN                            Attribute
+) {
+    HOST_CONSOLE_OUT *Console = (HOST_CONSOLE_OUT *)This;
+    if (Console == NULL || (Attribute & ~(UINTN)0x7F) != 0) {
+        return EFI_UNSUPPORTED;
+    }
+    Console->Mode.Attribute = (INT32)Attribute;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostTextSetCursorPosition (
+    IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  *This,
+    IN UINTN                            Column,
+    IN UINTN                            Row
+) {
+    HOST_CONSOLE_OUT *Console = (HOST_CONSOLE_OUT *)This;
+    if (Console == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (Column >= Console->Columns || Row >= Console->Rows) {
+        return EFI_UNSUPPORTED;
+    }
+    Console->Mode.CursorColumn = (INT32)Column;
+    Console->Mode.CursorRow = (INT32)Row;
+    HostConsoleUpdate(Console);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostTextEnableCursor (
+    IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  *This,
+    IN BOOLEAN                          Visible
+) {
+    HOST_CONSOLE_OUT *Console = (HOST_CONSOLE_OUT *)This;
+    if (Console == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    Console->Mode.CursorVisible = Visible;
+    HostConsoleUpdate(Console);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostTextReset (
+    IN EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL  *This,
+    IN BOOLEAN                          ExtendedVerification
+) {
+    (VOID)ExtendedVerification;
+
+    EFI_STATUS Status = HostTextSetAttribute(This, EFI_TEXT_ATTRIBUTE(EFI_LIGHTGRAY, EFI_BLACK));
+    if (Status == EFI_SUCCESS) {
+        Status = HostTextSetMode(This, 0);
+    }
+    return Status;
+}
+
+static VOID HostConsoleOutInitialize (
+    OUT HOST_CONSOLE_OUT    *Console,
+    IN INT32                Fd
+) {
+    Console->Protocol.Reset = HostTextReset;
+    Console->Protocol.OutputString = HostTextOutputString;
+    Console->Protocol.TestString = HostTextTestString;
+    Console->Protocol.QueryMode = HostTextQueryMode;
+    Console->Protocol.SetMode = HostTextSetMode;
+    Console->Protocol.SetAttribute = HostTextSetAttribute;
+    Console->Protocol.ClearScreen = HostTextClearScreen;
+    Console->Protocol.SetCursorPosition = HostTextSetCursorPosition;
+    Console->Protocol.EnableCursor = HostTextEnableCursor;
+    Console->Protocol.Mode = &Console->Mode;
+
+    Console->Mode.MaxMode = HOST_CONSOLE_MODES;
+    Console->Mode.Attribute = EFI_TEXT_ATTRIBUTE(EFI_LIGHTGRAY, EFI_BLACK);
+    Console->Mode.CursorVisible = TRUE;
+    Console->Fd = Fd;
+    Console->Terminal = Fd >= 0 && isatty(Fd) != 0;
+    Console->HighSurrogate = 0;
+    Console->Dirty = FALSE;
+    Console->NextFlush = 0;
+    HostConsoleSetGeometry(Console, 0);
+}
+
+/**
+ * Hands the terminal back: scrolling over the whole screen, default colors, a
+ * visible cursor and the prompt below the console
+ */
+static VOID HostConsoleOutShutdown (
+    IN OUT HOST_CONSOLE_OUT *Console
+) {
+    HostConsoleFlushOne(Console);
+    if (Console->Painted && Console->Terminal) {
+        CHAR8 Sequence[64];
+        INT32 Length = snprintf(Sequence, sizeof(Sequence), "\x1b[r\x1b[0m\x1b[?25h\x1b[%u;1H\n", (UINT32)Console->Rows);
+        HostConsoleWrite(Console->Fd, Sequence, (UINTN)Length);
+    }
+    Console->Fd = -1;
+    Console->Terminal = FALSE;
+    Console->Painted = FALSE;
+    std::vector<UINT32>().swap(Console->Shadow);
+    std::vector<UINT32>().swap(Console->Screen);
+    std::string().swap(Console->Output);
+}
+
+/**
+ * Returns TRUE when both descriptors lead to the same terminal or file, so that
+ * one screen serves both
+ */
+static BOOLEAN HostConsoleSameSink (
+    IN INT32 First,
+    IN INT32 Second
+) {
+    struct stat FirstStat;
+    struct stat SecondStat;
+    if (First < 0 || Second < 0 || fstat(First, &FirstStat) != 0 || fstat(Second, &SecondStat) != 0) {
+        return FALSE;
+    }
+    if (S_ISCHR(FirstStat.st_mode) && S_ISCHR(SecondStat.st_mode)) {
+        return FirstStat.st_rdev == SecondStat.st_rdev;
+    }
+    return FirstStat.st_dev == SecondStat.st_dev && FirstStat.st_ino == SecondStat.st_ino;
+}
+
+/**
+ * Moves whatever the input descriptor holds into the pending buffer without blocking
+ */
+static VOID HostConsolePoll (
+    VOID
+) {
+    if (mConsoleIn.Fd < 0) {
+        return;
+    }
+
+    struct pollfd Poll = { mConsoleIn.Fd, POLLIN, 0 };
+    while (poll(&Poll, 1, 0) > 0 && (Poll.revents & POLLIN) != 0) {
+        CHAR8 Buffer[64];
+        ssize_t Count = read(mConsoleIn.Fd, Buffer, sizeof(Buffer));
+        if (Count <= 0) {
+            return;
+        }
+        mConsoleIn.Pending.append(Buffer, (size_t)Count);
+    }
+}
+
+/**
+ * Decodes an ANSI escape sequence at the start of Sequence into a scan code.
+ * Returns the number of bytes consumed, or zero when the sequence is not recognised.
+ */
+static UINTN HostConsoleDecodeEscape (
+    IN const std::string    &Sequence,
+    OUT UINT16              *ScanCode
+) {
+    if (Sequence.size() >= 3 && Sequence[1] == 'O') {
+        if (Sequence[2] >= 'P' && Sequence[2] <= 'S') {
+            *ScanCode = (UINT16)(SCANCODE_FUNCTION1 + (Sequence[2] - 'P'));
+            return 3;
+        }
+        return 0;
+    }
+    if (Sequence.size() < 3 || Sequence[1] != '[') {
+        return 0;
+    }
+
+    switch (Sequence[2]) {
+    case 'A': *ScanCode = SCANCODE_UP_ARROW; return 3;
+    case 'B': *ScanCode = SCANCODE_DOWN_ARROW; return 3;
+    case 'C': *ScanCode = SCANCODE_RIGHT_ARROW; return 3;
+    case 'D': *ScanCode = SCANCODE_LEFT_ARROW; return 3;
+    case 'H': *ScanCode = SCANCODE_HOME; return 3;
+    case 'F': *ScanCode = SCANCODE_END; return 3;
+    default: break;
+    }
+
+    //
+    // CSI <number> ~
+    //
+    UINTN Index = 2;
+    UINT32 Number = 0;
+    while (Index < Sequence.size() && Sequence[Index] >= '0' && Sequence[Index] <= '9') {
+        Number = Number * 10 + (UINT32)(Sequence[Index] - '0');
+        Index++;
+    }
+    if (Index == 2 || Index >= Sequence.size() || Sequence[Index] != '~') {
+        return 0;
+    }
+
+    switch (Number) {
+    case 1: *ScanCode = SCANCODE_HOME; break;
+    case 2: *ScanCode = SCANCODE_INSERT; break;
+    case 3: *ScanCode = SCANCODE_DELETE; break;
+    case 4: *ScanCode = SCANCODE_END; break;
+    case 5: *ScanCode = SCANCODE_PAGE_UP; break;
+    case 6: *ScanCode = SCANCODE_PAGE_DOWN; break;
+    case 15: *ScanCode = SCANCODE_FUNCTION5; break;
+    case 17: *ScanCode = SCANCODE_FUNCTION6; break;
+    case 18: *ScanCode = SCANCODE_FUNCTION7; break;
+    case 19: *ScanCode = SCANCODE_FUNCTION8; break;
+    case 20: *ScanCode = SCANCODE_FUNCTION9; break;
+    case 21: *ScanCode = SCANCODE_FUNCTION10; break;
+    case 23: *ScanCode = SCANCODE_FUNCTION11; break;
+    case 24: *ScanCode = SCANCODE_FUNCTION12; break;
+    default: return 0;
+    }
+    return Index + 1;
+}
+
+/**
+ * Takes one key off the pending buffer. Returns FALSE when no key is available.
+ */
+static BOOLEAN HostConsoleTakeKey (
+    OUT EFI_INPUT_KEY *Key
+) {
+    std::string &Pending = mConsoleIn.Pending;
+    if (Pending.empty()) {
+        return FALSE;
+    }
+
+    Key->ScanCode = SCANCODE_NULL;
+    Key->UnicodeChar = CHAR_NULL;
+
+    UINT8 Lead = (UINT8)Pending[0];
+    if (Lead == 0x1B) {
+        UINTN Consumed = HostConsoleDecodeEscape(Pending, &Key->ScanCode);
+        if (Consumed == 0) {
+            Key->ScanCode = SCANCODE_ESCAPE;
+            Consumed = 1;
+        }
+        Pending.erase(0, Consumed);
+        return TRUE;
+    }
+
+    if (Lead == '\n' || Lead == '\r') {
+        Key->UnicodeChar = CHAR_CARRIAGE_RETURN;
+        Pending.erase(0, 1);
+        return TRUE;
+    }
+    if (Lead == 0x7F) {
+        Key->UnicodeChar = CHAR_BACKSPACE;
+        Pending.erase(0, 1);
+        return TRUE;
+    }
+
+    UINTN Length = Lead < 0x80 ? 1 : Lead >= 0xF0 ? 4 : Lead >= 0xE0 ? 3 : Lead >= 0xC0 ? 2 : 1;
+    if (Length > Pending.size()) {
+        //
+        // Wait for the rest of the character to arrive
+        //
+        return FALSE;
+    }
+
+    CHAR16 Units[2];
+    UINTN UnitCount = 2;
+    Utf8ToChar16(Pending.data(), Length, Units, &UnitCount, UTF_REPLACE_INVALID);
+    Key->UnicodeChar = UnitCount == 1 ? Units[0] : (CHAR16)0xFFFD;
+    Pending.erase(0, Length);
+    return TRUE;
+}
+
+static EFI_STATUS EFI_API HostTextInReset (
+    IN EFI_SIMPLE_TEXT_INPUT_PROTOCOL   *This,
+    IN BOOLEAN                          ExtendedVerification
+) {
+    (VOID)ExtendedVerification;
+
+    if (This == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    HostConsolePoll();
+    mConsoleIn.Pending.clear();
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostTextInReadKeyStroke (
+    IN EFI_SIMPLE_TEXT_INPUT_PROTOCOL   *This,
+    OUT EFI_INPUT_KEY                   *Key
+) {
+    if (This == NULL || Key == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    //
+    // Whatever was drawn before asking for a key is a finished frame
+    //
+    HostConsoleFlush();
+    HostConsolePoll();
+    return HostConsoleTakeKey(Key) ? EFI_SUCCESS : EFI_NOT_READY;
+}
+
+static VOID EFI_API HostWaitForKeyNotify (
+    IN EFI_EVENT    Event,
+    IN VOID         *Context
+) {
+    (VOID)Context;
+
+    HostConsolePoll();
+    if (!mConsoleIn.Pending.empty()) {
+        HostSignalEvent(Event);
+    }
+}
+
+EFI_STATUS HostConsoleInitialize (
+    VOID
+) {
+    mConsoleIn.Protocol.Reset = HostTextInReset;
+    mConsoleIn.Protocol.ReadKeyStroke = HostTextInReadKeyStroke;
+    mConsoleIn.Protocol.WaitForKey = NULL;
+    mConsoleIn.Fd = gHostConfig.ConsoleInFd;
+    mConsoleIn.Pending.clear();
+
+    HostConsoleOutInitialize(&mConsoleOut, gHostConfig.ConsoleOutFd);
+    HostConsoleOutInitialize(&mStandardError, gHostConfig.StandardErrorFd);
+
+    EFI_STATUS Status = HostCreateEvent(EFI_EVENT_NOTIFY_WAIT, TPL_NOTIFY, HostWaitForKeyNotify, NULL, &mConsoleIn.Protocol.WaitForKey);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+
+    EFI_HANDLE ConsoleInHandle = NULL;
+    Status = HostInstallProtocolInterface(&ConsoleInHandle, &EFI_SIMPLE_TEXT_INPUT_PROTOCOL_GUID, EFI_NATIVE_INTERFACE, &mConsoleIn.Protocol);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+
+    EFI_HANDLE ConsoleOutHandle = NULL;
+    Status = HostInstallProtocolInterface(&ConsoleOutHandle, &EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL_GUID, EFI_NATIVE_INTERFACE, &mConsoleOut.Protocol);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+
+    //
+    // Standard error on the terminal of the console shares its screen, as two
+    // screens would overwrite each other
+    //
+    EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL *StandardError = &mStandardError.Protocol;
+    if (HostConsoleSameSink(gHostConfig.ConsoleOutFd, gHostConfig.StandardErrorFd)) {
+        StandardError = &mConsoleOut.Protocol;
+        mStandardError.Fd = -1;
+        mStandardError.Terminal = FALSE;
+    }
+    EFI_HANDLE StandardErrorHandle = NULL;
+    Status = HostInstallProtocolInterface(&StandardErrorHandle, &EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL_GUID, EFI_NATIVE_INTERFACE, StandardError);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+
+    gHostSystemTable->ConsoleInHandle = ConsoleInHandle;
+    gHostSystemTable->ConsoleIn = &mConsoleIn.Protocol;
+    gHostSystemTable->ConsoleOutHandle = ConsoleOutHandle;
+    gHostSystemTable->ConsoleOut = &mConsoleOut.Protocol;
+    gHostSystemTable->StandardErrorHandle = StandardErrorHandle;
+    gHostSystemTable->StandardError = StandardError;
+    return EFI_SUCCESS;
+}
+
+VOID HostConsoleShutdown (
+    VOID
+) {
+    //
+    // The handles and the WaitForKey event are released with their modules
+    //
+    mConsoleIn.Protocol.WaitForKey = NULL;
+    mConsoleIn.Pending.clear();
+    mConsoleIn.Pending.shrink_to_fit();
+    mConsoleIn.Fd = -1;
+    HostConsoleOutShutdown(&mConsoleOut);
+    HostConsoleOutShutdown(&mStandardError);
+}
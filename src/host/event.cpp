@@ -0,0 +1,640 @@
+#include "internal.h"
+
+#include <efi/guid.h>
+
+#include <cstring>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+
+#define HOST_EVENT_SIGNATURE HOST_SIGNATURE_32('e', 'v', 'n', 't')
+
+/**
+ * Event types accepted by CreateEvent and CreateEventEx
+ */
+#define HOST_EVENT_VALID_TYPES (EFI_EVENT_TIMER | EFI_EVENT_RUNTIME | EFI_EVENT_NOTIFY_WAIT | EFI_EVENT_NOTIFY_SIGNAL)
+
+/**
+ * Timer wheel geometry. Timers are kept at a resolution of 2^10 * 100ns = 102.4us.
+ * The root level holds the next 256 ticks one slot per tick, and each further
+ * level holds 64 slots spanning 64 slots of the level below, so the wheel covers
+ * 2^26 ticks (about 1.9 hours) ahead. Later timers park in the last level and are
+ * placed again as they come closer.
+ */
+#define HOST_TIMER_TICK_SHIFT   10
+#define HOST_WHEEL_LEVELS       4
+#define HOST_WHEEL_ROOT_BITS    8
+#define HOST_WHEEL_LEVEL_BITS   6
+#define HOST_WHEEL_ROOT_SLOTS   (1 << HOST_WHEEL_ROOT_BITS)
+#define HOST_WHEEL_LEVEL_SLOTS  (1 << HOST_WHEEL_LEVEL_BITS)
+#define HOST_WHEEL_SPAN         ((UINT64)1 << (HOST_WHEEL_ROOT_BITS + (HOST_WHEEL_LEVELS - 1) * HOST_WHEEL_LEVEL_BITS))
+
+struct HOST_EVENT;
+
+typedef std::list<HOST_EVENT *> HOST_EVENT_LIST;
+
+struct HOST_EVENT {
+    UINT32                      Signature;
+    UINT32                      Type;
+    EFI_TPL                     NotifyTpl;
+    EFI_EVENT_NOTIFY            NotifyFunction;
+    VOID                        *NotifyContext;
+    BOOLEAN                     HasGroup;
+    EFI_GUID                    EventGroup;
+    HOST_EVENT_LIST::iterator   GroupLink;
+    UINT32                      SignalCount;
+    BOOLEAN                     NotifyQueued;
+    HOST_EVENT_LIST::iterator   NotifyLink;
+    BOOLEAN                     TimerArmed;
+    UINT64                      TriggerTime;
+    UINT64                      TriggerTick;
+    UINT64                      Period;
+    HOST_EVENT_LIST             *TimerList;     // Wheel slot or idle list holding TimerLink
+    HOST_EVENT_LIST::iterator   TimerLink;
+    UINT32                      TimerLevel;
+    UINT32                      TimerSlot;
+};
+
+struct HOST_GUID_HASH {
+    size_t operator() (const EFI_GUID &Guid) const {
+        return (size_t)HashGuid(&Guid);
+    }
+};
+
+struct HOST_GUID_EQUAL {
+    bool operator() (const EFI_GUID &First, const EFI_GUID &Second) const {
+        return CompareGuid(&First, &Second);
+    }
+};
+
+typedef std::unordered_map<EFI_GUID, HOST_EVENT_LIST, HOST_GUID_HASH, HOST_GUID_EQUAL> HOST_EVENT_GROUP_MAP;
+
+static std::unordered_set<HOST_EVENT *>  mEvents;
+static HOST_EVENT_GROUP_MAP              mEventGroups;
+
+/**
+ * Pending notifications are kept in one FIFO per TPL, with bit N of mPendingTpls
+ * set while the queue for TPL N is non-empty. Events with a notification function
+ * own one list node, spliced between mIdleNotifies and the queues.
+ */
+static HOST_EVENT_LIST  mNotifyQueues[TPL_HIGH_LEVEL + 1];
+static HOST_EVENT_LIST  mIdleNotifies;
+static UINT32           mPendingTpls;
+
+/**
+ * Timer events own one list node for their lifetime, which is spliced between the
+ * idle list and the wheel slots so that arming and cancelling never allocate
+ */
+static HOST_EVENT_LIST  mIdleTimers;
+static HOST_EVENT_LIST  mWheel[HOST_WHEEL_LEVELS][HOST_WHEEL_ROOT_SLOTS];
+static UINT64           mWheelBitmap[HOST_WHEEL_LEVELS][HOST_WHEEL_ROOT_SLOTS / 64];
+static UINT64           mWheelTick;     // Next tick to be processed
+static UINTN            mArmedTimers;
+
+static HOST_EVENT *HostLookupEvent (
+    IN EFI_EVENT Event
+) {
+    HOST_EVENT *Entry = (HOST_EVENT *)Event;
+    if (Entry == NULL || mEvents.count(Entry) == 0 || Entry->Signature != HOST_EVENT_SIGNATURE) {
+        return NULL;
+    }
+    return Entry;
+}
+
+/**
+ * Queues the notification function of Event. Must be called at TPL_HIGH_LEVEL.
+ */
+static VOID HostNotifyEvent (
+    IN HOST_EVENT *Event
+) {
+    if (Event->NotifyQueued) {
+        return;
+    }
+    HOST_EVENT_LIST &Queue = mNotifyQueues[Event->NotifyTpl];
+    Queue.splice(Queue.end(), mIdleNotifies, Event->NotifyLink);
+    Event->NotifyQueued = TRUE;
+    mPendingTpls |= (UINT32)1 << Event->NotifyTpl;
+}
+
+/**
+ * Takes Event off its notification queue. Must be called at TPL_HIGH_LEVEL.
+ */
+static VOID HostUnqueueEvent (
+    IN HOST_EVENT *Event
+) {
+    HOST_EVENT_LIST &Queue = mNotifyQueues[Event->NotifyTpl];
+    mIdleNotifies.splice(mIdleNotifies.end(), Queue, Event->NotifyLink);
+    Event->NotifyQueued = FALSE;
+    if (Queue.empty()) {
+        mPendingTpls &= ~((UINT32)1 << Event->NotifyTpl);
+    }
+}
+
+/**
+ * Marks Event signaled and queues its notification. Must be called at TPL_HIGH_LEVEL.
+ */
+static VOID HostSignalEventLocked (
+    IN HOST_EVENT *Event
+) {
+    if (Event->SignalCount != 0) {
+        return;
+    }
+    Event->SignalCount++;
+    if ((Event->Type & EFI_EVENT_NOTIFY_SIGNAL) != 0) {
+        HostNotifyEvent(Event);
+    }
+}
+
+VOID HostDispatchEventNotifies (
+    IN EFI_TPL NewTpl
+) {
+    if (NewTpl >= TPL_HIGH_LEVEL) {
+        return;
+    }
+
+    //
+    // Drain the highest pending level first, and each level in signal order
+    //
+    UINT32 Above = ~(UINT32)0 << (NewTpl + 1);
+    while ((mPendingTpls & Above) != 0) {
+        EFI_TPL Tpl = 31 - __builtin_clz(mPendingTpls & Above);
+        HOST_EVENT *Event = mNotifyQueues[Tpl].front();
+        HostUnqueueEvent(Event);
+        if ((Event->Type & EFI_EVENT_NOTIFY_SIGNAL) != 0) {
+            Event->SignalCount = 0;
+        }
+
+        EFI_TPL SavedTpl = HostGetCurrentTpl();
+        HostSetCurrentTpl(Tpl);
+        Event->NotifyFunction((EFI_EVENT)Event, Event->NotifyContext);
+        HostSetCurrentTpl(SavedTpl);
+    }
+}
+
+static UINT32 HostWheelLevelShift (
+    IN UINT32 Level
+) {
+    return Level == 0 ? 0 : HOST_WHEEL_ROOT_BITS + (Level - 1) * HOST_WHEEL_LEVEL_BITS;
+}
+
+static VOID HostWheelMove (
+    IN HOST_EVENT       *Event,
+    IN HOST_EVENT_LIST  &List
+) {
+    List.splice(List.end(), *Event->TimerList, Event->TimerLink);
+    Event->TimerList = &List;
+}
+
+/**
+ * Places an armed timer in the slot matching its distance from the current tick
+ */
+static VOID HostWheelInsert (
+    IN HOST_EVENT *Event
+) {
+    UINT64 Tick = Event->TriggerTick < mWheelTick ? mWheelTick : Event->TriggerTick;
+    if (Tick - mWheelTick >= HOST_WHEEL_SPAN) {
+        Tick = mWheelTick + HOST_WHEEL_SPAN - 1;
+    }
+
+    UINT64 Delta = Tick - mWheelTick;
+    UINT32 Level = 0;
+    while (Level + 1 < HOST_WHEEL_LEVELS && Delta >= ((UINT64)1 << HostWheelLevelShift(Level + 1))) {
+        Level++;
+    }
+    UINT32 Slot = (UINT32)(Tick >> HostWheelLevelShift(Level)) & (Level == 0 ? HOST_WHEEL_ROOT_SLOTS - 1 : HOST_WHEEL_LEVEL_SLOTS - 1);
+
+    HostWheelMove(Event, mWheel[Level][Slot]);
+    Event->TimerLevel = Level;
+    Event->TimerSlot = Slot;
+    mWheelBitmap[Level][Slot / 64] |= (UINT64)1 << (Slot % 64);
+}
+
+/**
+ * Takes a timer off the wheel and back to the idle list
+ */
+static VOID HostWheelRemove (
+    IN HOST_EVENT *Event
+) {
+    HOST_EVENT_LIST &Slot = mWheel[Event->TimerLevel][Event->TimerSlot];
+    HostWheelMove(Event, mIdleTimers);
+    if (Slot.empty()) {
+        mWheelBitmap[Event->TimerLevel][Event->TimerSlot / 64] &= ~((UINT64)1 << (Event->TimerSlot % 64));
+    }
+}
+
+/**
+ * Detaches every timer in a slot onto Detached
+ */
+static VOID HostWheelTakeSlot (
+    IN UINT32           Level,
+    IN UINT32           Slot,
+    OUT HOST_EVENT_LIST &Detached
+) {
+    HOST_EVENT_LIST &List = mWheel[Level][Slot];
+    for (HOST_EVENT *Event : List) {
+        Event->TimerList = &Detached;
+    }
+    Detached.splice(Detached.end(), List);
+    mWheelBitmap[Level][Slot / 64] &= ~((UINT64)1 << (Slot % 64));
+}
+
+/**
+ * Redistributes the slot of Level that covers the current tick into the levels
+ * below. Returns the index of that slot, which is zero when the level has wrapped.
+ */
+static UINT32 HostWheelCascade (
+    IN UINT32 Level
+) {
+    UINT32 Slot = (UINT32)(mWheelTick >> HostWheelLevelShift(Level)) & (HOST_WHEEL_LEVEL_SLOTS - 1);
+    HOST_EVENT_LIST Detached;
+    HostWheelTakeSlot(Level, Slot, Detached);
+    while (!Detached.empty()) {
+        HostWheelInsert(Detached.front());
+    }
+    return Slot;
+}
+
+/**
+ * Index of the first occupied root slot at or after Start, or HOST_WHEEL_ROOT_SLOTS
+ */
+static UINT32 HostWheelNextRootSlot (
+    IN UINT32 Start
+) {
+    for (UINT32 Word = Start / 64; Word < HOST_WHEEL_ROOT_SLOTS / 64; Word++) {
+        UINT64 Bits = mWheelBitmap[0][Word];
+        if (Word == Start / 64) {
+            Bits &= ~(UINT64)0 << (Start % 64);
+        }
+        if (Bits != 0) {
+            return Word * 64 + (UINT32)__builtin_ctzll(Bits);
+        }
+    }
+    return HOST_WHEEL_ROOT_SLOTS;
+}
+
+/**
+ * Signals the timers of the current tick and advances it
+ */
+static VOID HostWheelExpire (
+    IN UINT64 Now
+) {
+    UINT32 Slot = (UINT32)mWheelTick & (HOST_WHEEL_ROOT_SLOTS - 1);
+    HOST_EVENT_LIST Expired;
+    HostWheelTakeSlot(0, Slot, Expired);
+    UINT64 Tick = mWheelTick++;
+
+    while (!Expired.empty()) {
+        HOST_EVENT *Event = Expired.front();
+        if (Event->TriggerTick > Tick) {
+            //
+            // Parked beyond the span of the wheel and not due yet
+            //
+            HostWheelInsert(Event);
+            continue;
+        }
+
+        if (Event->Period != 0) {
+            Event->TriggerTime += Event->Period;
+            if (Event->TriggerTime <= Now) {
+                Event->TriggerTime = Now + Event->Period;
+            }
+            Event->TriggerTick = (Event->TriggerTime + (1 << HOST_TIMER_TICK_SHIFT) - 1) >> HOST_TIMER_TICK_SHIFT;
+            HostWheelInsert(Event);
+        } else {
+            HostWheelMove(Event, mIdleTimers);
+            Event->TimerArmed = FALSE;
+            mArmedTimers--;
+        }
+        HostSignalEventLocked(Event);
+    }
+}
+
+VOID HostTimerCheck (
+    VOID
+) {
+    UINT64 Now = HostGetTimestamp();
+    UINT64 NowTick = Now >> HOST_TIMER_TICK_SHIFT;
+    while (mWheelTick <= NowTick) {
+        if (mArmedTimers == 0) {
+            mWheelTick = NowTick + 1;
+            return;
+        }
+
+        UINT32 Slot = (UINT32)mWheelTick & (HOST_WHEEL_ROOT_SLOTS - 1);
+        if (Slot == 0) {
+            for (UINT32 Level = 1; Level < HOST_WHEEL_LEVELS && HostWheelCascade(Level) == 0; Level++) {
+            }
+        }
+        HostWheelExpire(Now);
+
+        //
+        // Skip the empty root slots up to the next occupied one or the next wrap,
+        // where the levels above must be cascaded
+        //
+        Slot = (UINT32)mWheelTick & (HOST_WHEEL_ROOT_SLOTS - 1);
+        if (Slot != 0 && mWheelTick <= NowTick) {
+            UINT64 Next = (mWheelTick - Slot) + HostWheelNextRootSlot(Slot);
+            mWheelTick = Next < NowTick + 1 ? Next : NowTick + 1;
+        }
+    }
+}
+
+UINT64 HostNextTimerDeadline (
+    VOID
+) {
+    if (mArmedTimers == 0) {
+        return UINT64_MAX;
+    }
+
+    //
+    // The first occupied root slot of this round is exact. Past it the deadline is
+    // the next wrap: timers of the next round wait in root slots before Slot, but
+    // the levels above cascade at the wrap and may be due right after it. A wrap
+    // not processed yet leaves the root empty until its cascade, so it is the
+    // deadline itself.
+    //
+    UINT32 Slot = (UINT32)mWheelTick & (HOST_WHEEL_ROOT_SLOTS - 1);
+    if (Slot == 0) {
+        return mWheelTick << HOST_TIMER_TICK_SHIFT;
+    }
+    UINT64 Tick = (mWheelTick - Slot) + HostWheelNextRootSlot(Slot);
+    return Tick << HOST_TIMER_TICK_SHIFT;
+}
+
+VOID HostSignalEventGroup (
+    IN EFI_GUID *EventGroup
+) {
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_HIGH_LEVEL);
+    HOST_EVENT_GROUP_MAP::iterator Group = mEventGroups.find(*EventGroup);
+    if (Group != mEventGroups.end()) {
+        for (HOST_EVENT *Event : Group->second) {
+            HostSignalEventLocked(Event);
+        }
+    }
+    HostRestoreTpl(OldTpl);
+}
+
+static VOID HostNotifyReset (
+    VOID
+) {
+    for (HOST_EVENT_LIST &Queue : mNotifyQueues) {
+        Queue.clear();
+    }
+    mIdleNotifies.clear();
+    mPendingTpls = 0;
+}
+
+static VOID HostWheelReset (
+    VOID
+) {
+    for (HOST_EVENT_LIST (&Level)[HOST_WHEEL_ROOT_SLOTS] : mWheel) {
+        for (HOST_EVENT_LIST &Slot : Level) {
+            Slot.clear();
+        }
+    }
+    memset(mWheelBitmap, 0, sizeof(mWheelBitmap));
+    mIdleTimers.clear();
+    mArmedTimers = 0;
+}
+
+EFI_STATUS HostEventInitialize (
+    VOID
+) {
+    mEvents.clear();
+    mEventGroups.clear();
+    HostNotifyReset();
+    HostWheelReset();
+    mWheelTick = HostGetTimestamp() >> HOST_TIMER_TICK_SHIFT;
+    return EFI_SUCCESS;
+}
+
+VOID HostEventShutdown (
+    VOID
+) {
+    for (HOST_EVENT *Event : mEvents) {
+        Event->Signature = 0;
+        delete Event;
+    }
+    mEvents.clear();
+    mEventGroups.clear();
+    HostNotifyReset();
+    HostWheelReset();
+}
+
+EFI_STATUS EFI_API HostCreateEventEx (
+    IN UINT32           Type,
+    IN EFI_TPL          NotifyTpl,
+    IN EFI_EVENT_NOTIFY NotifyFunction OPTIONAL,
+    IN VOID             *NotifyContext OPTIONAL,
+    IN EFI_GUID         *EventGroup OPTIONAL,
+    OUT EFI_EVENT       *Event
+) {
+    if (Event == NULL || (Type & ~(UINT32)HOST_EVENT_VALID_TYPES) != 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    BOOLEAN NotifyWait = (Type & EFI_EVENT_NOTIFY_WAIT) != 0;
+    BOOLEAN NotifySignal = (Type & EFI_EVENT_NOTIFY_SIGNAL) != 0;
+    if (NotifyWait && NotifySignal) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (NotifyWait || NotifySignal) {
+        if (NotifyFunction == NULL || NotifyTpl <= TPL_APPLICATION || NotifyTpl >= TPL_HIGH_LEVEL) {
+            return EFI_INVALID_PARAMETER;
+        }
+    }
+    if (EventGroup != NULL && !NotifySignal) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    HOST_EVENT *Entry = new HOST_EVENT();
+    Entry->Signature = HOST_EVENT_SIGNATURE;
+    Entry->Type = Type;
+    if (NotifyWait || NotifySignal) {
+        Entry->NotifyTpl = NotifyTpl;
+        Entry->NotifyFunction = NotifyFunction;
+        Entry->NotifyContext = NotifyContext;
+        Entry->NotifyLink = mIdleNotifies.insert(mIdleNotifies.end(), Entry);
+    }
+    if (EventGroup != NULL) {
+        Entry->HasGroup = TRUE;
+        Entry->EventGroup = *EventGroup;
+        HOST_EVENT_LIST &Members = mEventGroups[*EventGroup];
+        Entry->GroupLink = Members.insert(Members.end(), Entry);
+    }
+    if ((Type & EFI_EVENT_TIMER) != 0) {
+        Entry->TimerList = &mIdleTimers;
+        Entry->TimerLink = mIdleTimers.insert(mIdleTimers.end(), Entry);
+    }
+
+    mEvents.insert(Entry);
+    *Event = (EFI_EVENT)Entry;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostCreateEvent (
+    IN UINT32           Type,
+    IN EFI_TPL          NotifyTpl,
+    IN EFI_EVENT_NOTIFY NotifyFunction OPTIONAL,
+    IN VOID             *NotifyContext OPTIONAL,
+    OUT EFI_EVENT       *Event
+) {
+    //
+    // The legacy signal types are expressed as membership of the matching event group
+    //
+    if (Type == EFI_EVENT_SIGNAL_EXIT_BOOT_SERVICES) {
+        return HostCreateEventEx(EFI_EVENT_NOTIFY_SIGNAL, NotifyTpl, NotifyFunction, NotifyContext, &EFI_EVENT_GROUP_EXIT_BOOT_SERVICES, Event);
+    }
+    if (Type == EFI_EVENT_SIGNAL_VIRTUAL_ADDRESS_CHANGE) {
+        return HostCreateEventEx(EFI_EVENT_RUNTIME | EFI_EVENT_NOTIFY_SIGNAL, NotifyTpl, NotifyFunction, NotifyContext, &EFI_EVENT_GROUP_VIRTUAL_ADDRESS_CHANGE, Event);
+    }
+    return HostCreateEventEx(Type, NotifyTpl, NotifyFunction, NotifyContext, NULL, Event);
+}
+
+EFI_STATUS EFI_API HostCloseEvent (
+    IN EFI_EVENT Event
+) {
+    HOST_EVENT *Entry = HostLookupEvent(Event);
+    if (Entry == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_HIGH_LEVEL);
+    if (Entry->NotifyQueued) {
+        HostUnqueueEvent(Entry);
+    }
+    if (Entry->NotifyFunction != NULL) {
+        mIdleNotifies.erase(Entry->NotifyLink);
+    }
+    if (Entry->TimerArmed) {
+        HostWheelRemove(Entry);
+        mArmedTimers--;
+    }
+    if ((Entry->Type & EFI_EVENT_TIMER) != 0) {
+        mIdleTimers.erase(Entry->TimerLink);
+    }
+    if (Entry->HasGroup) {
+        HOST_EVENT_GROUP_MAP::iterator Group = mEventGroups.find(Entry->EventGroup);
+        Group->second.erase(Entry->GroupLink);
+        if (Group->second.empty()) {
+            mEventGroups.erase(Group);
+        }
+    }
+    mEvents.erase(Entry);
+    HostRestoreTpl(OldTpl);
+
+    HostUnregisterProtocolNotify(Event);
+    Entry->Signature = 0;
+    delete Entry;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostSignalEvent (
+    IN EFI_EVENT Event
+) {
+    HOST_EVENT *Entry = HostLookupEvent(Event);
+    if (Entry == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    if (Entry->HasGroup) {
+        HostSignalEventGroup(&Entry->EventGroup);
+        return EFI_SUCCESS;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_HIGH_LEVEL);
+    HostSignalEventLocked(Entry);
+    HostRestoreTpl(OldTpl);
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostCheckEvent (
+    IN EFI_EVENT Event
+) {
+    HOST_EVENT *Entry = HostLookupEvent(Event);
+    if (Entry == NULL || (Entry->Type & EFI_EVENT_NOTIFY_SIGNAL) != 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_HIGH_LEVEL);
+    HostTimerCheck();
+    if (Entry->SignalCount == 0 && (Entry->Type & EFI_EVENT_NOTIFY_WAIT) != 0) {
+        HostNotifyEvent(Entry);
+    }
+    HostRestoreTpl(OldTpl);
+
+    if (Entry->SignalCount == 0) {
+        return EFI_NOT_READY;
+    }
+
+    OldTpl = HostRaiseTpl(TPL_HIGH_LEVEL);
+    Entry->SignalCount = 0;
+    HostRestoreTpl(OldTpl);
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostWaitForEvent (
+    IN UINTN        NumberOfEvents,
+    IN EFI_EVENT    *Event,
+    OUT UINTN       *Index
+) {
+    if (NumberOfEvents == 0 || Event == NULL || Index == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (HostGetCurrentTpl() != TPL_APPLICATION) {
+        return EFI_UNSUPPORTED;
+    }
+
+    for (;;) {
+        for (UINTN EventIndex = 0; EventIndex < NumberOfEvents; EventIndex++) {
+            EFI_STATUS Status = HostCheckEvent(Event[EventIndex]);
+            if (Status != EFI_NOT_READY) {
+                *Index = EventIndex;
+                return Status;
+            }
+        }
+        HostIdle(UINT64_MAX);
+    }
+}
+
+EFI_STATUS EFI_API HostSetTimer (
+    IN EFI_EVENT        Event,
+    IN EFI_TIMER_DELAY  Type,
+    IN UINT64           TriggerTime
+) {
+    HOST_EVENT *Entry = HostLookupEvent(Event);
+    if (Entry == NULL || (Entry->Type & EFI_EVENT_TIMER) == 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (Type != TimerCancel && Type != TimerPeriodic && Type != TimerRelative) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_HIGH_LEVEL);
+    if (Entry->TimerArmed) {
+        HostWheelRemove(Entry);
+        Entry->TimerArmed = FALSE;
+        mArmedTimers--;
+    }
+
+    if (Type != TimerCancel) {
+        //
+        // Bring the wheel up to date first so that the timer is placed relative to now
+        //
+        HostTimerCheck();
+        Entry->TriggerTime = HostGetTimestamp() + TriggerTime;
+        Entry->TriggerTick = (Entry->TriggerTime + (1 << HOST_TIMER_TICK_SHIFT) - 1) >> HOST_TIMER_TICK_SHIFT;
+        Entry->Period = 0;
+        if (Type == TimerPeriodic) {
+            //
+            // A period of 0 signals the timer on every tick, so it re-arms one tick on
+            //
+            Entry->Period = TriggerTime < (1 << HOST_TIMER_TICK_SHIFT) ? (1 << HOST_TIMER_TICK_SHIFT) : TriggerTime;
+        }
+        Entry->TimerArmed = TRUE;
+        mArmedTimers++;
+        HostWheelInsert(Entry);
+    }
+    HostRestoreTpl(OldTpl);
+    return EFI_SUCCESS;
+}
@@ -0,0 +1,1249 @@
+#include "internal.h"
+
+#include <efi/crc32.h>
+#include <efi/guid.h>
+#include <efi/string.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#define HOST_FAT_VOLUME_SIGNATURE   HOST_SIGNATURE_32('f', 'a', 't', 'v')
+#define HOST_FAT_FILE_SIGNATURE     HOST_SIGNATURE_32('f', 'a', 't', 'f')
+
+/**
+ * Directory entry attributes, per the Microsoft FAT specification. The attribute
+ * bits a file can carry match the EFI_FILE_* attributes.
+ */
+#define HOST_FAT_ATTRIBUTE_VOLUME_ID    0x08
+#define HOST_FAT_ATTRIBUTE_DIRECTORY    0x10
+#define HOST_FAT_ATTRIBUTE_LONG_NAME    0x0F
+#define HOST_FAT_ATTRIBUTE_LONG_MASK    0x3F
+
+#define HOST_FAT_ENTRY_FREE             0xE5
+#define HOST_FAT_ENTRY_KANJI_E5         0x05
+#define HOST_FAT_CASE_LOWER_BASE        0x08
+#define HOST_FAT_CASE_LOWER_EXTENSION   0x10
+#define HOST_FAT_LONG_NAME_LAST         0x40
+#define HOST_FAT_LONG_NAME_CHARACTERS   13
+
+/**
+ * Sequential reads ask the host to page in this much of the file ahead of the
+ * read position, following the file's cluster runs
+ */
+#define HOST_FAT_READAHEAD 0x400000
+
+/**
+ * Largest GPT partition entry array read while looking for the volume
+ */
+#define HOST_FAT_MAX_GPT_ENTRIES_SIZE 0x100000
+
+typedef struct __attribute__((__packed__)) {
+    UINT8   JumpBoot[3];
+    CHAR8   OemName[8];
+    UINT16  BytesPerSector;
+    UINT8   SectorsPerCluster;
+    UINT16  ReservedSectors;
+    UINT8   NumberOfFats;
+    UINT16  RootEntries;
+    UINT16  TotalSectors16;
+    UINT8   Media;
+    UINT16  FatSize16;
+    UINT16  SectorsPerTrack;
+    UINT16  NumberOfHeads;
+    UINT32  HiddenSectors;
+    UINT32  TotalSectors32;
+    union {
+        struct __attribute__((__packed__)) {
+            UINT8   DriveNumber;
+            UINT8   Reserved;
+            UINT8   BootSignature;
+            UINT32  VolumeId;
+            CHAR8   VolumeLabel[11];
+            CHAR8   FileSystemType[8];
+        } Fat16;
+        struct __attribute__((__packed__)) {
+            UINT32  FatSize32;
+            UINT16  ExtendedFlags;
+            UINT16  Version;
+            UINT32  RootCluster;
+            UINT16  FsInfoSector;
+            UINT16  BackupBootSector;
+            UINT8   Reserved[12];
+            UINT8   DriveNumber;
+            UINT8   Reserved1;
+            UINT8   BootSignature;
+            UINT32  VolumeId;
+            CHAR8   VolumeLabel[11];
+            CHAR8   FileSystemType[8];
+        } Fat32;
+    };
+} HOST_FAT_BOOT_SECTOR;
+
+typedef struct __attribute__((__packed__)) {
+    UINT8   Name[11];
+    UINT8   Attribute;
+    UINT8   CaseFlags;
+    UINT8   CreateTenths;
+    UINT16  CreateTime;
+    UINT16  CreateDate;
+    UINT16  AccessDate;
+    UINT16  FirstClusterHigh;
+    UINT16  WriteTime;
+    UINT16  WriteDate;
+    UINT16  FirstClusterLow;
+    UINT32  FileSize;
+} HOST_FAT_DIRECTORY_ENTRY;
+
+typedef struct __attribute__((__packed__)) {
+    UINT8   Ordinal;
+    UINT8   Name1[10];
+    UINT8   Attribute;
+    UINT8   Type;
+    UINT8   Checksum;
+    UINT8   Name2[12];
+    UINT16  FirstClusterLow;
+    UINT8   Name3[4];
+} HOST_FAT_LONG_NAME_ENTRY;
+
+/**
+ * A parsed directory entry
+ */
+typedef struct {
+    std::u16string  Name;
+    UINT8           Attribute;
+    UINT32          FirstCluster;
+    UINT32          Size;
+    UINT8           CreateTenths;
+    UINT16          CreateTime;
+    UINT16          CreateDate;
+    UINT16          AccessDate;
+    UINT16          WriteTime;
+    UINT16          WriteDate;
+} HOST_FAT_ENTRY;
+
+/**
+ * The entries of one directory, read once per volume. Index maps the upper-case
+ * long and short names of every entry to its position.
+ */
+typedef struct {
+    std::vector<HOST_FAT_ENTRY>                 Entries;
+    std::unordered_map<std::u16string, UINTN>   Index;
+} HOST_FAT_DIRECTORY;
+
+/**
+ * A run of Count clusters that are contiguous both in the file and on disk
+ */
+typedef struct {
+    UINT32  FileCluster;
+    UINT32  DiskCluster;
+    UINT32  Count;
+} HOST_FAT_EXTENT;
+
+typedef struct {
+    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL                     FileSystem;
+    UINT32                                              Signature;
+    INT32                                               Fd;
+    UINT32                                              FatType;        // 12, 16 or 32
+    UINT32                                              ClusterShift;
+    UINT32                                              ClusterCount;
+    UINT32                                              RootCluster;    // FAT32 only
+    UINT64                                              RootOffset;     // FAT12/16 fixed root directory
+    UINT64                                              RootSize;
+    UINT64                                              DataOffset;     // Image offset of cluster 2
+    UINT64                                              FreeClusters;
+    std::vector<UINT8>                                  Fat;
+    std::vector<CHAR16>                                 Label;          // Null-terminated
+    std::unordered_map<UINT32, HOST_FAT_DIRECTORY>      Directories;    // By first cluster, 0 for the root
+    BOOLEAN                                             Installed;
+    UINTN                                               OpenFiles;
+} HOST_FAT_VOLUME;
+
+typedef struct {
+    EFI_FILE_PROTOCOL               Protocol;
+    UINT32                          Signature;
+    HOST_FAT_VOLUME                 *Volume;
+    std::vector<std::u16string>     Path;           // Names from the root, as stored
+    HOST_FAT_ENTRY                  Entry;
+    HOST_FAT_DIRECTORY              *Directory;     // Directories only
+    std::vector<HOST_FAT_EXTENT>    Extents;        // Regular files only
+    UINT64                          Position;       // Entry index for directories
+    UINT64                          ReadaheadEnd;
+} HOST_FAT_FILE;
+
+static std::unordered_set<HOST_FAT_VOLUME *>    mFatVolumes;
+static std::unordered_set<HOST_FAT_FILE *>      mFatFiles;
+
+static HOST_FAT_FILE *HostLookupFatFile (
+    IN EFI_FILE_PROTOCOL *This
+) {
+    HOST_FAT_FILE *File = (HOST_FAT_FILE *)This;
+    if (File == NULL || mFatFiles.count(File) == 0 || File->Signature != HOST_FAT_FILE_SIGNATURE) {
+        return NULL;
+    }
+    return File;
+}
+
+static EFI_STATUS HostFatReadImage (
+    IN INT32    Fd,
+    IN UINT64   Offset,
+    IN UINTN    Length,
+    OUT VOID    *Buffer
+) {
+    UINT8 *Bytes = (UINT8 *)Buffer;
+    while (Length != 0) {
+        ssize_t Read = pread(Fd, Bytes, Length, (off_t)Offset);
+        if (Read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (Read < 0) {
+            return EFI_DEVICE_ERROR;
+        }
+        if (Read == 0) {
+            return EFI_VOLUME_CORRUPTED;
+        }
+        Bytes += Read;
+        Offset += (UINT64)Read;
+        Length -= (UINTN)Read;
+    }
+    return EFI_SUCCESS;
+}
+
+/**
+ * Folds Name to upper case, which is how FAT compares names
+ */
+static std::u16string HostFatUpcase (
+    IN const std::u16string &Name
+) {
+    std::u16string Upper(Name);
+    for (CHAR16 &Character : Upper) {
+        Character = CharToUpper(Character);
+    }
+    return Upper;
+}
+
+/**
+ * Returns the cluster following Cluster in its chain. Values outside the data
+ * area, including the end-of-chain markers, end the chain.
+ */
+static UINT32 HostFatNext (
+    IN const HOST_FAT_VOLUME    *Volume,
+    IN UINT32                   Cluster
+) {
+    const UINT8 *Fat = Volume->Fat.data();
+    switch (Volume->FatType) {
+    case 12: {
+        UINTN Offset = Cluster + Cluster / 2;
+        UINT32 Value = Fat[Offset] | ((UINT32)Fat[Offset + 1] << 8);
+        return (Cluster & 1) != 0 ? Value >> 4 : Value & 0xFFF;
+    }
+    case 16:
+        return Fat[Cluster * 2] | ((UINT32)Fat[Cluster * 2 + 1] << 8);
+    default:
+        return (Fat[Cluster * 4] | ((UINT32)Fat[Cluster * 4 + 1] << 8) | ((UINT32)Fat[Cluster * 4 + 2] << 16) | ((UINT32)Fat[Cluster * 4 + 3] << 24)) & 0x0FFFFFFF;
+    }
+}
+
+static BOOLEAN HostFatIsDataCluster (
+    IN const HOST_FAT_VOLUME    *Volume,
+    IN UINT32                   Cluster
+) {
+    return Cluster >= 2 && Cluster - 2 < Volume->ClusterCount;
+}
+
+/**
+ * Walks the chain starting at FirstCluster into runs of contiguous clusters
+ */
+static VOID HostFatBuildExtents (
+    IN const HOST_FAT_VOLUME        *Volume,
+    IN UINT32                       FirstCluster,
+    OUT std::vector<HOST_FAT_EXTENT> *Extents
+) {
+    Extents->clear();
+    UINT32 Cluster = FirstCluster;
+    UINT32 FileCluster = 0;
+    while (HostFatIsDataCluster(Volume, Cluster) && FileCluster < Volume->ClusterCount) {
+        if (!Extents->empty() && Extents->back().DiskCluster + Extents->back().Count == Cluster) {
+            Extents->back().Count++;
+        } else {
+            Extents->push_back({ FileCluster, Cluster, 1 });
+        }
+        FileCluster++;
+        Cluster = HostFatNext(Volume, Cluster);
+    }
+}
+
+/**
+ * Calls Visit with the image offset and length of every contiguous piece of the
+ * file range [Offset, Offset + Length). Returns FALSE when the cluster chain ends
+ * before the range does.
+ */
+template <typename VISITOR>
+static BOOLEAN HostFatForEachRun (
+    IN const HOST_FAT_VOLUME                *Volume,
+    IN const std::vector<HOST_FAT_EXTENT>   &Extents,
+    IN UINT64                               Offset,
+    IN UINT64                               Length,
+    IN VISITOR                              Visit
+) {
+    UINT32 Shift = Volume->ClusterShift;
+    while (Length != 0) {
+        UINT64 FileCluster = Offset >> Shift;
+        auto Next = std::upper_bound(Extents.begin(), Extents.end(), FileCluster, [] (UINT64 Cluster, const HOST_FAT_EXTENT &Extent) {
+            return Cluster < Extent.FileCluster;
+        });
+        if (Next == Extents.begin()) {
+            return FALSE;
+        }
+        const HOST_FAT_EXTENT &Extent = *(Next - 1);
+        UINT64 RunEnd = (UINT64)(Extent.FileCluster + Extent.Count) << Shift;
+        if (Offset >= RunEnd) {
+            return FALSE;
+        }
+
+        UINT64 Piece = std::min(Length, RunEnd - Offset);
+        UINT64 ImageOffset = Volume->DataOffset + ((UINT64)(Extent.DiskCluster - 2) << Shift) + (Offset - ((UINT64)Extent.FileCluster << Shift));
+        if (!Visit(ImageOffset, Piece)) {
+            return FALSE;
+        }
+        Offset += Piece;
+        Length -= Piece;
+    }
+    return TRUE;
+}
+
+static UINT8 HostFatShortNameChecksum (
+    IN const UINT8 *Name
+) {
+    UINT8 Sum = 0;
+    for (UINTN Index = 0; Index < 11; Index++) {
+        Sum = (UINT8)(((Sum & 1) != 0 ? 0x80 : 0) + (Sum >> 1) + Name[Index]);
+    }
+    return Sum;
+}
+
+/**
+ * Formats an 8.3 name, honouring the lower-case flags Windows NT stores for names
+ * that need no long name entries
+ */
+static std::u16string HostFatShortName (
+    IN const HOST_FAT_DIRECTORY_ENTRY *Entry
+) {
+    std::u16string Name;
+    UINTN BaseLength = 8;
+    while (BaseLength > 0 && Entry->Name[BaseLength - 1] == ' ') {
+        BaseLength--;
+    }
+    UINTN ExtensionLength = 3;
+    while (ExtensionLength > 0 && Entry->Name[8 + ExtensionLength - 1] == ' ') {
+        ExtensionLength--;
+    }
+
+    for (UINTN Index = 0; Index < BaseLength; Index++) {
+        CHAR16 Character = Entry->Name[Index];
+        if (Index == 0 && Character == HOST_FAT_ENTRY_KANJI_E5) {
+            Character = HOST_FAT_ENTRY_FREE;
+        }
+        if ((Entry->CaseFlags & HOST_FAT_CASE_LOWER_BASE) != 0 && Character >= u'A' && Character <= u'Z') {
+            Character = (CHAR16)(Character + 0x20);
+        }
+        Name.push_back(Character);
+    }
+    if (ExtensionLength != 0) {
+        Name.push_back(u'.');
+    }
+    for (UINTN Index = 0; Index < ExtensionLength; Index++) {
+        CHAR16 Character = Entry->Name[8 + Index];
+        if ((Entry->CaseFlags & HOST_FAT_CASE_LOWER_EXTENSION) != 0 && Character >= u'A' && Character <= u'Z') {
+            Character = (CHAR16)(Character + 0x20);
+        }
+        Name.push_back(Character);
+    }
+    return Name;
+}
+
+/**
+ * Trims the space padding of an 11 character volume label
+ */
+static VOID HostFatSetLabel (
+    IN OUT HOST_FAT_VOLUME  *Volume,
+    IN const UINT8          *Label
+) {
+    UINTN Length = 11;
+    while (Length > 0 && Label[Length - 1] == ' ') {
+        Length--;
+    }
+    Volume->Label.assign(Label, Label + Length);
+    Volume->Label.push_back(CHAR_NULL);
+}
+
+/**
+ * Parses the raw entries of a directory, joining long name entries to the short
+ * entry they precede when their checksum matches
+ */
+static VOID HostFatParseDirectory (
+    IN OUT HOST_FAT_VOLUME      *Volume,
+    IN const UINT8              *Data,
+    IN UINTN                    Size,
+    IN BOOLEAN                  Root,
+    OUT HOST_FAT_DIRECTORY      *Directory
+) {
+    CHAR16 LongName[20 * HOST_FAT_LONG_NAME_CHARACTERS + 1];
+    UINTN LongParts = 0;
+    UINTN NextOrdinal = 0;
+    UINT8 Checksum = 0;
+
+    for (UINTN Offset = 0; Offset + sizeof(HOST_FAT_DIRECTORY_ENTRY) <= Size; Offset += sizeof(HOST_FAT_DIRECTORY_ENTRY)) {
+        HOST_FAT_DIRECTORY_ENTRY Entry;
+        __builtin_memcpy(&Entry, Data + Offset, sizeof(Entry));
+        if (Entry.Name[0] == 0) {
+            break;
+        }
+        if (Entry.Name[0] == HOST_FAT_ENTRY_FREE) {
+            NextOrdinal = 0;
+            continue;
+        }
+
+        if ((Entry.Attribute & HOST_FAT_ATTRIBUTE_LONG_MASK) == HOST_FAT_ATTRIBUTE_LONG_NAME) {
+            HOST_FAT_LONG_NAME_ENTRY Long;
+            __builtin_memcpy(&Long, &Entry, sizeof(Long));
+            UINTN Ordinal = Long.Ordinal & 0x1F;
+            if (Ordinal == 0 || Ordinal > 20) {
+                LongParts = 0;
+                NextOrdinal = 0;
+                continue;
+            }
+            if ((Long.Ordinal & HOST_FAT_LONG_NAME_LAST) != 0) {
+                LongParts = Ordinal;
+                Checksum = Long.Checksum;
+                LongName[Ordinal * HOST_FAT_LONG_NAME_CHARACTERS] = CHAR_NULL;
+            } else if (Ordinal != NextOrdinal || Long.Checksum != Checksum) {
+                LongParts = 0;
+                NextOrdinal = 0;
+                continue;
+            }
+
+            CHAR16 *Part = &LongName[(Ordinal - 1) * HOST_FAT_LONG_NAME_CHARACTERS];
+            for (UINTN Index = 0; Index < 5; Index++) {
+                Part[Index] = (CHAR16)(Long.Name1[Index * 2] | (Long.Name1[Index * 2 + 1] << 8));
+            }
+            for (UINTN Index = 0; Index < 6; Index++) {
+                Part[5 + Index] = (CHAR16)(Long.Name2[Index * 2] | (Long.Name2[Index * 2 + 1] << 8));
+            }
+            for (UINTN Index = 0; Index < 2; Index++) {
+                Part[11 + Index] = (CHAR16)(Long.Name3[Index * 2] | (Long.Name3[Index * 2 + 1] << 8));
+            }
+            NextOrdinal = Ordinal - 1;
+            continue;
+        }
+
+        BOOLEAN HasLongName = LongParts != 0 && NextOrdinal == 0 && Checksum == HostFatShortNameChecksum(Entry.Name);
+        LongParts = HasLongName ? LongParts : 0;
+        NextOrdinal = 0;
+
+        if ((Entry.Attribute & HOST_FAT_ATTRIBUTE_VOLUME_ID) != 0) {
+            if (Root) {
+                HostFatSetLabel(Volume, Entry.Name);
+            }
+            LongParts = 0;
+            continue;
+        }
+
+        HOST_FAT_ENTRY Parsed;
+        std::u16string ShortName = HostFatShortName(&Entry);
+        if (HasLongName) {
+            UINTN Length = 0;
+            while (Length < LongParts * HOST_FAT_LONG_NAME_CHARACTERS && LongName[Length] != CHAR_NULL) {
+                Length++;
+            }
+            Parsed.Name.assign(LongName, Length);
+        } else {
+            Parsed.Name = ShortName;
+        }
+        LongParts = 0;
+
+        Parsed.Attribute = Entry.Attribute & EFI_FILE_VALID_ATTR;
+        Parsed.FirstCluster = ((UINT32)Entry.FirstClusterHigh << 16) | Entry.FirstClusterLow;
+        if (Volume->FatType != 32) {
+            Parsed.FirstCluster &= 0xFFFF;
+        }
+        Parsed.Size = (Entry.Attribute & HOST_FAT_ATTRIBUTE_DIRECTORY) != 0 ? 0 : Entry.FileSize;
+        Parsed.CreateTenths = Entry.CreateTenths;
+        Parsed.CreateTime = Entry.CreateTime;
+        Parsed.CreateDate = Entry.CreateDate;
+        Parsed.AccessDate = Entry.AccessDate;
+        Parsed.WriteTime = Entry.WriteTime;
+        Parsed.WriteDate = Entry.WriteDate;
+
+        UINTN Position = Directory->Entries.size();
+        if (Parsed.Name != u"." && Parsed.Name != u"..") {
+            Directory->Index.emplace(HostFatUpcase(Parsed.Name), Position);
+            Directory->Index.emplace(HostFatUpcase(ShortName), Position);
+        }
+        Directory->Entries.push_back(std::move(Parsed));
+    }
+}
+
+/**
+ * Returns the directory starting at FirstCluster, 0 for the root, reading it on
+ * first use
+ */
+static HOST_FAT_DIRECTORY *HostFatLoadDirectory (
+    IN HOST_FAT_VOLUME  *Volume,
+    IN UINT32           FirstCluster,
+    OUT EFI_STATUS      *Status
+) {
+    auto Cached = Volume->Directories.find(FirstCluster);
+    if (Cached != Volume->Directories.end()) {
+        *Status = EFI_SUCCESS;
+        return &Cached->second;
+    }
+
+    std::vector<UINT8> Data;
+    if (FirstCluster == 0 && Volume->FatType != 32) {
+        Data.resize((UINTN)Volume->RootSize);
+        *Status = HostFatReadImage(Volume->Fd, Volume->RootOffset, Data.size(), Data.data());
+    } else {
+        std::vector<HOST_FAT_EXTENT> Extents;
+        HostFatBuildExtents(Volume, FirstCluster == 0 ? Volume->RootCluster : FirstCluster, &Extents);
+        if (Extents.empty()) {
+            *Status = EFI_VOLUME_CORRUPTED;
+            return NULL;
+        }
+        UINT64 Size = (UINT64)(Extents.back().FileCluster + Extents.back().Count) << Volume->ClusterShift;
+        Data.resize((UINTN)Size);
+        UINT8 *Cursor = Data.data();
+        *Status = EFI_SUCCESS;
+        HostFatForEachRun(Volume, Extents, 0, Size, [&] (UINT64 ImageOffset, UINT64 Length) {
+            *Status = HostFatReadImage(Volume->Fd, ImageOffset, (UINTN)Length, Cursor);
+            Cursor += Length;
+            return *Status == EFI_SUCCESS;
+        });
+    }
+    if (*Status != EFI_SUCCESS) {
+        return NULL;
+    }
+
+    HOST_FAT_DIRECTORY *Directory = &Volume->Directories[FirstCluster];
+    HostFatParseDirectory(Volume, Data.data(), Data.size(), FirstCluster == 0, Directory);
+    return Directory;
+}
+
+static VOID HostFatTimeToEfi (
+    IN UINT16       Date,
+    IN UINT16       Time,
+    IN UINT8        Tenths,
+    OUT EFI_TIME    *EfiTime
+) {
+    *EfiTime = {};
+    if (Date == 0) {
+        return;
+    }
+    EfiTime->Year = (UINT16)(1980 + (Date >> 9));
+    EfiTime->Month = (UINT8)((Date >> 5) & 0x0F);
+    EfiTime->Day = (UINT8)(Date & 0x1F);
+    EfiTime->Hour = (UINT8)(Time >> 11);
+    EfiTime->Minute = (UINT8)((Time >> 5) & 0x3F);
+    EfiTime->Second = (UINT8)((Time & 0x1F) * 2 + Tenths / 100);
+    EfiTime->Nanosecond = (UINT32)(Tenths % 100) * 10000000;
+    EfiTime->TimeZone = EFI_UNSPECIFIED_TIMEZONE;
+}
+
+static EFI_STATUS HostFatFillInfo (
+    IN const HOST_FAT_VOLUME    *Volume,
+    IN const HOST_FAT_ENTRY     *Entry,
+    IN OUT UINTN                *BufferSize,
+    OUT VOID                    *Buffer
+) {
+    UINTN Size = SIZE_OF_EFI_FILE_INFO + (Entry->Name.size() + 1) * sizeof(CHAR16);
+    if (*BufferSize < Size) {
+        *BufferSize = Size;
+        return EFI_BUFFER_TOO_SMALL;
+    }
+
+    UINT64 ClusterMask = ((UINT64)1 << Volume->ClusterShift) - 1;
+    EFI_FILE_INFO *Info = (EFI_FILE_INFO *)Buffer;
+    Info->Size = Size;
+    Info->FileSize = Entry->Size;
+    Info->PhysicalSize = (Entry->Size + ClusterMask) & ~ClusterMask;
+    HostFatTimeToEfi(Entry->CreateDate, Entry->CreateTime, Entry->CreateTenths, &Info->CreateTime);
+    HostFatTimeToEfi(Entry->AccessDate, 0, 0, &Info->LastAccessTime);
+    HostFatTimeToEfi(Entry->WriteDate, Entry->WriteTime, 0, &Info->ModificationTime);
+    Info->Attribute = Entry->Attribute;
+    __builtin_memcpy(Info->FileName, Entry->Name.c_str(), (Entry->Name.size() + 1) * sizeof(CHAR16));
+    *BufferSize = Size;
+    return EFI_SUCCESS;
+}
+
+/**
+ * Asks the host to page in the file range ahead of a sequential reader that has
+ * come within half a window of what was requested before
+ */
+static VOID HostFatReadahead (
+    IN HOST_FAT_FILE    *File,
+    IN UINT64           ReadStart,
+    IN UINT64           ReadEnd
+) {
+    if (ReadStart + HOST_FAT_READAHEAD < File->ReadaheadEnd || ReadStart > File->ReadaheadEnd) {
+        File->ReadaheadEnd = ReadEnd;
+    }
+    if (ReadEnd + HOST_FAT_READAHEAD / 2 < File->ReadaheadEnd || File->ReadaheadEnd >= File->Entry.Size) {
+        return;
+    }
+
+    UINT64 Start = std::max(ReadEnd, File->ReadaheadEnd);
+    UINT64 End = std::min<UINT64>(ReadEnd + HOST_FAT_READAHEAD, File->Entry.Size);
+    if (End > Start) {
+        INT32 Fd = File->Volume->Fd;
+        HostFatForEachRun(File->Volume, File->Extents, Start, End - Start, [Fd] (UINT64 ImageOffset, UINT64 Length) {
+            posix_fadvise(Fd, (off_t)ImageOffset, (off_t)Length, POSIX_FADV_WILLNEED);
+            return TRUE;
+        });
+    }
+    File->ReadaheadEnd = End;
+}
+
+static HOST_FAT_FILE *HostFatCreateHandle (
+    IN HOST_FAT_VOLUME  *Volume
+);
+
+static EFI_STATUS EFI_API HostFatOpen (
+    IN EFI_FILE_PROTOCOL    *This,
+    OUT EFI_FILE_PROTOCOL   **NewHandle,
+    IN CHAR16               *FileName,
+    IN UINT64               OpenMode,
+    IN UINT64               Attributes
+) {
+    (VOID)Attributes;
+
+    HOST_FAT_FILE *Parent = HostLookupFatFile(This);
+    if (Parent == NULL || NewHandle == NULL || FileName == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (OpenMode != EFI_FILE_MODE_READ && OpenMode != (EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE) &&
+        OpenMode != (EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE)) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if ((OpenMode & EFI_FILE_MODE_WRITE) != 0) {
+        return EFI_WRITE_PROTECTED;
+    }
+    if (Parent->Directory == NULL && FileName[0] != L'\\' && FileName[0] != CHAR_NULL) {
+        return EFI_NOT_FOUND;
+    }
+
+    //
+    // Resolve "." and ".." by name, so only real names are looked up on disk
+    //
+    std::vector<std::u16string> Path;
+    const CHAR16 *Cursor = FileName;
+    if (*Cursor == u'\\') {
+        Cursor++;
+    } else {
+        Path = Parent->Path;
+    }
+    while (*Cursor != CHAR_NULL) {
+        const CHAR16 *End = Cursor;
+        while (*End != CHAR_NULL && *End != u'\\') {
+            End++;
+        }
+        std::u16string Component(Cursor, (size_t)(End - Cursor));
+        Cursor = *End == CHAR_NULL ? End : End + 1;
+
+        if (Component.empty() || Component == u".") {
+            continue;
+        }
+        if (Component == u"..") {
+            if (Path.empty()) {
+                return EFI_NOT_FOUND;
+            }
+            Path.pop_back();
+            continue;
+        }
+        Path.push_back(std::move(Component));
+    }
+
+    HOST_FAT_VOLUME *Volume = Parent->Volume;
+    EFI_STATUS Status;
+    HOST_FAT_DIRECTORY *Directory = HostFatLoadDirectory(Volume, 0, &Status);
+    HOST_FAT_ENTRY Entry = {};
+    Entry.Attribute = EFI_FILE_DIRECTORY;
+
+    for (std::u16string &Component : Path) {
+        if (Status != EFI_SUCCESS) {
+            return Status;
+        }
+        if (Directory == NULL) {
+            return EFI_NOT_FOUND;
+        }
+        auto Found = Directory->Index.find(HostFatUpcase(Component));
+        if (Found == Directory->Index.end()) {
+            return EFI_NOT_FOUND;
+        }
+        Entry = Directory->Entries[Found->second];
+        Component = Entry.Name;
+
+        Directory = NULL;
+        Status = EFI_SUCCESS;
+        if ((Entry.Attribute & EFI_FILE_DIRECTORY) != 0) {
+            if (Entry.FirstCluster == 0) {
+                return EFI_VOLUME_CORRUPTED;
+            }
+            Directory = HostFatLoadDirectory(Volume, Entry.FirstCluster, &Status);
+        }
+    }
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+
+    HOST_FAT_FILE *File = HostFatCreateHandle(Volume);
+    File->Path = std::move(Path);
+    File->Entry = std::move(Entry);
+    File->Directory = Directory;
+    if (Directory == NULL) {
+        HostFatBuildExtents(Volume, File->Entry.FirstCluster, &File->Extents);
+    }
+    *NewHandle = &File->Protocol;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostFatClose (
+    IN EFI_FILE_PROTOCOL *This
+);
+
+static EFI_STATUS EFI_API HostFatDelete (
+    IN EFI_FILE_PROTOCOL *This
+) {
+    if (HostFatClose(This) != EFI_SUCCESS) {
+        return EFI_INVALID_PARAMETER;
+    }
+    return EFI_WARN_DELETE_FAILURE;
+}
+
+static EFI_STATUS EFI_API HostFatRead (
+    IN EFI_FILE_PROTOCOL    *This,
+    IN OUT UINTN            *BufferSize,
+    OUT VOID                *Buffer
+) {
+    HOST_FAT_FILE *File = HostLookupFatFile(This);
+    if (File == NULL || BufferSize == NULL || (*BufferSize != 0 && Buffer == NULL)) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    if (File->Directory != NULL) {
+        if (File->Position >= File->Directory->Entries.size()) {
+            *BufferSize = 0;
+            return EFI_SUCCESS;
+        }
+        EFI_STATUS Status = HostFatFillInfo(File->Volume, &File->Directory->Entries[(UINTN)File->Position], BufferSize, Buffer);
+        if (Status == EFI_SUCCESS) {
+            File->Position++;
+        }
+        return Status;
+    }
+
+    if (File->Position > File->Entry.Size) {
+        return EFI_DEVICE_ERROR;
+    }
+    UINT64 Length = std::min<UINT64>(*BufferSize, File->Entry.Size - File->Position);
+    UINT8 *Cursor = (UINT8 *)Buffer;
+    EFI_STATUS Status = EFI_SUCCESS;
+    BOOLEAN Complete = HostFatForEachRun(File->Volume, File->Extents, File->Position, Length, [&] (UINT64 ImageOffset, UINT64 Piece) {
+        Status = HostFatReadImage(File->Volume->Fd, ImageOffset, (UINTN)Piece, Cursor);
+        Cursor += Piece;
+        return Status == EFI_SUCCESS;
+    });
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    if (!Complete) {
+        return EFI_VOLUME_CORRUPTED;
+    }
+
+    HostFatReadahead(File, File->Position, File->Position + Length);
+    File->Position += Length;
+    *BufferSize = (UINTN)Length;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostFatWrite (
+    IN EFI_FILE_PROTOCOL    *This,
+    IN OUT UINTN            *BufferSize,
+    IN VOID                 *Buffer
+) {
+    (VOID)BufferSize;
+    (VOID)Buffer;
+
+    HOST_FAT_FILE *File = HostLookupFatFile(This);
+    if (File == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    return File->Directory != NULL ? EFI_UNSUPPORTED : EFI_ACCESS_DENIED;
+}
+
+static EFI_STATUS EFI_API HostFatGetPosition (
+    IN EFI_FILE_PROTOCOL    *This,
+    OUT UINT64              *Position
+) {
+    HOST_FAT_FILE *File = HostLookupFatFile(This);
+    if (File == NULL || Position == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (File->Directory != NULL) {
+        return EFI_UNSUPPORTED;
+    }
+    *Position = File->Position;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostFatSetPosition (
+    IN EFI_FILE_PROTOCOL    *This,
+    IN UINT64               Position
+) {
+    HOST_FAT_FILE *File = HostLookupFatFile(This);
+    if (File == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (File->Directory != NULL && Position != 0) {
+        return EFI_UNSUPPORTED;
+    }
+    File->Position = Position == UINT64_MAX ? File->Entry.Size : Position;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostFatGetInfo (
+    IN EFI_FILE_PROTOCOL    *This,
+    IN EFI_GUID             *InformationType,
+    IN OUT UINTN            *BufferSize,
+    OUT VOID                *Buffer
+) {
+    HOST_FAT_FILE *File = HostLookupFatFile(This);
+    if (File == NULL || InformationType == NULL || BufferSize == NULL || (*BufferSize != 0 && Buffer == NULL)) {
+        return EFI_INVALID_PARAMETER;
+    }
+    HOST_FAT_VOLUME *Volume = File->Volume;
+
+    if (CompareGuid(InformationType, &EFI_FILE_INFO_ID)) {
+        return HostFatFillInfo(Volume, &File->Entry, BufferSize, Buffer);
+    }
+
+    UINTN LabelSize = Volume->Label.size() * sizeof(CHAR16);
+    if (CompareGuid(InformationType, &EFI_FILE_SYSTEM_INFO_ID)) {
+        UINTN Size = SIZE_OF_EFI_FILE_SYSTEM_INFO + LabelSize;
+        if (*BufferSize < Size) {
+            *BufferSize = Size;
+            return EFI_BUFFER_TOO_SMALL;
+        }
+        EFI_FILE_SYSTEM_INFO *Info = (EFI_FILE_SYSTEM_INFO *)Buffer;
+        Info->Size = Size;
+        Info->ReadOnly = TRUE;
+        Info->VolumeSize = (UINT64)Volume->ClusterCount << Volume->ClusterShift;
+        Info->FreeSpace = Volume->FreeClusters << Volume->ClusterShift;
+        Info->BlockSize = (UINT32)1 << Volume->ClusterShift;
+        __builtin_memcpy(Info->VolumeLabel, Volume->Label.data(), LabelSize);
+        *BufferSize = Size;
+        return EFI_SUCCESS;
+    }
+
+    if (CompareGuid(InformationType, &EFI_FILE_SYSTEM_VOLUME_LABEL_ID)) {
+        if (*BufferSize < LabelSize) {
+            *BufferSize = LabelSize;
+            return EFI_BUFFER_TOO_SMALL;
+        }
+        __builtin_memcpy(Buffer, Volume->Label.data(), LabelSize);
+        *BufferSize = LabelSize;
+        return EFI_SUCCESS;
+    }
+    return EFI_UNSUPPORTED;
+}
+
+static EFI_STATUS EFI_API HostFatSetInfo (
+    IN EFI_FILE_PROTOCOL    *This,
+    IN EFI_GUID             *InformationType,
+    IN UINTN                BufferSize,
+    IN VOID                 *Buffer
+) {
+    (VOID)BufferSize;
+    if (HostLookupFatFile(This) == NULL || InformationType == NULL || Buffer == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFI_API HostFatFlush (
+    IN EFI_FILE_PROTOCOL *This
+) {
+    return HostLookupFatFile(This) == NULL ? EFI_INVALID_PARAMETER : EFI_ACCESS_DENIED;
+}
+
+/**
+ * The volume is read from the page cache of the host, so the Ex functions carry
+ * out the request at once and then signal the token
+ */
+static EFI_STATUS HostFatCompleteToken (
+    IN EFI_FILE_IO_TOKEN    *Token,
+    IN EFI_STATUS           Status
+) {
+    Token->Status = Status;
+    if (Status == EFI_SUCCESS && Token->Event != NULL) {
+        HostSignalEvent(Token->Event);
+    }
+    return Status;
+}
+
+static EFI_STATUS EFI_API HostFatOpenEx (
+    IN EFI_FILE_PROTOCOL        *This,
+    OUT EFI_FILE_PROTOCOL       **NewHandle,
+    IN CHAR16                   *FileName,
+    IN UINT64                   OpenMode,
+    IN UINT64                   Attributes,
+    IN OUT EFI_FILE_IO_TOKEN    *Token
+) {
+    if (Token == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    return HostFatCompleteToken(Token, HostFatOpen(This, NewHandle, FileName, OpenMode, Attributes));
+}
+
+static EFI_STATUS EFI_API HostFatReadEx (
+    IN EFI_FILE_PROTOCOL        *This,
+    IN OUT EFI_FILE_IO_TOKEN    *Token
+) {
+    if (Token == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    return HostFatCompleteToken(Token, HostFatRead(This, &Token->BufferSize, Token->Buffer));
+}
+
+static EFI_STATUS EFI_API HostFatWriteEx (
+    IN EFI_FILE_PROTOCOL        *This,
+    IN OUT EFI_FILE_IO_TOKEN    *Token
+) {
+    if (Token == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    return HostFatCompleteToken(Token, HostFatWrite(This, &Token->BufferSize, Token->Buffer));
+}
+
+static EFI_STATUS EFI_API HostFatFlushEx (
+    IN EFI_FILE_PROTOCOL        *This,
+    IN OUT EFI_FILE_IO_TOKEN    *Token
+) {
+    if (Token == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    return HostFatCompleteToken(Token, HostFatFlush(This));
+}
+
+static HOST_FAT_FILE *HostFatCreateHandle (
+    IN HOST_FAT_VOLUME *Volume
+) {
+    HOST_FAT_FILE *File = new HOST_FAT_FILE();
+    File->Protocol.Revision = EFI_FILE_PROTOCOL_REVISION2;
+    File->Protocol.Open = HostFatOpen;
+    File->Protocol.Close = HostFatClose;
+    File->Protocol.Delete = HostFatDelete;
+    File->Protocol.Read = HostFatRead;
+    File->Protocol.Write = HostFatWrite;
+    File->Protocol.GetPosition = HostFatGetPosition;
+    File->Protocol.SetPosition = HostFatSetPosition;
+    File->Protocol.GetInfo = HostFatGetInfo;
+    File->Protocol.SetInfo = HostFatSetInfo;
+    File->Protocol.Flush = HostFatFlush;
+    File->Protocol.OpenEx = HostFatOpenEx;
+    File->Protocol.ReadEx = HostFatReadEx;
+    File->Protocol.WriteEx = HostFatWriteEx;
+    File->Protocol.FlushEx = HostFatFlushEx;
+    File->Signature = HOST_FAT_FILE_SIGNATURE;
+    File->Volume = Volume;
+    File->Directory = NULL;
+    File->Position = 0;
+    File->ReadaheadEnd = 0;
+
+    Volume->OpenFiles++;
+    mFatFiles.insert(File);
+    return File;
+}
+
+static VOID HostFatReleaseVolume (
+    IN HOST_FAT_VOLUME *Volume
+) {
+    if (Volume->OpenFiles != 0 || Volume->Installed) {
+        return;
+    }
+    mFatVolumes.erase(Volume);
+    close(Volume->Fd);
+    Volume->Signature = 0;
+    delete Volume;
+}
+
+static EFI_STATUS EFI_API HostFatClose (
+    IN EFI_FILE_PROTOCOL *This
+) {
+    HOST_FAT_FILE *File = HostLookupFatFile(This);
+    if (File == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    mFatFiles.erase(File);
+    HostFileForgetDirectoryError(This);
+    HOST_FAT_VOLUME *Volume = File->Volume;
+    Volume->OpenFiles--;
+    HostFatReleaseVolume(Volume);
+
+    File->Signature = 0;
+    delete File;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostFatOpenVolume (
+    IN EFI_SIMPLE_FILE_SYSTEM_PROTOCOL  *This,
+    OUT EFI_FILE_PROTOCOL               **Root
+) {
+    HOST_FAT_VOLUME *Volume = (HOST_FAT_VOLUME *)This;
+    if (Volume == NULL || Root == NULL || mFatVolumes.count(Volume) == 0 || Volume->Signature != HOST_FAT_VOLUME_SIGNATURE) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_STATUS Status;
+    HOST_FAT_DIRECTORY *Directory = HostFatLoadDirectory(Volume, 0, &Status);
+    if (Directory == NULL) {
+        return Status;
+    }
+    HOST_FAT_FILE *File = HostFatCreateHandle(Volume);
+    File->Entry.Attribute = EFI_FILE_DIRECTORY;
+    File->Directory = Directory;
+    *Root = &File->Protocol;
+    return EFI_SUCCESS;
+}
+
+static BOOLEAN HostFatIsBootSector (
+    IN const HOST_FAT_BOOT_SECTOR *Boot
+) {
+    if (Boot->JumpBoot[0] != 0xEB && Boot->JumpBoot[0] != 0xE9) {
+        return FALSE;
+    }
+    UINT16 BytesPerSector = Boot->BytesPerSector;
+    UINT8 SectorsPerCluster = Boot->SectorsPerCluster;
+    return BytesPerSector >= 512 && BytesPerSector <= 4096 && (BytesPerSector & (BytesPerSector - 1)) == 0 &&
+           SectorsPerCluster != 0 && (SectorsPerCluster & (SectorsPerCluster - 1)) == 0 &&
+           Boot->NumberOfFats != 0 && Boot->ReservedSectors != 0;
+}
+
+/**
+ * Finds the byte offset of the FAT volume in the image: the image itself, the
+ * EFI system partition of a GPT disk, or the first FAT partition of an MBR disk
+ */
+static EFI_STATUS HostFatLocateVolume (
+    IN INT32    Fd,
+    OUT UINT64  *Base
+) {
+    union {
+        HOST_FAT_BOOT_SECTOR    Boot;
+        MASTER_BOOT_RECORD      Mbr;
+        UINT8                   Bytes[512];
+    } Sector;
+    EFI_STATUS Status = HostFatReadImage(Fd, 0, sizeof(Sector), &Sector);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    if (HostFatIsBootSector(&Sector.Boot)) {
+        *Base = 0;
+        return EFI_SUCCESS;
+    }
+    if (Sector.Mbr.Signature != MBR_SIGNATURE) {
+        return EFI_UNSUPPORTED;
+    }
+
+    if (Sector.Mbr.Partition[0].OSIndicator == PMBR_GPT_PARTITION) {
+        for (UINT32 BlockSize = 512; BlockSize <= 4096; BlockSize *= 8) {
+            std::vector<UINT8> Block(BlockSize);
+            if (HostFatReadImage(Fd, BlockSize, BlockSize, Block.data()) != EFI_SUCCESS) {
+                continue;
+            }
+            const EFI_PARTITION_TABLE_HEADER *Header = (const EFI_PARTITION_TABLE_HEADER *)Block.data();
+            if (!ValidateGptHeader(Header, BlockSize)) {
+                continue;
+            }
+            UINT64 EntriesSize = (UINT64)Header->NumberOfPartitionEntries * Header->SizeOfPartitionEntry;
+            if (EntriesSize > HOST_FAT_MAX_GPT_ENTRIES_SIZE) {
+                return EFI_UNSUPPORTED;
+            }
+            std::vector<UINT8> Entries((UINTN)EntriesSize);
+            Status = HostFatReadImage(Fd, Header->PartitionEntryLBA * BlockSize, Entries.size(), Entries.data());
+            if (Status != EFI_SUCCESS || !ValidateGptEntries(Header, Entries.data(), Entries.size())) {
+                return EFI_VOLUME_CORRUPTED;
+            }
+            for (UINT32 Index = 0; Index < Header->NumberOfPartitionEntries; Index++) {
+                EFI_PARTITION_ENTRY Entry;
+                __builtin_memcpy(&Entry, &Entries[(UINTN)Index * Header->SizeOfPartitionEntry], sizeof(Entry));
+                if (CompareGuid(&Entry.PartitionTypeGUID, &EFI_PART_TYPE_EFI_SYSTEM_PART_GUID)) {
+                    *Base = Entry.StartingLBA * BlockSize;
+                    return EFI_SUCCESS;
+                }
+            }
+            return EFI_NOT_FOUND;
+        }
+        return EFI_VOLUME_CORRUPTED;
+    }
+
+    for (UINTN Index = 0; Index < 4; Index++) {
+        const MBR_PARTITION_RECORD *Partition = &Sector.Mbr.Partition[Index];
+        switch (Partition->OSIndicator) {
+        case 0x01:  // FAT12
+        case 0x04:  // FAT16 below 32 MiB
+        case 0x06:  // FAT16
+        case 0x0B:  // FAT32
+        case 0x0C:  // FAT32, LBA
+        case 0x0E:  // FAT16, LBA
+        case EFI_PARTITION:
+            break;
+        default:
+            continue;
+        }
+        UINT32 StartingLba;
+        __builtin_memcpy(&StartingLba, Partition->StartingLBA, sizeof(StartingLba));
+        HOST_FAT_BOOT_SECTOR Boot;
+        if (HostFatReadImage(Fd, (UINT64)StartingLba * 512, sizeof(Boot), &Boot) == EFI_SUCCESS && HostFatIsBootSector(&Boot)) {
+            *Base = (UINT64)StartingLba * 512;
+            return EFI_SUCCESS;
+        }
+    }
+    return EFI_NOT_FOUND;
+}
+
+/**
+ * Reads the boot sector and the first FAT of the volume at Base and derives its
+ * geometry
+ */
+static EFI_STATUS HostFatMount (
+    IN OUT HOST_FAT_VOLUME  *Volume,
+    IN UINT64               Base
+) {
+    HOST_FAT_BOOT_SECTOR Boot;
+    EFI_STATUS Status = HostFatReadImage(Volume->Fd, Base, sizeof(Boot), &Boot);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    if (!HostFatIsBootSector(&Boot)) {
+        return EFI_UNSUPPORTED;
+    }
+
+    UINT64 BytesPerSector = Boot.BytesPerSector;
+    UINT64 FatSectors = Boot.FatSize16 != 0 ? Boot.FatSize16 : Boot.Fat32.FatSize32;
+    UINT64 TotalSectors = Boot.TotalSectors16 != 0 ? Boot.TotalSectors16 : Boot.TotalSectors32;
+    UINT64 RootSectors = ((UINT64)Boot.RootEntries * sizeof(HOST_FAT_DIRECTORY_ENTRY) + BytesPerSector - 1) / BytesPerSector;
+    UINT64 DataSector = Boot.ReservedSectors + Boot.NumberOfFats * FatSectors + RootSectors;
+    if (FatSectors == 0 || DataSector >= TotalSectors) {
+        return EFI_VOLUME_CORRUPTED;
+    }
+
+    UINT64 ClusterCount = (TotalSectors - DataSector) / Boot.SectorsPerCluster;
+    Volume->FatType = ClusterCount < 4085 ? 12 : ClusterCount < 65525 ? 16 : 32;
+    Volume->ClusterShift = (UINT32)__builtin_ctzll(BytesPerSector * Boot.SectorsPerCluster);
+    Volume->ClusterCount = (UINT32)std::min<UINT64>(ClusterCount, 0x0FFFFFF5);
+    Volume->RootOffset = Base + (Boot.ReservedSectors + Boot.NumberOfFats * FatSectors) * BytesPerSector;
+    Volume->RootSize = RootSectors * BytesPerSector;
+    Volume->DataOffset = Base + DataSector * BytesPerSector;
+    if (Volume->FatType == 32) {
+        if (Boot.RootEntries != 0 || !HostFatIsDataCluster(Volume, Boot.Fat32.RootCluster)) {
+            return EFI_VOLUME_CORRUPTED;
+        }
+        Volume->RootCluster = Boot.Fat32.RootCluster;
+    } else if (Boot.RootEntries == 0) {
+        return EFI_VOLUME_CORRUPTED;
+    }
+
+    //
+    // Keep the part of the first FAT that describes the data area in memory
+    //
+    UINT64 Entries = (UINT64)Volume->ClusterCount + 2;
+    UINT64 FatBytes = Volume->FatType == 12 ? (Entries * 3 + 1) / 2 + 1 : Entries * (Volume->FatType / 8);
+    if (FatBytes > FatSectors * BytesPerSector + (Volume->FatType == 12 ? 1 : 0)) {
+        return EFI_VOLUME_CORRUPTED;
+    }
+    Volume->Fat.assign((UINTN)FatBytes, 0);
+    UINT64 FatRead = std::min(FatBytes, FatSectors * BytesPerSector);
+    Status = HostFatReadImage(Volume->Fd, Base + Boot.ReservedSectors * BytesPerSector, (UINTN)FatRead, Volume->Fat.data());
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+
+    Volume->FreeClusters = 0;
+    for (UINT32 Cluster = 2; Cluster < Entries; Cluster++) {
+        if (HostFatNext(Volume, Cluster) == 0) {
+            Volume->FreeClusters++;
+        }
+    }
+
+    const CHAR8 *Label = Volume->FatType == 32 ? Boot.Fat32.VolumeLabel : Boot.Fat16.VolumeLabel;
+    UINT8 BootSignature = Volume->FatType == 32 ? Boot.Fat32.BootSignature : Boot.Fat16.BootSignature;
+    if (BootSignature == 0x29 && __builtin_memcmp(Label, "NO NAME    ", 11) != 0) {
+        HostFatSetLabel(Volume, (const UINT8 *)Label);
+    } else {
+        Volume->Label.assign(1, CHAR_NULL);
+    }
+
+    //
+    // Reading the root directory picks up the label it may carry
+    //
+    HostFatLoadDirectory(Volume, 0, &Status);
+    return Status;
+}
+
+EFI_STATUS EfiHostInstallFatFileSystem (
+    IN const CHAR8      *Path,
+    IN OUT EFI_HANDLE   *Handle
+) {
+    if (Path == NULL || Handle == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (gHostSystemTable == NULL) {
+        return EFI_NOT_STARTED;
+    }
+
+    INT32 Fd = open(Path, O_RDONLY | O_CLOEXEC);
+    if (Fd < 0) {
+        return errno == ENOENT ? EFI_NOT_FOUND : EFI_ACCESS_DENIED;
+    }
+
+    HOST_FAT_VOLUME *Volume = new HOST_FAT_VOLUME();
+    Volume->FileSystem.Revision = EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_REVISION;
+    Volume->FileSystem.OpenVolume = HostFatOpenVolume;
+    Volume->Signature = HOST_FAT_VOLUME_SIGNATURE;
+    Volume->Fd = Fd;
+    Volume->Installed = FALSE;
+    Volume->OpenFiles = 0;
+    mFatVolumes.insert(Volume);
+
+    UINT64 Base = 0;
+    EFI_STATUS Status = HostFatLocateVolume(Fd, &Base);
+    if (Status == EFI_SUCCESS) {
+        Status = HostFatMount(Volume, Base);
+    }
+    if (Status == EFI_SUCCESS) {
+        Status = HostInstallProtocolInterface(Handle, &EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_GUID, EFI_NATIVE_INTERFACE, &Volume->FileSystem);
+    }
+    if (Status != EFI_SUCCESS) {
+        HostFatReleaseVolume(Volume);
+        return Status;
+    }
+    Volume->Installed = TRUE;
+    return EFI_SUCCESS;
+}
+
+VOID HostFatShutdown (
+    VOID
+) {
+    while (!mFatFiles.empty()) {
+        HostFatClose(&(*mFatFiles.begin())->Protocol);
+    }
+    while (!mFatVolumes.empty()) {
+        HOST_FAT_VOLUME *Volume = *mFatVolumes.begin();
+        Volume->Installed = FALSE;
+        HostFatReleaseVolume(Volume);
+    }
+}
@@ -0,0 +1,1536 @@
+#include "internal.h"
+
+#include <efi/guid.h>
+#include <efi/string.h>
+
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#define HOST_FILE_SIGNATURE         HOST_SIGNATURE_32('f', 'i', 'l', 'e')
+#define HOST_FILE_VOLUME_SIGNATURE  HOST_SIGNATURE_32('f', 'v', 'o', 'l')
+
+/**
+ * Open modes accepted by Open, per UEFI Specification 2.10 Section 13.5.2
+ */
+#define HOST_FILE_MODE_READ_ONLY    (EFI_FILE_MODE_READ)
+#define HOST_FILE_MODE_READ_WRITE   (EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE)
+#define HOST_FILE_MODE_CREATE       (EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE)
+
+/**
+ * Largest transfer handed to the kernel in one request. Longer requests are
+ * carried out as a chain of transfers.
+ */
+#define HOST_FILE_IO_CHUNK 0x40000000
+
+/**
+ * Mappings EfiHostMapFile can hand out at once
+ */
+#define HOST_FILE_MAPPINGS 64
+
+typedef struct {
+    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL FileSystem;
+    UINT32                          Signature;
+    INT32                           RootFd;
+    BOOLEAN                         ReadOnly;
+    BOOLEAN                         Installed;      // FileSystem is on a handle and keeps the volume alive
+    UINTN                           OpenFiles;
+    std::vector<CHAR16>             Label;          // Null-terminated
+    UINT64                          Generation;     // Advanced by every change made through the volume
+    struct statvfs                  FileSystemStat; // As of FileSystemGeneration, 0 when not taken
+    UINT64                          FileSystemGeneration;
+} HOST_FILE_VOLUME;
+
+typedef struct {
+    EFI_FILE_PROTOCOL   Protocol;
+    UINT32              Signature;
+    HOST_FILE_VOLUME    *Volume;
+    std::string         Path;           // Relative to the volume root, empty for the root itself
+    INT32               Fd;
+    BOOLEAN             Directory;
+    UINT64              OpenMode;
+    UINT64              Position;
+    UINT64              Size;           // Size of a regular file as last seen or written
+    UINTN               Pending;        // Asynchronous requests in flight
+    DIR                 *Stream;        // Directory enumeration, opened by the first Read
+    std::string         Entry;          // Directory entry a too small Read left to return next
+    BOOLEAN             EntryPending;
+    struct stat         Stat;           // As of StatGeneration, 0 when not taken
+    UINT64              StatGeneration;
+} HOST_FILE;
+
+/**
+ * One ReadEx, WriteEx or FlushEx in flight
+ */
+typedef struct {
+    HOST_FILE           *File;
+    EFI_FILE_IO_TOKEN   *Token;
+    UINT8               Opcode;
+    UINT8               *Buffer;
+    UINT64              Offset;
+    UINTN               Length;
+    UINTN               Done;
+} HOST_FILE_REQUEST;
+
+/**
+ * A mapping handed out by EfiHostMapFile. The SIGBUS handler reads these, so Base
+ * is published last and cleared first.
+ */
+typedef struct {
+    UINTN       Base;       // Page aligned start of the host mapping, 0 when unused
+    UINTN       Length;     // Whole pages
+    const VOID  *Mapping;   // Address given to the caller, inside the first page
+} HOST_FILE_MAPPING;
+
+static std::unordered_set<HOST_FILE_VOLUME *>   mVolumes;
+static std::unordered_set<HOST_FILE *>          mFiles;
+static BOOLEAN                                  mFileShutdown;
+static std::unordered_map<EFI_FILE_PROTOCOL *, EFI_STATUS>  mDirectoryErrors;   // Held back by EfiHostReadDirectoryEntries
+static HOST_FILE_MAPPING                        mMappings[HOST_FILE_MAPPINGS];
+static UINTN                                    mMapPageSize;
+static BOOLEAN                                  mMapHandlerInstalled;
+static struct sigaction                         mPreviousBusAction;
+
+static HOST_FILE *HostLookupFile (
+    IN EFI_FILE_PROTOCOL *This
+) {
+    HOST_FILE *File = (HOST_FILE *)This;
+    if (File == NULL || mFiles.count(File) == 0 || File->Signature != HOST_FILE_SIGNATURE) {
+        return NULL;
+    }
+    return File;
+}
+
+static EFI_STATUS HostFileStatusFromErrno (
+    IN INT32 Error
+) {
+    switch (Error) {
+    case ENOENT:
+    case ENOTDIR:
+    case ELOOP:
+    case ENAMETOOLONG:
+        return EFI_NOT_FOUND;
+    case EACCES:
+    case EPERM:
+    case EEXIST:
+    case ENOTEMPTY:
+    case EBUSY:
+        return EFI_ACCESS_DENIED;
+    case EROFS:
+        return EFI_WRITE_PROTECTED;
+    case ENOSPC:
+    case EDQUOT:
+    case EFBIG:
+        return EFI_VOLUME_FULL;
+    case ENOMEM:
+    case EMFILE:
+    case ENFILE:
+        return EFI_OUT_OF_RESOURCES;
+    default:
+        return EFI_DEVICE_ERROR;
+    }
+}
+
+/**
+ * Reads up to Length bytes at Offset, stopping early only at the end of the file
+ */
+static EFI_STATUS HostFileReadAt (
+    IN INT32    Fd,
+    OUT UINT8   *Buffer,
+    IN UINTN    Length,
+    IN UINT64   Offset,
+    OUT UINTN   *Done
+) {
+    *Done = 0;
+    while (*Done < Length) {
+        ssize_t Read = pread(Fd, Buffer + *Done, Length - *Done, (off_t)(Offset + *Done));
+        if (Read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return HostFileStatusFromErrno(errno);
+        }
+        if (Read == 0) {
+            break;
+        }
+        *Done += (UINTN)Read;
+    }
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS HostFileWriteAt (
+    IN INT32        Fd,
+    IN const UINT8  *Buffer,
+    IN UINTN        Length,
+    IN UINT64       Offset,
+    OUT UINTN       *Done
+) {
+    *Done = 0;
+    while (*Done < Length) {
+        ssize_t Written = pwrite(Fd, Buffer + *Done, Length - *Done, (off_t)(Offset + *Done));
+        if (Written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return HostFileStatusFromErrno(errno);
+        }
+        *Done += (UINTN)Written;
+    }
+    return EFI_SUCCESS;
+}
+
+/**
+ * Resolves FileName against Base, a directory path relative to the volume root.
+ * A leading backslash starts from the root, and ".." may not climb above it.
+ */
+static EFI_STATUS HostFileResolvePath (
+    IN const std::string    &Base,
+    IN const CHAR16         *FileName,
+    OUT std::string         *Path
+) {
+    UINTN Length = StrLen(FileName);
+    UINTN Utf8Length = 0;
+    Char16ToUtf8(FileName, Length, NULL, &Utf8Length, 0);
+    std::string Name(Utf8Length, '\0');
+    if (Char16ToUtf8(FileName, Length, &Name[0], &Utf8Length, 0) != EFI_SUCCESS) {
+        return EFI_NOT_FOUND;
+    }
+
+    if (!Name.empty() && Name[0] == '\\') {
+        Path->clear();
+    } else {
+        *Path = Base;
+    }
+
+    size_t Start = 0;
+    while (Start <= Name.size()) {
+        size_t End = Name.find('\\', Start);
+        if (End == std::string::npos) {
+            End = Name.size();
+        }
+        std::string Component = Name.substr(Start, End - Start);
+        Start = End + 1;
+
+        if (Component.empty() || Component == ".") {
+            continue;
+        }
+        if (Component == "..") {
+            if (Path->empty()) {
+                return EFI_NOT_FOUND;
+            }
+            size_t Slash = Path->rfind('/');
+            Path->erase(Slash == std::string::npos ? 0 : Slash);
+            continue;
+        }
+        if (Component.find('/') != std::string::npos) {
+            return EFI_NOT_FOUND;
+        }
+        if (!Path->empty()) {
+            Path->push_back('/');
+        }
+        Path->append(Component);
+    }
+    return EFI_SUCCESS;
+}
+
+/**
+ * Returns the last component of Path, which is empty for the volume root
+ */
+static std::string HostFileBaseName (
+    IN const std::string &Path
+) {
+    size_t Slash = Path.rfind('/');
+    return Slash == std::string::npos ? Path : Path.substr(Slash + 1);
+}
+
+static VOID HostFileTimeFromHost (
+    IN const struct timespec    *Host,
+    OUT EFI_TIME                *Time
+) {
+    struct tm Calendar;
+    *Time = {};
+    if (gmtime_r(&Host->tv_sec, &Calendar) == NULL) {
+        return;
+    }
+    Time->Year = (UINT16)(Calendar.tm_year + 1900);
+    Time->Month = (UINT8)(Calendar.tm_mon + 1);
+    Time->Day = (UINT8)Calendar.tm_mday;
+    Time->Hour = (UINT8)Calendar.tm_hour;
+    Time->Minute = (UINT8)Calendar.tm_min;
+    Time->Second = (UINT8)Calendar.tm_sec;
+    Time->Nanosecond = (UINT32)Host->tv_nsec;
+}
+
+/**
+ * Converts Time for utimensat. An all-zero EFI_TIME leaves the host time as it
+ * is; other times must be valid.
+ */
+static BOOLEAN HostFileTimeToHost (
+    IN const EFI_TIME   *Time,
+    OUT struct timespec *Host
+) {
+    static const EFI_TIME Zero = {};
+    if (__builtin_memcmp(Time, &Zero, sizeof(EFI_TIME)) == 0) {
+        Host->tv_sec = 0;
+        Host->tv_nsec = UTIME_OMIT;
+        return TRUE;
+    }
+    if (Time->Year < 1900 || Time->Month < 1 || Time->Month > 12 || Time->Day < 1 || Time->Day > 31 ||
+        Time->Hour > 23 || Time->Minute > 59 || Time->Second > 59 || Time->Nanosecond > 999999999) {
+        return FALSE;
+    }
+    if (Time->TimeZone != EFI_UNSPECIFIED_TIMEZONE && (Time->TimeZone < -1440 || Time->TimeZone > 1440)) {
+        return FALSE;
+    }
+
+    struct tm Calendar = {};
+    Calendar.tm_year = Time->Year - 1900;
+    Calendar.tm_mon = Time->Month - 1;
+    Calendar.tm_mday = Time->Day;
+    Calendar.tm_hour = Time->Hour;
+    Calendar.tm_min = Time->Minute;
+    Calendar.tm_sec = Time->Second;
+    Host->tv_sec = timegm(&Calendar);
+    if (Time->TimeZone != EFI_UNSPECIFIED_TIMEZONE) {
+        Host->tv_sec += (time_t)Time->TimeZone * 60;
+    }
+    Host->tv_nsec = (long)Time->Nanosecond;
+    return TRUE;
+}
+
+/**
+ * Records a change made through Volume, which retires the information GetInfo
+ * cached for its handles
+ */
+static VOID HostFileTouch (
+    IN HOST_FILE_VOLUME *Volume
+) {
+    Volume->Generation++;
+}
+
+/**
+ * Returns the host status of File. It is taken again only after a change made
+ * through the volume, so changes made on the host behind its back show up once
+ * the volume next changes.
+ */
+static EFI_STATUS HostFileStat (
+    IN HOST_FILE            *File,
+    OUT const struct stat   **Stat
+) {
+    if (File->StatGeneration != File->Volume->Generation) {
+        if (fstat(File->Fd, &File->Stat) != 0) {
+            File->StatGeneration = 0;
+            return HostFileStatusFromErrno(errno);
+        }
+        File->StatGeneration = File->Volume->Generation;
+    }
+    *Stat = &File->Stat;
+    return EFI_SUCCESS;
+}
+
+/**
+ * Builds the EFI_FILE_INFO of a host file called Name
+ */
+static EFI_STATUS HostFileFillInfo (
+    IN const struct stat    *Stat,
+    IN const std::string    &Name,
+    IN OUT UINTN            *BufferSize,
+    OUT VOID                *Buffer
+) {
+    UINTN NameLength = 0;
+    Utf8ToChar16(Name.data(), Name.size(), NULL, &NameLength, UTF_REPLACE_INVALID);
+    UINTN Size = SIZE_OF_EFI_FILE_INFO + (NameLength + 1) * sizeof(CHAR16);
+    if (*BufferSize < Size) {
+        *BufferSize = Size;
+        return EFI_BUFFER_TOO_SMALL;
+    }
+
+    EFI_FILE_INFO *Info = (EFI_FILE_INFO *)Buffer;
+    Info->Size = Size;
+    Info->FileSize = (UINT64)Stat->st_size;
+    Info->PhysicalSize = (UINT64)Stat->st_blocks * 512;
+    HostFileTimeFromHost(&Stat->st_ctim, &Info->CreateTime);
+    HostFileTimeFromHost(&Stat->st_atim, &Info->LastAccessTime);
+    HostFileTimeFromHost(&Stat->st_mtim, &Info->ModificationTime);
+    Info->Attribute = 0;
+    if (S_ISDIR(Stat->st_mode)) {
+        Info->Attribute |= EFI_FILE_DIRECTORY;
+    }
+    if ((Stat->st_mode & (S_IWUSR | S_IWGRP | S_IWOTH)) == 0) {
+        Info->Attribute |= EFI_FILE_READ_ONLY;
+    }
+    Utf8ToChar16(Name.data(), Name.size(), Info->FileName, &NameLength, UTF_REPLACE_INVALID);
+    Info->FileName[NameLength] = CHAR_NULL;
+    *BufferSize = Size;
+    return EFI_SUCCESS;
+}
+
+/**
+ * Returns the next directory entry of File. An entry that does not fit stays
+ * pending, so the caller can retry it with a larger buffer.
+ */
+static EFI_STATUS HostFileReadDirectory (
+    IN HOST_FILE    *File,
+    IN OUT UINTN    *BufferSize,
+    OUT VOID        *Buffer
+) {
+    if (File->Stream == NULL) {
+        INT32 Fd = openat(File->Fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (Fd < 0) {
+            return HostFileStatusFromErrno(errno);
+        }
+        File->Stream = fdopendir(Fd);
+        if (File->Stream == NULL) {
+            close(Fd);
+            return EFI_DEVICE_ERROR;
+        }
+    }
+
+    for (;;) {
+        if (!File->EntryPending) {
+            errno = 0;
+            struct dirent *Entry = readdir(File->Stream);
+            if (Entry == NULL) {
+                if (errno != 0) {
+                    return EFI_DEVICE_ERROR;
+                }
+                *BufferSize = 0;
+                return EFI_SUCCESS;
+            }
+
+            //
+            // Like FAT, the root directory has no "." and ".." entries
+            //
+            if (File->Path.empty() && (__builtin_strcmp(Entry->d_name, ".") == 0 || __builtin_strcmp(Entry->d_name, "..") == 0)) {
+                continue;
+            }
+            File->Entry = Entry->d_name;
+            File->EntryPending = TRUE;
+        }
+
+        //
+        // Entries that are neither files nor directories, or that vanished, are
+        // not part of the volume
+        //
+        struct stat Stat;
+        if (fstatat(File->Fd, File->Entry.c_str(), &Stat, 0) != 0 || (!S_ISDIR(Stat.st_mode) && !S_ISREG(Stat.st_mode))) {
+            File->EntryPending = FALSE;
+            continue;
+        }
+
+        EFI_STATUS Status = HostFileFillInfo(&Stat, File->Entry, BufferSize, Buffer);
+        if (Status == EFI_SUCCESS) {
+            File->EntryPending = FALSE;
+        }
+        return Status;
+    }
+}
+
+static EFI_STATUS EFI_API HostFileOpen (
+    IN EFI_FILE_PROTOCOL    *This,
+    OUT EFI_FILE_PROTOCOL   **NewHandle,
+    IN CHAR16               *FileName,
+    IN UINT64               OpenMode,
+    IN UINT64               Attributes
+);
+
+static VOID HostFileComplete (
+    IN VOID     *Context,
+    IN INT32    Result
+);
+
+/**
+ * Starts the next transfer of Request, or carries it out synchronously when no
+ * ring is available. Returns FALSE when the request has been completed.
+ */
+static BOOLEAN HostFileIssue (
+    IN HOST_FILE_REQUEST *Request
+) {
+    HOST_FILE *File = Request->File;
+    UINTN Length = Request->Length - Request->Done;
+    if (Length > HOST_FILE_IO_CHUNK) {
+        Length = HOST_FILE_IO_CHUNK;
+    }
+
+    EFI_STATUS Status = HostUringSubmit(Request->Opcode, File->Fd, Request->Buffer + Request->Done, (UINT32)Length, Request->Offset + Request->Done, HostFileComplete, Request);
+    if (Status == EFI_SUCCESS) {
+        return TRUE;
+    }
+
+    UINTN Done = 0;
+    if (Request->Opcode == IORING_OP_READ) {
+        Status = HostFileReadAt(File->Fd, Request->Buffer + Request->Done, Request->Length - Request->Done, Request->Offset + Request->Done, &Done);
+    } else if (Request->Opcode == IORING_OP_WRITE) {
+        Status = HostFileWriteAt(File->Fd, Request->Buffer + Request->Done, Request->Length - Request->Done, Request->Offset + Request->Done, &Done);
+    } else {
+        Status = EFI_SUCCESS;
+        if (fsync(File->Fd) != 0) {
+            Status = HostFileStatusFromErrno(errno);
+        }
+    }
+    Request->Done += Done;
+    Request->Token->Status = Status;
+    return FALSE;
+}
+
+/**
+ * Finishes Request: reports the outcome in its token and signals the token event
+ */
+static VOID HostFileFinish (
+    IN HOST_FILE_REQUEST *Request
+) {
+    EFI_FILE_IO_TOKEN *Token = Request->Token;
+    Request->File->Pending--;
+    if (Request->Opcode != IORING_OP_FSYNC) {
+        Token->BufferSize = Request->Done;
+    }
+    if (Request->Opcode == IORING_OP_WRITE) {
+        HostFileTouch(Request->File->Volume);
+    }
+    BOOLEAN Signal = !mFileShutdown;
+    delete Request;
+
+    if (Signal) {
+        HostSignalEvent(Token->Event);
+    }
+}
+
+static VOID HostFileComplete (
+    IN VOID     *Context,
+    IN INT32    Result
+) {
+    HOST_FILE_REQUEST *Request = (HOST_FILE_REQUEST *)Context;
+    if (Result < 0) {
+        Request->Token->Status = HostFileStatusFromErrno(-Result);
+        HostFileFinish(Request);
+        return;
+    }
+
+    Request->Token->Status = EFI_SUCCESS;
+    if (Request->Opcode != IORING_OP_FSYNC && Result > 0) {
+        Request->Done += (UINTN)Result;
+        if (Request->Done < Request->Length && HostFileIssue(Request)) {
+            return;
+        }
+    }
+    HostFileFinish(Request);
+}
+
+/**
+ * Queues an asynchronous request for Token, or completes it at once when the
+ * transfer could be carried out without the ring
+ */
+static EFI_STATUS HostFileQueue (
+    IN HOST_FILE            *File,
+    IN EFI_FILE_IO_TOKEN    *Token,
+    IN UINT8                Opcode,
+    IN UINT64               Offset,
+    IN UINTN                Length
+) {
+    HOST_FILE_REQUEST *Request = new HOST_FILE_REQUEST();
+    Request->File = File;
+    Request->Token = Token;
+    Request->Opcode = Opcode;
+    Request->Buffer = (UINT8 *)Token->Buffer;
+    Request->Offset = Offset;
+    Request->Length = Length;
+    Request->Done = 0;
+    File->Pending++;
+
+    if (Length == 0 && Opcode != IORING_OP_FSYNC) {
+        Token->Status = EFI_SUCCESS;
+        HostFileFinish(Request);
+    } else if (!HostFileIssue(Request)) {
+        HostFileFinish(Request);
+    }
+    return EFI_SUCCESS;
+}
+
+/**
+ * Waits until every asynchronous request of File has completed
+ */
+static VOID HostFileDrain (
+    IN HOST_FILE *File
+) {
+    while (File->Pending != 0) {
+        HostUringWait(UINT64_MAX);
+        EFI_TPL OldTpl = HostRaiseTpl(TPL_HIGH_LEVEL);
+        HostUringPoll();
+        HostRestoreTpl(OldTpl);
+    }
+}
+
+/**
+ * Frees Volume once it has neither open files nor a handle keeping it alive
+ */
+static VOID HostFileReleaseVolume (
+    IN HOST_FILE_VOLUME *Volume
+) {
+    if (Volume->OpenFiles != 0 || Volume->Installed) {
+        return;
+    }
+    mVolumes.erase(Volume);
+    close(Volume->RootFd);
+    Volume->Signature = 0;
+    delete Volume;
+}
+
+static VOID HostFileDestroy (
+    IN HOST_FILE *File
+) {
+    HostFileDrain(File);
+    mFiles.erase(File);
+    HostFileForgetDirectoryError(&File->Protocol);
+    if (File->Stream != NULL) {
+        closedir(File->Stream);
+    }
+    close(File->Fd);
+
+    HOST_FILE_VOLUME *Volume = File->Volume;
+    Volume->OpenFiles--;
+    HostFileReleaseVolume(Volume);
+
+    File->Signature = 0;
+    delete File;
+}
+
+static EFI_STATUS EFI_API HostFileClose (
+    IN EFI_FILE_PROTOCOL *This
+) {
+    HOST_FILE *File = HostLookupFile(This);
+    if (File == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    HostFileDestroy(File);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostFileDelete (
+    IN EFI_FILE_PROTOCOL *This
+) {
+    HOST_FILE *File = HostLookupFile(This);
+    if (File == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    //
+    // The handle is closed whether or not the file could be deleted
+    //
+    BOOLEAN Deleted = FALSE;
+    if ((File->OpenMode & EFI_FILE_MODE_WRITE) != 0 && !File->Path.empty()) {
+        HostFileDrain(File);
+        Deleted = unlinkat(File->Volume->RootFd, File->Path.c_str(), File->Directory ? AT_REMOVEDIR : 0) == 0;
+        HostFileTouch(File->Volume);
+    }
+    HostFileDestroy(File);
+    if (!Deleted) {
+        return EFI_WARN_DELETE_FAILURE;
+    }
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostFileRead (
+    IN EFI_FILE_PROTOCOL    *This,
+    IN OUT UINTN            *BufferSize,
+    OUT VOID                *Buffer
+) {
+    HOST_FILE *File = HostLookupFile(This);
+    if (File == NULL || BufferSize == NULL || (*BufferSize != 0 && Buffer == NULL)) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (File->Directory) {
+        return HostFileReadDirectory(File, BufferSize, Buffer);
+    }
+
+    UINTN Done = 0;
+    EFI_STATUS Status = HostFileReadAt(File->Fd, (UINT8 *)Buffer, *BufferSize, File->Position, &Done);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    if (Done == 0 && *BufferSize != 0 && File->Position > File->Size) {
+        return EFI_DEVICE_ERROR;
+    }
+    File->Position += Done;
+    if (File->Position > File->Size) {
+        File->Size = File->Position;
+    }
+    *BufferSize = Done;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostFileWrite (
+    IN EFI_FILE_PROTOCOL    *This,
+    IN OUT UINTN            *BufferSize,
+    IN VOID                 *Buffer
+) {
+    HOST_FILE *File = HostLookupFile(This);
+    if (File == NULL || BufferSize == NULL || (*BufferSize != 0 && Buffer == NULL)) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (File->Directory) {
+        return EFI_UNSUPPORTED;
+    }
+    if ((File->OpenMode & EFI_FILE_MODE_WRITE) == 0) {
+        return EFI_ACCESS_DENIED;
+    }
+
+    UINTN Done = 0;
+    EFI_STATUS Status = HostFileWriteAt(File->Fd, (const UINT8 *)Buffer, *BufferSize, File->Position, &Done);
+    HostFileTouch(File->Volume);
+    File->Position += Done;
+    if (File->Position > File->Size) {
+        File->Size = File->Position;
+    }
+    *BufferSize = Done;
+    return Status;
+}
+
+static EFI_STATUS EFI_API HostFileGetPosition (
+    IN EFI_FILE_PROTOCOL    *This,
+    OUT UINT64              *Position
+) {
+    HOST_FILE *File = HostLookupFile(This);
+    if (File == NULL || Position == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (File->Directory) {
+        return EFI_UNSUPPORTED;
+    }
+    *Position = File->Position;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostFileSetPosition (
+    IN EFI_FILE_PROTOCOL    *This,
+    IN UINT64               Position
+) {
+    HOST_FILE *File = HostLookupFile(This);
+    if (File == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (File->Directory) {
+        if (Position != 0) {
+            return EFI_UNSUPPORTED;
+        }
+        if (File->Stream != NULL) {
+            rewinddir(File->Stream);
+        }
+        File->EntryPending = FALSE;
+        return EFI_SUCCESS;
+    }
+
+    if (Position == UINT64_MAX) {
+        struct stat Stat;
+        if (fstat(File->Fd, &Stat) == 0) {
+            File->Size = (UINT64)Stat.st_size;
+        }
+        Position = File->Size;
+    }
+    File->Position = Position;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostFileGetInfo (
+    IN EFI_FILE_PROTOCOL    *This,
+    IN EFI_GUID             *InformationType,
+    IN OUT UINTN            *BufferSize,
+    OUT VOID                *Buffer
+) {
+    HOST_FILE *File = HostLookupFile(This);
+    if (File == NULL || InformationType == NULL || BufferSize == NULL || (*BufferSize != 0 && Buffer == NULL)) {
+        return EFI_INVALID_PARAMETER;
+    }
+    HOST_FILE_VOLUME *Volume = File->Volume;
+
+    if (CompareGuid(InformationType, &EFI_FILE_INFO_ID)) {
+        const struct stat *Stat = NULL;
+        EFI_STATUS Status = HostFileStat(File, &Stat);
+        if (Status != EFI_SUCCESS) {
+            return Status;
+        }
+        if (!File->Directory) {
+            File->Size = (UINT64)Stat->st_size;
+        }
+        return HostFileFillInfo(Stat, HostFileBaseName(File->Path), BufferSize, Buffer);
+    }
+
+    UINTN LabelSize = Volume->Label.size() * sizeof(CHAR16);
+    if (CompareGuid(InformationType, &EFI_FILE_SYSTEM_INFO_ID)) {
+        UINTN Size = SIZE_OF_EFI_FILE_SYSTEM_INFO + LabelSize;
+        if (*BufferSize < Size) {
+            *BufferSize = Size;
+            return EFI_BUFFER_TOO_SMALL;
+        }
+        if (Volume->FileSystemGeneration != Volume->Generation) {
+            if (fstatvfs(Volume->RootFd, &Volume->FileSystemStat) != 0) {
+                Volume->FileSystemGeneration = 0;
+                return HostFileStatusFromErrno(errno);
+            }
+            Volume->FileSystemGeneration = Volume->Generation;
+        }
+        const struct statvfs &FileSystem = Volume->FileSystemStat;
+
+        EFI_FILE_SYSTEM_INFO *Info = (EFI_FILE_SYSTEM_INFO *)Buffer;
+        Info->Size = Size;
+        Info->ReadOnly = Volume->ReadOnly || (FileSystem.f_flag & ST_RDONLY) != 0;
+        Info->VolumeSize = (UINT64)FileSystem.f_blocks * FileSystem.f_frsize;
+        Info->FreeSpace = (UINT64)FileSystem.f_bavail * FileSystem.f_frsize;
+        Info->BlockSize = (UINT32)FileSystem.f_bsize;
+        __builtin_memcpy(Info->VolumeLabel, Volume->Label.data(), LabelSize);
+        *BufferSize = Size;
+        return EFI_SUCCESS;
+    }
+
+    if (CompareGuid(InformationType, &EFI_FILE_SYSTEM_VOLUME_LABEL_ID)) {
+        if (*BufferSize < LabelSize) {
+            *BufferSize = LabelSize;
+            return EFI_BUFFER_TOO_SMALL;
+        }
+        __builtin_memcpy(Buffer, Volume->Label.data(), LabelSize);
+        *BufferSize = LabelSize;
+        return EFI_SUCCESS;
+    }
+    return EFI_UNSUPPORTED;
+}
+
+/**
+ * Replaces the volume label with the Null-terminated Label of at most Size bytes
+ */
+static EFI_STATUS HostFileSetLabel (
+    IN HOST_FILE_VOLUME *Volume,
+    IN const CHAR16     *Label,
+    IN UINTN            Size
+) {
+    UINTN Length = 0;
+    while (Length < Size / sizeof(CHAR16) && Label[Length] != CHAR_NULL) {
+        Length++;
+    }
+    if (Length == Size / sizeof(CHAR16)) {
+        return EFI_BAD_BUFFER_SIZE;
+    }
+    if (Volume->ReadOnly) {
+        return EFI_WRITE_PROTECTED;
+    }
+    Volume->Label.assign(Label, Label + Length + 1);
+    return EFI_SUCCESS;
+}
+
+/**
+ * Applies an EFI_FILE_INFO to File: its size, times, read-only attribute and
+ * name, which may move the file within the volume
+ */
+static EFI_STATUS HostFileSetFileInfo (
+    IN HOST_FILE            *File,
+    IN const EFI_FILE_INFO  *Info,
+    IN UINTN                BufferSize
+) {
+    if (BufferSize < SIZE_OF_EFI_FILE_INFO + sizeof(CHAR16) || Info->Size > BufferSize || Info->Size < SIZE_OF_EFI_FILE_INFO + sizeof(CHAR16)) {
+        return EFI_BAD_BUFFER_SIZE;
+    }
+    UINTN NameLength = 0;
+    UINTN MaxLength = (UINTN)(Info->Size - SIZE_OF_EFI_FILE_INFO) / sizeof(CHAR16);
+    while (NameLength < MaxLength && Info->FileName[NameLength] != CHAR_NULL) {
+        NameLength++;
+    }
+    if (NameLength == MaxLength || NameLength == 0 || (Info->Attribute & ~(UINT64)EFI_FILE_VALID_ATTR) != 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    struct timespec Times[2];
+    if (!HostFileTimeToHost(&Info->LastAccessTime, &Times[0]) || !HostFileTimeToHost(&Info->ModificationTime, &Times[1])) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    struct stat Stat;
+    if (fstat(File->Fd, &Stat) != 0) {
+        return HostFileStatusFromErrno(errno);
+    }
+    if (((Info->Attribute & EFI_FILE_DIRECTORY) != 0) != (File->Directory != FALSE)) {
+        return EFI_ACCESS_DENIED;
+    }
+    if (File->Volume->ReadOnly) {
+        return EFI_WRITE_PROTECTED;
+    }
+
+    //
+    // The new name is relative to the directory holding the file
+    //
+    std::string Parent = File->Path.substr(0, File->Path.size() - HostFileBaseName(File->Path).size());
+    if (!Parent.empty()) {
+        Parent.pop_back();
+    }
+    std::string Path;
+    EFI_STATUS Status = HostFileResolvePath(Parent, Info->FileName, &Path);
+    if (Status != EFI_SUCCESS) {
+        return EFI_ACCESS_DENIED;
+    }
+
+    BOOLEAN Resize = !File->Directory && Info->FileSize != (UINT64)Stat.st_size;
+    BOOLEAN Rename = Path != File->Path;
+    if (File->Directory && Info->FileSize != (UINT64)Stat.st_size) {
+        return EFI_ACCESS_DENIED;
+    }
+    if ((File->OpenMode & EFI_FILE_MODE_WRITE) == 0) {
+        //
+        // A read-only handle may only change the attributes
+        //
+        if (Resize || Rename) {
+            return EFI_ACCESS_DENIED;
+        }
+        Times[0].tv_nsec = UTIME_OMIT;
+        Times[1].tv_nsec = UTIME_OMIT;
+    }
+    if (Rename && File->Path.empty()) {
+        return EFI_ACCESS_DENIED;
+    }
+
+    if (Resize) {
+        if (ftruncate(File->Fd, (off_t)Info->FileSize) != 0) {
+            return HostFileStatusFromErrno(errno);
+        }
+        File->Size = Info->FileSize;
+    }
+    if ((Times[0].tv_nsec != UTIME_OMIT || Times[1].tv_nsec != UTIME_OMIT) && futimens(File->Fd, Times) != 0) {
+        return HostFileStatusFromErrno(errno);
+    }
+
+    mode_t Mode = Stat.st_mode & 07777;
+    if ((Info->Attribute & EFI_FILE_READ_ONLY) != 0) {
+        Mode &= ~(mode_t)(S_IWUSR | S_IWGRP | S_IWOTH);
+    } else if ((Mode & (S_IWUSR | S_IWGRP | S_IWOTH)) == 0) {
+        Mode |= S_IWUSR;
+    }
+    if (Mode != (Stat.st_mode & 07777) && fchmod(File->Fd, Mode) != 0) {
+        return HostFileStatusFromErrno(errno);
+    }
+
+    if (Rename) {
+        if (renameat2(File->Volume->RootFd, File->Path.c_str(), File->Volume->RootFd, Path.c_str(), RENAME_NOREPLACE) != 0) {
+            return HostFileStatusFromErrno(errno);
+        }
+        File->Path = std::move(Path);
+    }
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostFileSetInfo (
+    IN EFI_FILE_PROTOCOL    *This,
+    IN EFI_GUID             *InformationType,
+    IN UINTN                BufferSize,
+    IN VOID                 *Buffer
+) {
+    HOST_FILE *File = HostLookupFile(This);
+    if (File == NULL || InformationType == NULL || Buffer == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    if (CompareGuid(InformationType, &EFI_FILE_INFO_ID)) {
+        EFI_STATUS Status = HostFileSetFileInfo(File, (const EFI_FILE_INFO *)Buffer, BufferSize);
+        HostFileTouch(File->Volume);
+        return Status;
+    }
+    if (CompareGuid(InformationType, &EFI_FILE_SYSTEM_INFO_ID)) {
+        if (BufferSize < SIZE_OF_EFI_FILE_SYSTEM_INFO) {
+            return EFI_BAD_BUFFER_SIZE;
+        }
+        const EFI_FILE_SYSTEM_INFO *Info = (const EFI_FILE_SYSTEM_INFO *)Buffer;
+        return HostFileSetLabel(File->Volume, Info->VolumeLabel, BufferSize - SIZE_OF_EFI_FILE_SYSTEM_INFO);
+    }
+    if (CompareGuid(InformationType, &EFI_FILE_SYSTEM_VOLUME_LABEL_ID)) {
+        return HostFileSetLabel(File->Volume, (const CHAR16 *)Buffer, BufferSize);
+    }
+    return EFI_UNSUPPORTED;
+}
+
+static EFI_STATUS EFI_API HostFileFlush (
+    IN EFI_FILE_PROTOCOL *This
+) {
+    HOST_FILE *File = HostLookupFile(This);
+    if (File == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if ((File->OpenMode & EFI_FILE_MODE_WRITE) == 0) {
+        return EFI_ACCESS_DENIED;
+    }
+    if (fsync(File->Fd) != 0) {
+        return HostFileStatusFromErrno(errno);
+    }
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostFileOpenEx (
+    IN EFI_FILE_PROTOCOL        *This,
+    OUT EFI_FILE_PROTOCOL       **NewHandle,
+    IN CHAR16                   *FileName,
+    IN UINT64                   OpenMode,
+    IN UINT64                   Attributes,
+    IN OUT EFI_FILE_IO_TOKEN    *Token
+) {
+    if (Token == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    //
+    // Opening is a metadata operation the host carries out at once
+    //
+    EFI_STATUS Status = HostFileOpen(This, NewHandle, FileName, OpenMode, Attributes);
+    Token->Status = Status;
+    if (Status == EFI_SUCCESS && Token->Event != NULL) {
+        HostSignalEvent(Token->Event);
+    }
+    return Status;
+}
+
+static EFI_STATUS EFI_API HostFileReadEx (
+    IN EFI_FILE_PROTOCOL        *This,
+    IN OUT EFI_FILE_IO_TOKEN    *Token
+) {
+    if (Token == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (Token->Event == NULL) {
+        Token->Status = HostFileRead(This, &Token->BufferSize, Token->Buffer);
+        return Token->Status;
+    }
+
+    HOST_FILE *File = HostLookupFile(This);
+    if (File == NULL || (Token->BufferSize != 0 && Token->Buffer == NULL)) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (File->Directory) {
+        return EFI_UNSUPPORTED;
+    }
+
+    //
+    // The position moves past the bytes the read will return, so that requests
+    // queued back to back read consecutive ranges
+    //
+    UINT64 Offset = File->Position;
+    if (Offset + Token->BufferSize > File->Size) {
+        struct stat Stat;
+        if (fstat(File->Fd, &Stat) == 0 && (UINT64)Stat.st_size > File->Size) {
+            File->Size = (UINT64)Stat.st_size;
+        }
+    }
+    if (Offset > File->Size) {
+        return EFI_DEVICE_ERROR;
+    }
+    UINTN Length = Token->BufferSize;
+    if (Length > File->Size - Offset) {
+        Length = (UINTN)(File->Size - Offset);
+    }
+    File->Position += Length;
+    return HostFileQueue(File, Token, IORING_OP_READ, Offset, Length);
+}
+
+static EFI_STATUS EFI_API HostFileWriteEx (
+    IN EFI_FILE_PROTOCOL        *This,
+    IN OUT EFI_FILE_IO_TOKEN    *Token
+) {
+    if (Token == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (Token->Event == NULL) {
+        Token->Status = HostFileWrite(This, &Token->BufferSize, Token->Buffer);
+        return Token->Status;
+    }
+
+    HOST_FILE *File = HostLookupFile(This);
+    if (File == NULL || (Token->BufferSize != 0 && Token->Buffer == NULL)) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (File->Directory) {
+        return EFI_UNSUPPORTED;
+    }
+    if ((File->OpenMode & EFI_FILE_MODE_WRITE) == 0) {
+        return EFI_ACCESS_DENIED;
+    }
+
+    UINT64 Offset = File->Position;
+    File->Position += Token->BufferSize;
+    if (File->Position > File->Size) {
+        File->Size = File->Position;
+    }
+    HostFileTouch(File->Volume);
+    return HostFileQueue(File, Token, IORING_OP_WRITE, Offset, Token->BufferSize);
+}
+
+static EFI_STATUS EFI_API HostFileFlushEx (
+    IN EFI_FILE_PROTOCOL        *This,
+    IN OUT EFI_FILE_IO_TOKEN    *Token
+) {
+    if (Token == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (Token->Event == NULL) {
+        Token->Status = HostFileFlush(This);
+        return Token->Status;
+    }
+
+    HOST_FILE *File = HostLookupFile(This);
+    if (File == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if ((File->OpenMode & EFI_FILE_MODE_WRITE) == 0) {
+        return EFI_ACCESS_DENIED;
+    }
+    return HostFileQueue(File, Token, IORING_OP_FSYNC, 0, 0);
+}
+
+static HOST_FILE *HostFileCreateHandle (
+    IN HOST_FILE_VOLUME *Volume,
+    IN std::string      &&Path,
+    IN INT32            Fd,
+    IN BOOLEAN          Directory,
+    IN UINT64           OpenMode,
+    IN UINT64           Size
+) {
+    HOST_FILE *File = new HOST_FILE();
+    File->Protocol.Revision = EFI_FILE_PROTOCOL_REVISION2;
+    File->Protocol.Open = HostFileOpen;
+    File->Protocol.Close = HostFileClose;
+    File->Protocol.Delete = HostFileDelete;
+    File->Protocol.Read = HostFileRead;
+    File->Protocol.Write = HostFileWrite;
+    File->Protocol.GetPosition = HostFileGetPosition;
+    File->Protocol.SetPosition = HostFileSetPosition;
+    File->Protocol.GetInfo = HostFileGetInfo;
+    File->Protocol.SetInfo = HostFileSetInfo;
+    File->Protocol.Flush = HostFileFlush;
+    File->Protocol.OpenEx = HostFileOpenEx;
+    File->Protocol.ReadEx = HostFileReadEx;
+    File->Protocol.WriteEx = HostFileWriteEx;
+    File->Protocol.FlushEx = HostFileFlushEx;
+    File->Signature = HOST_FILE_SIGNATURE;
+    File->Volume = Volume;
+    File->Path = std::move(Path);
+    File->Fd = Fd;
+    File->Directory = Directory;
+    File->OpenMode = OpenMode;
+    File->Position = 0;
+    File->Size = Size;
+    File->Pending = 0;
+    File->Stream = NULL;
+    File->EntryPending = FALSE;
+    File->StatGeneration = 0;
+
+    Volume->OpenFiles++;
+    mFiles.insert(File);
+    return File;
+}
+
+static EFI_STATUS EFI_API HostFileOpen (
+    IN EFI_FILE_PROTOCOL    *This,
+    OUT EFI_FILE_PROTOCOL   **NewHandle,
+    IN CHAR16               *FileName,
+    IN UINT64               OpenMode,
+    IN UINT64               Attributes
+) {
+    HOST_FILE *Parent = HostLookupFile(This);
+    if (Parent == NULL || NewHandle == NULL || FileName == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (OpenMode != HOST_FILE_MODE_READ_ONLY && OpenMode != HOST_FILE_MODE_READ_WRITE && OpenMode != HOST_FILE_MODE_CREATE) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if ((Attributes & ~(UINT64)EFI_FILE_VALID_ATTR) != 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    HOST_FILE_VOLUME *Volume = Parent->Volume;
+    if ((OpenMode & EFI_FILE_MODE_WRITE) != 0 && Volume->ReadOnly) {
+        return EFI_WRITE_PROTECTED;
+    }
+
+    //
+    // Names are looked up from a directory, so only absolute names and the empty
+    // name make sense relative to a file
+    //
+    if (!Parent->Directory && FileName[0] != L'\\' && FileName[0] != CHAR_NULL) {
+        return EFI_NOT_FOUND;
+    }
+
+    std::string Path;
+    EFI_STATUS Status = HostFileResolvePath(Parent->Path, FileName, &Path);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    const char *HostPath = Path.empty() ? "." : Path.c_str();
+
+    struct stat Stat;
+    if (fstatat(Volume->RootFd, HostPath, &Stat, 0) != 0) {
+        if (errno != ENOENT || (OpenMode & EFI_FILE_MODE_CREATE) == 0) {
+            return HostFileStatusFromErrno(errno);
+        }
+        HostFileTouch(Volume);
+
+        mode_t Mode = (Attributes & EFI_FILE_READ_ONLY) != 0 ? 0444 : 0644;
+        if ((Attributes & EFI_FILE_DIRECTORY) != 0) {
+            if (mkdirat(Volume->RootFd, HostPath, Mode | 0111) != 0) {
+                return HostFileStatusFromErrno(errno);
+            }
+        } else {
+            INT32 Fd = openat(Volume->RootFd, HostPath, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, Mode);
+            if (Fd < 0) {
+                return HostFileStatusFromErrno(errno);
+            }
+            *NewHandle = &HostFileCreateHandle(Volume, std::move(Path), Fd, FALSE, OpenMode, 0)->Protocol;
+            return EFI_SUCCESS;
+        }
+        if (fstatat(Volume->RootFd, HostPath, &Stat, 0) != 0) {
+            return HostFileStatusFromErrno(errno);
+        }
+    }
+
+    BOOLEAN Directory = S_ISDIR(Stat.st_mode);
+    if (!Directory && !S_ISREG(Stat.st_mode)) {
+        return EFI_ACCESS_DENIED;
+    }
+
+    INT32 Flags = O_CLOEXEC;
+    if (Directory) {
+        Flags |= O_RDONLY | O_DIRECTORY;
+    } else {
+        Flags |= (OpenMode & EFI_FILE_MODE_WRITE) != 0 ? O_RDWR : O_RDONLY;
+    }
+    INT32 Fd = openat(Volume->RootFd, HostPath, Flags);
+    if (Fd < 0) {
+        return HostFileStatusFromErrno(errno);
+    }
+
+    *NewHandle = &HostFileCreateHandle(Volume, std::move(Path), Fd, Directory, OpenMode, Directory ? 0 : (UINT64)Stat.st_size)->Protocol;
+    return EFI_SUCCESS;
+}
+
+/**
+ * Opens a new handle on the root directory of Volume
+ */
+static EFI_STATUS HostFileOpenRoot (
+    IN HOST_FILE_VOLUME     *Volume,
+    OUT EFI_FILE_PROTOCOL   **Root
+) {
+    INT32 Fd = openat(Volume->RootFd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (Fd < 0) {
+        return HostFileStatusFromErrno(errno);
+    }
+    UINT64 OpenMode = Volume->ReadOnly ? HOST_FILE_MODE_READ_ONLY : HOST_FILE_MODE_READ_WRITE;
+    *Root = &HostFileCreateHandle(Volume, std::string(), Fd, TRUE, OpenMode, 0)->Protocol;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFI_API HostFileOpenVolume (
+    IN EFI_SIMPLE_FILE_SYSTEM_PROTOCOL  *This,
+    OUT EFI_FILE_PROTOCOL               **Root
+) {
+    HOST_FILE_VOLUME *Volume = (HOST_FILE_VOLUME *)This;
+    if (Volume == NULL || Root == NULL || mVolumes.count(Volume) == 0 || Volume->Signature != HOST_FILE_VOLUME_SIGNATURE) {
+        return EFI_INVALID_PARAMETER;
+    }
+    return HostFileOpenRoot(Volume, Root);
+}
+
+/**
+ * Creates a volume rooted at the host directory Path. The volume is labelled
+ * with the last component of Path.
+ */
+static EFI_STATUS HostFileCreateVolume (
+    IN const CHAR8          *Path,
+    IN BOOLEAN              ReadOnly,
+    OUT HOST_FILE_VOLUME    **NewVolume
+) {
+    if (Path == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (gHostSystemTable == NULL) {
+        return EFI_NOT_STARTED;
+    }
+
+    INT32 RootFd = open(Path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (RootFd < 0) {
+        return HostFileStatusFromErrno(errno);
+    }
+
+    HOST_FILE_VOLUME *Volume = new HOST_FILE_VOLUME();
+    Volume->FileSystem.Revision = EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_REVISION;
+    Volume->FileSystem.OpenVolume = HostFileOpenVolume;
+    Volume->Signature = HOST_FILE_VOLUME_SIGNATURE;
+    Volume->RootFd = RootFd;
+    Volume->ReadOnly = ReadOnly;
+    Volume->Installed = FALSE;
+    Volume->OpenFiles = 0;
+    Volume->Generation = 1;
+    Volume->FileSystemGeneration = 0;
+
+    std::string Name(Path);
+    while (Name.size() > 1 && Name.back() == '/') {
+        Name.pop_back();
+    }
+    Name = Name.substr(Name.rfind('/') + 1);
+    UINTN LabelLength = 0;
+    Utf8ToChar16(Name.data(), Name.size(), NULL, &LabelLength, UTF_REPLACE_INVALID);
+    Volume->Label.resize(LabelLength + 1);
+    Utf8ToChar16(Name.data(), Name.size(), Volume->Label.data(), &LabelLength, UTF_REPLACE_INVALID);
+    Volume->Label[LabelLength] = CHAR_NULL;
+
+    mVolumes.insert(Volume);
+    *NewVolume = Volume;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EfiHostOpenDirectory (
+    IN const CHAR8          *Path,
+    IN BOOLEAN              ReadOnly,
+    OUT EFI_FILE_PROTOCOL   **Root
+) {
+    if (Root == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    HOST_FILE_VOLUME *Volume;
+    EFI_STATUS Status = HostFileCreateVolume(Path, ReadOnly, &Volume);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    Status = HostFileOpenRoot(Volume, Root);
+    HostFileReleaseVolume(Volume);
+    return Status;
+}
+
+EFI_STATUS EfiHostInstallFileSystem (
+    IN const CHAR8      *Path,
+    IN BOOLEAN          ReadOnly,
+    IN OUT EFI_HANDLE   *Handle
+) {
+    if (Handle == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    HOST_FILE_VOLUME *Volume;
+    EFI_STATUS Status = HostFileCreateVolume(Path, ReadOnly, &Volume);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    Status = HostInstallProtocolInterface(Handle, &EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_GUID, EFI_NATIVE_INTERFACE, &Volume->FileSystem);
+    if (Status != EFI_SUCCESS) {
+        HostFileReleaseVolume(Volume);
+        return Status;
+    }
+    Volume->Installed = TRUE;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EfiHostReadDirectoryEntries (
+    IN EFI_FILE_PROTOCOL    *Directory,
+    IN OUT UINTN            *BufferSize,
+    OUT VOID                *Buffer,
+    OUT UINTN               *EntryCount
+) {
+    if (Directory == NULL || BufferSize == NULL || EntryCount == NULL || (*BufferSize != 0 && Buffer == NULL)) {
+        return EFI_INVALID_PARAMETER;
+    }
+    std::unordered_map<EFI_FILE_PROTOCOL *, EFI_STATUS>::iterator Held = mDirectoryErrors.find(Directory);
+    if (Held != mDirectoryErrors.end()) {
+        EFI_STATUS Status = Held->second;
+        mDirectoryErrors.erase(Held);
+        return Status;
+    }
+
+    //
+    // Read stops short of an entry that does not fit and returns it next time, so
+    // the batch ends at the first entry that would overflow the buffer
+    //
+    UINTN Used = 0;
+    UINTN Count = 0;
+    for (;;) {
+        UINTN Offset = (Used + 7) & ~(UINTN)7;
+        UINTN Size = Offset < *BufferSize ? *BufferSize - Offset : 0;
+        EFI_STATUS Status = Directory->Read(Directory, &Size, Size != 0 ? (UINT8 *)Buffer + Offset : NULL);
+        if (Status != EFI_SUCCESS) {
+            //
+            // The entries already read are returned first, and an error other than
+            // a full buffer is reported by the next call
+            //
+            if (Count != 0) {
+                if (Status != EFI_BUFFER_TOO_SMALL) {
+                    mDirectoryErrors[Directory] = Status;
+                }
+                break;
+            }
+            if (Status == EFI_BUFFER_TOO_SMALL) {
+                *BufferSize = Size;
+            }
+            return Status;
+        }
+        if (Size == 0) {
+            break;
+        }
+        Used = Offset + Size;
+        Count++;
+    }
+
+    *BufferSize = Used;
+    *EntryCount = Count;
+    return EFI_SUCCESS;
+}
+
+/**
+ * Turns a fault on a page of a mapped file that truncation took away into a page
+ * of zeros. Faults anywhere else go to the disposition that was in place before.
+ * Only mmap is called, a plain system call safe to make from a signal handler.
+ */
+static VOID HostFileBusHandler (
+    IN INT32        Signal,
+    IN siginfo_t    *Info,
+    IN VOID         *Context
+) {
+    UINTN Address = (UINTN)Info->si_addr;
+    for (UINTN Index = 0; Index < HOST_FILE_MAPPINGS; Index++) {
+        UINTN Base = __atomic_load_n(&mMappings[Index].Base, __ATOMIC_ACQUIRE);
+        if (Base == 0 || Address - Base >= mMappings[Index].Length) {
+            continue;
+        }
+        VOID *Page = (VOID *)(Address & ~(mMapPageSize - 1));
+        if (mmap(Page, mMapPageSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED) {
+            return;
+        }
+        break;
+    }
+
+    if ((mPreviousBusAction.sa_flags & SA_SIGINFO) != 0) {
+        mPreviousBusAction.sa_sigaction(Signal, Info, Context);
+    } else if (mPreviousBusAction.sa_handler != SIG_DFL && mPreviousBusAction.sa_handler != SIG_IGN) {
+        mPreviousBusAction.sa_handler(Signal);
+    } else {
+        //
+        // The faulting access runs again on return and now takes the default action
+        //
+        signal(SIGBUS, SIG_DFL);
+    }
+}
+
+EFI_STATUS EfiHostMapFile (
+    IN EFI_FILE_PROTOCOL    *File,
+    IN UINT64               Offset,
+    IN OUT UINTN            *Length,
+    OUT const VOID          **Mapping
+) {
+    HOST_FILE *Host = HostLookupFile(File);
+    if (Host == NULL || Length == NULL || Mapping == NULL || *Length == 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (Host->Directory) {
+        return EFI_UNSUPPORTED;
+    }
+
+    struct stat Stat;
+    if (fstat(Host->Fd, &Stat) != 0) {
+        return HostFileStatusFromErrno(errno);
+    }
+    UINT64 Size = (UINT64)Stat.st_size;
+    if (Offset >= Size) {
+        return EFI_END_OF_FILE;
+    }
+    UINTN Wanted = *Length;
+    if (Wanted > Size - Offset) {
+        Wanted = (UINTN)(Size - Offset);
+    }
+
+    HOST_FILE_MAPPING *Entry = NULL;
+    for (UINTN Index = 0; Index < HOST_FILE_MAPPINGS && Entry == NULL; Index++) {
+        if (mMappings[Index].Base == 0) {
+            Entry = &mMappings[Index];
+        }
+    }
+    if (Entry == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    if (!mMapHandlerInstalled) {
+        struct sigaction Action = {};
+        Action.sa_sigaction = HostFileBusHandler;
+        Action.sa_flags = SA_SIGINFO | SA_NODEFER;
+        sigemptyset(&Action.sa_mask);
+        if (sigaction(SIGBUS, &Action, &mPreviousBusAction) != 0) {
+            return EFI_DEVICE_ERROR;
+        }
+        mMapPageSize = (UINTN)sysconf(_SC_PAGESIZE);
+        mMapHandlerInstalled = TRUE;
+    }
+
+    UINT64 Start = Offset & ~(UINT64)(mMapPageSize - 1);
+    UINTN MapLength = ((UINTN)(Offset - Start) + Wanted + mMapPageSize - 1) & ~(mMapPageSize - 1);
+    VOID *Base = mmap(NULL, MapLength, PROT_READ, MAP_SHARED, Host->Fd, (off_t)Start);
+    if (Base == MAP_FAILED) {
+        return HostFileStatusFromErrno(errno);
+    }
+
+    Entry->Length = MapLength;
+    Entry->Mapping = (const UINT8 *)Base + (Offset - Start);
+    __atomic_store_n(&Entry->Base, (UINTN)Base, __ATOMIC_RELEASE);
+    *Length = Wanted;
+    *Mapping = Entry->Mapping;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EfiHostUnmapFile (
+    IN const VOID *Mapping
+) {
+    for (UINTN Index = 0; Index < HOST_FILE_MAPPINGS; Index++) {
+        HOST_FILE_MAPPING *Entry = &mMappings[Index];
+        if (Entry->Base != 0 && Entry->Mapping == Mapping) {
+            UINTN Base = Entry->Base;
+            __atomic_store_n(&Entry->Base, 0, __ATOMIC_RELEASE);
+            munmap((VOID *)Base, Entry->Length);
+            return EFI_SUCCESS;
+        }
+    }
+    return EFI_INVALID_PARAMETER;
+}
+
+VOID HostFileForgetDirectoryError (
+    IN EFI_FILE_PROTOCOL *Directory
+) {
+    mDirectoryErrors.erase(Directory);
+}
+
+VOID HostFileShutdown (
+    VOID
+) {
+    //
+    // Requests still in flight complete without touching their tokens, which the
+    // caller may already have released
+    //
+    mFileShutdown = TRUE;
+    while (!mFiles.empty()) {
+        HostFileDestroy(*mFiles.begin());
+    }
+    while (!mVolumes.empty()) {
+        HOST_FILE_VOLUME *Volume = *mVolumes.begin();
+        Volume->Installed = FALSE;
+        HostFileReleaseVolume(Volume);
+    }
+    HostUringShutdown();
+    mFileShutdown = FALSE;
+    mDirectoryErrors.clear();
+
+    for (HOST_FILE_MAPPING &Entry : mMappings) {
+        if (Entry.Base != 0) {
+            EfiHostUnmapFile(Entry.Mapping);
+        }
+    }
+    if (mMapHandlerInstalled) {
+        sigaction(SIGBUS, &mPreviousBusAction, NULL);
+        mMapHandlerInstalled = FALSE;
+    }
+}
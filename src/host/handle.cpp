@@ -0,0 +1,1109 @@
+#include "internal.h"
+
+#include <efi/device_path.h>
+#include <efi/guid.h>
+
+#include <cstring>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#define HOST_HANDLE_SIGNATURE           HOST_SIGNATURE_32('h', 'n', 'd', 'l')
+#define HOST_PROTOCOL_NOTIFY_SIGNATURE  HOST_SIGNATURE_32('p', 'r', 't', 'n')
+
+/**
+ * Initial number of slots in the protocol table, always a power of two
+ */
+#define HOST_PROTOCOL_TABLE_SIZE 64
+
+struct HOST_HANDLE;
+struct HOST_PROTOCOL_ENTRY;
+struct HOST_PROTOCOL_NOTIFY;
+struct HOST_DEVICE_PATH_NODE;
+
+/**
+ * One protocol interface installed on one handle. It is linked from both the
+ * handle's protocol array and the protocol's interface list, which stays in
+ * install order.
+ */
+typedef struct HOST_PROTOCOL_INTERFACE {
+    HOST_HANDLE                                         *Handle;
+    HOST_PROTOCOL_ENTRY                                 *Protocol;
+    VOID                                                *Interface;
+    std::list<HOST_PROTOCOL_INTERFACE *>::iterator      ProtocolLink;   // Position in Protocol->Interfaces
+    std::vector<EFI_OPEN_PROTOCOL_INFORMATION_ENTRY>    OpenList;
+    HOST_DEVICE_PATH_NODE                               *PathNode;      // Where a device path interface is indexed
+} HOST_PROTOCOL_INTERFACE;
+
+/**
+ * Every GUID ever installed or registered for notification. Entries live until
+ * shutdown, so the protocol table never needs deletion markers.
+ */
+struct HOST_PROTOCOL_ENTRY {
+    EFI_GUID_ALIGNED                        Protocol;
+    UINT64                                  Hash;
+    std::list<HOST_PROTOCOL_INTERFACE *>    Interfaces;
+    std::vector<HOST_PROTOCOL_NOTIFY *>     Notifies;
+};
+
+struct HOST_HANDLE {
+    UINT32                                  Signature;
+    std::list<HOST_HANDLE *>::iterator      Link;
+    std::vector<HOST_PROTOCOL_INTERFACE *>  Protocols;
+};
+
+struct HOST_PROTOCOL_NOTIFY {
+    UINT32                  Signature;
+    HOST_PROTOCOL_ENTRY     *Protocol;
+    EFI_EVENT               Event;
+    std::list<EFI_HANDLE>   NewHandles;
+};
+
+/**
+ * A trie of the installed device paths, one level per device path node. Each
+ * EFI_DEVICE_PATH_PROTOCOL interface is listed at the node its first instance
+ * ends on, so LocateDevicePath walks the path it is given once instead of
+ * comparing it against every handle.
+ */
+struct HOST_DEVICE_PATH_NODE {
+    HOST_DEVICE_PATH_NODE                                       *Parent;
+    UINT64                                                      Hash;       // HashDevicePathNode of Bytes
+    std::vector<UINT8>                                          Bytes;      // The device path node matched at this level
+    std::unordered_multimap<UINT64, HOST_DEVICE_PATH_NODE *>    Children;
+    std::vector<HOST_PROTOCOL_INTERFACE *>                      Paths;
+};
+
+static std::list<HOST_HANDLE *>                     mHandles;
+static std::unordered_set<HOST_HANDLE *>            mHandleSet;
+static std::list<HOST_PROTOCOL_NOTIFY *>            mProtocolNotifies;
+static std::unordered_set<HOST_PROTOCOL_NOTIFY *>   mProtocolNotifySet;
+static std::vector<HOST_PROTOCOL_ENTRY *>           mProtocolTable;
+static UINTN                                        mProtocolCount;
+static HOST_DEVICE_PATH_NODE                        mDevicePathTrie;
+
+/**
+ * Finds the protocol table entry for Protocol by linear probing. Returns NULL
+ * when the GUID has never been seen.
+ */
+static HOST_PROTOCOL_ENTRY *HostLookupProtocolEntry (
+    IN const EFI_GUID *Protocol
+) {
+    if (mProtocolTable.empty()) {
+        return NULL;
+    }
+
+    UINT64 Hash = HashGuid(Protocol);
+    UINTN Mask = mProtocolTable.size() - 1;
+    for (UINTN Slot = (UINTN)Hash & Mask;; Slot = (Slot + 1) & Mask) {
+        HOST_PROTOCOL_ENTRY *Entry = mProtocolTable[Slot];
+        if (Entry == NULL) {
+            return NULL;
+        }
+        if (Entry->Hash == Hash && CompareGuid(&Entry->Protocol.Guid, Protocol)) {
+            return Entry;
+        }
+    }
+}
+
+static VOID HostInsertProtocolSlot (
+    IN HOST_PROTOCOL_ENTRY *Entry
+) {
+    UINTN Mask = mProtocolTable.size() - 1;
+    UINTN Slot = (UINTN)Entry->Hash & Mask;
+    while (mProtocolTable[Slot] != NULL) {
+        Slot = (Slot + 1) & Mask;
+    }
+    mProtocolTable[Slot] = Entry;
+}
+
+/**
+ * Returns the protocol table entry for Protocol, creating it on first use
+ */
+static HOST_PROTOCOL_ENTRY *HostAddProtocolEntry (
+    IN const EFI_GUID *Protocol
+) {
+    HOST_PROTOCOL_ENTRY *Entry = HostLookupProtocolEntry(Protocol);
+    if (Entry != NULL) {
+        return Entry;
+    }
+
+    //
+    // Keep the load factor at or below three quarters
+    //
+    if ((mProtocolCount + 1) * 4 > mProtocolTable.size() * 3) {
+        std::vector<HOST_PROTOCOL_ENTRY *> Old;
+        Old.swap(mProtocolTable);
+        mProtocolTable.assign(Old.empty() ? HOST_PROTOCOL_TABLE_SIZE : Old.size() * 2, NULL);
+        for (HOST_PROTOCOL_ENTRY *Existing : Old) {
+            if (Existing != NULL) {
+                HostInsertProtocolSlot(Existing);
+            }
+        }
+    }
+
+    Entry = new HOST_PROTOCOL_ENTRY();
+    CopyGuid(&Entry->Protocol.Guid, Protocol);
+    Entry->Hash = HashGuid(Protocol);
+    HostInsertProtocolSlot(Entry);
+    mProtocolCount++;
+    return Entry;
+}
+
+static HOST_HANDLE *HostLookupHandle (
+    IN EFI_HANDLE Handle
+) {
+    HOST_HANDLE *Entry = (HOST_HANDLE *)Handle;
+    if (Entry == NULL || mHandleSet.count(Entry) == 0 || Entry->Signature != HOST_HANDLE_SIGNATURE) {
+        return NULL;
+    }
+    return Entry;
+}
+
+static HOST_PROTOCOL_INTERFACE *HostFindProtocolEntry (
+    IN HOST_HANDLE          *Handle,
+    IN HOST_PROTOCOL_ENTRY  *Protocol
+) {
+    for (HOST_PROTOCOL_INTERFACE *Entry : Handle->Protocols) {
+        if (Entry->Protocol == Protocol) {
+            return Entry;
+        }
+    }
+    return NULL;
+}
+
+static HOST_PROTOCOL_INTERFACE *HostFindProtocol (
+    IN HOST_HANDLE      *Handle,
+    IN const EFI_GUID   *Protocol
+) {
+    HOST_PROTOCOL_ENTRY *Entry = HostLookupProtocolEntry(Protocol);
+    return Entry != NULL ? HostFindProtocolEntry(Handle, Entry) : NULL;
+}
+
+static BOOLEAN HostIsOpenedByDriver (
+    IN HOST_PROTOCOL_INTERFACE *Entry
+) {
+    for (EFI_OPEN_PROTOCOL_INFORMATION_ENTRY &Open : Entry->OpenList) {
+        if ((Open.Attributes & EFI_OPEN_PROTOCOL_BY_DRIVER) != 0) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/**
+ * Queues Handle on every registration for Protocol and signals the registered events
+ */
+static VOID HostNotifyProtocol (
+    IN EFI_HANDLE           Handle,
+    IN HOST_PROTOCOL_ENTRY  *Protocol
+) {
+    for (HOST_PROTOCOL_NOTIFY *Notify : Protocol->Notifies) {
+        Notify->NewHandles.push_back(Handle);
+        HostSignalEvent(Notify->Event);
+    }
+}
+
+static VOID HostForgetHandle (
+    IN EFI_HANDLE Handle
+) {
+    for (HOST_PROTOCOL_NOTIFY *Notify : mProtocolNotifies) {
+        Notify->NewHandles.remove(Handle);
+    }
+}
+
+static HOST_DEVICE_PATH_NODE *HostFindDevicePathChild (
+    IN HOST_DEVICE_PATH_NODE            *Trie,
+    IN const EFI_DEVICE_PATH_PROTOCOL   *Node,
+    IN UINT64                           Hash
+) {
+    UINTN Length = DevicePathNodeLength(Node);
+    auto Range = Trie->Children.equal_range(Hash);
+    for (auto It = Range.first; It != Range.second; ++It) {
+        HOST_DEVICE_PATH_NODE *Child = It->second;
+        if (Child->Bytes.size() == Length && memcmp(Child->Bytes.data(), Node, Length) == 0) {
+            return Child;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Lists a device path interface in the trie, creating the nodes its first
+ * instance needs
+ */
+static VOID HostIndexDevicePath (
+    IN HOST_PROTOCOL_INTERFACE *Entry
+) {
+    Entry->PathNode = NULL;
+    if (Entry->Interface == NULL || !CompareGuid(&Entry->Protocol->Protocol.Guid, &EFI_DEVICE_PATH_PROTOCOL_GUID)) {
+        return;
+    }
+
+    HOST_DEVICE_PATH_NODE *Trie = &mDevicePathTrie;
+    const EFI_DEVICE_PATH_PROTOCOL *Node = (const EFI_DEVICE_PATH_PROTOCOL *)Entry->Interface;
+    while (!IsDevicePathEndType(Node) && DevicePathNodeLength(Node) >= sizeof(EFI_DEVICE_PATH_PROTOCOL)) {
+        UINT64 Hash = HashDevicePathNode(Node);
+        HOST_DEVICE_PATH_NODE *Child = HostFindDevicePathChild(Trie, Node, Hash);
+        if (Child == NULL) {
+            Child = new HOST_DEVICE_PATH_NODE();
+            Child->Parent = Trie;
+            Child->Hash = Hash;
+            Child->Bytes.assign((const UINT8 *)Node, (const UINT8 *)Node + DevicePathNodeLength(Node));
+            Trie->Children.emplace(Hash, Child);
+        }
+        Trie = Child;
+        Node = NextDevicePathNode(Node);
+    }
+    Trie->Paths.push_back(Entry);
+    Entry->PathNode = Trie;
+}
+
+/**
+ * Removes a device path interface from the trie, pruning the nodes no other
+ * path uses
+ */
+static VOID HostUnindexDevicePath (
+    IN HOST_PROTOCOL_INTERFACE *Entry
+) {
+    HOST_DEVICE_PATH_NODE *Trie = Entry->PathNode;
+    if (Trie == NULL) {
+        return;
+    }
+    Entry->PathNode = NULL;
+
+    std::vector<HOST_PROTOCOL_INTERFACE *> &Paths = Trie->Paths;
+    for (UINTN Index = 0; Index < Paths.size(); Index++) {
+        if (Paths[Index] == Entry) {
+            Paths.erase(Paths.begin() + Index);
+            break;
+        }
+    }
+
+    while (Trie != &mDevicePathTrie && Trie->Paths.empty() && Trie->Children.empty()) {
+        HOST_DEVICE_PATH_NODE *Parent = Trie->Parent;
+        auto Range = Parent->Children.equal_range(Trie->Hash);
+        for (auto It = Range.first; It != Range.second; ++It) {
+            if (It->second == Trie) {
+                Parent->Children.erase(It);
+                break;
+            }
+        }
+        delete Trie;
+        Trie = Parent;
+    }
+}
+
+static VOID HostFreeDevicePathTrie (
+    IN HOST_DEVICE_PATH_NODE *Trie
+) {
+    for (auto &Child : Trie->Children) {
+        HostFreeDevicePathTrie(Child.second);
+        delete Child.second;
+    }
+    Trie->Children.clear();
+    Trie->Paths.clear();
+}
+
+/**
+ * Unlinks Entry from its handle and protocol and frees it. The handle is freed
+ * with its last protocol.
+ */
+static VOID HostRemoveProtocolInterface (
+    IN HOST_PROTOCOL_INTERFACE *Entry
+) {
+    HOST_HANDLE *Handle = Entry->Handle;
+    std::vector<HOST_PROTOCOL_INTERFACE *> &Protocols = Handle->Protocols;
+    for (UINTN Index = 0; Index < Protocols.size(); Index++) {
+        if (Protocols[Index] == Entry) {
+            Protocols.erase(Protocols.begin() + Index);
+            break;
+        }
+    }
+
+    HostUnindexDevicePath(Entry);
+    Entry->Protocol->Interfaces.erase(Entry->ProtocolLink);
+    delete Entry;
+
+    if (Protocols.empty()) {
+        mHandles.erase(Handle->Link);
+        mHandleSet.erase(Handle);
+        HostForgetHandle(Handle);
+        Handle->Signature = 0;
+        delete Handle;
+    }
+}
+
+EFI_STATUS HostHandleInitialize (
+    VOID
+) {
+    mHandles.clear();
+    mHandleSet.clear();
+    mProtocolNotifies.clear();
+    mProtocolNotifySet.clear();
+    mProtocolTable.clear();
+    mProtocolCount = 0;
+    HostFreeDevicePathTrie(&mDevicePathTrie);
+    return EFI_SUCCESS;
+}
+
+VOID HostHandleShutdown (
+    VOID
+) {
+    for (HOST_HANDLE *Handle : mHandles) {
+        for (HOST_PROTOCOL_INTERFACE *Entry : Handle->Protocols) {
+            delete Entry;
+        }
+        Handle->Signature = 0;
+        delete Handle;
+    }
+    for (HOST_PROTOCOL_NOTIFY *Notify : mProtocolNotifies) {
+        Notify->Signature = 0;
+        delete Notify;
+    }
+    for (HOST_PROTOCOL_ENTRY *Entry : mProtocolTable) {
+        delete Entry;
+    }
+    HostFreeDevicePathTrie(&mDevicePathTrie);
+    mHandles.clear();
+    mHandleSet.clear();
+    mProtocolNotifies.clear();
+    mProtocolNotifySet.clear();
+    mProtocolTable.clear();
+    mProtocolTable.shrink_to_fit();
+    mProtocolCount = 0;
+}
+
+VOID HostUnregisterProtocolNotify (
+    IN EFI_EVENT Event
+) {
+    for (std::list<HOST_PROTOCOL_NOTIFY *>::iterator It = mProtocolNotifies.begin(); It != mProtocolNotifies.end();) {
+        HOST_PROTOCOL_NOTIFY *Notify = *It;
+        if (Notify->Event != Event) {
+            ++It;
+            continue;
+        }
+
+        std::vector<HOST_PROTOCOL_NOTIFY *> &Notifies = Notify->Protocol->Notifies;
+        for (UINTN Index = 0; Index < Notifies.size(); Index++) {
+            if (Notifies[Index] == Notify) {
+                Notifies.erase(Notifies.begin() + Index);
+                break;
+            }
+        }
+        mProtocolNotifySet.erase(Notify);
+        Notify->Signature = 0;
+        delete Notify;
+        It = mProtocolNotifies.erase(It);
+    }
+}
+
+/**
+ * Drops every open of a protocol made by AgentHandle, as unloading an image does
+ */
+VOID HostCloseAgentProtocols (
+    IN EFI_HANDLE AgentHandle
+) {
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    for (HOST_HANDLE *Handle : mHandles) {
+        for (HOST_PROTOCOL_INTERFACE *Protocol : Handle->Protocols) {
+            std::vector<EFI_OPEN_PROTOCOL_INFORMATION_ENTRY> &OpenList = Protocol->OpenList;
+            for (UINTN Index = 0; Index < OpenList.size();) {
+                if (OpenList[Index].AgentHandle == AgentHandle) {
+                    OpenList.erase(OpenList.begin() + Index);
+                } else {
+                    Index++;
+                }
+            }
+        }
+    }
+    HostRestoreTpl(OldTpl);
+}
+
+EFI_STATUS EFI_API HostInstallProtocolInterface (
+    IN OUT EFI_HANDLE       *Handle,
+    IN EFI_GUID             *Protocol,
+    IN EFI_INTERFACE_TYPE   InterfaceType,
+    IN VOID                 *Interface
+) {
+    if (Handle == NULL || Protocol == NULL || InterfaceType != EFI_NATIVE_INTERFACE) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    HOST_PROTOCOL_ENTRY *ProtocolEntry = HostAddProtocolEntry(Protocol);
+    HOST_HANDLE *Entry = NULL;
+    if (*Handle != NULL) {
+        Entry = HostLookupHandle(*Handle);
+        if (Entry == NULL || HostFindProtocolEntry(Entry, ProtocolEntry) != NULL) {
+            HostRestoreTpl(OldTpl);
+            return EFI_INVALID_PARAMETER;
+        }
+    } else {
+        Entry = new HOST_HANDLE();
+        Entry->Signature = HOST_HANDLE_SIGNATURE;
+        Entry->Link = mHandles.insert(mHandles.end(), Entry);
+        mHandleSet.insert(Entry);
+    }
+
+    HOST_PROTOCOL_INTERFACE *InterfaceEntry = new HOST_PROTOCOL_INTERFACE();
+    InterfaceEntry->Handle = Entry;
+    InterfaceEntry->Protocol = ProtocolEntry;
+    InterfaceEntry->Interface = Interface;
+    InterfaceEntry->ProtocolLink = ProtocolEntry->Interfaces.insert(ProtocolEntry->Interfaces.end(), InterfaceEntry);
+    Entry->Protocols.push_back(InterfaceEntry);
+    HostIndexDevicePath(InterfaceEntry);
+
+    *Handle = (EFI_HANDLE)Entry;
+    HostNotifyProtocol(*Handle, ProtocolEntry);
+    HostRestoreTpl(OldTpl);
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostReinstallProtocolInterface (
+    IN EFI_HANDLE   Handle,
+    IN EFI_GUID     *Protocol,
+    IN VOID         *OldInterface,
+    IN VOID         *NewInterface
+) {
+    if (Protocol == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    HOST_HANDLE *Entry = HostLookupHandle(Handle);
+    if (Entry == NULL) {
+        HostRestoreTpl(OldTpl);
+        return EFI_INVALID_PARAMETER;
+    }
+
+    HOST_PROTOCOL_INTERFACE *ProtocolEntry = HostFindProtocol(Entry, Protocol);
+    if (ProtocolEntry == NULL || ProtocolEntry->Interface != OldInterface) {
+        HostRestoreTpl(OldTpl);
+        return EFI_NOT_FOUND;
+    }
+    if (HostIsOpenedByDriver(ProtocolEntry)) {
+        HostRestoreTpl(OldTpl);
+        return EFI_ACCESS_DENIED;
+    }
+
+    HostUnindexDevicePath(ProtocolEntry);
+    ProtocolEntry->Interface = NewInterface;
+    HostIndexDevicePath(ProtocolEntry);
+    HostNotifyProtocol(Handle, ProtocolEntry->Protocol);
+    HostRestoreTpl(OldTpl);
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostUninstallProtocolInterface (
+    IN EFI_HANDLE   Handle,
+    IN EFI_GUID     *Protocol,
+    IN VOID         *Interface
+) {
+    if (Protocol == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    HOST_HANDLE *Entry = HostLookupHandle(Handle);
+    if (Entry == NULL) {
+        HostRestoreTpl(OldTpl);
+        return EFI_INVALID_PARAMETER;
+    }
+
+    HOST_PROTOCOL_INTERFACE *ProtocolEntry = HostFindProtocol(Entry, Protocol);
+    if (ProtocolEntry == NULL || ProtocolEntry->Interface != Interface) {
+        HostRestoreTpl(OldTpl);
+        return EFI_NOT_FOUND;
+    }
+    if (HostIsOpenedByDriver(ProtocolEntry)) {
+        HostRestoreTpl(OldTpl);
+        return EFI_ACCESS_DENIED;
+    }
+
+    HostRemoveProtocolInterface(ProtocolEntry);
+    HostRestoreTpl(OldTpl);
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostHandleProtocol (
+    IN EFI_HANDLE   Handle,
+    IN EFI_GUID     *Protocol,
+    OUT VOID        **Interface
+) {
+    return HostOpenProtocol(Handle, Protocol, Interface, gHostImageHandle, NULL, EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL);
+}
+
+EFI_STATUS EFI_API HostRegisterProtocolNotify (
+    IN EFI_GUID     *Protocol,
+    IN EFI_EVENT    Event,
+    OUT VOID        **Registration
+) {
+    if (Protocol == NULL || Event == NULL || Registration == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    HOST_PROTOCOL_NOTIFY *Notify = new HOST_PROTOCOL_NOTIFY();
+    Notify->Signature = HOST_PROTOCOL_NOTIFY_SIGNATURE;
+    Notify->Protocol = HostAddProtocolEntry(Protocol);
+    Notify->Event = Event;
+    Notify->Protocol->Notifies.push_back(Notify);
+    mProtocolNotifies.push_back(Notify);
+    mProtocolNotifySet.insert(Notify);
+    HostRestoreTpl(OldTpl);
+
+    *Registration = Notify;
+    return EFI_SUCCESS;
+}
+
+static HOST_PROTOCOL_NOTIFY *HostLookupRegistration (
+    IN VOID *Registration
+) {
+    HOST_PROTOCOL_NOTIFY *Notify = (HOST_PROTOCOL_NOTIFY *)Registration;
+    if (Notify == NULL || mProtocolNotifySet.count(Notify) == 0 || Notify->Signature != HOST_PROTOCOL_NOTIFY_SIGNATURE) {
+        return NULL;
+    }
+    return Notify;
+}
+
+/**
+ * Collects the handles matching a LocateHandle search
+ */
+static EFI_STATUS HostCollectHandles (
+    IN EFI_LOCATE_SEARCH_TYPE   SearchType,
+    IN EFI_GUID                 *Protocol OPTIONAL,
+    IN VOID                     *SearchKey OPTIONAL,
+    OUT std::vector<EFI_HANDLE> &Handles
+) {
+    switch (SearchType) {
+    case AllHandles:
+        for (HOST_HANDLE *Entry : mHandles) {
+            Handles.push_back((EFI_HANDLE)Entry);
+        }
+        break;
+
+    case ByRegisterNotify: {
+        HOST_PROTOCOL_NOTIFY *Notify = HostLookupRegistration(SearchKey);
+        if (Notify == NULL) {
+            return EFI_INVALID_PARAMETER;
+        }
+        //
+        // Each call returns the next handle that is new for the registration
+        //
+        if (!Notify->NewHandles.empty()) {
+            Handles.push_back(Notify->NewHandles.front());
+            Notify->NewHandles.pop_front();
+        }
+        break;
+    }
+
+    case ByProtocol: {
+        if (Protocol == NULL) {
+            return EFI_INVALID_PARAMETER;
+        }
+        HOST_PROTOCOL_ENTRY *Entry = HostLookupProtocolEntry(Protocol);
+        if (Entry != NULL) {
+            Handles.reserve(Entry->Interfaces.size());
+            for (HOST_PROTOCOL_INTERFACE *Interface : Entry->Interfaces) {
+                Handles.push_back((EFI_HANDLE)Interface->Handle);
+            }
+        }
+        break;
+    }
+
+    default:
+        return EFI_INVALID_PARAMETER;
+    }
+
+    return Handles.empty() ? EFI_NOT_FOUND : EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostLocateHandle (
+    IN EFI_LOCATE_SEARCH_TYPE   SearchType,
+    IN EFI_GUID                 *Protocol OPTIONAL,
+    IN VOID                     *SearchKey OPTIONAL,
+    IN OUT UINTN                *BufferSize,
+    OUT EFI_HANDLE              *Buffer
+) {
+    if (BufferSize == NULL || (*BufferSize != 0 && Buffer == NULL)) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    std::vector<EFI_HANDLE> Handles;
+    EFI_STATUS Status = HostCollectHandles(SearchType, Protocol, SearchKey, Handles);
+    if (Status == EFI_SUCCESS) {
+        UINTN Needed = Handles.size() * sizeof(EFI_HANDLE);
+        if (*BufferSize < Needed) {
+            Status = EFI_BUFFER_TOO_SMALL;
+            if (SearchType == ByRegisterNotify) {
+                HostLookupRegistration(SearchKey)->NewHandles.push_front(Handles[0]);
+            }
+        } else {
+            memcpy(Buffer, Handles.data(), Needed);
+        }
+        *BufferSize = Needed;
+    }
+    HostRestoreTpl(OldTpl);
+    return Status;
+}
+
+EFI_STATUS EFI_API HostLocateHandleBuffer (
+    IN EFI_LOCATE_SEARCH_TYPE   SearchType,
+    IN EFI_GUID                 *Protocol OPTIONAL,
+    IN VOID                     *SearchKey OPTIONAL,
+    OUT UINTN                   *NoHandles,
+    OUT EFI_HANDLE              **Buffer
+) {
+    if (NoHandles == NULL || Buffer == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    *NoHandles = 0;
+    *Buffer = NULL;
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    std::vector<EFI_HANDLE> Handles;
+    EFI_STATUS Status = HostCollectHandles(SearchType, Protocol, SearchKey, Handles);
+    if (Status == EFI_SUCCESS) {
+        Status = HostAllocatePool(EfiBootServicesData, Handles.size() * sizeof(EFI_HANDLE), (VOID **)Buffer);
+        if (Status == EFI_SUCCESS) {
+            memcpy(*Buffer, Handles.data(), Handles.size() * sizeof(EFI_HANDLE));
+            *NoHandles = Handles.size();
+        }
+    }
+    HostRestoreTpl(OldTpl);
+    return Status;
+}
+
+EFI_STATUS EFI_API HostLocateProtocol (
+    IN EFI_GUID *Protocol,
+    IN VOID     *Registration OPTIONAL,
+    OUT VOID    **Interface
+) {
+    if (Protocol == NULL || Interface == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    *Interface = NULL;
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    EFI_STATUS Status = EFI_NOT_FOUND;
+    if (Registration != NULL) {
+        HOST_PROTOCOL_NOTIFY *Notify = HostLookupRegistration(Registration);
+        while (Notify != NULL && !Notify->NewHandles.empty()) {
+            HOST_HANDLE *Entry = HostLookupHandle(Notify->NewHandles.front());
+            Notify->NewHandles.pop_front();
+            HOST_PROTOCOL_INTERFACE *ProtocolEntry = Entry != NULL ? HostFindProtocol(Entry, Protocol) : NULL;
+            if (ProtocolEntry != NULL) {
+                *Interface = ProtocolEntry->Interface;
+                Status = EFI_SUCCESS;
+                break;
+            }
+        }
+    } else {
+        HOST_PROTOCOL_ENTRY *Entry = HostLookupProtocolEntry(Protocol);
+        if (Entry != NULL && !Entry->Interfaces.empty()) {
+            *Interface = Entry->Interfaces.front()->Interface;
+            Status = EFI_SUCCESS;
+        }
+    }
+    HostRestoreTpl(OldTpl);
+    return Status;
+}
+
+EFI_STATUS EFI_API HostLocateDevicePath (
+    IN EFI_GUID                     *Protocol,
+    IN OUT EFI_DEVICE_PATH_PROTOCOL **DevicePath,
+    OUT EFI_HANDLE                  *Device
+) {
+    if (Protocol == NULL || DevicePath == NULL || *DevicePath == NULL || Device == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    //
+    // Follow the path down the trie; the deepest level with a handle supporting
+    // Protocol is the longest matching prefix
+    //
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    HOST_PROTOCOL_ENTRY *ProtocolEntry = HostLookupProtocolEntry(Protocol);
+    HOST_HANDLE *Best = NULL;
+    UINTN BestSize = 0;
+    HOST_DEVICE_PATH_NODE *Trie = &mDevicePathTrie;
+    const EFI_DEVICE_PATH_PROTOCOL *Node = *DevicePath;
+    while (ProtocolEntry != NULL) {
+        for (HOST_PROTOCOL_INTERFACE *Path : Trie->Paths) {
+            if (HostFindProtocolEntry(Path->Handle, ProtocolEntry) != NULL) {
+                Best = Path->Handle;
+                BestSize = (UINTN)((const UINT8 *)Node - (const UINT8 *)*DevicePath);
+                break;
+            }
+        }
+        if (IsDevicePathEndType(Node) || DevicePathNodeLength(Node) < sizeof(EFI_DEVICE_PATH_PROTOCOL)) {
+            break;
+        }
+        Trie = HostFindDevicePathChild(Trie, Node, HashDevicePathNode(Node));
+        if (Trie == NULL) {
+            break;
+        }
+        Node = NextDevicePathNode(Node);
+    }
+    HostRestoreTpl(OldTpl);
+
+    if (Best == NULL) {
+        return EFI_NOT_FOUND;
+    }
+    *Device = (EFI_HANDLE)Best;
+    *DevicePath = (EFI_DEVICE_PATH_PROTOCOL *)((UINT8 *)*DevicePath + BestSize);
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostConnectController (
+    IN EFI_HANDLE               ControllerHandle,
+    IN EFI_HANDLE               *DriverImageHandle OPTIONAL,
+    IN EFI_DEVICE_PATH_PROTOCOL *RemainingDevicePath OPTIONAL,
+    IN BOOLEAN                  Recursive
+) {
+    (VOID)DriverImageHandle;
+    (VOID)RemainingDevicePath;
+    (VOID)Recursive;
+
+    if (HostLookupHandle(ControllerHandle) == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    //
+    // The hosted environment has no driver binding support, so no driver can be connected
+    //
+    return EFI_NOT_FOUND;
+}
+
+EFI_STATUS EFI_API HostDisconnectController (
+    IN EFI_HANDLE   ControllerHandle,
+    IN EFI_HANDLE   DriverImageHandle OPTIONAL,
+    IN EFI_HANDLE   ChildHandle OPTIONAL
+) {
+    (VOID)DriverImageHandle;
+
+    if (HostLookupHandle(ControllerHandle) == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (ChildHandle != NULL && HostLookupHandle(ChildHandle) == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostOpenProtocol (
+    IN EFI_HANDLE   Handle,
+    IN EFI_GUID     *Protocol,
+    OUT VOID        **Interface OPTIONAL,
+    IN EFI_HANDLE   AgentHandle,
+    IN EFI_HANDLE   ControllerHandle,
+    IN UINT32       Attributes
+) {
+    if (Protocol == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (Interface == NULL && Attributes != EFI_OPEN_PROTOCOL_TEST_PROTOCOL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    EFI_STATUS Status = EFI_SUCCESS;
+    HOST_HANDLE *Entry = HostLookupHandle(Handle);
+    if (Entry == NULL) {
+        Status = EFI_INVALID_PARAMETER;
+    }
+
+    //
+    // Validate the agent and controller handles required by the open mode
+    //
+    if (Status == EFI_SUCCESS) {
+        switch (Attributes) {
+        case EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL:
+        case EFI_OPEN_PROTOCOL_GET_PROTOCOL:
+        case EFI_OPEN_PROTOCOL_TEST_PROTOCOL:
+            break;
+        case EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER:
+            if (HostLookupHandle(AgentHandle) == NULL || HostLookupHandle(ControllerHandle) == NULL || Handle == ControllerHandle) {
+                Status = EFI_INVALID_PARAMETER;
+            }
+            break;
+        case EFI_OPEN_PROTOCOL_BY_DRIVER:
+        case EFI_OPEN_PROTOCOL_BY_DRIVER | EFI_OPEN_PROTOCOL_EXCLUSIVE:
+            if (HostLookupHandle(AgentHandle) == NULL || HostLookupHandle(ControllerHandle) == NULL) {
+                Status = EFI_INVALID_PARAMETER;
+            }
+            break;
+        case EFI_OPEN_PROTOCOL_EXCLUSIVE:
+            if (HostLookupHandle(AgentHandle) == NULL) {
+                Status = EFI_INVALID_PARAMETER;
+            }
+            break;
+        default:
+            Status = EFI_INVALID_PARAMETER;
+            break;
+        }
+    }
+
+    HOST_PROTOCOL_INTERFACE *ProtocolEntry = NULL;
+    if (Status == EFI_SUCCESS) {
+        ProtocolEntry = HostFindProtocol(Entry, Protocol);
+        if (ProtocolEntry == NULL) {
+            Status = EFI_UNSUPPORTED;
+        }
+    }
+    if (Status != EFI_SUCCESS || Attributes == EFI_OPEN_PROTOCOL_TEST_PROTOCOL) {
+        if (Interface != NULL && Attributes != EFI_OPEN_PROTOCOL_TEST_PROTOCOL) {
+            *Interface = NULL;
+        }
+        HostRestoreTpl(OldTpl);
+        return Status;
+    }
+
+    BOOLEAN ByDriver = FALSE;
+    BOOLEAN Exclusive = FALSE;
+    EFI_OPEN_PROTOCOL_INFORMATION_ENTRY *Existing = NULL;
+    for (EFI_OPEN_PROTOCOL_INFORMATION_ENTRY &Open : ProtocolEntry->OpenList) {
+        BOOLEAN ExactMatch = Open.AgentHandle == AgentHandle && Open.ControllerHandle == ControllerHandle && Open.Attributes == Attributes;
+        if ((Open.Attributes & EFI_OPEN_PROTOCOL_BY_DRIVER) != 0) {
+            ByDriver = TRUE;
+        }
+        if ((Open.Attributes & EFI_OPEN_PROTOCOL_EXCLUSIVE) != 0) {
+            Exclusive = TRUE;
+        }
+        if (ExactMatch) {
+            Existing = &Open;
+        }
+    }
+
+    switch (Attributes) {
+    case EFI_OPEN_PROTOCOL_BY_DRIVER:
+        if (Exclusive || ByDriver) {
+            Status = (Existing != NULL && ByDriver) ? EFI_ALREADY_STARTED : EFI_ACCESS_DENIED;
+        }
+        break;
+    case EFI_OPEN_PROTOCOL_BY_DRIVER | EFI_OPEN_PROTOCOL_EXCLUSIVE:
+    case EFI_OPEN_PROTOCOL_EXCLUSIVE:
+        if (Exclusive) {
+            Status = Existing != NULL ? EFI_ALREADY_STARTED : EFI_ACCESS_DENIED;
+        } else if (ByDriver) {
+            //
+            // Without driver binding support the current owner cannot be disconnected
+            //
+            Status = EFI_ACCESS_DENIED;
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (Status == EFI_SUCCESS) {
+        if (Existing != NULL) {
+            Existing->OpenCount++;
+        } else {
+            EFI_OPEN_PROTOCOL_INFORMATION_ENTRY Open;
+            Open.AgentHandle = AgentHandle;
+            Open.ControllerHandle = ControllerHandle;
+            Open.Attributes = Attributes;
+            Open.OpenCount = 1;
+            ProtocolEntry->OpenList.push_back(Open);
+        }
+    }
+
+    *Interface = (Status == EFI_SUCCESS || Status == EFI_ALREADY_STARTED) ? ProtocolEntry->Interface : NULL;
+    HostRestoreTpl(OldTpl);
+    return Status;
+}
+
+EFI_STATUS EFI_API HostCloseProtocol (
+    IN EFI_HANDLE   Handle,
+    IN EFI_GUID     *Protocol,
+    IN EFI_HANDLE   AgentHandle,
+    IN EFI_HANDLE   ControllerHandle
+) {
+    if (Protocol == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    HOST_HANDLE *Entry = HostLookupHandle(Handle);
+    if (Entry == NULL || HostLookupHandle(AgentHandle) == NULL || (ControllerHandle != NULL && HostLookupHandle(ControllerHandle) == NULL)) {
+        HostRestoreTpl(OldTpl);
+        return EFI_INVALID_PARAMETER;
+    }
+
+    HOST_PROTOCOL_INTERFACE *ProtocolEntry = HostFindProtocol(Entry, Protocol);
+    EFI_STATUS Status = EFI_NOT_FOUND;
+    if (ProtocolEntry != NULL) {
+        std::vector<EFI_OPEN_PROTOCOL_INFORMATION_ENTRY> &OpenList = ProtocolEntry->OpenList;
+        for (UINTN Index = 0; Index < OpenList.size();) {
+            if (OpenList[Index].AgentHandle == AgentHandle && OpenList[Index].ControllerHandle == ControllerHandle) {
+                OpenList.erase(OpenList.begin() + Index);
+                Status = EFI_SUCCESS;
+            } else {
+                Index++;
+            }
+        }
+    }
+    HostRestoreTpl(OldTpl);
+    return Status;
+}
+
+EFI_STATUS EFI_API HostOpenProtocolInformation (
+    IN EFI_HANDLE                           Handle,
+    IN EFI_GUID                             *Protocol,
+    OUT EFI_OPEN_PROTOCOL_INFORMATION_ENTRY **EntryBuffer,
+    OUT UINTN                               *EntryCount
+) {
+    if (Protocol == NULL || EntryBuffer == NULL || EntryCount == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    HOST_HANDLE *Entry = HostLookupHandle(Handle);
+    HOST_PROTOCOL_INTERFACE *ProtocolEntry = Entry != NULL ? HostFindProtocol(Entry, Protocol) : NULL;
+    if (ProtocolEntry == NULL) {
+        HostRestoreTpl(OldTpl);
+        return EFI_NOT_FOUND;
+    }
+
+    UINTN Count = ProtocolEntry->OpenList.size();
+    UINTN Size = (Count != 0 ? Count : 1) * sizeof(EFI_OPEN_PROTOCOL_INFORMATION_ENTRY);
+    EFI_STATUS Status = HostAllocatePool(EfiBootServicesData, Size, (VOID **)EntryBuffer);
+    if (Status == EFI_SUCCESS) {
+        if (Count != 0) {
+            memcpy(*EntryBuffer, ProtocolEntry->OpenList.data(), Count * sizeof(EFI_OPEN_PROTOCOL_INFORMATION_ENTRY));
+        }
+        *EntryCount = Count;
+    }
+    HostRestoreTpl(OldTpl);
+    return Status;
+}
+
+EFI_STATUS EFI_API HostProtocolsPerHandle (
+    IN EFI_HANDLE   Handle,
+    OUT EFI_GUID    ***ProtocolBuffer,
+    OUT UINTN       *ProtocolBufferCount
+) {
+    if (ProtocolBuffer == NULL || ProtocolBufferCount == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    HOST_HANDLE *Entry = HostLookupHandle(Handle);
+    if (Entry == NULL) {
+        HostRestoreTpl(OldTpl);
+        return EFI_INVALID_PARAMETER;
+    }
+
+    UINTN Count = Entry->Protocols.size();
+    EFI_STATUS Status = HostAllocatePool(EfiBootServicesData, Count * sizeof(EFI_GUID *), (VOID **)ProtocolBuffer);
+    if (Status == EFI_SUCCESS) {
+        UINTN Index = 0;
+        for (HOST_PROTOCOL_INTERFACE *ProtocolEntry : Entry->Protocols) {
+            (*ProtocolBuffer)[Index++] = &ProtocolEntry->Protocol->Protocol.Guid;
+        }
+        *ProtocolBufferCount = Count;
+    }
+    HostRestoreTpl(OldTpl);
+    return Status;
+}
+
+EFI_STATUS EFI_API HostInstallMultipleProtocolInterfaces (
+    IN OUT EFI_HANDLE   *Handle,
+    ...
+) {
+    if (Handle == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    //
+    // Collect the (GUID, Interface) pairs up to the terminating NULL
+    //
+    std::vector<std::pair<EFI_GUID *, VOID *>> Pairs;
+    __builtin_ms_va_list Args;
+    __builtin_ms_va_start(Args, Handle);
+    for (;;) {
+        EFI_GUID *Protocol = __builtin_va_arg(Args, EFI_GUID *);
+        if (Protocol == NULL) {
+            break;
+        }
+        VOID *Interface = __builtin_va_arg(Args, VOID *);
+        Pairs.push_back(std::make_pair(Protocol, Interface));
+    }
+    __builtin_ms_va_end(Args);
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    EFI_HANDLE OriginalHandle = *Handle;
+    EFI_STATUS Status = EFI_SUCCESS;
+    UINTN Installed = 0;
+    for (; Installed < Pairs.size(); Installed++) {
+        //
+        // A device path may only be installed once across the handle database
+        //
+        if (CompareGuid(Pairs[Installed].first, &EFI_DEVICE_PATH_PROTOCOL_GUID) && Pairs[Installed].second != NULL) {
+            EFI_DEVICE_PATH_PROTOCOL *Remaining = (EFI_DEVICE_PATH_PROTOCOL *)Pairs[Installed].second;
+            EFI_HANDLE Existing;
+            if (HostLocateDevicePath(&EFI_DEVICE_PATH_PROTOCOL_GUID, &Remaining, &Existing) == EFI_SUCCESS && Remaining->Type == EFI_DEVICE_PATH_END) {
+                Status = EFI_ALREADY_STARTED;
+                break;
+            }
+        }
+
+        Status = HostInstallProtocolInterface(Handle, Pairs[Installed].first, EFI_NATIVE_INTERFACE, Pairs[Installed].second);
+        if (Status != EFI_SUCCESS) {
+            break;
+        }
+    }
+
+    if (Status != EFI_SUCCESS) {
+        while (Installed-- > 0) {
+            HostUninstallProtocolInterface(*Handle, Pairs[Installed].first, Pairs[Installed].second);
+        }
+        *Handle = OriginalHandle;
+    }
+    HostRestoreTpl(OldTpl);
+    return Status;
+}
+
+EFI_STATUS EFI_API HostUninstallMultipleProtocolInterfaces (
+    IN EFI_HANDLE Handle,
+    ...
+) {
+    std::vector<std::pair<EFI_GUID *, VOID *>> Pairs;
+    __builtin_ms_va_list Args;
+    __builtin_ms_va_start(Args, Handle);
+    for (;;) {
+        EFI_GUID *Protocol = __builtin_va_arg(Args, EFI_GUID *);
+        if (Protocol == NULL) {
+            break;
+        }
+        VOID *Interface = __builtin_va_arg(Args, VOID *);
+        Pairs.push_back(std::make_pair(Protocol, Interface));
+    }
+    __builtin_ms_va_end(Args);
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    HOST_HANDLE *Entry = HostLookupHandle(Handle);
+    if (Entry == NULL) {
+        HostRestoreTpl(OldTpl);
+        return EFI_INVALID_PARAMETER;
+    }
+
+    //
+    // Validate every pair first so that a failure leaves the handle untouched
+    //
+    for (std::pair<EFI_GUID *, VOID *> &Pair : Pairs) {
+        HOST_PROTOCOL_INTERFACE *ProtocolEntry = HostFindProtocol(Entry, Pair.first);
+        if (ProtocolEntry == NULL || ProtocolEntry->Interface != Pair.second || HostIsOpenedByDriver(ProtocolEntry)) {
+            HostRestoreTpl(OldTpl);
+            return EFI_INVALID_PARAMETER;
+        }
+    }
+
+    for (std::pair<EFI_GUID *, VOID *> &Pair : Pairs) {
+        HostUninstallProtocolInterface(Handle, Pair.first, Pair.second);
+    }
+    HostRestoreTpl(OldTpl);
+    return EFI_SUCCESS;
+}
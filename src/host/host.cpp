@@ -0,0 +1,320 @@
+#include "internal.h"
+
+#include <cerrno>
+#include <ctime>
+
+EFI_HOST_CONFIG         gHostConfig;
+EFI_SYSTEM_TABLE        *gHostSystemTable;
+EFI_BOOT_SERVICES       *gHostBootServices;
+EFI_RUNTIME_SERVICES    *gHostRuntimeServices;
+EFI_HANDLE              gHostImageHandle;
+BOOLEAN                 gHostAtRuntime;
+
+static EFI_SYSTEM_TABLE             mSystemTable;
+static EFI_BOOT_SERVICES            mBootServices;
+static EFI_RUNTIME_SERVICES         mRuntimeServices;
+static EFI_LOADED_IMAGE_PROTOCOL    mLoadedImage;
+static BOOLEAN                      mInitialized;
+static UINT64                       mTimeOrigin;
+static UINT64                       mVirtualTime;
+
+static CHAR16 mDefaultFirmwareVendor[] = u"uefi-spec hosted";
+
+/**
+ * Idle quantum used when nothing bounds a wait, in 100ns units
+ */
+#define HOST_IDLE_QUANTUM 10000
+
+static UINT64 HostReadMonotonicClock (
+    VOID
+) {
+    struct timespec Now;
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    return (UINT64)Now.tv_sec * 10000000 + (UINT64)Now.tv_nsec / 100;
+}
+
+UINT64 HostGetTimestamp (
+    VOID
+) {
+    if (gHostConfig.VirtualClock) {
+        return mVirtualTime;
+    }
+    return HostReadMonotonicClock() - mTimeOrigin;
+}
+
+VOID HostIdle (
+    IN UINT64 Deadline
+) {
+    HostConsoleFlush();
+
+    UINT64 Now = HostGetTimestamp();
+    UINT64 Until = HostNextTimerDeadline();
+    if (Deadline < Until) {
+        Until = Deadline;
+    }
+    if (Until < Now || Until - Now > HOST_IDLE_QUANTUM) {
+        Until = Now + HOST_IDLE_QUANTUM;
+    }
+
+    if (HostUringBusy()) {
+        //
+        // Asynchronous I/O completes while idle. With a virtual clock it takes no
+        // time, so wait for it before moving the clock.
+        //
+        HostUringWait(gHostConfig.VirtualClock ? UINT64_MAX : Until - Now);
+    } else if (gHostConfig.VirtualClock) {
+        mVirtualTime = Until;
+    } else if (Until > Now) {
+        struct timespec Delay;
+        Delay.tv_sec = (time_t)((Until - Now) / 10000000);
+        Delay.tv_nsec = (long)((Until - Now) % 10000000) * 100;
+        while (nanosleep(&Delay, &Delay) != 0 && errno == EINTR) {
+        }
+    }
+
+    //
+    // The hosted equivalent of the timer and I/O completion interrupts
+    //
+    if (HostGetCurrentTpl() < TPL_HIGH_LEVEL) {
+        EFI_TPL OldTpl = HostRaiseTpl(TPL_HIGH_LEVEL);
+        HostTimerCheck();
+        HostUringPoll();
+        HostRestoreTpl(OldTpl);
+    }
+}
+
+VOID HostUpdateTableCrc (
+    IN OUT EFI_TABLE_HEADER *Header
+) {
+    UINT32 Crc = 0;
+    Header->CRC32 = 0;
+    HostCalculateCrc32(Header, Header->HeaderSize, &Crc);
+    Header->CRC32 = Crc;
+}
+
+static VOID HostFillBootServices (
+    OUT EFI_BOOT_SERVICES *BootServices
+) {
+    BootServices->Header.Signature = EFI_BOOT_SERVICES_SIGNATURE;
+    BootServices->Header.Revision = EFI_BOOT_SERVICES_REVISION;
+    BootServices->Header.HeaderSize = sizeof(EFI_BOOT_SERVICES);
+
+    BootServices->RaiseTPL = HostRaiseTpl;
+    BootServices->RestoreTPL = HostRestoreTpl;
+
+    BootServices->AllocatePages = HostAllocatePages;
+    BootServices->FreePages = HostFreePages;
+    BootServices->GetMemoryMap = HostGetMemoryMap;
+    BootServices->AllocatePool = HostAllocatePool;
+    BootServices->FreePool = HostFreePool;
+
+    BootServices->CreateEvent = HostCreateEvent;
+    BootServices->SetTimer = HostSetTimer;
+    BootServices->WaitForEvent = HostWaitForEvent;
+    BootServices->SignalEvent = HostSignalEvent;
+    BootServices->CloseEvent = HostCloseEvent;
+    BootServices->CheckEvent = HostCheckEvent;
+
+    BootServices->InstallProtocolInterface = HostInstallProtocolInterface;
+    BootServices->ReinstallProtocolInterface = HostReinstallProtocolInterface;
+    BootServices->UninstallProtocolInterface = HostUninstallProtocolInterface;
+    BootServices->HandleProtocol = HostHandleProtocol;
+    BootServices->Reserved = NULL;
+    BootServices->RegisterProtocolNotify = HostRegisterProtocolNotify;
+    BootServices->LocateHandle = HostLocateHandle;
+    BootServices->LocateDevicePath = HostLocateDevicePath;
+    BootServices->InstallConfigurationTable = HostInstallConfigurationTable;
+
+    BootServices->LoadImage = HostLoadImage;
+    BootServices->StartImage = HostStartImage;
+    BootServices->Exit = HostExit;
+    BootServices->UnloadImage = HostUnloadImage;
+    BootServices->ExitBootServices = HostExitBootServices;
+
+    BootServices->GetNextMonotonicCount = HostGetNextMonotonicCount;
+    BootServices->Stall = HostStall;
+    BootServices->SetWatchdogTimer = HostSetWatchdogTimer;
+
+    BootServices->ConnectController = HostConnectController;
+    BootServices->DisconnectController = HostDisconnectController;
+
+    BootServices->OpenProtocol = HostOpenProtocol;
+    BootServices->CloseProtocol = HostCloseProtocol;
+    BootServices->OpenProtocolInformation = HostOpenProtocolInformation;
+
+    BootServices->ProtocolsPerHandle = HostProtocolsPerHandle;
+    BootServices->LocateHandleBuffer = HostLocateHandleBuffer;
+    BootServices->LocateProtocol = HostLocateProtocol;
+    BootServices->InstallMultipleProtocolInterfaces = HostInstallMultipleProtocolInterfaces;
+    BootServices->UninstallMultipleProtocolInterfaces = HostUninstallMultipleProtocolInterfaces;
+
+    BootServices->CalculateCrc32 = HostCalculateCrc32;
+
+    BootServices->CopyMem = HostCopyMem;
+    BootServices->SetMem = HostSetMem;
+    BootServices->CreateEventEx = HostCreateEventEx;
+}
+
+static VOID HostFillRuntimeServices (
+    OUT EFI_RUNTIME_SERVICES *RuntimeServices
+) {
+    RuntimeServices->Header.Signature = EFI_RUNTIME_SERVICES_SIGNATURE;
+    RuntimeServices->Header.Revision = EFI_RUNTIME_SERVICES_REVISION;
+    RuntimeServices->Header.HeaderSize = sizeof(EFI_RUNTIME_SERVICES);
+
+    RuntimeServices->GetTime = HostGetTime;
+    RuntimeServices->SetTime = HostSetTime;
+    RuntimeServices->GetWakeupTime = HostGetWakeupTime;
+    RuntimeServices->SetWakeupTime = HostSetWakeupTime;
+
+    RuntimeServices->SetVirtualAddressMap = HostSetVirtualAddressMap;
+    RuntimeServices->ConvertPointer = HostConvertPointer;
+
+    RuntimeServices->GetVariable = HostGetVariable;
+    RuntimeServices->GetNextVariableName = HostGetNextVariableName;
+    RuntimeServices->SetVariable = HostSetVariable;
+
+    RuntimeServices->GetNextHighMonotonicCount = HostGetNextHighMonotonicCount;
+    RuntimeServices->ResetSystem = HostResetSystem;
+
+    RuntimeServices->UpdateCapsule = HostUpdateCapsule;
+    RuntimeServices->QueryCapsuleCapabilities = HostQueryCapsuleCapabilities;
+
+    RuntimeServices->QueryVariableInfo = HostQueryVariableInfo;
+}
+
+VOID EfiHostGetDefaultConfig (
+    OUT EFI_HOST_CONFIG *Config
+) {
+    *Config = {};
+    Config->ArenaBase = 0x40000000;
+    Config->ArenaSize = 0x40000000;
+    Config->FirmwareVendor = mDefaultFirmwareVendor;
+    Config->FirmwareRevision = 0x00010000;
+    Config->ConsoleInFd = 0;
+    Config->ConsoleOutFd = 1;
+    Config->StandardErrorFd = 2;
+    Config->VirtualClock = FALSE;
+    Config->VariableStoreSize = 0x40000;
+    Config->ImageCacheSize = 0x4000000;
+    Config->ResetHook = NULL;
+}
+
+EFI_STATUS EfiHostInitialize (
+    IN EFI_HOST_CONFIG      *Config OPTIONAL,
+    OUT EFI_SYSTEM_TABLE    **SystemTable,
+    OUT EFI_HANDLE          *ImageHandle
+) {
+    if (SystemTable == NULL || ImageHandle == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (mInitialized) {
+        return EFI_ALREADY_STARTED;
+    }
+
+    if (Config != NULL) {
+        gHostConfig = *Config;
+    } else {
+        EfiHostGetDefaultConfig(&gHostConfig);
+    }
+    if (gHostConfig.FirmwareVendor == NULL) {
+        gHostConfig.FirmwareVendor = mDefaultFirmwareVendor;
+    }
+
+    mTimeOrigin = HostReadMonotonicClock();
+    mVirtualTime = 0;
+    gHostAtRuntime = FALSE;
+    HostSetCurrentTpl(TPL_APPLICATION);
+
+    mSystemTable = {};
+    mBootServices = {};
+    mRuntimeServices = {};
+    HostFillBootServices(&mBootServices);
+    HostFillRuntimeServices(&mRuntimeServices);
+
+    mSystemTable.Header.Signature = EFI_SYSTEM_TABLE_SIGNATURE;
+    mSystemTable.Header.Revision = EFI_SYSTEM_TABLE_REVISION;
+    mSystemTable.Header.HeaderSize = sizeof(EFI_SYSTEM_TABLE);
+    mSystemTable.FirmwareVendor = gHostConfig.FirmwareVendor;
+    mSystemTable.FirmwareRevision = gHostConfig.FirmwareRevision;
+    mSystemTable.BootServices = &mBootServices;
+    mSystemTable.RuntimeServices = &mRuntimeServices;
+
+    gHostSystemTable = &mSystemTable;
+    gHostBootServices = &mBootServices;
+    gHostRuntimeServices = &mRuntimeServices;
+    mInitialized = TRUE;
+
+    EFI_STATUS Status = HostMemoryInitialize();
+    if (Status == EFI_SUCCESS) {
+        Status = HostPoolInitialize();
+    }
+    if (Status == EFI_SUCCESS) {
+        Status = HostHandleInitialize();
+    }
+    if (Status == EFI_SUCCESS) {
+        Status = HostEventInitialize();
+    }
+    if (Status == EFI_SUCCESS) {
+        Status = HostVariableInitialize();
+    }
+    if (Status == EFI_SUCCESS) {
+        Status = HostConsoleInitialize();
+    }
+
+    if (Status == EFI_SUCCESS) {
+        mLoadedImage = {};
+        mLoadedImage.Revision = EFI_LOADED_IMAGE_PROTOCOL_REVISION;
+        mLoadedImage.SystemTable = &mSystemTable;
+        mLoadedImage.ImageCodeType = EfiLoaderCode;
+        mLoadedImage.ImageDataType = EfiLoaderData;
+
+        gHostImageHandle = NULL;
+        Status = HostInstallProtocolInterface(&gHostImageHandle, &EFI_LOADED_IMAGE_PROTOCOL_GUID, EFI_NATIVE_INTERFACE, &mLoadedImage);
+    }
+
+    if (Status != EFI_SUCCESS) {
+        EfiHostShutdown();
+        return Status;
+    }
+
+    HostUpdateTableCrc(&mBootServices.Header);
+    HostUpdateTableCrc(&mRuntimeServices.Header);
+    HostUpdateTableCrc(&mSystemTable.Header);
+
+    *SystemTable = &mSystemTable;
+    *ImageHandle = gHostImageHandle;
+    return EFI_SUCCESS;
+}
+
+VOID EfiHostShutdown (
+    VOID
+) {
+    if (!mInitialized) {
+        return;
+    }
+
+    HostConsoleShutdown();
+    HostFileShutdown();
+    HostFatShutdown();
+    HostImageShutdown();
+    HostMiscShutdown();
+    HostRuntimeShutdown();
+    HostVariableShutdown();
+    HostEventShutdown();
+    HostHandleShutdown();
+    HostPoolShutdown();
+    HostMemoryShutdown();
+
+    gHostSystemTable = NULL;
+    gHostBootServices = NULL;
+    gHostRuntimeServices = NULL;
+    gHostImageHandle = NULL;
+    mInitialized = FALSE;
+}
+
+EFI_SYSTEM_TABLE *EfiHostGetSystemTable (
+    VOID
+) {
+    return mInitialized ? &mSystemTable : NULL;
+}
@@ -0,0 +1,871 @@
+#include "internal.h"
+
+#include <efi/crc32.h>
+#include <efi/device_path.h>
+#include <efi/pe.h>
+
+#include <csetjmp>
+#include <cstring>
+#include <ctime>
+#include <sys/mman.h>
+#include <unordered_map>
+#include <vector>
+
+#define HOST_IMAGE_SIGNATURE HOST_SIGNATURE_32('i', 'm', 'a', 'g')
+
+/**
+ * The machine type of images that run natively in the host process
+ */
+#define HOST_IMAGE_MACHINE EFI_IMAGE_MACHINE_X64
+
+/**
+ * What loads of one binary from one device path share: the parsed headers, the
+ * loaded image protocol each load starts from, and the device paths, which are
+ * owned here and freed with the last image using them. While Cached, the entry
+ * also keeps the file, compared on a hit so that a CRC32 collision is never taken
+ * for a match, and the image as laid out and relocated for Base.
+ */
+typedef struct _HOST_IMAGE_CACHE_ENTRY {
+    struct _HOST_IMAGE_CACHE_ENTRY  *Previous;      // Least recently used first
+    struct _HOST_IMAGE_CACHE_ENTRY  *Next;
+    BOOLEAN                         Cached;
+    UINTN                           References;     // Images using the template and device paths
+    UINT32                          Crc;
+    EFI_PE_COFF_IMAGE_INFO          Info;
+    EFI_LOADED_IMAGE_PROTOCOL       Template;
+    EFI_DEVICE_PATH_PROTOCOL        *DevicePath;
+    std::vector<UINT8>              Source;
+    std::vector<UINT8>              Image;
+    EFI_PHYSICAL_ADDRESS            Base;
+} HOST_IMAGE_CACHE_ENTRY;
+
+typedef struct _HOST_IMAGE {
+    EFI_LOADED_IMAGE_PROTOCOL   LoadedImage;
+    UINT32                      Signature;
+    EFI_HANDLE                  Handle;
+    HOST_IMAGE_CACHE_ENTRY      *Entry;         // Owner of FilePath and DevicePath
+    EFI_DEVICE_PATH_PROTOCOL    *DevicePath;    // Installed as the loaded image device path, or NULL
+    EFI_PHYSICAL_ADDRESS        Allocation;     // Pages holding the image, which may start before ImageBase
+    UINTN                       AllocationPages;
+    UINTN                       ImagePages;     // Pages from ImageBase made executable
+    UINT16                      Subsystem;
+    EFI_IMAGE_ENTRY_POINT       EntryPoint;
+    BOOLEAN                     Started;
+    std::jmp_buf                *ExitJump;      // Where Exit returns to while the entry point runs
+    EFI_STATUS                  ExitStatus;
+    UINTN                       ExitDataSize;
+    CHAR16                      *ExitData;
+    struct _HOST_IMAGE          *Caller;        // The image running when this one was started
+    EFI_HOST_IMAGE_STATS        Stats;
+} HOST_IMAGE;
+
+static BOOLEAN                                      mBeforeExitSignaled;
+static std::unordered_map<EFI_HANDLE, HOST_IMAGE *> mImages;
+static HOST_IMAGE                                   *mCurrentImage;
+
+static std::unordered_multimap<UINT32, HOST_IMAGE_CACHE_ENTRY *>    mCache;         // Keyed by the CRC32 of the file
+static HOST_IMAGE_CACHE_ENTRY                                       *mCacheFirst;
+static HOST_IMAGE_CACHE_ENTRY                                       *mCacheLast;
+static UINT64                                                       mCacheSize;     // Bytes of files and images held
+
+static UINT64 HostImageReadClock (
+    VOID
+) {
+    struct timespec Now;
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    return (UINT64)Now.tv_sec * 1000000000 + (UINT64)Now.tv_nsec;
+}
+
+static HOST_IMAGE *HostLookupImage (
+    IN EFI_HANDLE Handle
+) {
+    std::unordered_map<EFI_HANDLE, HOST_IMAGE *>::iterator It = mImages.find(Handle);
+    if (It == mImages.end() || It->second->Signature != HOST_IMAGE_SIGNATURE) {
+        return NULL;
+    }
+    return It->second;
+}
+
+static BOOLEAN HostImageSamePath (
+    IN const EFI_DEVICE_PATH_PROTOCOL *First OPTIONAL,
+    IN const EFI_DEVICE_PATH_PROTOCOL *Second OPTIONAL
+) {
+    if (First == NULL || Second == NULL) {
+        return First == Second;
+    }
+    return CompareDevicePath(First, Second);
+}
+
+/**
+ * Creates an entry, not yet cached, for an image Info describes loaded from
+ * DevicePath, whose file is FilePath on its device
+ */
+static EFI_STATUS HostImageCacheCreate (
+    IN const EFI_PE_COFF_IMAGE_INFO     *Info,
+    IN const EFI_DEVICE_PATH_PROTOCOL   *FilePath OPTIONAL,
+    IN const EFI_DEVICE_PATH_PROTOCOL   *DevicePath OPTIONAL,
+    OUT HOST_IMAGE_CACHE_ENTRY          **Entry
+) {
+    HOST_IMAGE_CACHE_ENTRY *New = new HOST_IMAGE_CACHE_ENTRY();
+    New->Info = *Info;
+    New->Template.Revision = EFI_LOADED_IMAGE_PROTOCOL_REVISION;
+    New->Template.SystemTable = gHostSystemTable;
+    New->Template.ImageSize = Info->SizeOfImage;
+    if (Info->Subsystem == EFI_IMAGE_SUBSYSTEM_EFI_APPLICATION) {
+        New->Template.ImageCodeType = EfiLoaderCode;
+        New->Template.ImageDataType = EfiLoaderData;
+    } else if (Info->Subsystem == EFI_IMAGE_SUBSYSTEM_EFI_BOOT_SERVICE_DRIVER) {
+        New->Template.ImageCodeType = EfiBootServicesCode;
+        New->Template.ImageDataType = EfiBootServicesData;
+    } else {
+        New->Template.ImageCodeType = EfiRuntimeServicesCode;
+        New->Template.ImageDataType = EfiRuntimeServicesData;
+    }
+
+    EFI_STATUS Status = EFI_SUCCESS;
+    if (FilePath != NULL) {
+        Status = DuplicateDevicePath(gHostBootServices, EfiBootServicesData, FilePath, &New->Template.FilePath);
+    }
+    if (Status == EFI_SUCCESS && DevicePath != NULL) {
+        Status = DuplicateDevicePath(gHostBootServices, EfiBootServicesData, DevicePath, &New->DevicePath);
+    }
+    if (Status != EFI_SUCCESS) {
+        if (New->Template.FilePath != NULL) {
+            HostFreePool(New->Template.FilePath);
+        }
+        delete New;
+        return Status;
+    }
+    *Entry = New;
+    return EFI_SUCCESS;
+}
+
+static VOID HostImageCacheFree (
+    IN HOST_IMAGE_CACHE_ENTRY *Entry
+) {
+    if (Entry->Template.FilePath != NULL) {
+        HostFreePool(Entry->Template.FilePath);
+    }
+    if (Entry->DevicePath != NULL) {
+        HostFreePool(Entry->DevicePath);
+    }
+    delete Entry;
+}
+
+/**
+ * Drops an image's use of Entry, freeing it once no image uses it and it is no
+ * longer cached
+ */
+static VOID HostImageCacheRelease (
+    IN HOST_IMAGE_CACHE_ENTRY *Entry
+) {
+    Entry->References--;
+    if (Entry->References == 0 && !Entry->Cached) {
+        HostImageCacheFree(Entry);
+    }
+}
+
+/**
+ * Takes Entry out of the cache. Images still using it keep its template and
+ * device paths.
+ */
+static VOID HostImageCacheEvict (
+    IN HOST_IMAGE_CACHE_ENTRY *Entry
+) {
+    if (Entry->Previous != NULL) {
+        Entry->Previous->Next = Entry->Next;
+    } else {
+        mCacheFirst = Entry->Next;
+    }
+    if (Entry->Next != NULL) {
+        Entry->Next->Previous = Entry->Previous;
+    } else {
+        mCacheLast = Entry->Previous;
+    }
+    typedef std::unordered_multimap<UINT32, HOST_IMAGE_CACHE_ENTRY *>::iterator CACHE_ITERATOR;
+    std::pair<CACHE_ITERATOR, CACHE_ITERATOR> Range = mCache.equal_range(Entry->Crc);
+    for (CACHE_ITERATOR It = Range.first; It != Range.second; ++It) {
+        if (It->second == Entry) {
+            mCache.erase(It);
+            break;
+        }
+    }
+    mCacheSize -= Entry->Source.size() + Entry->Image.size();
+
+    Entry->Previous = NULL;
+    Entry->Next = NULL;
+    Entry->Cached = FALSE;
+    std::vector<UINT8>().swap(Entry->Source);
+    std::vector<UINT8>().swap(Entry->Image);
+    if (Entry->References == 0) {
+        HostImageCacheFree(Entry);
+    }
+}
+
+static VOID HostImageCacheAppend (
+    IN HOST_IMAGE_CACHE_ENTRY *Entry
+) {
+    Entry->Previous = mCacheLast;
+    Entry->Next = NULL;
+    if (mCacheLast != NULL) {
+        mCacheLast->Next = Entry;
+    } else {
+        mCacheFirst = Entry;
+    }
+    mCacheLast = Entry;
+}
+
+/**
+ * Finds the cached entry for the file in Source loaded from DevicePath and marks
+ * it most recently used
+ */
+static HOST_IMAGE_CACHE_ENTRY *HostImageCacheLookup (
+    IN UINT32                           Crc,
+    IN const VOID                       *Source,
+    IN UINTN                            SourceSize,
+    IN const EFI_DEVICE_PATH_PROTOCOL   *DevicePath OPTIONAL
+) {
+    typedef std::unordered_multimap<UINT32, HOST_IMAGE_CACHE_ENTRY *>::iterator CACHE_ITERATOR;
+    std::pair<CACHE_ITERATOR, CACHE_ITERATOR> Range = mCache.equal_range(Crc);
+    for (CACHE_ITERATOR It = Range.first; It != Range.second; ++It) {
+        HOST_IMAGE_CACHE_ENTRY *Entry = It->second;
+        if (Entry->Source.size() != SourceSize || !HostImageSamePath(Entry->DevicePath, DevicePath) || memcmp(Entry->Source.data(), Source, SourceSize) != 0) {
+            continue;
+        }
+        if (Entry != mCacheLast) {
+            Entry->Next->Previous = Entry->Previous;
+            if (Entry->Previous != NULL) {
+                Entry->Previous->Next = Entry->Next;
+            } else {
+                mCacheFirst = Entry->Next;
+            }
+            HostImageCacheAppend(Entry);
+        }
+        return Entry;
+    }
+    return NULL;
+}
+
+/**
+ * Caches Entry with the file in Source and the image just laid out and relocated
+ * at Base, evicting the least recently used entries to stay within
+ * ImageCacheSize. Nothing is cached when the two alone exceed it.
+ */
+static VOID HostImageCacheInsert (
+    IN HOST_IMAGE_CACHE_ENTRY   *Entry,
+    IN UINT32                   Crc,
+    IN const VOID               *Source,
+    IN UINTN                    SourceSize,
+    IN EFI_PHYSICAL_ADDRESS     Base
+) {
+    UINT64 Size = (UINT64)SourceSize + Entry->Info.SizeOfImage;
+    if (Size > gHostConfig.ImageCacheSize) {
+        return;
+    }
+    while (mCacheSize + Size > gHostConfig.ImageCacheSize) {
+        HostImageCacheEvict(mCacheFirst);
+    }
+
+    Entry->Crc = Crc;
+    Entry->Source.assign((const UINT8 *)Source, (const UINT8 *)Source + SourceSize);
+    Entry->Image.assign((const UINT8 *)(UINTN)Base, (const UINT8 *)(UINTN)Base + Entry->Info.SizeOfImage);
+    Entry->Base = Base;
+    Entry->Cached = TRUE;
+    mCache.emplace(Crc, Entry);
+    HostImageCacheAppend(Entry);
+    mCacheSize += Size;
+}
+
+/**
+ * Releases the pages and pool held by Image and forgets it. Its protocols must
+ * already be uninstalled.
+ */
+static VOID HostImageFree (
+    IN HOST_IMAGE *Image
+) {
+    mprotect((VOID *)(UINTN)Image->LoadedImage.ImageBase, EFI_PAGES_TO_SIZE(Image->ImagePages), PROT_READ | PROT_WRITE);
+    HostFreePages(Image->Allocation, Image->AllocationPages);
+    HostImageCacheRelease(Image->Entry);
+    if (Image->ExitData != NULL) {
+        HostFreePool(Image->ExitData);
+    }
+    mImages.erase(Image->Handle);
+    Image->Signature = 0;
+    delete Image;
+}
+
+/**
+ * Closes what Image opened and uninstalls its protocols, which deletes its handle,
+ * then frees it
+ */
+static EFI_STATUS HostImageUnload (
+    IN HOST_IMAGE *Image
+) {
+    HostCloseAgentProtocols(Image->Handle);
+
+    EFI_STATUS Status;
+    if (Image->DevicePath != NULL) {
+        Status = HostUninstallMultipleProtocolInterfaces(Image->Handle, &EFI_LOADED_IMAGE_PROTOCOL_GUID, &Image->LoadedImage, &EFI_LOADED_IMAGE_DEVICE_PATH_PROTOCOL_GUID, Image->DevicePath, NULL);
+    } else {
+        Status = HostUninstallProtocolInterface(Image->Handle, &EFI_LOADED_IMAGE_PROTOCOL_GUID, &Image->LoadedImage);
+    }
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    HostImageFree(Image);
+    return EFI_SUCCESS;
+}
+
+/**
+ * Reads the file FilePath names on the simple file system of Device into pool
+ */
+static EFI_STATUS HostImageReadFile (
+    IN EFI_HANDLE                       Device,
+    IN const EFI_DEVICE_PATH_PROTOCOL   *FilePath,
+    OUT VOID                            **Buffer,
+    OUT UINTN                           *BufferSize
+) {
+    EFI_SIMPLE_FILE_SYSTEM_PROTOCOL *FileSystem;
+    EFI_STATUS Status = HostHandleProtocol(Device, &EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_GUID, (VOID **)&FileSystem);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    EFI_FILE_PROTOCOL *File;
+    Status = FileSystem->OpenVolume(FileSystem, &File);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+
+    //
+    // Each file path node names a path relative to the previous one
+    //
+    std::vector<CHAR16> Name;
+    for (const EFI_DEVICE_PATH_PROTOCOL *Node = FilePath; !IsDevicePathEndType(Node); Node = NextDevicePathNode(Node)) {
+        if (Node->Type != EFI_DEVICE_PATH_MEDIA || Node->SubType != EFI_DEVICE_PATH_MEDIA_FILE_PATH) {
+            File->Close(File);
+            return EFI_NOT_FOUND;
+        }
+        UINTN Length = (DevicePathNodeLength(Node) - sizeof(EFI_DEVICE_PATH_PROTOCOL)) / sizeof(CHAR16);
+        Name.assign(Length + 1, CHAR_NULL);
+        memcpy(Name.data(), (const UINT8 *)Node + sizeof(EFI_DEVICE_PATH_PROTOCOL), Length * sizeof(CHAR16));
+
+        EFI_FILE_PROTOCOL *Next;
+        Status = File->Open(File, &Next, Name.data(), EFI_FILE_MODE_READ, 0);
+        File->Close(File);
+        if (Status != EFI_SUCCESS) {
+            return Status;
+        }
+        File = Next;
+    }
+
+    UINTN InfoSize = 0;
+    std::vector<UINT8> Info;
+    Status = File->GetInfo(File, &EFI_FILE_INFO_ID, &InfoSize, NULL);
+    if (Status == EFI_BUFFER_TOO_SMALL) {
+        Info.resize(InfoSize);
+        Status = File->GetInfo(File, &EFI_FILE_INFO_ID, &InfoSize, Info.data());
+    }
+    if (Status == EFI_SUCCESS && (((EFI_FILE_INFO *)Info.data())->Attribute & EFI_FILE_DIRECTORY) != 0) {
+        Status = EFI_NOT_FOUND;
+    }
+
+    UINTN Size = 0;
+    VOID *Data = NULL;
+    if (Status == EFI_SUCCESS) {
+        Size = (UINTN)((EFI_FILE_INFO *)Info.data())->FileSize;
+        Status = HostAllocatePool(EfiBootServicesData, Size != 0 ? Size : 1, &Data);
+    }
+    if (Status == EFI_SUCCESS) {
+        UINTN Read = Size;
+        Status = File->Read(File, &Read, Data);
+        if (Status == EFI_SUCCESS && Read != Size) {
+            Status = EFI_LOAD_ERROR;
+        }
+        if (Status != EFI_SUCCESS) {
+            HostFreePool(Data);
+        }
+    }
+    File->Close(File);
+
+    if (Status == EFI_SUCCESS) {
+        *Buffer = Data;
+        *BufferSize = Size;
+    }
+    return Status;
+}
+
+/**
+ * Reads the image DevicePath names into pool, from a simple file system or
+ * through the load file protocol, and finds the device it is on
+ */
+static EFI_STATUS HostImageReadDevicePath (
+    IN BOOLEAN                  BootPolicy,
+    IN EFI_DEVICE_PATH_PROTOCOL *DevicePath,
+    OUT VOID                    **Buffer,
+    OUT UINTN                   *BufferSize,
+    OUT EFI_HANDLE              *Device,
+    OUT EFI_DEVICE_PATH_PROTOCOL **FilePath
+) {
+    EFI_DEVICE_PATH_PROTOCOL *Remaining = DevicePath;
+    if (HostLocateDevicePath(&EFI_SIMPLE_FILE_SYSTEM_PROTOCOL_GUID, &Remaining, Device) == EFI_SUCCESS) {
+        *FilePath = Remaining;
+        return HostImageReadFile(*Device, Remaining, Buffer, BufferSize);
+    }
+
+    Remaining = DevicePath;
+    if (HostLocateDevicePath(&EFI_LOAD_FILE_PROTOCOL_GUID, &Remaining, Device) != EFI_SUCCESS) {
+        return EFI_NOT_FOUND;
+    }
+    *FilePath = Remaining;
+
+    EFI_LOAD_FILE_PROTOCOL *LoadFile;
+    EFI_STATUS Status = HostHandleProtocol(*Device, &EFI_LOAD_FILE_PROTOCOL_GUID, (VOID **)&LoadFile);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    UINTN Size = 0;
+    Status = LoadFile->LoadFile(LoadFile, Remaining, BootPolicy, &Size, NULL);
+    if (Status == EFI_SUCCESS) {
+        return EFI_LOAD_ERROR;
+    }
+    if (Status != EFI_BUFFER_TOO_SMALL) {
+        return Status;
+    }
+
+    VOID *Data;
+    Status = HostAllocatePool(EfiBootServicesData, Size, &Data);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    Status = LoadFile->LoadFile(LoadFile, Remaining, BootPolicy, &Size, Data);
+    if (Status != EFI_SUCCESS) {
+        HostFreePool(Data);
+        return Status;
+    }
+    *Buffer = Data;
+    *BufferSize = Size;
+    return EFI_SUCCESS;
+}
+
+/**
+ * Lays out, relocates and maps executable the image in Source, or copies it from
+ * Cached. The base Cached was relocated for is tried first, as no fixup is then
+ * needed, and the preferred base after it.
+ */
+static EFI_STATUS HostImagePlace (
+    IN const VOID                   *Source,
+    IN HOST_IMAGE_CACHE_ENTRY       *Cached OPTIONAL,
+    IN const EFI_PE_COFF_IMAGE_INFO *Info,
+    IN OUT HOST_IMAGE               *Image
+) {
+    UINT64 Alignment = Info->SectionAlignment > EFI_PAGE_SIZE ? Info->SectionAlignment : EFI_PAGE_SIZE;
+    UINTN Pages = EFI_SIZE_TO_PAGES(Info->SizeOfImage);
+    EFI_PHYSICAL_ADDRESS Candidates[2] = { Cached != NULL ? Cached->Base : 0, Info->ImageBase };
+    EFI_PHYSICAL_ADDRESS Base = 0;
+    EFI_STATUS Status = EFI_NOT_FOUND;
+    for (UINTN Index = 0; Index < 2 && Status != EFI_SUCCESS; Index++) {
+        Base = Candidates[Index];
+        if (Base != 0 && (Base & (Alignment - 1)) == 0) {
+            Status = HostAllocatePages(AllocateAddress, Image->LoadedImage.ImageCodeType, Pages, &Base);
+            Image->Allocation = Base;
+            Image->AllocationPages = Pages;
+        }
+    }
+    if (Status != EFI_SUCCESS) {
+        UINTN Extra = EFI_SIZE_TO_PAGES(Alignment) - 1;
+        Status = HostAllocatePages(AllocateAnyPages, Image->LoadedImage.ImageCodeType, Pages + Extra, &Image->Allocation);
+        if (Status != EFI_SUCCESS) {
+            return Status;
+        }
+        Image->AllocationPages = Pages + Extra;
+        Base = (Image->Allocation + Alignment - 1) & ~(Alignment - 1);
+    }
+    Image->ImagePages = Pages;
+    Image->LoadedImage.ImageBase = (VOID *)(UINTN)Base;
+    Image->LoadedImage.ImageSize = Info->SizeOfImage;
+
+    //
+    // The cached copy is already relocated, so it is rebased from where it was
+    // relocated for rather than from the preferred base
+    //
+    const EFI_PE_COFF_IMAGE_INFO *Layout = Info;
+    EFI_PE_COFF_IMAGE_INFO Rebase;
+    UINT64 Start = HostImageReadClock();
+    if (Cached != NULL) {
+        memcpy((VOID *)(UINTN)Base, Cached->Image.data(), Cached->Image.size());
+        Rebase = *Info;
+        Rebase.ImageBase = Cached->Base;
+        Layout = &Rebase;
+    } else {
+        PeCoffLoadImage(Source, Info, (VOID *)(UINTN)Base);
+    }
+    UINT64 Copied = HostImageReadClock();
+    UINTN Fixups = 0;
+    Status = PeCoffRelocateImage((VOID *)(UINTN)Base, Layout, Base, &Fixups);
+    UINT64 Relocated = HostImageReadClock();
+
+    Image->Stats.ImageSize = Info->SizeOfImage;
+    Image->Stats.SectionCopyTime = Copied - Start;
+    Image->Stats.RelocationTime = Relocated - Copied;
+    Image->Stats.Relocations = Fixups;
+    Image->Stats.Cached = Cached != NULL;
+
+    if (Status == EFI_SUCCESS && mprotect((VOID *)(UINTN)Base, EFI_PAGES_TO_SIZE(Pages), PROT_READ | PROT_WRITE | PROT_EXEC) != 0) {
+        Status = EFI_OUT_OF_RESOURCES;
+    }
+    if (Status != EFI_SUCCESS) {
+        HostFreePages(Image->Allocation, Image->AllocationPages);
+        return Status;
+    }
+    Image->EntryPoint = (EFI_IMAGE_ENTRY_POINT)(UINTN)(Base + Info->AddressOfEntryPoint);
+    return EFI_SUCCESS;
+}
+
+/**
+ * Checks that Source is a PE32+ image the host can run
+ */
+static EFI_STATUS HostImageCheck (
+    IN const VOID               *Source,
+    IN UINTN                    SourceSize,
+    OUT EFI_PE_COFF_IMAGE_INFO  *Info
+) {
+    EFI_STATUS Status = PeCoffGetImageInfo(Source, SourceSize, Info);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    if (Info->Machine != HOST_IMAGE_MACHINE) {
+        return EFI_UNSUPPORTED;
+    }
+    if (Info->Subsystem != EFI_IMAGE_SUBSYSTEM_EFI_APPLICATION && Info->Subsystem != EFI_IMAGE_SUBSYSTEM_EFI_BOOT_SERVICE_DRIVER && Info->Subsystem != EFI_IMAGE_SUBSYSTEM_EFI_RUNTIME_DRIVER) {
+        return EFI_UNSUPPORTED;
+    }
+    return EFI_SUCCESS;
+}
+
+/**
+ * Creates the image record and handle for the PE32+ image in Source. A file
+ * loaded before from the same DevicePath is neither parsed nor laid out again,
+ * and its loaded image protocol starts as a copy of the cached template that
+ * shares its device paths.
+ */
+static EFI_STATUS HostImageCreate (
+    IN EFI_HANDLE                       ParentImageHandle,
+    IN const VOID                       *Source,
+    IN UINTN                            SourceSize,
+    IN EFI_HANDLE                       Device,
+    IN const EFI_DEVICE_PATH_PROTOCOL   *FilePath OPTIONAL,
+    IN const EFI_DEVICE_PATH_PROTOCOL   *DevicePath OPTIONAL,
+    OUT EFI_HANDLE                      *ImageHandle
+) {
+    UINT32 Crc = 0;
+    HOST_IMAGE_CACHE_ENTRY *Cached = NULL;
+    if (gHostConfig.ImageCacheSize != 0) {
+        Crc = Crc32(Source, SourceSize);
+        Cached = HostImageCacheLookup(Crc, Source, SourceSize, DevicePath);
+    }
+
+    EFI_STATUS Status;
+    EFI_PE_COFF_IMAGE_INFO Info;
+    if (Cached != NULL) {
+        Info = Cached->Info;
+    } else {
+        Status = HostImageCheck(Source, SourceSize, &Info);
+        if (Status != EFI_SUCCESS) {
+            return Status;
+        }
+    }
+
+    //
+    // The same device path can lead to a different file path once handles come
+    // and go, and the loaded image must report the one it was found through
+    //
+    HOST_IMAGE_CACHE_ENTRY *Entry = Cached;
+    if (Entry == NULL || !HostImageSamePath(Entry->Template.FilePath, FilePath)) {
+        Status = HostImageCacheCreate(&Info, FilePath, DevicePath, &Entry);
+        if (Status != EFI_SUCCESS) {
+            return Status;
+        }
+    }
+    Entry->References++;
+
+    HOST_IMAGE *Image = new HOST_IMAGE();
+    Image->LoadedImage = Entry->Template;
+    Image->LoadedImage.ParentHandle = ParentImageHandle;
+    Image->LoadedImage.DeviceHandle = Device;
+    Image->Signature = HOST_IMAGE_SIGNATURE;
+    Image->Entry = Entry;
+    Image->DevicePath = Entry->DevicePath;
+    Image->Subsystem = Info.Subsystem;
+
+    Status = HostImagePlace(Source, Cached, &Info, Image);
+    if (Status != EFI_SUCCESS) {
+        HostImageCacheRelease(Entry);
+        delete Image;
+        if (Status != EFI_UNSUPPORTED && Status != EFI_OUT_OF_RESOURCES) {
+            Status = EFI_LOAD_ERROR;
+        }
+        return Status;
+    }
+    if (Cached == NULL && gHostConfig.ImageCacheSize != 0) {
+        HostImageCacheInsert(Entry, Crc, Source, SourceSize, (EFI_PHYSICAL_ADDRESS)(UINTN)Image->LoadedImage.ImageBase);
+    }
+
+    Status = HostInstallProtocolInterface(&Image->Handle, &EFI_LOADED_IMAGE_PROTOCOL_GUID, EFI_NATIVE_INTERFACE, &Image->LoadedImage);
+    if (Status == EFI_SUCCESS && Image->DevicePath != NULL) {
+        Status = HostInstallProtocolInterface(&Image->Handle, &EFI_LOADED_IMAGE_DEVICE_PATH_PROTOCOL_GUID, EFI_NATIVE_INTERFACE, Image->DevicePath);
+        if (Status != EFI_SUCCESS) {
+            HostUninstallProtocolInterface(Image->Handle, &EFI_LOADED_IMAGE_PROTOCOL_GUID, &Image->LoadedImage);
+        }
+    }
+    if (Status != EFI_SUCCESS) {
+        HostImageFree(Image);
+        return Status;
+    }
+
+    mImages[Image->Handle] = Image;
+    *ImageHandle = Image->Handle;
+    return EFI_SUCCESS;
+}
+
+/**
+ * Runs the entry point of Image, returning when it returns or calls Exit. Kept
+ * apart from StartImage so that setjmp only has this frame to preserve.
+ */
+static VOID HostImageRun (
+    IN HOST_IMAGE *Image
+) {
+    std::jmp_buf Exit;
+    Image->ExitJump = &Exit;
+    if (setjmp(Exit) == 0) {
+        Image->ExitStatus = Image->EntryPoint(Image->Handle, gHostSystemTable);
+    }
+    Image->ExitJump = NULL;
+}
+
+VOID HostImageShutdown (
+    VOID
+) {
+    //
+    // The handle database and the arena go down next, so only the records and the
+    // page protections need undoing
+    //
+    for (std::pair<EFI_HANDLE const, HOST_IMAGE *> &Entry : mImages) {
+        HOST_IMAGE *Image = Entry.second;
+        mprotect((VOID *)(UINTN)Image->LoadedImage.ImageBase, EFI_PAGES_TO_SIZE(Image->ImagePages), PROT_READ | PROT_WRITE);
+        if (--Image->Entry->References == 0 && !Image->Entry->Cached) {
+            delete Image->Entry;
+        }
+        Image->Signature = 0;
+        delete Image;
+    }
+    mImages.clear();
+
+    //
+    // Cached images are relocated for addresses in this arena, so they do not
+    // outlive it
+    //
+    while (mCacheFirst != NULL) {
+        HOST_IMAGE_CACHE_ENTRY *Entry = mCacheFirst;
+        mCacheFirst = Entry->Next;
+        delete Entry;
+    }
+    mCacheLast = NULL;
+    mCache.clear();
+    mCacheSize = 0;
+    mCurrentImage = NULL;
+    mBeforeExitSignaled = FALSE;
+}
+
+EFI_STATUS EFI_API HostLoadImage (
+    IN BOOLEAN                  BootPolicy,
+    IN EFI_HANDLE               ParentImageHandle,
+    IN EFI_DEVICE_PATH_PROTOCOL *DevicePath OPTIONAL,
+    IN VOID                     *SourceBuffer OPTIONAL,
+    IN UINTN                    SourceSize,
+    OUT EFI_HANDLE              *ImageHandle
+) {
+    VOID *Parent;
+    if (ImageHandle == NULL || HostHandleProtocol(ParentImageHandle, &EFI_LOADED_IMAGE_PROTOCOL_GUID, &Parent) != EFI_SUCCESS) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (DevicePath == NULL && SourceBuffer == NULL) {
+        return EFI_NOT_FOUND;
+    }
+    if (DevicePath != NULL && !IsDevicePathValid(DevicePath, 0)) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_HANDLE Device = NULL;
+    EFI_DEVICE_PATH_PROTOCOL *FilePath = DevicePath;
+    VOID *FileBuffer = NULL;
+    EFI_STATUS Status;
+    if (SourceBuffer != NULL) {
+        EFI_DEVICE_PATH_PROTOCOL *Remaining = DevicePath;
+        if (DevicePath != NULL && HostLocateDevicePath(&EFI_DEVICE_PATH_PROTOCOL_GUID, &Remaining, &Device) == EFI_SUCCESS) {
+            FilePath = Remaining;
+        }
+    } else {
+        Status = HostImageReadDevicePath(BootPolicy, DevicePath, &FileBuffer, &SourceSize, &Device, &FilePath);
+        if (Status != EFI_SUCCESS) {
+            return Status;
+        }
+        SourceBuffer = FileBuffer;
+    }
+
+    Status = HostImageCreate(ParentImageHandle, SourceBuffer, SourceSize, Device, FilePath, DevicePath, ImageHandle);
+    if (FileBuffer != NULL) {
+        HostFreePool(FileBuffer);
+    }
+    return Status;
+}
+
+EFI_STATUS EFI_API HostStartImage (
+    IN EFI_HANDLE   ImageHandle,
+    OUT UINTN       *ExitDataSize,
+    OUT CHAR16      **ExitData OPTIONAL
+) {
+    HOST_IMAGE *Image = HostLookupImage(ImageHandle);
+    if (Image == NULL || Image->Started) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    //
+    // Exit may leave from any depth, possibly at a raised TPL
+    //
+    EFI_TPL Tpl = HostGetCurrentTpl();
+    Image->Started = TRUE;
+    Image->Caller = mCurrentImage;
+    mCurrentImage = Image;
+    HostImageRun(Image);
+    mCurrentImage = Image->Caller;
+    if (HostGetCurrentTpl() > Tpl) {
+        HostRestoreTpl(Tpl);
+    }
+
+    EFI_STATUS Status = Image->ExitStatus;
+    if (ExitDataSize != NULL) {
+        *ExitDataSize = Image->ExitDataSize;
+    }
+    if (ExitData != NULL) {
+        *ExitData = Image->ExitData;
+        Image->ExitData = NULL;
+    }
+    Image->ExitDataSize = 0;
+    if (Image->ExitData != NULL) {
+        HostFreePool(Image->ExitData);
+        Image->ExitData = NULL;
+    }
+
+    //
+    // Applications, and drivers that fail, do not stay resident. An image whose
+    // protocols cannot be uninstalled stays loaded, and when it exited with
+    // EFI_SUCCESS the caller gets the unload status instead.
+    //
+    if (Image->Subsystem == EFI_IMAGE_SUBSYSTEM_EFI_APPLICATION || Status != EFI_SUCCESS) {
+        EFI_STATUS UnloadStatus = HostImageUnload(Image);
+        if (Status == EFI_SUCCESS) {
+            Status = UnloadStatus;
+        }
+    }
+    return Status;
+}
+
+EFI_STATUS EFI_API HostExit (
+    IN EFI_HANDLE   ImageHandle,
+    IN EFI_STATUS   ExitStatus,
+    IN UINTN        ExitDataSize,
+    IN CHAR16       *ExitData OPTIONAL
+) {
+    HOST_IMAGE *Image = HostLookupImage(ImageHandle);
+    if (Image == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (!Image->Started) {
+        return HostImageUnload(Image);
+    }
+    if (Image != mCurrentImage) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    Image->ExitStatus = ExitStatus;
+    if (ExitData != NULL && ExitDataSize != 0) {
+        VOID *Copy;
+        if (HostAllocatePool(EfiBootServicesData, ExitDataSize, &Copy) == EFI_SUCCESS) {
+            memcpy(Copy, ExitData, ExitDataSize);
+            Image->ExitData = (CHAR16 *)Copy;
+            Image->ExitDataSize = ExitDataSize;
+        }
+    }
+    std::longjmp(*Image->ExitJump, 1);
+}
+
+EFI_STATUS EFI_API HostUnloadImage (
+    IN EFI_HANDLE ImageHandle
+) {
+    HOST_IMAGE *Image = HostLookupImage(ImageHandle);
+    if (Image == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (Image->Started) {
+        if (Image->LoadedImage.Unload == NULL) {
+            return EFI_UNSUPPORTED;
+        }
+        EFI_STATUS Status = Image->LoadedImage.Unload(ImageHandle);
+        if (Status != EFI_SUCCESS) {
+            return Status;
+        }
+    }
+    return HostImageUnload(Image);
+}
+
+EFI_STATUS EfiHostGetImageStats (
+    IN EFI_HANDLE               ImageHandle,
+    OUT EFI_HOST_IMAGE_STATS    *Stats
+) {
+    HOST_IMAGE *Image = HostLookupImage(ImageHandle);
+    if (Image == NULL || Stats == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    *Stats = Image->Stats;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostExitBootServices (
+    IN EFI_HANDLE   ImageHandle,
+    IN UINTN        MapKey
+) {
+    if (ImageHandle != gHostImageHandle && HostLookupImage(ImageHandle) == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (gHostAtRuntime) {
+        return EFI_UNSUPPORTED;
+    }
+
+    //
+    // The before-exit group is notified ahead of the key check, so its members
+    // may still allocate memory and force the caller to fetch a fresh map. It is
+    // notified once per boot, so the caller's retry with a fresh key converges.
+    //
+    if (!mBeforeExitSignaled) {
+        mBeforeExitSignaled = TRUE;
+        HostSignalEventGroup(&EFI_EVENT_GROUP_BEFORE_EXIT_BOOT_SERVICES);
+    }
+    if (MapKey != HostGetMapKey()) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    HostSetWatchdogTimer(0, 0, 0, NULL);
+    HostSignalEventGroup(&EFI_EVENT_GROUP_EXIT_BOOT_SERVICES);
+    gHostAtRuntime = TRUE;
+
+    HostConsoleFlush();
+    gHostSystemTable->ConsoleInHandle = NULL;
+    gHostSystemTable->ConsoleIn = NULL;
+    gHostSystemTable->ConsoleOutHandle = NULL;
+    gHostSystemTable->ConsoleOut = NULL;
+    gHostSystemTable->StandardErrorHandle = NULL;
+    gHostSystemTable->StandardError = NULL;
+    gHostSystemTable->BootServices = NULL;
+    HostUpdateTableCrc(&gHostSystemTable->Header);
+    return EFI_SUCCESS;
+}
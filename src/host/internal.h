@@ -0,0 +1,605 @@
+#pragma once
+/**
+ * Hosted UEFI environment internals: Custom
+ */
+
+#include <efi/host.h>
+
+/**
+ * Host state shared between the service modules
+ */
+extern EFI_HOST_CONFIG          gHostConfig;
+extern EFI_SYSTEM_TABLE         *gHostSystemTable;
+extern EFI_BOOT_SERVICES        *gHostBootServices;
+extern EFI_RUNTIME_SERVICES     *gHostRuntimeServices;
+extern EFI_HANDLE               gHostImageHandle;
+extern BOOLEAN                  gHostAtRuntime;
+
+/**
+ * Signature helper for internal objects handed out as opaque pointers
+ */
+#define HOST_SIGNATURE_32(A, B, C, D) \
+    ((UINT32)(A) | ((UINT32)(B) << 8) | ((UINT32)(C) << 16) | ((UINT32)(D) << 24))
+
+/**
+ * Host tables and time: host.cpp
+ */
+VOID HostUpdateTableCrc (
+    IN OUT EFI_TABLE_HEADER *Header
+);
+
+UINT64 HostGetTimestamp (
+    VOID
+);
+
+VOID HostIdle (
+    IN UINT64 Deadline
+);
+
+/**
+ * Task priority levels: tpl.cpp
+ */
+EFI_TPL HostGetCurrentTpl (
+    VOID
+);
+
+VOID HostSetCurrentTpl (
+    IN EFI_TPL Tpl
+);
+
+EFI_TPL EFI_API HostRaiseTpl (
+    IN EFI_TPL NewTpl
+);
+
+VOID EFI_API HostRestoreTpl (
+    IN EFI_TPL OldTpl
+);
+
+/**
+ * Memory services: memory.cpp
+ */
+EFI_STATUS HostMemoryInitialize (
+    VOID
+);
+
+VOID HostMemoryShutdown (
+    VOID
+);
+
+UINTN HostGetMapKey (
+    VOID
+);
+
+BOOLEAN HostIsArenaAddress (
+    IN EFI_PHYSICAL_ADDRESS Address,
+    IN UINT64               Length
+);
+
+BOOLEAN HostIsAllocatableType (
+    IN UINT32 Type
+);
+
+EFI_STATUS EFI_API HostAllocatePages (
+    IN EFI_ALLOCATE_TYPE        Type,
+    IN EFI_MEMORY_TYPE          MemoryType,
+    IN UINTN                    Pages,
+    IN OUT EFI_PHYSICAL_ADDRESS *Memory
+);
+
+EFI_STATUS EFI_API HostFreePages (
+    IN EFI_PHYSICAL_ADDRESS Memory,
+    IN UINTN                Pages
+);
+
+EFI_STATUS EFI_API HostGetMemoryMap (
+    IN OUT UINTN                *MemoryMapSize,
+    OUT EFI_MEMORY_DESCRIPTOR   *MemoryMap,
+    OUT UINTN                   *MapKey,
+    OUT UINTN                   *DescriptorSize,
+    OUT UINT32                  *DescriptorVersion
+);
+
+/**
+ * Free page index: buddy.cpp
+ */
+VOID HostBuddyInitialize (
+    IN EFI_PHYSICAL_ADDRESS Base,
+    IN UINT64               Pages
+);
+
+VOID HostBuddyShutdown (
+    VOID
+);
+
+BOOLEAN HostBuddyAllocate (
+    IN UINT64                   Pages,
+    IN EFI_PHYSICAL_ADDRESS     Ceiling,
+    OUT EFI_PHYSICAL_ADDRESS    *Memory
+);
+
+BOOLEAN HostBuddyReserve (
+    IN EFI_PHYSICAL_ADDRESS Memory,
+    IN UINT64               Pages
+);
+
+VOID HostBuddyFree (
+    IN EFI_PHYSICAL_ADDRESS Memory,
+    IN UINT64               Pages
+);
+
+/**
+ * Pool services: pool.cpp
+ */
+EFI_STATUS HostPoolInitialize (
+    VOID
+);
+
+VOID HostPoolShutdown (
+    VOID
+);
+
+EFI_STATUS EFI_API HostAllocatePool (
+    IN EFI_MEMORY_TYPE  PoolType,
+    IN UINTN            Size,
+    OUT VOID            **Buffer
+);
+
+EFI_STATUS EFI_API HostFreePool (
+    IN VOID *Buffer
+);
+
+/**
+ * Event services: event.cpp
+ */
+EFI_STATUS HostEventInitialize (
+    VOID
+);
+
+VOID HostEventShutdown (
+    VOID
+);
+
+VOID HostDispatchEventNotifies (
+    IN EFI_TPL NewTpl
+);
+
+VOID HostTimerCheck (
+    VOID
+);
+
+UINT64 HostNextTimerDeadline (
+    VOID
+);
+
+VOID HostSignalEventGroup (
+    IN EFI_GUID *EventGroup
+);
+
+EFI_STATUS EFI_API HostCreateEvent (
+    IN UINT32           Type,
+    IN EFI_TPL          NotifyTpl,
+    IN EFI_EVENT_NOTIFY NotifyFunction OPTIONAL,
+    IN VOID             *NotifyContext OPTIONAL,
+    OUT EFI_EVENT       *Event
+);
+
+EFI_STATUS EFI_API HostCreateEventEx (
+    IN UINT32           Type,
+    IN EFI_TPL          NotifyTpl,
+    IN EFI_EVENT_NOTIFY NotifyFunction OPTIONAL,
+    IN VOID             *NotifyContext OPTIONAL,
+    IN EFI_GUID         *EventGroup OPTIONAL,
+    OUT EFI_EVENT       *Event
+);
+
+EFI_STATUS EFI_API HostCloseEvent (
+    IN EFI_EVENT Event
+);
+
+EFI_STATUS EFI_API HostSignalEvent (
+    IN EFI_EVENT Event
+);
+
+EFI_STATUS EFI_API HostWaitForEvent (
+    IN UINTN        NumberOfEvents,
+    IN EFI_EVENT    *Event,
+    OUT UINTN       *Index
+);
+
+EFI_STATUS EFI_API HostCheckEvent (
+    IN EFI_EVENT Event
+);
+
+EFI_STATUS EFI_API HostSetTimer (
+    IN EFI_EVENT        Event,
+    IN EFI_TIMER_DELAY  Type,
+    IN UINT64           TriggerTime
+);
+
+/**
+ * Handle and protocol services: handle.cpp
+ */
+EFI_STATUS HostHandleInitialize (
+    VOID
+);
+
+VOID HostHandleShutdown (
+    VOID
+);
+
+VOID HostUnregisterProtocolNotify (
+    IN EFI_EVENT Event
+);
+
+VOID HostCloseAgentProtocols (
+    IN EFI_HANDLE AgentHandle
+);
+
+EFI_STATUS EFI_API HostInstallProtocolInterface (
+    IN OUT EFI_HANDLE       *Handle,
+    IN EFI_GUID             *Protocol,
+    IN EFI_INTERFACE_TYPE   InterfaceType,
+    IN VOID                 *Interface
+);
+
+EFI_STATUS EFI_API HostReinstallProtocolInterface (
+    IN EFI_HANDLE   Handle,
+    IN EFI_GUID     *Protocol,
+    IN VOID         *OldInterface,
+    IN VOID         *NewInterface
+);
+
+EFI_STATUS EFI_API HostUninstallProtocolInterface (
+    IN EFI_HANDLE   Handle,
+    IN EFI_GUID     *Protocol,
+    IN VOID         *Interface
+);
+
+EFI_STATUS EFI_API HostHandleProtocol (
+    IN EFI_HANDLE   Handle,
+    IN EFI_GUID     *Protocol,
+    OUT VOID        **Interface
+);
+
+EFI_STATUS EFI_API HostRegisterProtocolNotify (
+    IN EFI_GUID     *Protocol,
+    IN EFI_EVENT    Event,
+    OUT VOID        **Registration
+);
+
+EFI_STATUS EFI_API HostLocateHandle (
+    IN EFI_LOCATE_SEARCH_TYPE   SearchType,
+    IN EFI_GUID                 *Protocol OPTIONAL,
+    IN VOID                     *SearchKey OPTIONAL,
+    IN OUT UINTN                *BufferSize,
+    OUT EFI_HANDLE              *Buffer
+);
+
+EFI_STATUS EFI_API HostLocateDevicePath (
+    IN EFI_GUID                     *Protocol,
+    IN OUT EFI_DEVICE_PATH_PROTOCOL **DevicePath,
+    OUT EFI_HANDLE                  *Device
+);
+
+EFI_STATUS EFI_API HostConnectController (
+    IN EFI_HANDLE               ControllerHandle,
+    IN EFI_HANDLE               *DriverImageHandle OPTIONAL,
+    IN EFI_DEVICE_PATH_PROTOCOL *RemainingDevicePath OPTIONAL,
+    IN BOOLEAN                  Recursive
+);
+
+EFI_STATUS EFI_API HostDisconnectController (
+    IN EFI_HANDLE   ControllerHandle,
+    IN EFI_HANDLE   DriverImageHandle OPTIONAL,
+    IN EFI_HANDLE   ChildHandle OPTIONAL
+);
+
+EFI_STATUS EFI_API HostOpenProtocol (
+    IN EFI_HANDLE   Handle,
+    IN EFI_GUID     *Protocol,
+    OUT VOID        **Interface OPTIONAL,
+    IN EFI_HANDLE   AgentHandle,
+    IN EFI_HANDLE   ControllerHandle,
+    IN UINT32       Attributes
+);
+
+EFI_STATUS EFI_API HostCloseProtocol (
+    IN EFI_HANDLE   Handle,
+    IN EFI_GUID     *Protocol,
+    IN EFI_HANDLE   AgentHandle,
+    IN EFI_HANDLE   ControllerHandle
+);
+
+EFI_STATUS EFI_API HostOpenProtocolInformation (
+    IN EFI_HANDLE                           Handle,
+    IN EFI_GUID                             *Protocol,
+    OUT EFI_OPEN_PROTOCOL_INFORMATION_ENTRY **EntryBuffer,
+    OUT UINTN                               *EntryCount
+);
+
+EFI_STATUS EFI_API HostProtocolsPerHandle (
+    IN EFI_HANDLE   Handle,
+    OUT EFI_GUID    ***ProtocolBuffer,
+    OUT UINTN       *ProtocolBufferCount
+);
+
+EFI_STATUS EFI_API HostLocateHandleBuffer (
+    IN EFI_LOCATE_SEARCH_TYPE   SearchType,
+    IN EFI_GUID                 *Protocol OPTIONAL,
+    IN VOID                     *SearchKey OPTIONAL,
+    OUT UINTN                   *NoHandles,
+    OUT EFI_HANDLE              **Buffer
+);
+
+EFI_STATUS EFI_API HostLocateProtocol (
+    IN EFI_GUID *Protocol,
+    IN VOID     *Registration OPTIONAL,
+    OUT VOID    **Interface
+);
+
+EFI_STATUS EFI_API HostInstallMultipleProtocolInterfaces (
+    IN OUT EFI_HANDLE   *Handle,
+    ...
+);
+
+EFI_STATUS EFI_API HostUninstallMultipleProtocolInterfaces (
+    IN EFI_HANDLE Handle,
+    ...
+);
+
+/**
+ * Image services: image.cpp
+ */
+VOID HostImageShutdown (
+    VOID
+);
+
+EFI_STATUS EFI_API HostLoadImage (
+    IN BOOLEAN                  BootPolicy,
+    IN EFI_HANDLE               ParentImageHandle,
+    IN EFI_DEVICE_PATH_PROTOCOL *DevicePath OPTIONAL,
+    IN VOID                     *SourceBuffer OPTIONAL,
+    IN UINTN                    SourceSize,
+    OUT EFI_HANDLE              *ImageHandle
+);
+
+EFI_STATUS EFI_API HostStartImage (
+    IN EFI_HANDLE   ImageHandle,
+    OUT UINTN       *ExitDataSize,
+    OUT CHAR16      **ExitData OPTIONAL
+);
+
+EFI_STATUS EFI_API HostExit (
+    IN EFI_HANDLE   ImageHandle,
+    IN EFI_STATUS   ExitStatus,
+    IN UINTN        ExitDataSize,
+    IN CHAR16       *ExitData OPTIONAL
+);
+
+EFI_STATUS EFI_API HostUnloadImage (
+    IN EFI_HANDLE ImageHandle
+);
+
+EFI_STATUS EFI_API HostExitBootServices (
+    IN EFI_HANDLE   ImageHandle,
+    IN UINTN        MapKey
+);
+
+/**
+ * Miscellaneous boot services: misc.cpp
+ */
+VOID HostMiscShutdown (
+    VOID
+);
+
+EFI_STATUS EFI_API HostStall (
+    IN UINTN Microseconds
+);
+
+EFI_STATUS EFI_API HostSetWatchdogTimer (
+    IN UINTN    Timeout,
+    IN UINT64   WatchdogCode,
+    IN UINTN    DataSize,
+    IN CHAR16   *WatchdogData OPTIONAL
+);
+
+EFI_STATUS EFI_API HostInstallConfigurationTable (
+    IN EFI_GUID *Guid,
+    IN VOID     *Table
+);
+
+EFI_STATUS EFI_API HostCalculateCrc32 (
+    IN VOID     *Data,
+    IN UINTN    DataSize,
+    OUT UINT32  *Crc32
+);
+
+VOID EFI_API HostCopyMem (
+    IN VOID     *Destination,
+    IN VOID     *Source,
+    IN UINTN    Length
+);
+
+VOID EFI_API HostSetMem (
+    IN VOID     *Buffer,
+    IN UINTN    Size,
+    IN UINT8    Value
+);
+
+/**
+ * Runtime services: runtime.cpp
+ */
+VOID HostRuntimeShutdown (
+    VOID
+);
+
+EFI_STATUS EFI_API HostGetTime (
+    OUT EFI_TIME                *Time,
+    OUT EFI_TIME_CAPABILITIES   *Capabilities OPTIONAL
+);
+
+EFI_STATUS EFI_API HostSetTime (
+    IN EFI_TIME *Time
+);
+
+EFI_STATUS EFI_API HostGetWakeupTime (
+    OUT BOOLEAN     *Enabled,
+    OUT BOOLEAN     *Pending,
+    OUT EFI_TIME    *Time
+);
+
+EFI_STATUS EFI_API HostSetWakeupTime (
+    IN BOOLEAN  Enable,
+    IN EFI_TIME *Time OPTIONAL
+);
+
+EFI_STATUS EFI_API HostSetVirtualAddressMap (
+    IN UINTN                    MemoryMapSize,
+    IN UINTN                    DescriptorSize,
+    IN UINT32                   DescriptorVersion,
+    IN EFI_MEMORY_DESCRIPTOR    *VirtualMap
+);
+
+EFI_STATUS EFI_API HostConvertPointer (
+    IN UINTN    DebugDisposition,
+    IN VOID     **Address
+);
+
+EFI_STATUS EFI_API HostGetNextMonotonicCount (
+    OUT UINT64 *Count
+);
+
+EFI_STATUS EFI_API HostGetNextHighMonotonicCount (
+    OUT UINT32 *HighCount
+);
+
+VOID EFI_API HostResetSystem (
+    IN EFI_RESET_TYPE   ResetType,
+    IN EFI_STATUS       ResetStatus,
+    IN UINTN            DataSize,
+    IN VOID             *ResetData OPTIONAL
+);
+
+EFI_STATUS EFI_API HostUpdateCapsule (
+    IN EFI_CAPSULE_HEADER   **CapsuleHeaderArray,
+    IN UINTN                CapsuleCount,
+    IN EFI_PHYSICAL_ADDRESS ScatterGatherList OPTIONAL
+);
+
+EFI_STATUS EFI_API HostQueryCapsuleCapabilities (
+    IN EFI_CAPSULE_HEADER   **CapsuleHeaderArray,
+    IN UINTN                CapsuleCount,
+    OUT UINT64              *MaximumCapsuleSize,
+    OUT EFI_RESET_TYPE      *ResetType
+);
+
+/**
+ * Variable services: variable.cpp
+ */
+EFI_STATUS HostVariableInitialize (
+    VOID
+);
+
+VOID HostVariableShutdown (
+    VOID
+);
+
+EFI_STATUS EFI_API HostGetVariable (
+    IN CHAR16       *VariableName,
+    IN EFI_GUID     *VendorGuid,
+    OUT UINT32      *Attributes OPTIONAL,
+    IN OUT UINTN    *DataSize,
+    OUT VOID        *Data OPTIONAL
+);
+
+EFI_STATUS EFI_API HostGetNextVariableName (
+    IN OUT UINTN    *VariableNameSize,
+    IN OUT CHAR16   *VariableName,
+    IN OUT EFI_GUID *VendorGuid
+);
+
+EFI_STATUS EFI_API HostSetVariable (
+    IN CHAR16   *VariableName,
+    IN EFI_GUID *VendorGuid,
+    IN UINT32   Attributes,
+    IN UINTN    DataSize,
+    IN VOID     *Data
+);
+
+EFI_STATUS EFI_API HostQueryVariableInfo (
+    IN UINT32   Attributes,
+    OUT UINT64  *MaximumVariableStorageSize,
+    OUT UINT64  *RemainingVariableStorageSize,
+    OUT UINT64  *MaximumVariableSize
+);
+
+/**
+ * Console: console.cpp
+ */
+EFI_STATUS HostConsoleInitialize (
+    VOID
+);
+
+VOID HostConsoleShutdown (
+    VOID
+);
+
+VOID HostConsoleFlush (
+    VOID
+);
+
+VOID HostConsoleFlushDue (
+    VOID
+);
+
+/**
+ * Asynchronous I/O ring: uring.cpp
+ */
+typedef VOID (*HOST_URING_COMPLETE) (
+    IN VOID     *Context,
+    IN INT32    Result
+);
+
+EFI_STATUS HostUringSubmit (
+    IN UINT8                Opcode,
+    IN INT32                Fd,
+    IN VOID                 *Buffer OPTIONAL,
+    IN UINT32               Length,
+    IN UINT64               Offset,
+    IN HOST_URING_COMPLETE  Complete,
+    IN VOID                 *Context
+);
+
+VOID HostUringPoll (
+    VOID
+);
+
+BOOLEAN HostUringBusy (
+    VOID
+);
+
+VOID HostUringWait (
+    IN UINT64 Timeout
+);
+
+VOID HostUringShutdown (
+    VOID
+);
+
+/**
+ * File protocol: file.cpp
+ */
+VOID HostFileShutdown (
+    VOID
+);
+
+VOID HostFileForgetDirectoryError (
+    IN EFI_FILE_PROTOCOL *Directory
+);
+
+/**
+ * FAT file system: fat.cpp
+ */
+VOID HostFatShutdown (
+    VOID
+);
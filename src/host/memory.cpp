@@ -0,0 +1,287 @@
+#include "internal.h"
+
+#include <cstring>
+#include <map>
+#include <sys/mman.h>
+#include <vector>
+
+/**
+ * First memory type of the OEM and OS loader defined ranges
+ */
+#define HOST_OEM_MEMORY_TYPE_FIRST 0x70000000
+
+typedef struct {
+    UINT64  Pages;
+    UINT32  Type;
+} HOST_MEMORY_RANGE;
+
+/**
+ * Descriptors are padded past sizeof so that callers have to honour DescriptorSize
+ */
+#define HOST_DESCRIPTOR_SIZE (sizeof(EFI_MEMORY_DESCRIPTOR) + sizeof(UINT64))
+
+/**
+ * The ranges always cover the whole arena and adjacent ranges never share a type,
+ * so each range is exactly one descriptor. mMapKey is a generation counter bumped
+ * by every change to the ranges; the descriptor image is rebuilt only when it
+ * falls behind that generation.
+ */
+static VOID                                             *mArena;
+static UINT64                                           mArenaSize;
+static std::map<EFI_PHYSICAL_ADDRESS, HOST_MEMORY_RANGE> mRanges;
+static UINTN                                            mMapKey;
+static std::vector<UINT8>                               mMapImage;
+static UINTN                                            mMapImageKey;
+
+BOOLEAN HostIsAllocatableType (
+    IN UINT32 Type
+) {
+    if (Type == EfiConventionalMemory || Type == EfiPersistentMemory || Type == EfiUnacceptedMemoryType) {
+        return FALSE;
+    }
+    return Type < EfiMaxMemoryType || Type >= HOST_OEM_MEMORY_TYPE_FIRST;
+}
+
+static UINT64 HostMemoryAttribute (
+    IN UINT32 Type
+) {
+    UINT64 Attribute = EFI_MEMORY_UC | EFI_MEMORY_WC | EFI_MEMORY_WT | EFI_MEMORY_WB;
+    if (Type == EfiRuntimeServicesCode || Type == EfiRuntimeServicesData) {
+        Attribute |= EFI_MEMORY_RUNTIME;
+    }
+    return Attribute;
+}
+
+/**
+ * Changes the type of [Start, Start + Pages) which must lie inside the range at Range
+ */
+static VOID HostConvertRange (
+    IN std::map<EFI_PHYSICAL_ADDRESS, HOST_MEMORY_RANGE>::iterator Range,
+    IN EFI_PHYSICAL_ADDRESS Start,
+    IN UINT64               Pages,
+    IN UINT32               Type
+) {
+    EFI_PHYSICAL_ADDRESS RangeStart = Range->first;
+    HOST_MEMORY_RANGE Old = Range->second;
+    EFI_PHYSICAL_ADDRESS RangeEnd = RangeStart + EFI_PAGES_TO_SIZE(Old.Pages);
+    EFI_PHYSICAL_ADDRESS End = Start + EFI_PAGES_TO_SIZE(Pages);
+
+    mRanges.erase(Range);
+    if (Start > RangeStart) {
+        mRanges[RangeStart] = { (Start - RangeStart) >> EFI_PAGE_SHIFT, Old.Type };
+    }
+    if (End < RangeEnd) {
+        mRanges[End] = { (RangeEnd - End) >> EFI_PAGE_SHIFT, Old.Type };
+    }
+    std::map<EFI_PHYSICAL_ADDRESS, HOST_MEMORY_RANGE>::iterator It = mRanges.insert({ Start, { Pages, Type } }).first;
+
+    //
+    // Coalesce with neighbours of the same type
+    //
+    std::map<EFI_PHYSICAL_ADDRESS, HOST_MEMORY_RANGE>::iterator Next = std::next(It);
+    if (Next != mRanges.end() && Next->second.Type == Type && It->first + EFI_PAGES_TO_SIZE(It->second.Pages) == Next->first) {
+        It->second.Pages += Next->second.Pages;
+        mRanges.erase(Next);
+    }
+    if (It != mRanges.begin()) {
+        std::map<EFI_PHYSICAL_ADDRESS, HOST_MEMORY_RANGE>::iterator Previous = std::prev(It);
+        if (Previous->second.Type == Type && Previous->first + EFI_PAGES_TO_SIZE(Previous->second.Pages) == It->first) {
+            Previous->second.Pages += It->second.Pages;
+            mRanges.erase(It);
+        }
+    }
+
+    mMapKey++;
+}
+
+EFI_STATUS HostMemoryInitialize (
+    VOID
+) {
+    mArenaSize = gHostConfig.ArenaSize & ~(UINT64)EFI_PAGE_MASK;
+    if (mArenaSize == 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    int Flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+    VOID *Hint = (VOID *)(UINTN)gHostConfig.ArenaBase;
+    mArena = MAP_FAILED;
+    if (Hint != NULL) {
+        mArena = mmap(Hint, mArenaSize, PROT_READ | PROT_WRITE, Flags | MAP_FIXED_NOREPLACE, -1, 0);
+    }
+    if (mArena == MAP_FAILED) {
+        mArena = mmap(NULL, mArenaSize, PROT_READ | PROT_WRITE, Flags, -1, 0);
+    }
+    if (mArena == MAP_FAILED) {
+        mArena = NULL;
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    mRanges.clear();
+    mRanges[(EFI_PHYSICAL_ADDRESS)(UINTN)mArena] = { mArenaSize >> EFI_PAGE_SHIFT, EfiConventionalMemory };
+    HostBuddyInitialize((EFI_PHYSICAL_ADDRESS)(UINTN)mArena, mArenaSize >> EFI_PAGE_SHIFT);
+    mMapKey = 1;
+    mMapImage.clear();
+    mMapImageKey = 0;
+    return EFI_SUCCESS;
+}
+
+VOID HostMemoryShutdown (
+    VOID
+) {
+    if (mArena != NULL) {
+        munmap(mArena, mArenaSize);
+        mArena = NULL;
+    }
+    mRanges.clear();
+    mMapImage.clear();
+    mMapImage.shrink_to_fit();
+    mMapImageKey = 0;
+    HostBuddyShutdown();
+}
+
+UINTN HostGetMapKey (
+    VOID
+) {
+    return mMapKey;
+}
+
+BOOLEAN HostIsArenaAddress (
+    IN EFI_PHYSICAL_ADDRESS Address,
+    IN UINT64               Length
+) {
+    EFI_PHYSICAL_ADDRESS Base = (EFI_PHYSICAL_ADDRESS)(UINTN)mArena;
+    return mArena != NULL && Address >= Base && Length <= mArenaSize && Address - Base <= mArenaSize - Length;
+}
+
+EFI_STATUS EFI_API HostAllocatePages (
+    IN EFI_ALLOCATE_TYPE        Type,
+    IN EFI_MEMORY_TYPE          MemoryType,
+    IN UINTN                    Pages,
+    IN OUT EFI_PHYSICAL_ADDRESS *Memory
+) {
+    if (Memory == NULL || Type >= MaxAllocateType || !HostIsAllocatableType((UINT32)MemoryType)) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (Pages == 0 || Pages > (mArenaSize >> EFI_PAGE_SHIFT)) {
+        return Pages == 0 ? EFI_INVALID_PARAMETER : EFI_OUT_OF_RESOURCES;
+    }
+
+    UINT64 Size = EFI_PAGES_TO_SIZE((UINT64)Pages);
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    EFI_STATUS Status = EFI_NOT_FOUND;
+
+    if (Type == AllocateAddress) {
+        if ((*Memory & EFI_PAGE_MASK) != 0) {
+            HostRestoreTpl(OldTpl);
+            return EFI_INVALID_PARAMETER;
+        }
+        std::map<EFI_PHYSICAL_ADDRESS, HOST_MEMORY_RANGE>::iterator Range = mRanges.upper_bound(*Memory);
+        if (Range != mRanges.begin()) {
+            --Range;
+            EFI_PHYSICAL_ADDRESS RangeEnd = Range->first + EFI_PAGES_TO_SIZE(Range->second.Pages);
+            if (Range->second.Type == EfiConventionalMemory && *Memory + Size <= RangeEnd && *Memory + Size > *Memory &&
+                HostBuddyReserve(*Memory, Pages)) {
+                HostConvertRange(Range, *Memory, Pages, (UINT32)MemoryType);
+                Status = EFI_SUCCESS;
+            }
+        }
+    } else {
+        EFI_PHYSICAL_ADDRESS Ceiling = Type == AllocateMaxAddress ? *Memory : UINT64_MAX;
+        EFI_PHYSICAL_ADDRESS Start = 0;
+        Status = EFI_OUT_OF_RESOURCES;
+        if (HostBuddyAllocate(Pages, Ceiling, &Start)) {
+            std::map<EFI_PHYSICAL_ADDRESS, HOST_MEMORY_RANGE>::iterator Range = std::prev(mRanges.upper_bound(Start));
+            HostConvertRange(Range, Start, Pages, (UINT32)MemoryType);
+            *Memory = Start;
+            Status = EFI_SUCCESS;
+        }
+    }
+
+    HostRestoreTpl(OldTpl);
+    return Status;
+}
+
+EFI_STATUS EFI_API HostFreePages (
+    IN EFI_PHYSICAL_ADDRESS Memory,
+    IN UINTN                Pages
+) {
+    if ((Memory & EFI_PAGE_MASK) != 0 || Pages == 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    EFI_STATUS Status = EFI_NOT_FOUND;
+    std::map<EFI_PHYSICAL_ADDRESS, HOST_MEMORY_RANGE>::iterator Range = mRanges.upper_bound(Memory);
+    if (Range != mRanges.begin()) {
+        --Range;
+        EFI_PHYSICAL_ADDRESS RangeEnd = Range->first + EFI_PAGES_TO_SIZE(Range->second.Pages);
+        UINT64 Size = EFI_PAGES_TO_SIZE((UINT64)Pages);
+        if (Range->second.Type != EfiConventionalMemory && Memory + Size <= RangeEnd && Memory + Size > Memory) {
+            HostConvertRange(Range, Memory, Pages, EfiConventionalMemory);
+            HostBuddyFree(Memory, Pages);
+            Status = EFI_SUCCESS;
+        }
+    }
+    HostRestoreTpl(OldTpl);
+    return Status;
+}
+
+/**
+ * Renders the ranges into mMapImage as the descriptors GetMemoryMap returns
+ */
+static VOID HostBuildMapImage (
+    VOID
+) {
+    mMapImage.assign(mRanges.size() * HOST_DESCRIPTOR_SIZE, 0);
+    UINT8 *Cursor = mMapImage.data();
+    for (std::pair<const EFI_PHYSICAL_ADDRESS, HOST_MEMORY_RANGE> &Range : mRanges) {
+        EFI_MEMORY_DESCRIPTOR *Descriptor = (EFI_MEMORY_DESCRIPTOR *)Cursor;
+        Descriptor->Type = Range.second.Type;
+        Descriptor->PhysicalStart = Range.first;
+        Descriptor->VirtualStart = 0;
+        Descriptor->NumberOfPages = Range.second.Pages;
+        Descriptor->Attribute = HostMemoryAttribute(Range.second.Type);
+        Cursor += HOST_DESCRIPTOR_SIZE;
+    }
+    mMapImageKey = mMapKey;
+}
+
+EFI_STATUS EFI_API HostGetMemoryMap (
+    IN OUT UINTN                *MemoryMapSize,
+    OUT EFI_MEMORY_DESCRIPTOR   *MemoryMap,
+    OUT UINTN                   *MapKey,
+    OUT UINTN                   *DescriptorSize,
+    OUT UINT32                  *DescriptorVersion
+) {
+    if (MemoryMapSize == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    if (DescriptorSize != NULL) {
+        *DescriptorSize = HOST_DESCRIPTOR_SIZE;
+    }
+    if (DescriptorVersion != NULL) {
+        *DescriptorVersion = EFI_MEMORY_DESCRIPTOR_VERSION;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    UINTN Needed = mRanges.size() * HOST_DESCRIPTOR_SIZE;
+    if (*MemoryMapSize < Needed) {
+        *MemoryMapSize = Needed;
+        HostRestoreTpl(OldTpl);
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    if (MemoryMap == NULL || MapKey == NULL) {
+        HostRestoreTpl(OldTpl);
+        return EFI_INVALID_PARAMETER;
+    }
+
+    if (mMapImageKey != mMapKey) {
+        HostBuildMapImage();
+    }
+    memcpy(MemoryMap, mMapImage.data(), Needed);
+    *MemoryMapSize = Needed;
+    *MapKey = mMapKey;
+    HostRestoreTpl(OldTpl);
+    return EFI_SUCCESS;
+}
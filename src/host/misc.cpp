@@ -0,0 +1,135 @@
+#include "internal.h"
+
+#include <efi/crc32.h>
+#include <efi/guid.h>
+#include <efi/mem.h>
+
+#include <vector>
+
+static std::vector<EFI_CONFIGURATION_TABLE> mConfigurationTables;
+static EFI_EVENT                            mWatchdogEvent;
+static std::vector<CHAR16>                  mWatchdogData;
+
+static VOID EFI_API HostWatchdogNotify (
+    IN EFI_EVENT    Event,
+    IN VOID         *Context
+) {
+    (VOID)Event;
+    (VOID)Context;
+    HostResetSystem(EFI_RESET_COLD, EFI_TIMEOUT, mWatchdogData.size() * sizeof(CHAR16), mWatchdogData.empty() ? NULL : mWatchdogData.data());
+}
+
+VOID HostMiscShutdown (
+    VOID
+) {
+    mConfigurationTables.clear();
+    mConfigurationTables.shrink_to_fit();
+    mWatchdogEvent = NULL;
+    mWatchdogData.clear();
+}
+
+EFI_STATUS EFI_API HostStall (
+    IN UINTN Microseconds
+) {
+    UINT64 Deadline = HostGetTimestamp() + (UINT64)Microseconds * 10;
+    while (HostGetTimestamp() < Deadline) {
+        HostIdle(Deadline);
+    }
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostSetWatchdogTimer (
+    IN UINTN    Timeout,
+    IN UINT64   WatchdogCode,
+    IN UINTN    DataSize,
+    IN CHAR16   *WatchdogData OPTIONAL
+) {
+    (VOID)WatchdogCode;
+
+    if (DataSize != 0 && WatchdogData == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    if (mWatchdogEvent == NULL) {
+        EFI_STATUS Status = HostCreateEvent(EFI_EVENT_TIMER | EFI_EVENT_NOTIFY_SIGNAL, TPL_NOTIFY, HostWatchdogNotify, NULL, &mWatchdogEvent);
+        if (Status != EFI_SUCCESS) {
+            return EFI_DEVICE_ERROR;
+        }
+    }
+
+    mWatchdogData.assign(WatchdogData, WatchdogData + DataSize / sizeof(CHAR16));
+    if (Timeout == 0) {
+        return HostSetTimer(mWatchdogEvent, TimerCancel, 0);
+    }
+    return HostSetTimer(mWatchdogEvent, TimerRelative, (UINT64)Timeout * 10000000);
+}
+
+EFI_STATUS EFI_API HostInstallConfigurationTable (
+    IN EFI_GUID *Guid,
+    IN VOID     *Table
+) {
+    if (Guid == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    std::vector<EFI_CONFIGURATION_TABLE>::iterator It = mConfigurationTables.begin();
+    while (It != mConfigurationTables.end() && !CompareGuid(&It->VendorGuid, Guid)) {
+        ++It;
+    }
+
+    if (Table == NULL) {
+        if (It == mConfigurationTables.end()) {
+            HostRestoreTpl(OldTpl);
+            return EFI_NOT_FOUND;
+        }
+        mConfigurationTables.erase(It);
+    } else if (It != mConfigurationTables.end()) {
+        It->VendorTable = Table;
+    } else {
+        EFI_CONFIGURATION_TABLE Entry;
+        Entry.VendorGuid = *Guid;
+        Entry.VendorTable = Table;
+        mConfigurationTables.push_back(Entry);
+    }
+
+    gHostSystemTable->NumberOfTableEntries = mConfigurationTables.size();
+    gHostSystemTable->ConfigurationTable = mConfigurationTables.empty() ? NULL : mConfigurationTables.data();
+    HostUpdateTableCrc(&gHostSystemTable->Header);
+    HostRestoreTpl(OldTpl);
+
+    //
+    // Consumers of the table are told through the event group named by its GUID
+    //
+    HostSignalEventGroup(Guid);
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostCalculateCrc32 (
+    IN VOID     *Data,
+    IN UINTN    DataSize,
+    OUT UINT32  *Crc32
+) {
+    if (Data == NULL || DataSize == 0 || Crc32 == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    *Crc32 = ::Crc32(Data, DataSize);
+    return EFI_SUCCESS;
+}
+
+VOID EFI_API HostCopyMem (
+    IN VOID     *Destination,
+    IN VOID     *Source,
+    IN UINTN    Length
+) {
+    CopyMem(Destination, Source, Length);
+}
+
+VOID EFI_API HostSetMem (
+    IN VOID     *Buffer,
+    IN UINTN    Size,
+    IN UINT8    Value
+) {
+    SetMem(Buffer, Size, Value);
+}
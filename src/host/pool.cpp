@@ -0,0 +1,321 @@
+#include "internal.h"
+
+#include <map>
+
+#define HOST_POOL_SIGNATURE HOST_SIGNATURE_32('p', 'h', 'd', '0')
+#define HOST_SLAB_SIGNATURE HOST_SIGNATURE_32('s', 'l', 'a', 'b')
+
+/**
+ * Block sizes served from slabs. Every size is a multiple of 16 so blocks stay
+ * 16-byte aligned behind the 64 byte slab header; larger requests take whole pages.
+ */
+static const UINT32 mPoolClassSizes[] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512, 672, 1008
+};
+
+#define HOST_POOL_CLASS_COUNT   (sizeof(mPoolClassSizes) / sizeof(mPoolClassSizes[0]))
+#define HOST_POOL_MAX_SLAB_SIZE 1008
+
+/**
+ * Header of a page-sized allocation, placed at the start of its first page
+ */
+typedef struct {
+    UINT32  Signature;
+    UINT32  Type;
+    UINT64  Pages;
+} HOST_POOL_HEADER;
+
+typedef struct HOST_POOL_FREE_BLOCK {
+    struct HOST_POOL_FREE_BLOCK *Next;
+} HOST_POOL_FREE_BLOCK;
+
+/**
+ * Header at the start of every slab page. The owning slab of a block is found by
+ * masking the block address down to its page.
+ */
+typedef struct HOST_POOL_SLAB {
+    UINT32                  Signature;
+    UINT32                  Type;
+    UINT32                  Class;
+    UINT32                  BlockSize;
+    UINT32                  Capacity;
+    UINT32                  FreeCount;
+    HOST_POOL_FREE_BLOCK    *FreeList;
+    struct HOST_POOL_SLAB   *Next;
+    struct HOST_POOL_SLAB   *Previous;
+    UINT8                   Reserved[16];
+} HOST_POOL_SLAB;
+
+static_assert(sizeof(HOST_POOL_SLAB) == 64, "slab header must keep blocks 16-byte aligned");
+static_assert(sizeof(HOST_POOL_HEADER) == 16, "pool header must keep buffers 16-byte aligned");
+
+typedef struct {
+    HOST_POOL_SLAB          *Available[HOST_POOL_CLASS_COUNT];  // Slabs with at least one free block
+    EFI_HOST_POOL_STATS     Stats;
+} HOST_POOL;
+
+static HOST_POOL                    mPools[EfiMaxMemoryType];
+static std::map<UINT32, HOST_POOL>  mOemPools;
+static UINT8                        mPoolClassOf[HOST_POOL_MAX_SLAB_SIZE / 16 + 1];
+
+static HOST_POOL *HostGetPool (
+    IN UINT32 Type
+) {
+    if (Type < EfiMaxMemoryType) {
+        return &mPools[Type];
+    }
+    return &mOemPools[Type];
+}
+
+static VOID HostLinkSlab (
+    IN HOST_POOL        *Pool,
+    IN HOST_POOL_SLAB   *Slab
+) {
+    Slab->Previous = NULL;
+    Slab->Next = Pool->Available[Slab->Class];
+    if (Slab->Next != NULL) {
+        Slab->Next->Previous = Slab;
+    }
+    Pool->Available[Slab->Class] = Slab;
+}
+
+static VOID HostUnlinkSlab (
+    IN HOST_POOL        *Pool,
+    IN HOST_POOL_SLAB   *Slab
+) {
+    if (Slab->Previous != NULL) {
+        Slab->Previous->Next = Slab->Next;
+    } else {
+        Pool->Available[Slab->Class] = Slab->Next;
+    }
+    if (Slab->Next != NULL) {
+        Slab->Next->Previous = Slab->Previous;
+    }
+    Slab->Next = NULL;
+    Slab->Previous = NULL;
+}
+
+static HOST_POOL_SLAB *HostCreateSlab (
+    IN HOST_POOL    *Pool,
+    IN UINT32       Type,
+    IN UINT32       Class
+) {
+    EFI_PHYSICAL_ADDRESS Memory = 0;
+    if (HostAllocatePages(AllocateAnyPages, (EFI_MEMORY_TYPE)Type, 1, &Memory) != EFI_SUCCESS) {
+        return NULL;
+    }
+
+    HOST_POOL_SLAB *Slab = (HOST_POOL_SLAB *)(UINTN)Memory;
+    Slab->Signature = HOST_SLAB_SIGNATURE;
+    Slab->Type = Type;
+    Slab->Class = Class;
+    Slab->BlockSize = mPoolClassSizes[Class];
+    Slab->Capacity = (EFI_PAGE_SIZE - sizeof(HOST_POOL_SLAB)) / Slab->BlockSize;
+    Slab->FreeCount = Slab->Capacity;
+
+    //
+    // Thread the free list in address order so that fresh slabs hand out ascending blocks
+    //
+    UINT8 *Blocks = (UINT8 *)(Slab + 1);
+    HOST_POOL_FREE_BLOCK **Link = &Slab->FreeList;
+    for (UINT32 Index = 0; Index < Slab->Capacity; Index++) {
+        HOST_POOL_FREE_BLOCK *Block = (HOST_POOL_FREE_BLOCK *)(Blocks + (UINTN)Index * Slab->BlockSize);
+        *Link = Block;
+        Link = &Block->Next;
+    }
+    *Link = NULL;
+
+    HostLinkSlab(Pool, Slab);
+    Pool->Stats.SlabPages++;
+    return Slab;
+}
+
+static VOID HostRecordAllocation (
+    IN OUT EFI_HOST_POOL_STATS  *Stats,
+    IN UINT64                   Size
+) {
+    Stats->Allocations++;
+    Stats->TotalAllocations++;
+    Stats->BytesInUse += Size;
+    if (Stats->BytesInUse > Stats->PeakBytesInUse) {
+        Stats->PeakBytesInUse = Stats->BytesInUse;
+    }
+}
+
+static VOID HostRecordFree (
+    IN OUT EFI_HOST_POOL_STATS  *Stats,
+    IN UINT64                   Size
+) {
+    Stats->Allocations--;
+    Stats->TotalFrees++;
+    Stats->BytesInUse -= Size;
+}
+
+EFI_STATUS HostPoolInitialize (
+    VOID
+) {
+    for (UINT32 Class = 0, Size = 0; Size <= HOST_POOL_MAX_SLAB_SIZE; Size += 16) {
+        while (mPoolClassSizes[Class] < Size) {
+            Class++;
+        }
+        mPoolClassOf[Size / 16] = (UINT8)Class;
+    }
+    for (HOST_POOL &Pool : mPools) {
+        Pool = {};
+    }
+    mOemPools.clear();
+    return EFI_SUCCESS;
+}
+
+VOID HostPoolShutdown (
+    VOID
+) {
+    //
+    // Slab and large pages go away with the arena
+    //
+    for (HOST_POOL &Pool : mPools) {
+        Pool = {};
+    }
+    mOemPools.clear();
+}
+
+EFI_STATUS EFI_API HostAllocatePool (
+    IN EFI_MEMORY_TYPE  PoolType,
+    IN UINTN            Size,
+    OUT VOID            **Buffer
+) {
+    if (Buffer == NULL || !HostIsAllocatableType((UINT32)PoolType)) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (Size > gHostConfig.ArenaSize) {
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    HOST_POOL *Pool = HostGetPool((UINT32)PoolType);
+
+    if (Size <= HOST_POOL_MAX_SLAB_SIZE) {
+        UINT32 Class = mPoolClassOf[(Size + 15) / 16];
+        HOST_POOL_SLAB *Slab = Pool->Available[Class];
+        if (Slab == NULL) {
+            Slab = HostCreateSlab(Pool, (UINT32)PoolType, Class);
+            if (Slab == NULL) {
+                HostRestoreTpl(OldTpl);
+                return EFI_OUT_OF_RESOURCES;
+            }
+        }
+
+        HOST_POOL_FREE_BLOCK *Block = Slab->FreeList;
+        Slab->FreeList = Block->Next;
+        if (--Slab->FreeCount == 0) {
+            HostUnlinkSlab(Pool, Slab);
+        }
+        HostRecordAllocation(&Pool->Stats, Slab->BlockSize);
+        HostRestoreTpl(OldTpl);
+
+        *Buffer = Block;
+        return EFI_SUCCESS;
+    }
+
+    UINT64 Pages = EFI_SIZE_TO_PAGES(Size + sizeof(HOST_POOL_HEADER));
+    EFI_PHYSICAL_ADDRESS Memory = 0;
+    EFI_STATUS Status = HostAllocatePages(AllocateAnyPages, PoolType, Pages, &Memory);
+    if (Status != EFI_SUCCESS) {
+        HostRestoreTpl(OldTpl);
+        return Status;
+    }
+
+    HOST_POOL_HEADER *Header = (HOST_POOL_HEADER *)(UINTN)Memory;
+    Header->Signature = HOST_POOL_SIGNATURE;
+    Header->Type = (UINT32)PoolType;
+    Header->Pages = Pages;
+    Pool->Stats.LargePages += Pages;
+    HostRecordAllocation(&Pool->Stats, EFI_PAGES_TO_SIZE(Pages));
+    HostRestoreTpl(OldTpl);
+
+    *Buffer = Header + 1;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostFreePool (
+    IN VOID *Buffer
+) {
+    EFI_PHYSICAL_ADDRESS Address = (EFI_PHYSICAL_ADDRESS)(UINTN)Buffer;
+    EFI_PHYSICAL_ADDRESS Page = Address & ~(EFI_PHYSICAL_ADDRESS)EFI_PAGE_MASK;
+    if (Buffer == NULL || (Address & 0x0F) != 0 || Address == Page || !HostIsArenaAddress(Page, EFI_PAGE_SIZE)) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_TPL OldTpl = HostRaiseTpl(TPL_NOTIFY);
+    UINT32 Signature = *(UINT32 *)(UINTN)Page;
+
+    if (Signature == HOST_SLAB_SIGNATURE) {
+        HOST_POOL_SLAB *Slab = (HOST_POOL_SLAB *)(UINTN)Page;
+        UINTN Offset = (UINTN)(Address - Page) - sizeof(HOST_POOL_SLAB);
+        if ((UINTN)(Address - Page) < sizeof(HOST_POOL_SLAB) || Offset % Slab->BlockSize != 0 || Offset / Slab->BlockSize >= Slab->Capacity) {
+            HostRestoreTpl(OldTpl);
+            return EFI_INVALID_PARAMETER;
+        }
+
+        HOST_POOL *Pool = HostGetPool(Slab->Type);
+        HOST_POOL_FREE_BLOCK *Block = (HOST_POOL_FREE_BLOCK *)Buffer;
+        Block->Next = Slab->FreeList;
+        Slab->FreeList = Block;
+        if (Slab->FreeCount++ == 0) {
+            HostLinkSlab(Pool, Slab);
+        }
+        HostRecordFree(&Pool->Stats, Slab->BlockSize);
+
+        //
+        // Keep at most one empty slab per class to absorb alloc/free churn
+        //
+        if (Slab->FreeCount == Slab->Capacity && (Slab->Next != NULL || Slab->Previous != NULL)) {
+            HostUnlinkSlab(Pool, Slab);
+            Slab->Signature = 0;
+            Pool->Stats.SlabPages--;
+            HostFreePages(Page, 1);
+        }
+        HostRestoreTpl(OldTpl);
+        return EFI_SUCCESS;
+    }
+
+    HOST_POOL_HEADER *Header = (HOST_POOL_HEADER *)(UINTN)Page;
+    if (Signature != HOST_POOL_SIGNATURE || Address != Page + sizeof(HOST_POOL_HEADER)) {
+        HostRestoreTpl(OldTpl);
+        return EFI_INVALID_PARAMETER;
+    }
+
+    HOST_POOL *Pool = HostGetPool(Header->Type);
+    UINT64 Pages = Header->Pages;
+    Header->Signature = 0;
+    Pool->Stats.LargePages -= Pages;
+    HostRecordFree(&Pool->Stats, EFI_PAGES_TO_SIZE(Pages));
+    EFI_STATUS Status = HostFreePages(Page, Pages);
+    HostRestoreTpl(OldTpl);
+    return Status;
+}
+
+EFI_STATUS EfiHostGetPoolStats (
+    IN EFI_MEMORY_TYPE      PoolType,
+    OUT EFI_HOST_POOL_STATS *Stats
+) {
+    if (Stats == NULL || !HostIsAllocatableType((UINT32)PoolType)) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (EfiHostGetSystemTable() == NULL) {
+        return EFI_NOT_READY;
+    }
+
+    if ((UINT32)PoolType < EfiMaxMemoryType) {
+        *Stats = mPools[PoolType].Stats;
+        return EFI_SUCCESS;
+    }
+
+    std::map<UINT32, HOST_POOL>::const_iterator It = mOemPools.find((UINT32)PoolType);
+    if (It == mOemPools.end()) {
+        *Stats = {};
+    } else {
+        *Stats = It->second.Stats;
+    }
+    return EFI_SUCCESS;
+}
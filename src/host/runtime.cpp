@@ -0,0 +1,363 @@
+#include "internal.h"
+
+#include <efi/memory_map.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+/**
+ * One runtime range of the virtual map
+ */
+typedef struct {
+    EFI_PHYSICAL_ADDRESS    PhysicalStart;
+    EFI_PHYSICAL_ADDRESS    PhysicalEnd;    // Exclusive
+    EFI_VIRTUAL_ADDRESS     VirtualStart;
+} HOST_VIRTUAL_RANGE;
+
+static UINT64                           mMonotonicCount;
+static BOOLEAN                          mVirtualMode;
+
+/**
+ * The runtime ranges of the map being applied, sorted by PhysicalStart so that a
+ * conversion is a binary search, and the range the last conversion hit, since
+ * runtime drivers convert pointers into the same few ranges in bursts. Both are
+ * only set while SetVirtualAddressMap notifies the address change, which is when
+ * mConverting is TRUE.
+ */
+static BOOLEAN                          mConverting;
+static std::vector<HOST_VIRTUAL_RANGE>  mVirtualMap;
+static const HOST_VIRTUAL_RANGE         *mLastRange;
+
+VOID HostRuntimeShutdown (
+    VOID
+) {
+    mMonotonicCount = 0;
+    mVirtualMode = FALSE;
+    mConverting = FALSE;
+    mVirtualMap.clear();
+    mVirtualMap.shrink_to_fit();
+    mLastRange = NULL;
+}
+
+/**
+ * Returns TRUE when every byte of the sorted, disjoint Inner ranges lies in the
+ * sorted, disjoint Outer ranges, which may cover it in adjacent pieces
+ */
+static BOOLEAN HostVirtualRangesCover (
+    IN const std::vector<HOST_VIRTUAL_RANGE> &Outer,
+    IN const std::vector<HOST_VIRTUAL_RANGE> &Inner
+) {
+    UINTN Index = 0;
+    for (const HOST_VIRTUAL_RANGE &Range : Inner) {
+        EFI_PHYSICAL_ADDRESS Position = Range.PhysicalStart;
+        while (Position < Range.PhysicalEnd) {
+            while (Index < Outer.size() && Outer[Index].PhysicalEnd <= Position) {
+                Index++;
+            }
+            if (Index == Outer.size() || Outer[Index].PhysicalStart > Position) {
+                return FALSE;
+            }
+            Position = Outer[Index].PhysicalEnd;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * Collects the runtime ranges of the memory map as it stands
+ */
+static EFI_STATUS HostGetRuntimeRanges (
+    OUT std::vector<HOST_VIRTUAL_RANGE> &Ranges
+) {
+    UINTN MapSize = 0;
+    UINTN MapKey;
+    UINTN DescriptorSize;
+    UINT32 DescriptorVersion;
+    std::vector<UINT8> Map;
+    EFI_STATUS Status = HostGetMemoryMap(&MapSize, NULL, &MapKey, &DescriptorSize, &DescriptorVersion);
+    if (Status == EFI_BUFFER_TOO_SMALL) {
+        Map.resize(MapSize);
+        Status = HostGetMemoryMap(&MapSize, (EFI_MEMORY_DESCRIPTOR *)Map.data(), &MapKey, &DescriptorSize, &DescriptorVersion);
+    }
+    EFI_MEMORY_MAP_VIEW View;
+    if (Status == EFI_SUCCESS) {
+        Status = MemoryMapViewInitialize(&View, (EFI_MEMORY_DESCRIPTOR *)Map.data(), MapSize, DescriptorSize, DescriptorVersion);
+    }
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+
+    Ranges.clear();
+    for (const EFI_MEMORY_DESCRIPTOR &Descriptor : View) {
+        if ((Descriptor.Attribute & EFI_MEMORY_RUNTIME) != 0) {
+            Ranges.push_back({ Descriptor.PhysicalStart, Descriptor.PhysicalStart + EFI_PAGES_TO_SIZE(Descriptor.NumberOfPages), 0 });
+        }
+    }
+    return EFI_SUCCESS;
+}
+
+/**
+ * Finds the range of the map being applied that holds Address
+ */
+static const HOST_VIRTUAL_RANGE *HostFindVirtualRange (
+    IN EFI_PHYSICAL_ADDRESS Address
+) {
+    if (mLastRange != NULL && Address >= mLastRange->PhysicalStart && Address < mLastRange->PhysicalEnd) {
+        return mLastRange;
+    }
+    std::vector<HOST_VIRTUAL_RANGE>::const_iterator It = std::upper_bound(mVirtualMap.begin(), mVirtualMap.end(), Address, [] (EFI_PHYSICAL_ADDRESS Value, const HOST_VIRTUAL_RANGE &Range) {
+        return Value < Range.PhysicalStart;
+    });
+    if (It == mVirtualMap.begin() || Address >= (It - 1)->PhysicalEnd) {
+        return NULL;
+    }
+    mLastRange = &*(It - 1);
+    return mLastRange;
+}
+
+/**
+ * ConvertPointer for one pointer, with the checks of the specification
+ */
+static EFI_STATUS HostConvertOne (
+    IN UINTN    DebugDisposition,
+    IN OUT VOID **Address
+) {
+    if (*Address == NULL) {
+        return (DebugDisposition & EFI_OPTIONAL_PTR) != 0 ? EFI_SUCCESS : EFI_INVALID_PARAMETER;
+    }
+    EFI_PHYSICAL_ADDRESS Physical = (EFI_PHYSICAL_ADDRESS)(UINTN)*Address;
+    const HOST_VIRTUAL_RANGE *Range = HostFindVirtualRange(Physical);
+    if (Range == NULL) {
+        return EFI_NOT_FOUND;
+    }
+    *Address = (VOID *)(UINTN)(Physical - Range->PhysicalStart + Range->VirtualStart);
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostGetTime (
+    OUT EFI_TIME                *Time,
+    OUT EFI_TIME_CAPABILITIES   *Capabilities OPTIONAL
+) {
+    if (Time == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    struct timespec Now;
+    struct tm Calendar;
+    if (clock_gettime(CLOCK_REALTIME, &Now) != 0 || gmtime_r(&Now.tv_sec, &Calendar) == NULL) {
+        return EFI_DEVICE_ERROR;
+    }
+
+    Time->Year = (UINT16)(Calendar.tm_year + 1900);
+    Time->Month = (UINT8)(Calendar.tm_mon + 1);
+    Time->Day = (UINT8)Calendar.tm_mday;
+    Time->Hour = (UINT8)Calendar.tm_hour;
+    Time->Minute = (UINT8)Calendar.tm_min;
+    Time->Second = (UINT8)Calendar.tm_sec;
+    Time->Pad1 = 0;
+    Time->Nanosecond = (UINT32)Now.tv_nsec;
+    Time->TimeZone = 0;
+    Time->Daylight = 0;
+    Time->Pad2 = 0;
+
+    if (Capabilities != NULL) {
+        Capabilities->Resolution = 1;
+        Capabilities->Accuracy = 50000000;
+        Capabilities->SetsToZero = FALSE;
+    }
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostSetTime (
+    IN EFI_TIME *Time
+) {
+    (VOID)Time;
+    //
+    // The host clock belongs to the host
+    //
+    return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS EFI_API HostGetWakeupTime (
+    OUT BOOLEAN     *Enabled,
+    OUT BOOLEAN     *Pending,
+    OUT EFI_TIME    *Time
+) {
+    (VOID)Enabled;
+    (VOID)Pending;
+    (VOID)Time;
+    return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS EFI_API HostSetWakeupTime (
+    IN BOOLEAN  Enable,
+    IN EFI_TIME *Time OPTIONAL
+) {
+    (VOID)Enable;
+    (VOID)Time;
+    return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS EFI_API HostSetVirtualAddressMap (
+    IN UINTN                    MemoryMapSize,
+    IN UINTN                    DescriptorSize,
+    IN UINT32                   DescriptorVersion,
+    IN EFI_MEMORY_DESCRIPTOR    *VirtualMap
+) {
+    if (!gHostAtRuntime || mVirtualMode) {
+        return EFI_UNSUPPORTED;
+    }
+    EFI_MEMORY_MAP_VIEW View;
+    EFI_STATUS Status = MemoryMapViewInitialize(&View, VirtualMap, MemoryMapSize, DescriptorSize, DescriptorVersion);
+    if (Status != EFI_SUCCESS) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    std::vector<HOST_VIRTUAL_RANGE> Ranges;
+    Ranges.reserve(MemoryMapViewCount(&View));
+    for (const EFI_MEMORY_DESCRIPTOR &Descriptor : View) {
+        if ((Descriptor.Attribute & EFI_MEMORY_RUNTIME) == 0) {
+            continue;
+        }
+        UINT64 Size = EFI_PAGES_TO_SIZE(Descriptor.NumberOfPages);
+        if (Descriptor.NumberOfPages == 0 || (Descriptor.PhysicalStart & EFI_PAGE_MASK) != 0 || (Descriptor.VirtualStart & EFI_PAGE_MASK) != 0 ||
+            Descriptor.PhysicalStart + Size <= Descriptor.PhysicalStart || Descriptor.VirtualStart + Size <= Descriptor.VirtualStart) {
+            return EFI_INVALID_PARAMETER;
+        }
+        Ranges.push_back({ Descriptor.PhysicalStart, Descriptor.PhysicalStart + Size, Descriptor.VirtualStart });
+    }
+    std::sort(Ranges.begin(), Ranges.end(), [] (const HOST_VIRTUAL_RANGE &First, const HOST_VIRTUAL_RANGE &Second) {
+        return First.PhysicalStart < Second.PhysicalStart;
+    });
+    for (UINTN Index = 1; Index < Ranges.size(); Index++) {
+        if (Ranges[Index].PhysicalStart < Ranges[Index - 1].PhysicalEnd) {
+            return EFI_INVALID_PARAMETER;
+        }
+    }
+
+    //
+    // Every range given must be runtime memory, and all runtime memory must be given
+    //
+    std::vector<HOST_VIRTUAL_RANGE> Runtime;
+    Status = HostGetRuntimeRanges(Runtime);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    if (!HostVirtualRangesCover(Runtime, Ranges)) {
+        return EFI_NOT_FOUND;
+    }
+    if (!HostVirtualRangesCover(Ranges, Runtime)) {
+        return EFI_NO_MAPPING;
+    }
+
+    //
+    // The host runs in place: nothing is remapped, and the tables and services the
+    // host provides are host memory outside the map, so only the pointers runtime
+    // drivers convert in their notifications change
+    //
+    mVirtualMode = TRUE;
+    mVirtualMap.swap(Ranges);
+    mLastRange = NULL;
+    mConverting = TRUE;
+    HostSignalEventGroup(&EFI_EVENT_GROUP_VIRTUAL_ADDRESS_CHANGE);
+    mConverting = FALSE;
+    mVirtualMap.clear();
+    mVirtualMap.shrink_to_fit();
+    mLastRange = NULL;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostConvertPointer (
+    IN UINTN    DebugDisposition,
+    IN VOID     **Address
+) {
+    if (Address == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (!mConverting) {
+        return EFI_UNSUPPORTED;
+    }
+    return HostConvertOne(DebugDisposition, Address);
+}
+
+EFI_STATUS EfiHostConvertPointers (
+    IN UINTN    DebugDisposition,
+    IN UINTN    Count,
+    IN OUT VOID **Pointers
+) {
+    if (Pointers == NULL && Count != 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (!mConverting) {
+        return EFI_UNSUPPORTED;
+    }
+
+    EFI_STATUS Result = EFI_SUCCESS;
+    for (UINTN Index = 0; Index < Count; Index++) {
+        EFI_STATUS Status = HostConvertOne(DebugDisposition, &Pointers[Index]);
+        if (Status != EFI_SUCCESS && Result == EFI_SUCCESS) {
+            Result = Status;
+        }
+    }
+    return Result;
+}
+
+EFI_STATUS EFI_API HostGetNextMonotonicCount (
+    OUT UINT64 *Count
+) {
+    if (Count == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    *Count = mMonotonicCount++;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostGetNextHighMonotonicCount (
+    OUT UINT32 *HighCount
+) {
+    if (HighCount == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    mMonotonicCount = ((mMonotonicCount >> 32) + 1) << 32;
+    *HighCount = (UINT32)(mMonotonicCount >> 32);
+    return EFI_SUCCESS;
+}
+
+VOID EFI_API HostResetSystem (
+    IN EFI_RESET_TYPE   ResetType,
+    IN EFI_STATUS       ResetStatus,
+    IN UINTN            DataSize,
+    IN VOID             *ResetData OPTIONAL
+) {
+    if (gHostConfig.ResetHook != NULL) {
+        gHostConfig.ResetHook(ResetType, ResetStatus, DataSize, ResetData);
+        return;
+    }
+    exit(ResetStatus == EFI_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+EFI_STATUS EFI_API HostUpdateCapsule (
+    IN EFI_CAPSULE_HEADER   **CapsuleHeaderArray,
+    IN UINTN                CapsuleCount,
+    IN EFI_PHYSICAL_ADDRESS ScatterGatherList OPTIONAL
+) {
+    (VOID)CapsuleHeaderArray;
+    (VOID)CapsuleCount;
+    (VOID)ScatterGatherList;
+    return EFI_UNSUPPORTED;
+}
+
+EFI_STATUS EFI_API HostQueryCapsuleCapabilities (
+    IN EFI_CAPSULE_HEADER   **CapsuleHeaderArray,
+    IN UINTN                CapsuleCount,
+    OUT UINT64              *MaximumCapsuleSize,
+    OUT EFI_RESET_TYPE      *ResetType
+) {
+    (VOID)CapsuleHeaderArray;
+    (VOID)CapsuleCount;
+    (VOID)MaximumCapsuleSize;
+    (VOID)ResetType;
+    return EFI_UNSUPPORTED;
+}
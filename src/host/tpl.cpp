@@ -0,0 +1,49 @@
+#include "internal.h"
+
+static EFI_TPL mCurrentTpl = TPL_APPLICATION;
+
+EFI_TPL HostGetCurrentTpl (
+    VOID
+) {
+    return mCurrentTpl;
+}
+
+VOID HostSetCurrentTpl (
+    IN EFI_TPL Tpl
+) {
+    mCurrentTpl = Tpl;
+}
+
+EFI_TPL EFI_API HostRaiseTpl (
+    IN EFI_TPL NewTpl
+) {
+    EFI_TPL OldTpl = mCurrentTpl;
+    if (NewTpl > TPL_HIGH_LEVEL) {
+        NewTpl = TPL_HIGH_LEVEL;
+    }
+    if (NewTpl > OldTpl) {
+        mCurrentTpl = NewTpl;
+    }
+    return OldTpl;
+}
+
+VOID EFI_API HostRestoreTpl (
+    IN EFI_TPL OldTpl
+) {
+    if (OldTpl > mCurrentTpl) {
+        return;
+    }
+
+    //
+    // Lowering below TPL_HIGH_LEVEL is where a timer or I/O completion interrupt
+    // could be taken
+    //
+    if (OldTpl < TPL_HIGH_LEVEL && mCurrentTpl == TPL_HIGH_LEVEL) {
+        HostTimerCheck();
+        HostUringPoll();
+        HostConsoleFlushDue();
+    }
+
+    HostDispatchEventNotifies(OldTpl);
+    mCurrentTpl = OldTpl;
+}
@@ -0,0 +1,267 @@
+#include "internal.h"
+
+#include <cerrno>
+#include <ctime>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * Submission queue depth. At most this many requests are in flight, which keeps
+ * the completion queue, twice as deep, from overflowing.
+ */
+#define HOST_URING_ENTRIES 128
+
+typedef struct {
+    HOST_URING_COMPLETE Complete;
+    VOID                *Context;
+} HOST_URING_REQUEST;
+
+static INT32                mRingFd = -1;
+static BOOLEAN              mRingUnavailable;
+static UINT32               mRingFeatures;
+static VOID                 *mSqRing;
+static size_t               mSqRingSize;
+static VOID                 *mCqRing;
+static size_t               mCqRingSize;
+static struct io_uring_sqe  *mSqes;
+static size_t               mSqesSize;
+static UINT32               *mSqTail;
+static UINT32               mSqMask;
+static UINT32               *mSqArray;
+static UINT32               *mCqHead;
+static UINT32               *mCqTail;
+static UINT32               mCqMask;
+static struct io_uring_cqe  *mCqes;
+
+/**
+ * Requests in flight are identified by their slot, which is also the user_data of
+ * their SQE. Free slots are kept on a stack.
+ */
+static HOST_URING_REQUEST   mRequests[HOST_URING_ENTRIES];
+static UINT32               mFreeSlots[HOST_URING_ENTRIES];
+static UINT32               mFreeCount;
+
+static VOID HostUringRelease (
+    VOID
+) {
+    if (mSqes != NULL) {
+        munmap(mSqes, mSqesSize);
+    }
+    if (mCqRing != NULL && mCqRing != mSqRing) {
+        munmap(mCqRing, mCqRingSize);
+    }
+    if (mSqRing != NULL) {
+        munmap(mSqRing, mSqRingSize);
+    }
+    if (mRingFd >= 0) {
+        close(mRingFd);
+    }
+    mRingFd = -1;
+    mSqRing = NULL;
+    mCqRing = NULL;
+    mSqes = NULL;
+}
+
+/**
+ * Creates the ring on first use. Kernels without io_uring, or sandboxes that
+ * filter it, leave mRingUnavailable set and callers fall back to blocking I/O.
+ */
+static BOOLEAN HostUringSetup (
+    VOID
+) {
+    if (mRingFd >= 0) {
+        return TRUE;
+    }
+    if (mRingUnavailable) {
+        return FALSE;
+    }
+
+    struct io_uring_params Params = {};
+    INT32 Fd = (INT32)syscall(__NR_io_uring_setup, HOST_URING_ENTRIES, &Params);
+    if (Fd < 0) {
+        mRingUnavailable = TRUE;
+        return FALSE;
+    }
+    mRingFd = Fd;
+    mRingFeatures = Params.features;
+
+    mSqRingSize = Params.sq_off.array + Params.sq_entries * sizeof(UINT32);
+    mCqRingSize = Params.cq_off.cqes + Params.cq_entries * sizeof(struct io_uring_cqe);
+    if ((Params.features & IORING_FEAT_SINGLE_MMAP) != 0 && mCqRingSize > mSqRingSize) {
+        mSqRingSize = mCqRingSize;
+    }
+
+    mSqRing = mmap(NULL, mSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_SQ_RING);
+    if (mSqRing == MAP_FAILED) {
+        mSqRing = NULL;
+    } else if ((Params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+        mCqRing = mSqRing;
+    } else {
+        mCqRing = mmap(NULL, mCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_CQ_RING);
+        if (mCqRing == MAP_FAILED) {
+            mCqRing = NULL;
+        }
+    }
+    mSqesSize = Params.sq_entries * sizeof(struct io_uring_sqe);
+    mSqes = (struct io_uring_sqe *)mmap(NULL, mSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_SQES);
+    if (mSqes == MAP_FAILED) {
+        mSqes = NULL;
+    }
+    if (mSqRing == NULL || mCqRing == NULL || mSqes == NULL) {
+        HostUringRelease();
+        mRingUnavailable = TRUE;
+        return FALSE;
+    }
+
+    UINT8 *SqRing = (UINT8 *)mSqRing;
+    UINT8 *CqRing = (UINT8 *)mCqRing;
+    mSqTail = (UINT32 *)(SqRing + Params.sq_off.tail);
+    mSqMask = *(UINT32 *)(SqRing + Params.sq_off.ring_mask);
+    mSqArray = (UINT32 *)(SqRing + Params.sq_off.array);
+    mCqHead = (UINT32 *)(CqRing + Params.cq_off.head);
+    mCqTail = (UINT32 *)(CqRing + Params.cq_off.tail);
+    mCqMask = *(UINT32 *)(CqRing + Params.cq_off.ring_mask);
+    mCqes = (struct io_uring_cqe *)(CqRing + Params.cq_off.cqes);
+
+    for (UINT32 Slot = 0; Slot < HOST_URING_ENTRIES; Slot++) {
+        mFreeSlots[Slot] = HOST_URING_ENTRIES - 1 - Slot;
+    }
+    mFreeCount = HOST_URING_ENTRIES;
+    return TRUE;
+}
+
+/**
+ * Blocks until a completion is posted or Timeout, in 100ns units, has passed
+ */
+static VOID HostUringWaitCompletion (
+    IN UINT64 Timeout
+) {
+    struct timespec Delay;
+    Delay.tv_sec = (time_t)(Timeout / 10000000);
+    Delay.tv_nsec = (long)(Timeout % 10000000) * 100;
+
+    if ((mRingFeatures & IORING_FEAT_EXT_ARG) != 0) {
+        struct __kernel_timespec KernelDelay = { Delay.tv_sec, Delay.tv_nsec };
+        struct io_uring_getevents_arg Arg = {};
+        Arg.ts = Timeout == UINT64_MAX ? 0 : (UINT64)(UINTN)&KernelDelay;
+        syscall(__NR_io_uring_enter, mRingFd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &Arg, sizeof(Arg));
+        return;
+    }
+
+    struct pollfd Poll = { mRingFd, POLLIN, 0 };
+    ppoll(&Poll, 1, Timeout == UINT64_MAX ? NULL : &Delay, NULL);
+}
+
+EFI_STATUS HostUringSubmit (
+    IN UINT8                Opcode,
+    IN INT32                Fd,
+    IN VOID                 *Buffer OPTIONAL,
+    IN UINT32               Length,
+    IN UINT64               Offset,
+    IN HOST_URING_COMPLETE  Complete,
+    IN VOID                 *Context
+) {
+    if (!HostUringSetup()) {
+        return EFI_UNSUPPORTED;
+    }
+
+    //
+    // With every slot busy, take completions until one frees up
+    //
+    while (mFreeCount == 0) {
+        HostUringWaitCompletion(UINT64_MAX);
+        EFI_TPL OldTpl = HostRaiseTpl(TPL_HIGH_LEVEL);
+        HostUringPoll();
+        HostRestoreTpl(OldTpl);
+    }
+
+    UINT32 Slot = mFreeSlots[--mFreeCount];
+    mRequests[Slot].Complete = Complete;
+    mRequests[Slot].Context = Context;
+
+    UINT32 Tail = *mSqTail;
+    UINT32 Index = Tail & mSqMask;
+    struct io_uring_sqe *Sqe = &mSqes[Index];
+    *Sqe = {};
+    Sqe->opcode = Opcode;
+    Sqe->fd = Fd;
+    Sqe->addr = (UINT64)(UINTN)Buffer;
+    Sqe->len = Length;
+    Sqe->off = Offset;
+    Sqe->user_data = Slot;
+    mSqArray[Index] = Index;
+    __atomic_store_n(mSqTail, Tail + 1, __ATOMIC_RELEASE);
+
+    INT32 Submitted;
+    do {
+        Submitted = (INT32)syscall(__NR_io_uring_enter, mRingFd, 1, 0, 0, NULL, 0);
+    } while (Submitted < 0 && errno == EINTR);
+
+    if (Submitted != 1) {
+        //
+        // The kernel did not consume the entry, so take it back
+        //
+        __atomic_store_n(mSqTail, Tail, __ATOMIC_RELEASE);
+        mFreeSlots[mFreeCount++] = Slot;
+        return EFI_DEVICE_ERROR;
+    }
+    return EFI_SUCCESS;
+}
+
+VOID HostUringPoll (
+    VOID
+) {
+    if (mRingFd < 0 || mFreeCount == HOST_URING_ENTRIES) {
+        return;
+    }
+
+    UINT32 Head = *mCqHead;
+    while (Head != __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe *Cqe = &mCqes[Head & mCqMask];
+        UINT32 Slot = (UINT32)Cqe->user_data;
+        INT32 Result = Cqe->res;
+        __atomic_store_n(mCqHead, ++Head, __ATOMIC_RELEASE);
+
+        //
+        // Release the slot first so that the completion can submit a follow-up
+        //
+        HOST_URING_REQUEST Request = mRequests[Slot];
+        mFreeSlots[mFreeCount++] = Slot;
+        Request.Complete(Request.Context, Result);
+    }
+}
+
+BOOLEAN HostUringBusy (
+    VOID
+) {
+    return mRingFd >= 0 && mFreeCount != HOST_URING_ENTRIES;
+}
+
+VOID HostUringWait (
+    IN UINT64 Timeout
+) {
+    if (!HostUringBusy()) {
+        return;
+    }
+    if (__atomic_load_n(mCqTail, __ATOMIC_ACQUIRE) != *mCqHead) {
+        return;
+    }
+    HostUringWaitCompletion(Timeout);
+}
+
+VOID HostUringShutdown (
+    VOID
+) {
+    while (HostUringBusy()) {
+        HostUringWait(UINT64_MAX);
+        EFI_TPL OldTpl = HostRaiseTpl(TPL_HIGH_LEVEL);
+        HostUringPoll();
+        HostRestoreTpl(OldTpl);
+    }
+    HostUringRelease();
+    mRingUnavailable = FALSE;
+    mFreeCount = 0;
+}
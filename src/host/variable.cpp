@@ -0,0 +1,789 @@
+#include "internal.h"
+
+#include <efi/crc32.h>
+#include <efi/guid.h>
+#include <efi/string.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Largest variable, name and data combined, accepted by SetVariable
+ */
+#define HOST_MAXIMUM_VARIABLE_SIZE 0x10000
+
+/**
+ * Bytes of superseded records the log may hold before it is compacted, or the
+ * live size of the log when that is larger, so compaction costs amortize to a
+ * constant per SetVariable
+ */
+#define HOST_VARIABLE_COMPACT_THRESHOLD 0x10000
+
+/**
+ * Bytes handed to the ring per write while compacting
+ */
+#define HOST_VARIABLE_IO_CHUNK 0x100000
+
+#define HOST_VARIABLE_LOG_SIGNATURE     0x474F4C5241564645ULL   // "EFVARLOG"
+#define HOST_VARIABLE_LOG_VERSION       1
+#define HOST_VARIABLE_RECORD_SIGNATURE  HOST_SIGNATURE_32('v', 'r', 'e', 'c')
+
+/**
+ * Start of the log file, followed by records up to the end of the file
+ */
+typedef struct {
+    UINT64  Signature;
+    UINT32  Version;
+    UINT32  HeaderSize;
+} HOST_VARIABLE_LOG_HEADER;
+
+/**
+ * One change to a non-volatile variable, followed by NameSize bytes of terminated
+ * name and DataSize bytes of data. Attributes of 0 delete the variable and
+ * EFI_VARIABLE_APPEND_WRITE appends the data. Records are packed, so they are
+ * copied out before their fields are read.
+ */
+typedef struct {
+    UINT32      Signature;
+    UINT32      Crc;            // CRC32 of the record from Attributes to the end of its data
+    UINT32      Attributes;
+    UINT32      NameSize;
+    UINT32      DataSize;
+    EFI_GUID    VendorGuid;
+} HOST_VARIABLE_RECORD;
+
+typedef struct {
+    EFI_GUID        VendorGuid;
+    std::u16string  Name;
+} HOST_VARIABLE_KEY;
+
+struct HOST_VARIABLE_KEY_HASH {
+    size_t operator() (const HOST_VARIABLE_KEY &Key) const {
+        return (size_t)HashGuid(&Key.VendorGuid) ^ std::hash<std::u16string>()(Key.Name);
+    }
+};
+
+struct HOST_VARIABLE_KEY_EQUAL {
+    bool operator() (const HOST_VARIABLE_KEY &First, const HOST_VARIABLE_KEY &Second) const {
+        return CompareGuid(&First.VendorGuid, &Second.VendorGuid) && First.Name == Second.Name;
+    }
+};
+
+/**
+ * Variables are linked in creation order, which GetNextVariableName follows so
+ * that a walk is stable across rehashing and costs O(1) per name
+ */
+typedef struct _HOST_VARIABLE {
+    struct _HOST_VARIABLE       *Previous;
+    struct _HOST_VARIABLE       *Next;
+    const HOST_VARIABLE_KEY     *Key;
+    UINT32                      Attributes;
+    std::vector<UINT8>          Data;
+} HOST_VARIABLE;
+
+typedef std::unordered_map<HOST_VARIABLE_KEY, HOST_VARIABLE, HOST_VARIABLE_KEY_HASH, HOST_VARIABLE_KEY_EQUAL> HOST_VARIABLE_MAP;
+
+/**
+ * A compaction in flight: the live records as of its start, written to Path
+ * through the ring, and the records appended to the old log since, copied over
+ * once the snapshot is on disk
+ */
+typedef struct {
+    std::string         Path;
+    INT32               Fd;
+    UINT8               Opcode;
+    UINTN               Done;
+    std::vector<UINT8>  Buffer;
+    std::vector<UINT8>  Tail;
+} HOST_VARIABLE_COMPACTION;
+
+static HOST_VARIABLE_MAP            mVariables;
+static HOST_VARIABLE                *mFirst;
+static HOST_VARIABLE                *mLast;
+static UINT64                       mUsedSize[2];   // Volatile and non-volatile variables, each at its record size
+static std::string                  mLogPath;
+static INT32                        mLogFd = -1;
+static UINT64                       mLogSize;
+static std::vector<UINT8>           mRecord;
+static HOST_VARIABLE_COMPACTION     *mCompaction;
+
+static UINT64 HostVariableCost (
+    IN UINTN NameSize,
+    IN UINTN DataSize
+) {
+    return sizeof(HOST_VARIABLE_RECORD) + NameSize + DataSize;
+}
+
+static UINTN HostVariableClass (
+    IN UINT32 Attributes
+) {
+    return (Attributes & EFI_VARIABLE_NON_VOLATILE) != 0 ? 1 : 0;
+}
+
+static BOOLEAN HostVariableVisible (
+    IN const HOST_VARIABLE &Variable
+) {
+    return !gHostAtRuntime || (Variable.Attributes & EFI_VARIABLE_RUNTIME_ACCESS) != 0;
+}
+
+static EFI_STATUS HostVariableWriteAt (
+    IN INT32        Fd,
+    IN const UINT8  *Buffer,
+    IN UINTN        Length,
+    IN UINT64       Offset
+) {
+    UINTN Done = 0;
+    while (Done < Length) {
+        ssize_t Written = pwrite(Fd, Buffer + Done, Length - Done, (off_t)(Offset + Done));
+        if (Written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == ENOSPC ? EFI_OUT_OF_RESOURCES : EFI_DEVICE_ERROR;
+        }
+        Done += (UINTN)Written;
+    }
+    return EFI_SUCCESS;
+}
+
+/**
+ * Adds the record for a change to the variable Key to the end of Buffer
+ */
+static VOID HostVariableBuildRecord (
+    IN OUT std::vector<UINT8>   &Buffer,
+    IN const HOST_VARIABLE_KEY  &Key,
+    IN UINT32                   Attributes,
+    IN const UINT8              *Data,
+    IN UINTN                    DataSize
+) {
+    HOST_VARIABLE_RECORD Record;
+    Record.Signature = HOST_VARIABLE_RECORD_SIGNATURE;
+    Record.Crc = 0;
+    Record.Attributes = Attributes;
+    Record.NameSize = (UINT32)((Key.Name.size() + 1) * sizeof(CHAR16));
+    Record.DataSize = (UINT32)DataSize;
+    Record.VendorGuid = Key.VendorGuid;
+
+    UINTN Start = Buffer.size();
+    Buffer.resize(Start + HostVariableCost(Record.NameSize, DataSize));
+    UINT8 *Bytes = Buffer.data() + Start;
+    memcpy(Bytes, &Record, sizeof(Record));
+    memcpy(Bytes + sizeof(Record), Key.Name.c_str(), Record.NameSize);
+    if (DataSize != 0) {
+        memcpy(Bytes + sizeof(Record) + Record.NameSize, Data, DataSize);
+    }
+
+    UINTN CrcStart = offsetof(HOST_VARIABLE_RECORD, Attributes);
+    UINT32 Crc = Crc32(Bytes + CrcStart, Buffer.size() - Start - CrcStart);
+    memcpy(Bytes + offsetof(HOST_VARIABLE_RECORD, Crc), &Crc, sizeof(Crc));
+}
+
+/**
+ * Makes a change to the variable Key in memory, SetVariable having validated it
+ * or the log having recorded it
+ */
+static VOID HostVariableApply (
+    IN const HOST_VARIABLE_KEY  &Key,
+    IN UINT32                   Attributes,
+    IN const UINT8              *Data,
+    IN UINTN                    DataSize
+) {
+    UINTN NameSize = (Key.Name.size() + 1) * sizeof(CHAR16);
+    HOST_VARIABLE_MAP::iterator It = mVariables.find(Key);
+
+    if (It != mVariables.end()) {
+        HOST_VARIABLE &Variable = It->second;
+        mUsedSize[HostVariableClass(Variable.Attributes)] -= HostVariableCost(NameSize, Variable.Data.size());
+        if (Attributes == 0) {
+            (Variable.Previous != NULL ? Variable.Previous->Next : mFirst) = Variable.Next;
+            (Variable.Next != NULL ? Variable.Next->Previous : mLast) = Variable.Previous;
+            mVariables.erase(It);
+            return;
+        }
+    } else {
+        if (Attributes == 0) {
+            return;
+        }
+        It = mVariables.emplace(Key, HOST_VARIABLE()).first;
+        HOST_VARIABLE &Variable = It->second;
+        Variable.Previous = mLast;
+        Variable.Next = NULL;
+        Variable.Key = &It->first;
+        (mLast != NULL ? mLast->Next : mFirst) = &Variable;
+        mLast = &Variable;
+    }
+
+    HOST_VARIABLE &Variable = It->second;
+    Variable.Attributes = Attributes & ~(UINT32)EFI_VARIABLE_APPEND_WRITE;
+    if ((Attributes & EFI_VARIABLE_APPEND_WRITE) != 0) {
+        Variable.Data.insert(Variable.Data.end(), Data, Data + DataSize);
+    } else {
+        Variable.Data.assign(Data, Data + DataSize);
+    }
+    mUsedSize[HostVariableClass(Variable.Attributes)] += HostVariableCost(NameSize, Variable.Data.size());
+}
+
+static VOID HostVariableCompactComplete (
+    IN VOID     *Context,
+    IN INT32    Result
+);
+
+/**
+ * Ends the compaction: on success the new log replaces the old one, otherwise it
+ * is discarded and the old log carries on
+ */
+static VOID HostVariableCompactFinish (
+    IN EFI_STATUS Status
+) {
+    HOST_VARIABLE_COMPACTION *Compaction = mCompaction;
+    mCompaction = NULL;
+
+    if (Status == EFI_SUCCESS && !Compaction->Tail.empty()) {
+        Status = HostVariableWriteAt(Compaction->Fd, Compaction->Tail.data(), Compaction->Tail.size(), Compaction->Buffer.size());
+    }
+    if (Status == EFI_SUCCESS && rename(Compaction->Path.c_str(), mLogPath.c_str()) != 0) {
+        Status = EFI_DEVICE_ERROR;
+    }
+
+    if (Status == EFI_SUCCESS) {
+        close(mLogFd);
+        mLogFd = Compaction->Fd;
+        mLogSize = Compaction->Buffer.size() + Compaction->Tail.size();
+    } else {
+        close(Compaction->Fd);
+        unlink(Compaction->Path.c_str());
+    }
+    delete Compaction;
+}
+
+/**
+ * Starts the next step of the compaction on the ring, or carries the rest out
+ * synchronously when no ring is available
+ */
+static VOID HostVariableCompactIssue (
+    VOID
+) {
+    HOST_VARIABLE_COMPACTION *Compaction = mCompaction;
+    if (Compaction->Opcode == IORING_OP_WRITE) {
+        UINTN Length = Compaction->Buffer.size() - Compaction->Done;
+        if (Length > HOST_VARIABLE_IO_CHUNK) {
+            Length = HOST_VARIABLE_IO_CHUNK;
+        }
+        if (HostUringSubmit(IORING_OP_WRITE, Compaction->Fd, Compaction->Buffer.data() + Compaction->Done, (UINT32)Length, Compaction->Done, HostVariableCompactComplete, Compaction) == EFI_SUCCESS) {
+            return;
+        }
+    } else if (HostUringSubmit(IORING_OP_FSYNC, Compaction->Fd, NULL, 0, 0, HostVariableCompactComplete, Compaction) == EFI_SUCCESS) {
+        return;
+    }
+
+    EFI_STATUS Status = EFI_SUCCESS;
+    if (Compaction->Opcode == IORING_OP_WRITE) {
+        Status = HostVariableWriteAt(Compaction->Fd, Compaction->Buffer.data() + Compaction->Done, Compaction->Buffer.size() - Compaction->Done, Compaction->Done);
+    }
+    if (Status == EFI_SUCCESS && fsync(Compaction->Fd) != 0) {
+        Status = EFI_DEVICE_ERROR;
+    }
+    HostVariableCompactFinish(Status);
+}
+
+static VOID HostVariableCompactComplete (
+    IN VOID     *Context,
+    IN INT32    Result
+) {
+    HOST_VARIABLE_COMPACTION *Compaction = (HOST_VARIABLE_COMPACTION *)Context;
+    if (Result < 0 || (Compaction->Opcode == IORING_OP_WRITE && Result == 0)) {
+        HostVariableCompactFinish(EFI_DEVICE_ERROR);
+        return;
+    }
+    if (Compaction->Opcode == IORING_OP_FSYNC) {
+        HostVariableCompactFinish(EFI_SUCCESS);
+        return;
+    }
+
+    Compaction->Done += (UINTN)Result;
+    if (Compaction->Done == Compaction->Buffer.size()) {
+        Compaction->Opcode = IORING_OP_FSYNC;
+    }
+    HostVariableCompactIssue();
+}
+
+/**
+ * Rewrites the log with only the live records once superseded ones outweigh
+ * both the threshold and the live ones. The snapshot is written in the background
+ * while SetVariable keeps appending to the old log.
+ */
+static VOID HostVariableCompact (
+    VOID
+) {
+    //
+    // A compaction in flight advances here as well as at interrupt points, so
+    // that a burst of SetVariable calls does not outrun it
+    //
+    if (mCompaction != NULL) {
+        EFI_TPL OldTpl = HostRaiseTpl(TPL_HIGH_LEVEL);
+        HostUringPoll();
+        HostRestoreTpl(OldTpl);
+    }
+
+    UINT64 LiveSize = sizeof(HOST_VARIABLE_LOG_HEADER) + mUsedSize[1];
+    UINT64 Garbage = mLogSize - LiveSize;
+    if (mLogFd < 0 || mCompaction != NULL || Garbage < HOST_VARIABLE_COMPACT_THRESHOLD || Garbage < LiveSize) {
+        return;
+    }
+
+    std::string Path = mLogPath + ".compact";
+    INT32 Fd = open(Path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (Fd < 0) {
+        return;
+    }
+
+    HOST_VARIABLE_COMPACTION *Compaction = new HOST_VARIABLE_COMPACTION();
+    Compaction->Path = Path;
+    Compaction->Fd = Fd;
+    Compaction->Opcode = IORING_OP_WRITE;
+    Compaction->Done = 0;
+    Compaction->Buffer.reserve(LiveSize);
+
+    HOST_VARIABLE_LOG_HEADER Header = { HOST_VARIABLE_LOG_SIGNATURE, HOST_VARIABLE_LOG_VERSION, sizeof(HOST_VARIABLE_LOG_HEADER) };
+    Compaction->Buffer.insert(Compaction->Buffer.end(), (const UINT8 *)&Header, (const UINT8 *)(&Header + 1));
+    for (const HOST_VARIABLE *Variable = mFirst; Variable != NULL; Variable = Variable->Next) {
+        if ((Variable->Attributes & EFI_VARIABLE_NON_VOLATILE) != 0) {
+            HostVariableBuildRecord(Compaction->Buffer, *Variable->Key, Variable->Attributes, Variable->Data.data(), Variable->Data.size());
+        }
+    }
+
+    mCompaction = Compaction;
+    HostVariableCompactIssue();
+}
+
+/**
+ * Appends the record for a change to a non-volatile variable to the log. The
+ * record is written with a single pwrite and is not synced; a torn record is
+ * dropped when the log is next replayed.
+ */
+static EFI_STATUS HostVariableLog (
+    IN const HOST_VARIABLE_KEY  &Key,
+    IN UINT32                   Attributes,
+    IN const UINT8              *Data,
+    IN UINTN                    DataSize
+) {
+    if (mLogFd < 0) {
+        return EFI_SUCCESS;
+    }
+
+    mRecord.clear();
+    HostVariableBuildRecord(mRecord, Key, Attributes, Data, DataSize);
+    EFI_STATUS Status = HostVariableWriteAt(mLogFd, mRecord.data(), mRecord.size(), mLogSize);
+    if (Status != EFI_SUCCESS) {
+        if (ftruncate(mLogFd, (off_t)mLogSize) != 0) {
+            return EFI_DEVICE_ERROR;
+        }
+        return Status;
+    }
+
+    mLogSize += mRecord.size();
+    if (mCompaction != NULL) {
+        mCompaction->Tail.insert(mCompaction->Tail.end(), mRecord.begin(), mRecord.end());
+    }
+    return EFI_SUCCESS;
+}
+
+/**
+ * Rebuilds the non-volatile variables from the log, cutting it at the first
+ * record that is torn or fails its checks
+ */
+static EFI_STATUS HostVariableReplay (
+    VOID
+) {
+    struct stat Stat;
+    if (fstat(mLogFd, &Stat) != 0) {
+        return EFI_DEVICE_ERROR;
+    }
+
+    HOST_VARIABLE_LOG_HEADER Header = { HOST_VARIABLE_LOG_SIGNATURE, HOST_VARIABLE_LOG_VERSION, sizeof(HOST_VARIABLE_LOG_HEADER) };
+    if (Stat.st_size == 0) {
+        mLogSize = sizeof(Header);
+        return HostVariableWriteAt(mLogFd, (const UINT8 *)&Header, sizeof(Header), 0);
+    }
+
+    std::vector<UINT8> Log((UINTN)Stat.st_size);
+    UINTN Size = 0;
+    while (Size < Log.size()) {
+        ssize_t Read = pread(mLogFd, Log.data() + Size, Log.size() - Size, (off_t)Size);
+        if (Read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (Read <= 0) {
+            break;
+        }
+        Size += (UINTN)Read;
+    }
+
+    HOST_VARIABLE_LOG_HEADER Found;
+    if (Size < sizeof(Found)) {
+        return EFI_VOLUME_CORRUPTED;
+    }
+    memcpy(&Found, Log.data(), sizeof(Found));
+    if (Found.Signature != Header.Signature || Found.Version != Header.Version || Found.HeaderSize < sizeof(Found) || Found.HeaderSize > Size) {
+        return EFI_VOLUME_CORRUPTED;
+    }
+
+    UINTN Offset = Found.HeaderSize;
+    while (Size - Offset >= sizeof(HOST_VARIABLE_RECORD)) {
+        HOST_VARIABLE_RECORD Record;
+        memcpy(&Record, Log.data() + Offset, sizeof(Record));
+        if (Record.Signature != HOST_VARIABLE_RECORD_SIGNATURE || Record.NameSize < 2 * sizeof(CHAR16) || Record.NameSize % sizeof(CHAR16) != 0) {
+            break;
+        }
+        if ((UINT64)Record.NameSize + Record.DataSize > HOST_MAXIMUM_VARIABLE_SIZE || HostVariableCost(Record.NameSize, Record.DataSize) > Size - Offset) {
+            break;
+        }
+
+        const UINT8 *Name = Log.data() + Offset + sizeof(Record);
+        const UINT8 *Data = Name + Record.NameSize;
+        UINTN CrcStart = offsetof(HOST_VARIABLE_RECORD, Attributes);
+        if (Crc32(Log.data() + Offset + CrcStart, HostVariableCost(Record.NameSize, Record.DataSize) - CrcStart) != Record.Crc) {
+            break;
+        }
+
+        HOST_VARIABLE_KEY Key = { Record.VendorGuid, std::u16string(Record.NameSize / sizeof(CHAR16) - 1, CHAR_NULL) };
+        memcpy(&Key.Name[0], Name, Record.NameSize - sizeof(CHAR16));
+        if (Name[Record.NameSize - 2] != 0 || Name[Record.NameSize - 1] != 0 || Key.Name.find(CHAR_NULL) != std::u16string::npos) {
+            break;
+        }
+
+        HostVariableApply(Key, Record.Attributes, Data, Record.DataSize);
+        Offset += HostVariableCost(Record.NameSize, Record.DataSize);
+    }
+
+    if (Offset != (UINTN)Stat.st_size && ftruncate(mLogFd, (off_t)Offset) != 0) {
+        return EFI_DEVICE_ERROR;
+    }
+    mLogSize = Offset;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS HostVariableInitialize (
+    VOID
+) {
+    mVariables.clear();
+    mFirst = NULL;
+    mLast = NULL;
+    mUsedSize[0] = 0;
+    mUsedSize[1] = 0;
+    mLogSize = 0;
+    if (gHostConfig.VariableStorePath == NULL) {
+        return EFI_SUCCESS;
+    }
+
+    mLogPath = gHostConfig.VariableStorePath;
+    mLogFd = open(mLogPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (mLogFd < 0) {
+        return EFI_DEVICE_ERROR;
+    }
+
+    EFI_STATUS Status = HostVariableReplay();
+    if (Status != EFI_SUCCESS) {
+        close(mLogFd);
+        mLogFd = -1;
+        return Status;
+    }
+    HostVariableCompact();
+    return EFI_SUCCESS;
+}
+
+VOID HostVariableShutdown (
+    VOID
+) {
+    while (mCompaction != NULL) {
+        HostUringWait(UINT64_MAX);
+        EFI_TPL OldTpl = HostRaiseTpl(TPL_HIGH_LEVEL);
+        HostUringPoll();
+        HostRestoreTpl(OldTpl);
+    }
+    if (mLogFd >= 0) {
+        fdatasync(mLogFd);
+        close(mLogFd);
+        mLogFd = -1;
+    }
+
+    mVariables.clear();
+    mFirst = NULL;
+    mLast = NULL;
+    mUsedSize[0] = 0;
+    mUsedSize[1] = 0;
+    mLogPath.clear();
+    mLogSize = 0;
+    mRecord.clear();
+    mRecord.shrink_to_fit();
+}
+
+EFI_STATUS EFI_API HostGetVariable (
+    IN CHAR16       *VariableName,
+    IN EFI_GUID     *VendorGuid,
+    OUT UINT32      *Attributes OPTIONAL,
+    IN OUT UINTN    *DataSize,
+    OUT VOID        *Data OPTIONAL
+) {
+    if (VariableName == NULL || VendorGuid == NULL || DataSize == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    HOST_VARIABLE_KEY Key = { *VendorGuid, VariableName };
+    HOST_VARIABLE_MAP::const_iterator It = mVariables.find(Key);
+    if (It == mVariables.end() || !HostVariableVisible(It->second)) {
+        return EFI_NOT_FOUND;
+    }
+
+    const HOST_VARIABLE &Variable = It->second;
+    if (Attributes != NULL) {
+        *Attributes = Variable.Attributes;
+    }
+    if (*DataSize < Variable.Data.size()) {
+        *DataSize = Variable.Data.size();
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    if (Data == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    *DataSize = Variable.Data.size();
+    if (!Variable.Data.empty()) {
+        memcpy(Data, Variable.Data.data(), Variable.Data.size());
+    }
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostGetNextVariableName (
+    IN OUT UINTN    *VariableNameSize,
+    IN OUT CHAR16   *VariableName,
+    IN OUT EFI_GUID *VendorGuid
+) {
+    if (VariableNameSize == NULL || VariableName == NULL || VendorGuid == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    //
+    // The current name must be terminated within the buffer the caller describes
+    //
+    UINTN Length = 0;
+    while (Length < *VariableNameSize / sizeof(CHAR16) && VariableName[Length] != CHAR_NULL) {
+        Length++;
+    }
+    if (Length == *VariableNameSize / sizeof(CHAR16)) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    const HOST_VARIABLE *Variable;
+    if (Length == 0) {
+        Variable = mFirst;
+    } else {
+        HOST_VARIABLE_KEY Key = { *VendorGuid, std::u16string(VariableName, Length) };
+        HOST_VARIABLE_MAP::const_iterator It = mVariables.find(Key);
+        if (It == mVariables.end() || !HostVariableVisible(It->second)) {
+            return EFI_INVALID_PARAMETER;
+        }
+        Variable = It->second.Next;
+    }
+
+    while (Variable != NULL && !HostVariableVisible(*Variable)) {
+        Variable = Variable->Next;
+    }
+    if (Variable == NULL) {
+        return EFI_NOT_FOUND;
+    }
+
+    UINTN NameSize = (Variable->Key->Name.size() + 1) * sizeof(CHAR16);
+    if (*VariableNameSize < NameSize) {
+        *VariableNameSize = NameSize;
+        return EFI_BUFFER_TOO_SMALL;
+    }
+
+    memcpy(VariableName, Variable->Key->Name.c_str(), NameSize);
+    *VendorGuid = Variable->Key->VendorGuid;
+    *VariableNameSize = NameSize;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostSetVariable (
+    IN CHAR16   *VariableName,
+    IN EFI_GUID *VendorGuid,
+    IN UINT32   Attributes,
+    IN UINTN    DataSize,
+    IN VOID     *Data
+) {
+    if (VariableName == NULL || VariableName[0] == CHAR_NULL || VendorGuid == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (DataSize != 0 && Data == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if ((Attributes & (EFI_VARIABLE_AUTHENTICATED_WRITE_ACCESS | EFI_VARIABLE_TIME_BASED_AUTHENTICATED_WRITE_ACCESS | EFI_VARIABLE_ENHANCED_AUTHENTICATED_ACCESS)) != 0) {
+        return EFI_UNSUPPORTED;
+    }
+    if ((Attributes & EFI_VARIABLE_RUNTIME_ACCESS) != 0 && (Attributes & EFI_VARIABLE_BOOTSERVICE_ACCESS) == 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if ((Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) != 0 && (Attributes & EFI_VARIABLE_NON_VOLATILE) == 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (gHostAtRuntime && Attributes != 0 && (Attributes & EFI_VARIABLE_RUNTIME_ACCESS) == 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    HOST_VARIABLE_KEY Key = { *VendorGuid, VariableName };
+    UINTN NameSize = (Key.Name.size() + 1) * sizeof(CHAR16);
+    if (NameSize + DataSize > HOST_MAXIMUM_VARIABLE_SIZE) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    HOST_VARIABLE_MAP::iterator It = mVariables.find(Key);
+    if (It != mVariables.end() && !HostVariableVisible(It->second)) {
+        return EFI_WRITE_PROTECTED;
+    }
+
+    BOOLEAN Append = (Attributes & EFI_VARIABLE_APPEND_WRITE) != 0;
+    UINT32 StoredAttributes = Attributes & ~(UINT32)EFI_VARIABLE_APPEND_WRITE;
+    const UINT8 *Bytes = (const UINT8 *)Data;
+    EFI_STATUS Status;
+
+    //
+    // A zero size or zero attribute write deletes, except that an empty append is a no-op
+    //
+    if (StoredAttributes == 0 || (DataSize == 0 && !Append)) {
+        if (It == mVariables.end()) {
+            return EFI_NOT_FOUND;
+        }
+        if ((It->second.Attributes & EFI_VARIABLE_NON_VOLATILE) != 0) {
+            Status = HostVariableLog(Key, 0, NULL, 0);
+            if (Status != EFI_SUCCESS) {
+                return EFI_DEVICE_ERROR;
+            }
+        }
+        HostVariableApply(Key, 0, NULL, 0);
+        HostVariableCompact();
+        return EFI_SUCCESS;
+    }
+
+    if (DataSize == 0) {
+        return EFI_SUCCESS;
+    }
+
+    UINTN Class = HostVariableClass(StoredAttributes);
+    UINT64 OldCost = 0;
+    UINTN NewSize = DataSize;
+    if (It != mVariables.end()) {
+        if (It->second.Attributes != StoredAttributes) {
+            return EFI_INVALID_PARAMETER;
+        }
+        OldCost = HostVariableCost(NameSize, It->second.Data.size());
+        if (Append) {
+            NewSize += It->second.Data.size();
+        }
+        if (NameSize + NewSize > HOST_MAXIMUM_VARIABLE_SIZE) {
+            return EFI_INVALID_PARAMETER;
+        }
+    }
+    if (mUsedSize[Class] - OldCost + HostVariableCost(NameSize, NewSize) > gHostConfig.VariableStoreSize) {
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    //
+    // Appends are logged as appends, so a record costs what the caller passed in
+    // rather than the whole variable
+    //
+    if (Class != 0) {
+        Status = HostVariableLog(Key, Attributes, Bytes, DataSize);
+        if (Status != EFI_SUCCESS) {
+            return Status == EFI_OUT_OF_RESOURCES ? EFI_OUT_OF_RESOURCES : EFI_DEVICE_ERROR;
+        }
+    }
+    HostVariableApply(Key, Attributes, Bytes, DataSize);
+    if (Class != 0) {
+        HostVariableCompact();
+    }
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EFI_API HostQueryVariableInfo (
+    IN UINT32   Attributes,
+    OUT UINT64  *MaximumVariableStorageSize,
+    OUT UINT64  *RemainingVariableStorageSize,
+    OUT UINT64  *MaximumVariableSize
+) {
+    if (MaximumVariableStorageSize == NULL || RemainingVariableStorageSize == NULL || MaximumVariableSize == NULL || Attributes == 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if ((Attributes & (EFI_VARIABLE_AUTHENTICATED_WRITE_ACCESS | EFI_VARIABLE_TIME_BASED_AUTHENTICATED_WRITE_ACCESS | EFI_VARIABLE_ENHANCED_AUTHENTICATED_ACCESS)) != 0) {
+        return EFI_UNSUPPORTED;
+    }
+    if ((Attributes & EFI_VARIABLE_RUNTIME_ACCESS) != 0 && (Attributes & EFI_VARIABLE_BOOTSERVICE_ACCESS) == 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (gHostAtRuntime && (Attributes & EFI_VARIABLE_RUNTIME_ACCESS) == 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    //
+    // Superseded records in the log are reclaimed by compaction, so only live
+    // variables count against the store
+    //
+    UINT64 UsedSize = mUsedSize[HostVariableClass(Attributes)];
+    *MaximumVariableStorageSize = gHostConfig.VariableStoreSize;
+    *RemainingVariableStorageSize = UsedSize < gHostConfig.VariableStoreSize ? gHostConfig.VariableStoreSize - UsedSize : 0;
+    *MaximumVariableSize = HOST_MAXIMUM_VARIABLE_SIZE;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS EfiHostGetVariables (
+    IN const EFI_GUID   *VendorGuid OPTIONAL,
+    IN OUT UINTN        *BufferSize,
+    OUT VOID            *Buffer OPTIONAL,
+    OUT UINTN           *EntryCount
+) {
+    if (BufferSize == NULL || EntryCount == NULL || (*BufferSize != 0 && Buffer == NULL)) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    //
+    // One pass writes the entries that fit and keeps counting past the end, so a
+    // buffer that is too small still learns the size it needs
+    //
+    UINTN Used = 0;
+    UINTN Count = 0;
+    for (const HOST_VARIABLE *Variable = mFirst; Variable != NULL; Variable = Variable->Next) {
+        if (!HostVariableVisible(*Variable) || (VendorGuid != NULL && !CompareGuid(VendorGuid, &Variable->Key->VendorGuid))) {
+            continue;
+        }
+
+        UINTN Offset = (Used + 7) & ~(UINTN)7;
+        UINTN NameSize = (Variable->Key->Name.size() + 1) * sizeof(CHAR16);
+        UINTN Size = SIZE_OF_EFI_HOST_VARIABLE_INFO + NameSize;
+        if (Offset + Size <= *BufferSize) {
+            EFI_HOST_VARIABLE_INFO *Info = (EFI_HOST_VARIABLE_INFO *)((UINT8 *)Buffer + Offset);
+            Info->Size = Size;
+            Info->VendorGuid = Variable->Key->VendorGuid;
+            Info->Attributes = Variable->Attributes;
+            Info->DataSize = (UINT32)Variable->Data.size();
+            memcpy(Info->VariableName, Variable->Key->Name.c_str(), NameSize);
+        }
+        Used = Offset + Size;
+        Count++;
+    }
+
+    if (Used > *BufferSize) {
+        *BufferSize = Used;
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    *BufferSize = Used;
+    *EntryCount = Count;
+    return EFI_SUCCESS;
+}
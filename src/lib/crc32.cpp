@@ -0,0 +1,290 @@
+#include <efi/crc32.h>
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__linux__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+/**
+ * Reflected IEEE 802.3 polynomial
+ */
+#define CRC32_POLYNOMIAL 0xEDB88320
+
+/**
+ * Kernels advance the raw CRC register, which is kept inverted between calls
+ */
+typedef UINT32 (*CRC32_KERNEL) (
+    IN UINT32       Register,
+    IN const UINT8  *Bytes,
+    IN UINTN        Length
+);
+
+/**
+ * Slicing-by-8 tables: Table[0] is the byte-at-a-time table and Table[N][Byte] is
+ * the CRC of Byte followed by N zero bytes
+ */
+struct CRC32_TABLES {
+    UINT32 Table[8][256];
+
+    constexpr CRC32_TABLES () : Table() {
+        for (UINT32 Index = 0; Index < 256; Index++) {
+            UINT32 Value = Index;
+            for (UINTN Bit = 0; Bit < 8; Bit++) {
+                Value = (Value & 1) != 0 ? (Value >> 1) ^ CRC32_POLYNOMIAL : Value >> 1;
+            }
+            Table[0][Index] = Value;
+        }
+        for (UINT32 Index = 0; Index < 256; Index++) {
+            for (UINTN Slice = 1; Slice < 8; Slice++) {
+                Table[Slice][Index] = (Table[Slice - 1][Index] >> 8) ^ Table[0][Table[Slice - 1][Index] & 0xFF];
+            }
+        }
+    }
+};
+
+static constexpr CRC32_TABLES mCrc32Tables;
+
+static UINT32 Crc32Slicing (
+    IN UINT32       Register,
+    IN const UINT8  *Bytes,
+    IN UINTN        Length
+) {
+    const UINT32 (*Table)[256] = mCrc32Tables.Table;
+    while (Length >= 8) {
+        UINT32 Low;
+        UINT32 High;
+        memcpy(&Low, Bytes, sizeof(Low));
+        memcpy(&High, Bytes + 4, sizeof(High));
+        Low ^= Register;
+        Register = Table[7][Low & 0xFF] ^ Table[6][(Low >> 8) & 0xFF] ^ Table[5][(Low >> 16) & 0xFF] ^ Table[4][Low >> 24] ^
+            Table[3][High & 0xFF] ^ Table[2][(High >> 8) & 0xFF] ^ Table[1][(High >> 16) & 0xFF] ^ Table[0][High >> 24];
+        Bytes += 8;
+        Length -= 8;
+    }
+    while (Length-- != 0) {
+        Register = Table[0][(Register ^ *Bytes++) & 0xFF] ^ (Register >> 8);
+    }
+    return Register;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/**
+ * Folds 64 bytes per iteration with carry-less multiplies, then reduces the 128-bit
+ * remainder with Barrett reduction, following Intel's "Fast CRC Computation for
+ * Generic Polynomials Using PCLMULQDQ Instruction". Constants are for the reflected
+ * IEEE polynomial.
+ */
+__attribute__((target("pclmul,sse2")))
+static UINT32 Crc32Pclmul (
+    IN UINT32       Register,
+    IN const UINT8  *Bytes,
+    IN UINTN        Length
+) {
+    if (Length < 64) {
+        return Crc32Slicing(Register, Bytes, Length);
+    }
+
+    const __m128i K1K2 = _mm_set_epi64x(0x01C6E41596, 0x0154442BD4);
+    const __m128i K3K4 = _mm_set_epi64x(0x00CCAA009E, 0x01751997D0);
+    const __m128i K5K0 = _mm_set_epi64x(0x0000000000, 0x0163CD6124);
+    const __m128i Poly = _mm_set_epi64x(0x01F7011641, 0x01DB710641);
+    const __m128i Mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i X1 = _mm_loadu_si128((const __m128i *)(Bytes + 0x00));
+    __m128i X2 = _mm_loadu_si128((const __m128i *)(Bytes + 0x10));
+    __m128i X3 = _mm_loadu_si128((const __m128i *)(Bytes + 0x20));
+    __m128i X4 = _mm_loadu_si128((const __m128i *)(Bytes + 0x30));
+    X1 = _mm_xor_si128(X1, _mm_cvtsi32_si128((int)Register));
+    Bytes += 64;
+    Length -= 64;
+
+    while (Length >= 64) {
+        __m128i X5 = _mm_clmulepi64_si128(X1, K1K2, 0x00);
+        __m128i X6 = _mm_clmulepi64_si128(X2, K1K2, 0x00);
+        __m128i X7 = _mm_clmulepi64_si128(X3, K1K2, 0x00);
+        __m128i X8 = _mm_clmulepi64_si128(X4, K1K2, 0x00);
+        X1 = _mm_clmulepi64_si128(X1, K1K2, 0x11);
+        X2 = _mm_clmulepi64_si128(X2, K1K2, 0x11);
+        X3 = _mm_clmulepi64_si128(X3, K1K2, 0x11);
+        X4 = _mm_clmulepi64_si128(X4, K1K2, 0x11);
+        X1 = _mm_xor_si128(_mm_xor_si128(X1, X5), _mm_loadu_si128((const __m128i *)(Bytes + 0x00)));
+        X2 = _mm_xor_si128(_mm_xor_si128(X2, X6), _mm_loadu_si128((const __m128i *)(Bytes + 0x10)));
+        X3 = _mm_xor_si128(_mm_xor_si128(X3, X7), _mm_loadu_si128((const __m128i *)(Bytes + 0x20)));
+        X4 = _mm_xor_si128(_mm_xor_si128(X4, X8), _mm_loadu_si128((const __m128i *)(Bytes + 0x30)));
+        Bytes += 64;
+        Length -= 64;
+    }
+
+    //
+    // Fold the four lanes into one, then any remaining whole 16 byte blocks
+    //
+    __m128i X5 = _mm_clmulepi64_si128(X1, K3K4, 0x00);
+    X1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(X1, K3K4, 0x11), X2), X5);
+    X5 = _mm_clmulepi64_si128(X1, K3K4, 0x00);
+    X1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(X1, K3K4, 0x11), X3), X5);
+    X5 = _mm_clmulepi64_si128(X1, K3K4, 0x00);
+    X1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(X1, K3K4, 0x11), X4), X5);
+    while (Length >= 16) {
+        X5 = _mm_clmulepi64_si128(X1, K3K4, 0x00);
+        X1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(X1, K3K4, 0x11), _mm_loadu_si128((const __m128i *)Bytes)), X5);
+        Bytes += 16;
+        Length -= 16;
+    }
+
+    //
+    // 128 to 64 bits, then Barrett reduction to 32 bits
+    //
+    X2 = _mm_clmulepi64_si128(X1, K3K4, 0x10);
+    X1 = _mm_xor_si128(_mm_srli_si128(X1, 8), X2);
+    X2 = _mm_srli_si128(X1, 4);
+    X1 = _mm_and_si128(X1, Mask32);
+    X1 = _mm_xor_si128(_mm_clmulepi64_si128(X1, K5K0, 0x00), X2);
+
+    X2 = _mm_and_si128(X1, Mask32);
+    X2 = _mm_clmulepi64_si128(X2, Poly, 0x10);
+    X2 = _mm_and_si128(X2, Mask32);
+    X2 = _mm_clmulepi64_si128(X2, Poly, 0x00);
+    X1 = _mm_xor_si128(X1, X2);
+    Register = (UINT32)_mm_cvtsi128_si32(_mm_srli_si128(X1, 4));
+
+    return Crc32Slicing(Register, Bytes, Length);
+}
+#elif defined(__aarch64__) && defined(__linux__)
+/**
+ * ARMv8 CRC32 instructions implement the IEEE polynomial directly
+ */
+__attribute__((target("+crc")))
+static UINT32 Crc32Armv8 (
+    IN UINT32       Register,
+    IN const UINT8  *Bytes,
+    IN UINTN        Length
+) {
+    while (Length >= 8) {
+        UINT64 Qword;
+        memcpy(&Qword, Bytes, sizeof(Qword));
+        Register = __crc32d(Register, Qword);
+        Bytes += 8;
+        Length -= 8;
+    }
+    while (Length-- != 0) {
+        Register = __crc32b(Register, *Bytes++);
+    }
+    return Register;
+}
+#endif
+
+static CRC32_KERNEL Crc32SelectKernel (
+    VOID
+) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("pclmul")) {
+        return Crc32Pclmul;
+    }
+#elif defined(__aarch64__) && defined(__linux__)
+    if ((getauxval(AT_HWCAP) & HWCAP_CRC32) != 0) {
+        return Crc32Armv8;
+    }
+#endif
+    return Crc32Slicing;
+}
+
+UINT32 Crc32Update (
+    IN UINT32       Crc,
+    IN const VOID   *Data,
+    IN UINTN        DataSize
+) {
+    static const CRC32_KERNEL Kernel = Crc32SelectKernel();
+    return ~Kernel(~Crc, (const UINT8 *)Data, DataSize);
+}
+
+UINT32 Crc32 (
+    IN const VOID   *Data,
+    IN UINTN        DataSize
+) {
+    return Crc32Update(0, Data, DataSize);
+}
+
+/**
+ * CRC of a header whose CRC32 field at CrcOffset is taken to be zero, so that
+ * headers can be checked without writing to them
+ */
+static UINT32 Crc32WithZeroField (
+    IN const VOID   *Header,
+    IN UINTN        HeaderSize,
+    IN UINTN        CrcOffset
+) {
+    static const UINT32 Zero = 0;
+    const UINT8 *Bytes = (const UINT8 *)Header;
+    UINT32 Crc = Crc32Update(0, Bytes, CrcOffset);
+    Crc = Crc32Update(Crc, &Zero, sizeof(Zero));
+    return Crc32Update(Crc, Bytes + CrcOffset + sizeof(Zero), HeaderSize - CrcOffset - sizeof(Zero));
+}
+
+BOOLEAN ValidateTableHeader (
+    IN const EFI_TABLE_HEADER   *Header,
+    IN UINT64                   Signature
+) {
+    if (Header == NULL || Header->Signature != Signature || Header->HeaderSize < sizeof(EFI_TABLE_HEADER)) {
+        return FALSE;
+    }
+    return Crc32WithZeroField(Header, Header->HeaderSize, offsetof(EFI_TABLE_HEADER, CRC32)) == Header->CRC32;
+}
+
+BOOLEAN ValidateSystemTable (
+    IN const EFI_SYSTEM_TABLE *SystemTable
+) {
+    if (SystemTable == NULL || !ValidateTableHeader(&SystemTable->Header, EFI_SYSTEM_TABLE_SIGNATURE)) {
+        return FALSE;
+    }
+    if (SystemTable->BootServices != NULL && !ValidateTableHeader(&SystemTable->BootServices->Header, EFI_BOOT_SERVICES_SIGNATURE)) {
+        return FALSE;
+    }
+    return SystemTable->RuntimeServices != NULL && ValidateTableHeader(&SystemTable->RuntimeServices->Header, EFI_RUNTIME_SERVICES_SIGNATURE);
+}
+
+BOOLEAN ValidateGptHeader (
+    IN const EFI_PARTITION_TABLE_HEADER *Header,
+    IN UINT32                           BlockSize
+) {
+    if (Header == NULL || Header->Header.Signature != EFI_PTAB_HEADER_ID) {
+        return FALSE;
+    }
+    if (Header->Header.HeaderSize < sizeof(EFI_PARTITION_TABLE_HEADER) || Header->Header.HeaderSize > BlockSize) {
+        return FALSE;
+    }
+
+    UINT32 EntrySize = Header->SizeOfPartitionEntry;
+    if (EntrySize < sizeof(EFI_PARTITION_ENTRY) || EntrySize % sizeof(EFI_PARTITION_ENTRY) != 0 ||
+        ((EntrySize / sizeof(EFI_PARTITION_ENTRY)) & (EntrySize / sizeof(EFI_PARTITION_ENTRY) - 1)) != 0) {
+        return FALSE;
+    }
+    return Crc32WithZeroField(Header, Header->Header.HeaderSize, offsetof(EFI_TABLE_HEADER, CRC32)) == Header->Header.CRC32;
+}
+
+BOOLEAN ValidateGptEntries (
+    IN const EFI_PARTITION_TABLE_HEADER *Header,
+    IN const VOID                       *Entries,
+    IN UINTN                            EntriesSize
+) {
+    if (Header == NULL || Entries == NULL) {
+        return FALSE;
+    }
+    if (Header->SizeOfPartitionEntry < sizeof(EFI_PARTITION_ENTRY) || Header->SizeOfPartitionEntry % 8 != 0) {
+        return FALSE;
+    }
+
+    //
+    // Both factors are 32 bits wide, so the product cannot overflow 64 bits
+    //
+    UINT64 Size = (UINT64)Header->NumberOfPartitionEntries * Header->SizeOfPartitionEntry;
+    if (Size > EntriesSize) {
+        return FALSE;
+    }
+    return Crc32(Entries, (UINTN)Size) == Header->PartitionEntryArrayCRC32;
+}
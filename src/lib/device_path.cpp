@@ -0,0 +1,202 @@
+#include <efi/device_path.h>
+
+#include <string.h>
+
+BOOLEAN IsDevicePathValid (
+    IN const EFI_DEVICE_PATH_PROTOCOL   *DevicePath,
+    IN UINTN                            MaxSize
+) {
+    if (DevicePath == NULL) {
+        return FALSE;
+    }
+
+    UINTN Remaining = MaxSize != 0 ? MaxSize : ~(UINTN)0;
+    const EFI_DEVICE_PATH_PROTOCOL *Node = DevicePath;
+    for (;;) {
+        if (Remaining < sizeof(EFI_DEVICE_PATH_PROTOCOL)) {
+            return FALSE;
+        }
+        UINTN Length = DevicePathNodeLength(Node);
+        if (Length < sizeof(EFI_DEVICE_PATH_PROTOCOL) || Length > Remaining) {
+            return FALSE;
+        }
+        if (IsDevicePathEnd(Node)) {
+            return TRUE;
+        }
+        Remaining -= Length;
+        Node = NextDevicePathNode(Node);
+    }
+}
+
+UINTN GetDevicePathSize (
+    IN const EFI_DEVICE_PATH_PROTOCOL *DevicePath OPTIONAL
+) {
+    if (DevicePath == NULL) {
+        return 0;
+    }
+
+    const EFI_DEVICE_PATH_PROTOCOL *Node = DevicePath;
+    for (;;) {
+        UINTN Length = DevicePathNodeLength(Node);
+        if (Length < sizeof(EFI_DEVICE_PATH_PROTOCOL)) {
+            return 0;
+        }
+        if (IsDevicePathEnd(Node)) {
+            return (UINTN)((const UINT8 *)Node - (const UINT8 *)DevicePath) + Length;
+        }
+        Node = NextDevicePathNode(Node);
+    }
+}
+
+UINTN GetDevicePathInstanceSize (
+    IN const EFI_DEVICE_PATH_PROTOCOL *DevicePath
+) {
+    const EFI_DEVICE_PATH_PROTOCOL *Node = DevicePath;
+    while (!IsDevicePathEndType(Node)) {
+        if (DevicePathNodeLength(Node) < sizeof(EFI_DEVICE_PATH_PROTOCOL)) {
+            break;
+        }
+        Node = NextDevicePathNode(Node);
+    }
+    return (UINTN)((const UINT8 *)Node - (const UINT8 *)DevicePath);
+}
+
+BOOLEAN CompareDevicePath (
+    IN const EFI_DEVICE_PATH_PROTOCOL *First,
+    IN const EFI_DEVICE_PATH_PROTOCOL *Second
+) {
+    UINTN Size = GetDevicePathSize(First);
+    return Size != 0 && Size == GetDevicePathSize(Second) && memcmp(First, Second, Size) == 0;
+}
+
+UINT64 HashDevicePathNode (
+    IN const EFI_DEVICE_PATH_PROTOCOL *Node
+) {
+    const UINT8 *Bytes = (const UINT8 *)Node;
+    UINTN Length = DevicePathNodeLength(Node);
+    if (Length < sizeof(EFI_DEVICE_PATH_PROTOCOL)) {
+        Length = sizeof(EFI_DEVICE_PATH_PROTOCOL);
+    }
+
+    //
+    // Fold the node eight bytes at a time, the last word zero padded
+    //
+    UINT64 Hash = Length * 0x9E3779B97F4A7C15;
+    for (UINTN Offset = 0; Offset < Length; Offset += sizeof(UINT64)) {
+        UINT64 Word = 0;
+        memcpy(&Word, Bytes + Offset, Length - Offset < sizeof(Word) ? Length - Offset : sizeof(Word));
+        Hash = (Hash ^ Word) * 0xBF58476D1CE4E5B9;
+        Hash ^= Hash >> 31;
+    }
+    Hash ^= Hash >> 29;
+    Hash *= 0x94D049BB133111EB;
+    Hash ^= Hash >> 32;
+    return Hash;
+}
+
+EFI_STATUS DuplicateDevicePath (
+    IN EFI_BOOT_SERVICES                *BootServices,
+    IN EFI_MEMORY_TYPE                  PoolType,
+    IN const EFI_DEVICE_PATH_PROTOCOL   *DevicePath,
+    OUT EFI_DEVICE_PATH_PROTOCOL        **Copy
+) {
+    if (BootServices == NULL || Copy == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    UINTN Size = GetDevicePathSize(DevicePath);
+    if (Size == 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    EFI_STATUS Status = BootServices->AllocatePool(PoolType, Size, (VOID **)Copy);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    memcpy(*Copy, DevicePath, Size);
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS AppendDevicePath (
+    IN EFI_BOOT_SERVICES                *BootServices,
+    IN EFI_MEMORY_TYPE                  PoolType,
+    IN const EFI_DEVICE_PATH_PROTOCOL   *First OPTIONAL,
+    IN const EFI_DEVICE_PATH_PROTOCOL   *Second OPTIONAL,
+    OUT EFI_DEVICE_PATH_PROTOCOL        **Result
+) {
+    if (BootServices == NULL || Result == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    UINTN FirstSize = 0;
+    if (First != NULL) {
+        FirstSize = GetDevicePathSize(First);
+        if (FirstSize == 0) {
+            return EFI_INVALID_PARAMETER;
+        }
+        FirstSize -= sizeof(EFI_DEVICE_PATH_PROTOCOL);
+    }
+    UINTN SecondSize = sizeof(EFI_DEVICE_PATH_PROTOCOL);
+    if (Second != NULL) {
+        SecondSize = GetDevicePathSize(Second);
+        if (SecondSize == 0) {
+            return EFI_INVALID_PARAMETER;
+        }
+    }
+
+    UINT8 *Buffer;
+    EFI_STATUS Status = BootServices->AllocatePool(PoolType, FirstSize + SecondSize, (VOID **)&Buffer);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    if (FirstSize != 0) {
+        memcpy(Buffer, First, FirstSize);
+    }
+    if (Second != NULL) {
+        memcpy(Buffer + FirstSize, Second, SecondSize);
+    } else {
+        SetDevicePathEndNode((EFI_DEVICE_PATH_PROTOCOL *)(Buffer + FirstSize));
+    }
+    *Result = (EFI_DEVICE_PATH_PROTOCOL *)Buffer;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS AppendDevicePathNode (
+    IN EFI_BOOT_SERVICES                *BootServices,
+    IN EFI_MEMORY_TYPE                  PoolType,
+    IN const EFI_DEVICE_PATH_PROTOCOL   *DevicePath OPTIONAL,
+    IN const EFI_DEVICE_PATH_PROTOCOL   *Node OPTIONAL,
+    OUT EFI_DEVICE_PATH_PROTOCOL        **Result
+) {
+    if (Node == NULL) {
+        return AppendDevicePath(BootServices, PoolType, DevicePath, NULL, Result);
+    }
+    if (BootServices == NULL || Result == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    UINTN PathSize = 0;
+    if (DevicePath != NULL) {
+        PathSize = GetDevicePathSize(DevicePath);
+        if (PathSize == 0) {
+            return EFI_INVALID_PARAMETER;
+        }
+        PathSize -= sizeof(EFI_DEVICE_PATH_PROTOCOL);
+    }
+    UINTN NodeSize = DevicePathNodeLength(Node);
+    if (NodeSize < sizeof(EFI_DEVICE_PATH_PROTOCOL)) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    UINT8 *Buffer;
+    EFI_STATUS Status = BootServices->AllocatePool(PoolType, PathSize + NodeSize + sizeof(EFI_DEVICE_PATH_PROTOCOL), (VOID **)&Buffer);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    if (PathSize != 0) {
+        memcpy(Buffer, DevicePath, PathSize);
+    }
+    memcpy(Buffer + PathSize, Node, NodeSize);
+    SetDevicePathEndNode((EFI_DEVICE_PATH_PROTOCOL *)(Buffer + PathSize + NodeSize));
+    *Result = (EFI_DEVICE_PATH_PROTOCOL *)Buffer;
+    return EFI_SUCCESS;
+}
@@ -0,0 +1,1642 @@
+#include <efi/device_path.h>
+
+#include <string.h>
+
+/**
+ * Arguments a text node may carry
+ */
+#define DEVICE_PATH_TEXT_MAX_ARGUMENTS 8
+
+/**
+ * EISA compressed "PNP" vendor of ACPI _HID values
+ */
+#define DEVICE_PATH_EISA_PNP 0x41D0
+
+/**
+ * Node data sizes, excluding the node header
+ */
+#define DEVICE_PATH_PCI_SIZE            2
+#define DEVICE_PATH_PCCARD_SIZE         1
+#define DEVICE_PATH_MEMORY_MAPPED_SIZE  20
+#define DEVICE_PATH_CONTROLLER_SIZE     4
+#define DEVICE_PATH_BMC_SIZE            9
+#define DEVICE_PATH_ACPI_SIZE           8
+#define DEVICE_PATH_ATAPI_SIZE          4
+#define DEVICE_PATH_SCSI_SIZE           4
+#define DEVICE_PATH_USB_SIZE            2
+#define DEVICE_PATH_I2O_SIZE            4
+#define DEVICE_PATH_MAC_SIZE            33
+#define DEVICE_PATH_IPV4_SIZE           23
+#define DEVICE_PATH_USB_CLASS_SIZE      7
+#define DEVICE_PATH_UNIT_SIZE           1
+#define DEVICE_PATH_SATA_SIZE           6
+#define DEVICE_PATH_VLAN_SIZE           2
+#define DEVICE_PATH_NVME_SIZE           12
+#define DEVICE_PATH_UFS_SIZE            2
+#define DEVICE_PATH_SLOT_SIZE           1
+#define DEVICE_PATH_HARD_DRIVE_SIZE     38
+#define DEVICE_PATH_CD_ROM_SIZE         20
+#define DEVICE_PATH_GUID_SIZE           16
+#define DEVICE_PATH_OFFSET_SIZE         20
+#define DEVICE_PATH_RAM_DISK_SIZE       34
+
+/**
+ * HD() partition formats and signature types
+ */
+#define DEVICE_PATH_PARTITION_MBR       0x01
+#define DEVICE_PATH_PARTITION_GPT       0x02
+#define DEVICE_PATH_SIGNATURE_MBR       0x01
+#define DEVICE_PATH_SIGNATURE_GUID      0x02
+
+/**
+ * IPv4() protocol names
+ */
+#define DEVICE_PATH_PROTOCOL_TCP        6
+#define DEVICE_PATH_PROTOCOL_UDP        17
+
+/**
+ * ACPI nodes with a name of their own: Acpi(PNPxxxx,UID) is written Name(UID)
+ */
+static const struct {
+    const char  *Name;
+    UINT16      Device;
+} mAcpiNames[] = {
+    { "PciRoot", 0x0A03 },
+    { "PcieRoot", 0x0A08 },
+    { "Floppy", 0x0604 },
+    { "Keyboard", 0x0301 },
+    { "Serial", 0x0501 },
+    { "ParallelPort", 0x0401 },
+};
+
+/**
+ * Generic node forms: Path(Type,SubType,Data) and the per type forms without Type
+ */
+static const struct {
+    const char  *Name;
+    UINT8       Type;
+} mGenericNames[] = {
+    { "HardwarePath", EFI_DEVICE_PATH_HARDWARE },
+    { "AcpiPath", EFI_DEVICE_PATH_ACPI },
+    { "Msg", EFI_DEVICE_PATH_MESSAGING },
+    { "MediaPath", EFI_DEVICE_PATH_MEDIA },
+    { "BbsPath", EFI_DEVICE_PATH_BIOS },
+};
+
+static const char mLowerDigits[] = "0123456789abcdef";
+static const char mUpperDigits[] = "0123456789ABCDEF";
+
+static inline UINT16 DevicePathRead16 (
+    IN const UINT8 *Data
+) {
+    UINT16 Value;
+    memcpy(&Value, Data, sizeof(Value));
+    return Value;
+}
+
+static inline UINT32 DevicePathRead32 (
+    IN const UINT8 *Data
+) {
+    UINT32 Value;
+    memcpy(&Value, Data, sizeof(Value));
+    return Value;
+}
+
+static inline UINT64 DevicePathRead64 (
+    IN const UINT8 *Data
+) {
+    UINT64 Value;
+    memcpy(&Value, Data, sizeof(Value));
+    return Value;
+}
+
+static inline BOOLEAN DevicePathIsZero (
+    IN const UINT8  *Data,
+    IN UINTN        Size
+) {
+    for (UINTN Index = 0; Index < Size; Index++) {
+        if (Data[Index] != 0) {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * Text output: characters past Capacity are counted but not stored, so a single
+ * pass reports the size a larger buffer needs
+ */
+template <typename CHAR>
+struct DEVICE_PATH_TEXT {
+    CHAR    *Buffer;
+    UINTN   Capacity;
+    UINTN   Length;
+};
+
+template <typename CHAR>
+static inline VOID TextPutChar (
+    IN OUT DEVICE_PATH_TEXT<CHAR>   *Text,
+    IN UINT32                       Character
+) {
+    if (Text->Length < Text->Capacity) {
+        Text->Buffer[Text->Length] = (CHAR)Character;
+    }
+    Text->Length++;
+}
+
+template <typename CHAR>
+static VOID TextPutString (
+    IN OUT DEVICE_PATH_TEXT<CHAR>   *Text,
+    IN const char                   *String
+) {
+    while (*String != '\0') {
+        TextPutChar(Text, (UINT8)*String++);
+    }
+}
+
+template <typename CHAR>
+static VOID TextPutHex (
+    IN OUT DEVICE_PATH_TEXT<CHAR>   *Text,
+    IN UINT64                       Value
+) {
+    char Digits[16];
+    UINTN Count = 0;
+    do {
+        Digits[Count++] = mLowerDigits[Value & 0xF];
+        Value >>= 4;
+    } while (Value != 0);
+    TextPutChar(Text, '0');
+    TextPutChar(Text, 'x');
+    while (Count != 0) {
+        TextPutChar(Text, Digits[--Count]);
+    }
+}
+
+template <typename CHAR>
+static VOID TextPutDecimal (
+    IN OUT DEVICE_PATH_TEXT<CHAR>   *Text,
+    IN UINT64                       Value
+) {
+    char Digits[20];
+    UINTN Count = 0;
+    do {
+        Digits[Count++] = (char)('0' + Value % 10);
+        Value /= 10;
+    } while (Value != 0);
+    while (Count != 0) {
+        TextPutChar(Text, Digits[--Count]);
+    }
+}
+
+template <typename CHAR>
+static VOID TextPutBytes (
+    IN OUT DEVICE_PATH_TEXT<CHAR>   *Text,
+    IN const UINT8                  *Data,
+    IN UINTN                        Size
+) {
+    for (UINTN Index = 0; Index < Size; Index++) {
+        TextPutChar(Text, mLowerDigits[Data[Index] >> 4]);
+        TextPutChar(Text, mLowerDigits[Data[Index] & 0xF]);
+    }
+}
+
+template <typename CHAR>
+static VOID TextPutGuid (
+    IN OUT DEVICE_PATH_TEXT<CHAR>   *Text,
+    IN const UINT8                  *Guid
+) {
+    //
+    // Data1, Data2 and Data3 are little endian, Data4 is a byte array
+    //
+    static const UINT8 Order[16] = { 3, 2, 1, 0, 5, 4, 7, 6, 8, 9, 10, 11, 12, 13, 14, 15 };
+    for (UINTN Index = 0; Index < 16; Index++) {
+        if (Index == 4 || Index == 6 || Index == 8 || Index == 10) {
+            TextPutChar(Text, '-');
+        }
+        UINT8 Byte = Guid[Order[Index]];
+        TextPutChar(Text, mUpperDigits[Byte >> 4]);
+        TextPutChar(Text, mUpperDigits[Byte & 0xF]);
+    }
+}
+
+template <typename CHAR>
+static VOID TextPutIpv4 (
+    IN OUT DEVICE_PATH_TEXT<CHAR>   *Text,
+    IN const UINT8                  *Address,
+    IN UINT16                       Port
+) {
+    for (UINTN Index = 0; Index < 4; Index++) {
+        if (Index != 0) {
+            TextPutChar(Text, '.');
+        }
+        TextPutDecimal(Text, Address[Index]);
+    }
+    if (Port != 0) {
+        TextPutChar(Text, ':');
+        TextPutDecimal(Text, Port);
+    }
+}
+
+static VOID TextPutCodePoint (
+    IN OUT DEVICE_PATH_TEXT<CHAR16> *Text,
+    IN UINT32                       CodePoint
+) {
+    if (CodePoint >= 0x10000) {
+        CodePoint -= 0x10000;
+        TextPutChar(Text, 0xD800 | (CodePoint >> 10));
+        TextPutChar(Text, 0xDC00 | (CodePoint & 0x3FF));
+    } else {
+        TextPutChar(Text, CodePoint);
+    }
+}
+
+static VOID TextPutCodePoint (
+    IN OUT DEVICE_PATH_TEXT<CHAR8>  *Text,
+    IN UINT32                       CodePoint
+) {
+    if (CodePoint < 0x80) {
+        TextPutChar(Text, CodePoint);
+    } else if (CodePoint < 0x800) {
+        TextPutChar(Text, 0xC0 | (CodePoint >> 6));
+        TextPutChar(Text, 0x80 | (CodePoint & 0x3F));
+    } else if (CodePoint < 0x10000) {
+        TextPutChar(Text, 0xE0 | (CodePoint >> 12));
+        TextPutChar(Text, 0x80 | ((CodePoint >> 6) & 0x3F));
+        TextPutChar(Text, 0x80 | (CodePoint & 0x3F));
+    } else {
+        TextPutChar(Text, 0xF0 | (CodePoint >> 18));
+        TextPutChar(Text, 0x80 | ((CodePoint >> 12) & 0x3F));
+        TextPutChar(Text, 0x80 | ((CodePoint >> 6) & 0x3F));
+        TextPutChar(Text, 0x80 | (CodePoint & 0x3F));
+    }
+}
+
+/**
+ * A file path node is written bare only when its text cannot be mistaken for a
+ * separator or another node: one terminator at the end, no control characters,
+ * no "/,()" and no unpaired surrogates
+ */
+static BOOLEAN DevicePathIsPlainFilePath (
+    IN const UINT8  *Data,
+    IN UINTN        Size
+) {
+    if (Size < 2 * sizeof(CHAR16) || Size % sizeof(CHAR16) != 0 || DevicePathRead16(Data + Size - sizeof(CHAR16)) != 0) {
+        return FALSE;
+    }
+    UINTN Count = Size / sizeof(CHAR16) - 1;
+    for (UINTN Index = 0; Index < Count; Index++) {
+        UINT16 Unit = DevicePathRead16(Data + Index * sizeof(CHAR16));
+        if (Unit < 0x20 || Unit == 0x7F || Unit == '/' || Unit == ',' || Unit == '(' || Unit == ')' || (Unit >= 0xDC00 && Unit <= 0xDFFF)) {
+            return FALSE;
+        }
+        if (Unit >= 0xD800 && Unit <= 0xDBFF) {
+            if (Index + 1 == Count) {
+                return FALSE;
+            }
+            UINT16 Low = DevicePathRead16(Data + (Index + 1) * sizeof(CHAR16));
+            if (Low < 0xDC00 || Low > 0xDFFF) {
+                return FALSE;
+            }
+            Index++;
+        }
+    }
+    return TRUE;
+}
+
+/**
+ * Writes a node in its dedicated form, returning FALSE without writing anything
+ * when it has none that carries it exactly
+ */
+template <typename CHAR>
+static BOOLEAN TextPutKnownNode (
+    IN OUT DEVICE_PATH_TEXT<CHAR>   *Text,
+    IN UINT8                        Type,
+    IN UINT8                        SubType,
+    IN const UINT8                  *Data,
+    IN UINTN                        Size
+) {
+    switch (Type) {
+    case EFI_DEVICE_PATH_HARDWARE:
+        switch (SubType) {
+        case EFI_DEVICE_PATH_HARDWARE_PCI:
+            if (Size != DEVICE_PATH_PCI_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "Pci(");
+            TextPutHex(Text, Data[1]);
+            TextPutChar(Text, ',');
+            TextPutHex(Text, Data[0]);
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_HARDWARE_PCCARD:
+            if (Size != DEVICE_PATH_PCCARD_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "PcCard(");
+            TextPutHex(Text, Data[0]);
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_HARDWARE_MEMORY_MAPPED:
+            if (Size != DEVICE_PATH_MEMORY_MAPPED_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "MemoryMapped(");
+            TextPutHex(Text, DevicePathRead32(Data));
+            TextPutChar(Text, ',');
+            TextPutHex(Text, DevicePathRead64(Data + 4));
+            TextPutChar(Text, ',');
+            TextPutHex(Text, DevicePathRead64(Data + 12));
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_HARDWARE_VENDOR:
+            if (Size < DEVICE_PATH_GUID_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "VenHw(");
+            break;
+
+        case EFI_DEVICE_PATH_HARDWARE_CONTROLLER:
+            if (Size != DEVICE_PATH_CONTROLLER_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "Ctrl(");
+            TextPutHex(Text, DevicePathRead32(Data));
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_HARDWARE_BMC:
+            if (Size != DEVICE_PATH_BMC_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "BMC(");
+            TextPutHex(Text, Data[0]);
+            TextPutChar(Text, ',');
+            TextPutHex(Text, DevicePathRead64(Data + 1));
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        default:
+            return FALSE;
+        }
+        break;
+
+    case EFI_DEVICE_PATH_ACPI:
+        if (SubType == EFI_DEVICE_PATH_ACPI_ACPI && Size == DEVICE_PATH_ACPI_SIZE) {
+            UINT32 Hid = DevicePathRead32(Data);
+            UINT32 Uid = DevicePathRead32(Data + 4);
+            if ((Hid & 0xFFFF) != DEVICE_PATH_EISA_PNP) {
+                TextPutString(Text, "Acpi(");
+                TextPutHex(Text, Hid);
+            } else {
+                UINT16 Device = (UINT16)(Hid >> 16);
+                for (UINTN Index = 0; Index < sizeof(mAcpiNames) / sizeof(mAcpiNames[0]); Index++) {
+                    if (mAcpiNames[Index].Device == Device) {
+                        TextPutString(Text, mAcpiNames[Index].Name);
+                        TextPutChar(Text, '(');
+                        TextPutHex(Text, Uid);
+                        TextPutChar(Text, ')');
+                        return TRUE;
+                    }
+                }
+                TextPutString(Text, "Acpi(PNP");
+                for (INTN Shift = 12; Shift >= 0; Shift -= 4) {
+                    TextPutChar(Text, mUpperDigits[(Device >> Shift) & 0xF]);
+                }
+            }
+            TextPutChar(Text, ',');
+            TextPutHex(Text, Uid);
+            TextPutChar(Text, ')');
+            return TRUE;
+        }
+        if (SubType == EFI_DEVICE_PATH_ACPI_ADR && Size != 0 && Size % 4 == 0 && Size / 4 <= DEVICE_PATH_TEXT_MAX_ARGUMENTS) {
+            TextPutString(Text, "AcpiAdr(");
+            for (UINTN Offset = 0; Offset < Size; Offset += 4) {
+                if (Offset != 0) {
+                    TextPutChar(Text, ',');
+                }
+                TextPutHex(Text, DevicePathRead32(Data + Offset));
+            }
+            TextPutChar(Text, ')');
+            return TRUE;
+        }
+        return FALSE;
+
+    case EFI_DEVICE_PATH_MESSAGING:
+        switch (SubType) {
+        case EFI_DEVICE_PATH_MESSAGING_ATAPI:
+            if (Size != DEVICE_PATH_ATAPI_SIZE || Data[0] > 1 || Data[1] > 1) {
+                return FALSE;
+            }
+            TextPutString(Text, Data[0] == 0 ? "Ata(Primary," : "Ata(Secondary,");
+            TextPutString(Text, Data[1] == 0 ? "Master," : "Slave,");
+            TextPutHex(Text, DevicePathRead16(Data + 2));
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_MESSAGING_SCSI:
+            if (Size != DEVICE_PATH_SCSI_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "Scsi(");
+            TextPutHex(Text, DevicePathRead16(Data));
+            TextPutChar(Text, ',');
+            TextPutHex(Text, DevicePathRead16(Data + 2));
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_MESSAGING_USB:
+            if (Size != DEVICE_PATH_USB_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "USB(");
+            TextPutHex(Text, Data[0]);
+            TextPutChar(Text, ',');
+            TextPutHex(Text, Data[1]);
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_MESSAGING_I2O:
+            if (Size != DEVICE_PATH_I2O_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "I2O(");
+            TextPutHex(Text, DevicePathRead32(Data));
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_MESSAGING_VENDOR:
+            if (Size < DEVICE_PATH_GUID_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "VenMsg(");
+            break;
+
+        case EFI_DEVICE_PATH_MESSAGING_MAC: {
+            if (Size != DEVICE_PATH_MAC_SIZE) {
+                return FALSE;
+            }
+            //
+            // Ethernet and IEEE 802 addresses are 6 bytes, the rest of the field is padding
+            //
+            UINTN AddressSize = Data[32] <= 1 ? 6 : 32;
+            if (!DevicePathIsZero(Data + AddressSize, 32 - AddressSize)) {
+                return FALSE;
+            }
+            TextPutString(Text, "MAC(");
+            TextPutBytes(Text, Data, AddressSize);
+            TextPutChar(Text, ',');
+            TextPutHex(Text, Data[32]);
+            TextPutChar(Text, ')');
+            return TRUE;
+        }
+
+        case EFI_DEVICE_PATH_MESSAGING_IPV4: {
+            if (Size != DEVICE_PATH_IPV4_SIZE || Data[14] > 1) {
+                return FALSE;
+            }
+            UINT16 Protocol = DevicePathRead16(Data + 12);
+            TextPutString(Text, "IPv4(");
+            TextPutIpv4(Text, Data + 4, DevicePathRead16(Data + 10));
+            TextPutChar(Text, ',');
+            if (Protocol == DEVICE_PATH_PROTOCOL_TCP) {
+                TextPutString(Text, "TCP");
+            } else if (Protocol == DEVICE_PATH_PROTOCOL_UDP) {
+                TextPutString(Text, "UDP");
+            } else {
+                TextPutHex(Text, Protocol);
+            }
+            TextPutString(Text, Data[14] != 0 ? ",Static," : ",DHCP,");
+            TextPutIpv4(Text, Data, DevicePathRead16(Data + 8));
+            TextPutChar(Text, ',');
+            TextPutIpv4(Text, Data + 15, 0);
+            TextPutChar(Text, ',');
+            TextPutIpv4(Text, Data + 19, 0);
+            TextPutChar(Text, ')');
+            return TRUE;
+        }
+
+        case EFI_DEVICE_PATH_MESSAGING_USB_CLASS:
+            if (Size != DEVICE_PATH_USB_CLASS_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "UsbClass(");
+            TextPutHex(Text, DevicePathRead16(Data));
+            TextPutChar(Text, ',');
+            TextPutHex(Text, DevicePathRead16(Data + 2));
+            for (UINTN Index = 4; Index < DEVICE_PATH_USB_CLASS_SIZE; Index++) {
+                TextPutChar(Text, ',');
+                TextPutHex(Text, Data[Index]);
+            }
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_MESSAGING_LOGICAL_UNIT:
+            if (Size != DEVICE_PATH_UNIT_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "Unit(");
+            TextPutHex(Text, Data[0]);
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_MESSAGING_SATA:
+            if (Size != DEVICE_PATH_SATA_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "Sata(");
+            TextPutHex(Text, DevicePathRead16(Data));
+            TextPutChar(Text, ',');
+            TextPutHex(Text, DevicePathRead16(Data + 2));
+            TextPutChar(Text, ',');
+            TextPutHex(Text, DevicePathRead16(Data + 4));
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_MESSAGING_VLAN:
+            if (Size != DEVICE_PATH_VLAN_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "Vlan(");
+            TextPutDecimal(Text, DevicePathRead16(Data));
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_MESSAGING_NVME:
+            if (Size != DEVICE_PATH_NVME_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "NVMe(");
+            TextPutHex(Text, DevicePathRead32(Data));
+            for (UINTN Index = 0; Index < 8; Index++) {
+                TextPutChar(Text, Index == 0 ? ',' : '-');
+                TextPutBytes(Text, Data + 11 - Index, 1);
+            }
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_MESSAGING_URI:
+            for (UINTN Index = 0; Index < Size; Index++) {
+                if (Data[Index] < 0x20 || Data[Index] > 0x7E || Data[Index] == '(' || Data[Index] == ')') {
+                    return FALSE;
+                }
+            }
+            TextPutString(Text, "Uri(");
+            for (UINTN Index = 0; Index < Size; Index++) {
+                TextPutChar(Text, Data[Index]);
+            }
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_MESSAGING_UFS:
+            if (Size != DEVICE_PATH_UFS_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "UFS(");
+            TextPutHex(Text, Data[0]);
+            TextPutChar(Text, ',');
+            TextPutHex(Text, Data[1]);
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_MESSAGING_SD:
+        case EFI_DEVICE_PATH_MESSAGING_EMMC:
+            if (Size != DEVICE_PATH_SLOT_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, SubType == EFI_DEVICE_PATH_MESSAGING_SD ? "SD(" : "eMMC(");
+            TextPutHex(Text, Data[0]);
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        default:
+            return FALSE;
+        }
+        break;
+
+    case EFI_DEVICE_PATH_MEDIA:
+        switch (SubType) {
+        case EFI_DEVICE_PATH_MEDIA_HARD_DRIVE: {
+            if (Size != DEVICE_PATH_HARD_DRIVE_SIZE) {
+                return FALSE;
+            }
+            const UINT8 *Signature = Data + 20;
+            BOOLEAN Gpt = Data[36] == DEVICE_PATH_PARTITION_GPT && Data[37] == DEVICE_PATH_SIGNATURE_GUID;
+            BOOLEAN Mbr = Data[36] == DEVICE_PATH_PARTITION_MBR && Data[37] == DEVICE_PATH_SIGNATURE_MBR && DevicePathIsZero(Signature + 4, 12);
+            if (!Gpt && !Mbr) {
+                return FALSE;
+            }
+            TextPutString(Text, "HD(");
+            TextPutDecimal(Text, DevicePathRead32(Data));
+            if (Gpt) {
+                TextPutString(Text, ",GPT,");
+                TextPutGuid(Text, Signature);
+            } else {
+                TextPutString(Text, ",MBR,");
+                TextPutHex(Text, DevicePathRead32(Signature));
+            }
+            TextPutChar(Text, ',');
+            TextPutHex(Text, DevicePathRead64(Data + 4));
+            TextPutChar(Text, ',');
+            TextPutHex(Text, DevicePathRead64(Data + 12));
+            TextPutChar(Text, ')');
+            return TRUE;
+        }
+
+        case EFI_DEVICE_PATH_MEDIA_CD_ROM:
+            if (Size != DEVICE_PATH_CD_ROM_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "CDROM(");
+            TextPutHex(Text, DevicePathRead32(Data));
+            TextPutChar(Text, ',');
+            TextPutHex(Text, DevicePathRead64(Data + 4));
+            TextPutChar(Text, ',');
+            TextPutHex(Text, DevicePathRead64(Data + 12));
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_MEDIA_VENDOR:
+            if (Size < DEVICE_PATH_GUID_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "VenMedia(");
+            break;
+
+        case EFI_DEVICE_PATH_MEDIA_FILE_PATH: {
+            if (!DevicePathIsPlainFilePath(Data, Size)) {
+                return FALSE;
+            }
+            UINTN Count = Size / sizeof(CHAR16) - 1;
+            for (UINTN Index = 0; Index < Count; Index++) {
+                UINT32 CodePoint = DevicePathRead16(Data + Index * sizeof(CHAR16));
+                if (CodePoint >= 0xD800 && CodePoint <= 0xDBFF) {
+                    Index++;
+                    CodePoint = 0x10000 + ((CodePoint - 0xD800) << 10) + (DevicePathRead16(Data + Index * sizeof(CHAR16)) - 0xDC00);
+                }
+                TextPutCodePoint(Text, CodePoint);
+            }
+            return TRUE;
+        }
+
+        case EFI_DEVICE_PATH_MEDIA_PROTOCOL:
+        case EFI_DEVICE_PATH_MEDIA_PIWG_FILE:
+        case EFI_DEVICE_PATH_MEDIA_PIWG_VOLUME:
+            if (Size != DEVICE_PATH_GUID_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, SubType == EFI_DEVICE_PATH_MEDIA_PROTOCOL ? "Media(" : SubType == EFI_DEVICE_PATH_MEDIA_PIWG_FILE ? "FvFile(" : "Fv(");
+            TextPutGuid(Text, Data);
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_MEDIA_RELATIVE_OFFSET_RANGE:
+            if (Size != DEVICE_PATH_OFFSET_SIZE || DevicePathRead32(Data) != 0) {
+                return FALSE;
+            }
+            TextPutString(Text, "Offset(");
+            TextPutHex(Text, DevicePathRead64(Data + 4));
+            TextPutChar(Text, ',');
+            TextPutHex(Text, DevicePathRead64(Data + 12));
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        case EFI_DEVICE_PATH_MEDIA_RAM:
+            if (Size != DEVICE_PATH_RAM_DISK_SIZE) {
+                return FALSE;
+            }
+            TextPutString(Text, "RamDisk(");
+            TextPutHex(Text, DevicePathRead64(Data));
+            TextPutChar(Text, ',');
+            TextPutHex(Text, DevicePathRead64(Data + 8));
+            TextPutChar(Text, ',');
+            TextPutHex(Text, DevicePathRead16(Data + 32));
+            TextPutChar(Text, ',');
+            TextPutGuid(Text, Data + 16);
+            TextPutChar(Text, ')');
+            return TRUE;
+
+        default:
+            return FALSE;
+        }
+        break;
+
+    default:
+        return FALSE;
+    }
+
+    //
+    // Vendor nodes: a GUID followed by optional data
+    //
+    TextPutGuid(Text, Data);
+    if (Size > DEVICE_PATH_GUID_SIZE) {
+        TextPutChar(Text, ',');
+        TextPutBytes(Text, Data + DEVICE_PATH_GUID_SIZE, Size - DEVICE_PATH_GUID_SIZE);
+    }
+    TextPutChar(Text, ')');
+    return TRUE;
+}
+
+template <typename CHAR>
+static EFI_STATUS DevicePathToTextWorker (
+    IN const EFI_DEVICE_PATH_PROTOCOL   *DevicePath,
+    OUT CHAR                            *Buffer OPTIONAL,
+    IN OUT UINTN                        *BufferSize
+) {
+    if (DevicePath == NULL || BufferSize == NULL || GetDevicePathSize(DevicePath) == 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    DEVICE_PATH_TEXT<CHAR> Text;
+    Text.Buffer = Buffer;
+    Text.Capacity = Buffer != NULL ? *BufferSize / sizeof(CHAR) : 0;
+    Text.Length = 0;
+
+    BOOLEAN First = TRUE;
+    for (const EFI_DEVICE_PATH_PROTOCOL *Node = DevicePath; !IsDevicePathEnd(Node); Node = NextDevicePathNode(Node)) {
+        const UINT8 *Header = (const UINT8 *)Node;
+        const UINT8 *Data = Header + sizeof(EFI_DEVICE_PATH_PROTOCOL);
+        UINTN Size = DevicePathNodeLength(Node) - sizeof(EFI_DEVICE_PATH_PROTOCOL);
+        if (Header[0] == EFI_DEVICE_PATH_END && Header[1] == EFI_DEVICE_PATH_END_INSTANCE && Size == 0) {
+            TextPutChar(&Text, ',');
+            First = TRUE;
+            continue;
+        }
+        if (!First) {
+            TextPutChar(&Text, '/');
+        }
+        First = FALSE;
+        if (!TextPutKnownNode(&Text, Header[0], Header[1], Data, Size)) {
+            TextPutString(&Text, "Path(");
+            TextPutHex(&Text, Header[0]);
+            TextPutChar(&Text, ',');
+            TextPutHex(&Text, Header[1]);
+            if (Size != 0) {
+                TextPutChar(&Text, ',');
+                TextPutBytes(&Text, Data, Size);
+            }
+            TextPutChar(&Text, ')');
+        }
+    }
+    TextPutChar(&Text, 0);
+
+    UINTN Needed = Text.Length * sizeof(CHAR);
+    if (Text.Length > Text.Capacity) {
+        *BufferSize = Needed;
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    *BufferSize = Needed;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS DevicePathToText (
+    IN const EFI_DEVICE_PATH_PROTOCOL   *DevicePath,
+    OUT CHAR16                          *Buffer OPTIONAL,
+    IN OUT UINTN                        *BufferSize
+) {
+    return DevicePathToTextWorker(DevicePath, Buffer, BufferSize);
+}
+
+EFI_STATUS DevicePathToUtf8 (
+    IN const EFI_DEVICE_PATH_PROTOCOL   *DevicePath,
+    OUT CHAR8                           *Buffer OPTIONAL,
+    IN OUT UINTN                        *BufferSize
+) {
+    return DevicePathToTextWorker(DevicePath, Buffer, BufferSize);
+}
+
+/**
+ * Binary output: bytes past Capacity are counted but not stored
+ */
+typedef struct {
+    UINT8   *Buffer;
+    UINTN   Capacity;
+    UINTN   Length;
+} DEVICE_PATH_BINARY;
+
+static inline VOID BinaryPut (
+    IN OUT DEVICE_PATH_BINARY   *Binary,
+    IN const VOID               *Data,
+    IN UINTN                    Size
+) {
+    if (Binary->Length + Size <= Binary->Capacity) {
+        memcpy(Binary->Buffer + Binary->Length, Data, Size);
+    }
+    Binary->Length += Size;
+}
+
+static inline VOID BinaryPut8 (
+    IN OUT DEVICE_PATH_BINARY   *Binary,
+    IN UINT64                   Value
+) {
+    UINT8 Byte = (UINT8)Value;
+    BinaryPut(Binary, &Byte, sizeof(Byte));
+}
+
+static inline VOID BinaryPut16 (
+    IN OUT DEVICE_PATH_BINARY   *Binary,
+    IN UINT64                   Value
+) {
+    UINT16 Word = (UINT16)Value;
+    BinaryPut(Binary, &Word, sizeof(Word));
+}
+
+static inline VOID BinaryPut32 (
+    IN OUT DEVICE_PATH_BINARY   *Binary,
+    IN UINT64                   Value
+) {
+    UINT32 Word = (UINT32)Value;
+    BinaryPut(Binary, &Word, sizeof(Word));
+}
+
+static inline VOID BinaryPut64 (
+    IN OUT DEVICE_PATH_BINARY   *Binary,
+    IN UINT64                   Value
+) {
+    BinaryPut(Binary, &Value, sizeof(Value));
+}
+
+static inline UINTN BinaryBeginNode (
+    IN OUT DEVICE_PATH_BINARY   *Binary,
+    IN UINT8                    Type,
+    IN UINT8                    SubType
+) {
+    UINTN Start = Binary->Length;
+    UINT8 Header[sizeof(EFI_DEVICE_PATH_PROTOCOL)] = { Type, SubType, 0, 0 };
+    BinaryPut(Binary, Header, sizeof(Header));
+    return Start;
+}
+
+static inline EFI_STATUS BinaryEndNode (
+    IN OUT DEVICE_PATH_BINARY   *Binary,
+    IN UINTN                    Start
+) {
+    UINTN Length = Binary->Length - Start;
+    if (Length > 0xFFFF) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (Binary->Length <= Binary->Capacity) {
+        SetDevicePathNodeLength((EFI_DEVICE_PATH_PROTOCOL *)(Binary->Buffer + Start), Length);
+    }
+    return EFI_SUCCESS;
+}
+
+/**
+ * A run of characters within the text being parsed
+ */
+template <typename CHAR>
+struct DEVICE_PATH_SPAN {
+    const CHAR  *Start;
+    UINTN       Length;
+};
+
+template <typename CHAR>
+static inline BOOLEAN SpanIs (
+    IN DEVICE_PATH_SPAN<CHAR>   Span,
+    IN const char               *Keyword
+) {
+    UINTN Index = 0;
+    for (; Index < Span.Length; Index++) {
+        if (Keyword[Index] == '\0' || (UINT32)Span.Start[Index] != (UINT8)Keyword[Index]) {
+            return FALSE;
+        }
+    }
+    return Keyword[Index] == '\0';
+}
+
+static inline INTN ParseHexDigit (
+    IN UINT32 Character
+) {
+    if (Character >= '0' && Character <= '9') {
+        return Character - '0';
+    }
+    if (Character >= 'a' && Character <= 'f') {
+        return Character - 'a' + 10;
+    }
+    if (Character >= 'A' && Character <= 'F') {
+        return Character - 'A' + 10;
+    }
+    return -1;
+}
+
+template <typename CHAR>
+static BOOLEAN ParseNumber (
+    IN DEVICE_PATH_SPAN<CHAR>   Span,
+    IN UINT64                   Maximum,
+    OUT UINT64                  *Value
+) {
+    UINT64 Result = 0;
+    if (Span.Length > 2 && Span.Start[0] == '0' && (Span.Start[1] == 'x' || Span.Start[1] == 'X')) {
+        for (UINTN Index = 2; Index < Span.Length; Index++) {
+            INTN Digit = ParseHexDigit(Span.Start[Index]);
+            if (Digit < 0 || Result > (Maximum >> 4)) {
+                return FALSE;
+            }
+            Result = (Result << 4) | (UINT64)Digit;
+        }
+    } else {
+        if (Span.Length == 0) {
+            return FALSE;
+        }
+        for (UINTN Index = 0; Index < Span.Length; Index++) {
+            UINT32 Character = Span.Start[Index];
+            if (Character < '0' || Character > '9' || Result > (Maximum - (Character - '0')) / 10) {
+                return FALSE;
+            }
+            Result = Result * 10 + (Character - '0');
+        }
+    }
+    if (Result > Maximum) {
+        return FALSE;
+    }
+    *Value = Result;
+    return TRUE;
+}
+
+template <typename CHAR>
+static BOOLEAN ParseGuid (
+    IN DEVICE_PATH_SPAN<CHAR>   Span,
+    OUT UINT8                   *Guid
+) {
+    static const UINT8 Order[16] = { 3, 2, 1, 0, 5, 4, 7, 6, 8, 9, 10, 11, 12, 13, 14, 15 };
+    if (Span.Length != 36) {
+        return FALSE;
+    }
+    UINTN Position = 0;
+    for (UINTN Index = 0; Index < 16; Index++) {
+        if (Index == 4 || Index == 6 || Index == 8 || Index == 10) {
+            if (Span.Start[Position++] != '-') {
+                return FALSE;
+            }
+        }
+        INTN High = ParseHexDigit(Span.Start[Position++]);
+        INTN Low = ParseHexDigit(Span.Start[Position++]);
+        if (High < 0 || Low < 0) {
+            return FALSE;
+        }
+        Guid[Order[Index]] = (UINT8)((High << 4) | Low);
+    }
+    return TRUE;
+}
+
+/**
+ * Hex digit pairs, written straight to the output; Maximum bounds the byte count
+ */
+template <typename CHAR>
+static BOOLEAN ParseBytes (
+    IN DEVICE_PATH_SPAN<CHAR>   Span,
+    IN UINTN                    Maximum,
+    IN OUT DEVICE_PATH_BINARY   *Binary
+) {
+    if (Span.Length % 2 != 0 || Span.Length / 2 > Maximum) {
+        return FALSE;
+    }
+    for (UINTN Index = 0; Index < Span.Length; Index += 2) {
+        INTN High = ParseHexDigit(Span.Start[Index]);
+        INTN Low = ParseHexDigit(Span.Start[Index + 1]);
+        if (High < 0 || Low < 0) {
+            return FALSE;
+        }
+        BinaryPut8(Binary, (High << 4) | Low);
+    }
+    return TRUE;
+}
+
+/**
+ * Dotted decimal address with an optional ":Port" when Port is not NULL
+ */
+template <typename CHAR>
+static BOOLEAN ParseIpv4 (
+    IN DEVICE_PATH_SPAN<CHAR>   Span,
+    OUT UINT8                   *Address,
+    OUT UINT16                  *Port OPTIONAL
+) {
+    UINTN Position = 0;
+    for (UINTN Index = 0; Index < 4; Index++) {
+        DEVICE_PATH_SPAN<CHAR> Part = { Span.Start + Position, 0 };
+        while (Position < Span.Length && Span.Start[Position] != '.' && Span.Start[Position] != ':') {
+            Position++;
+            Part.Length++;
+        }
+        UINT64 Value;
+        if (!ParseNumber(Part, 0xFF, &Value)) {
+            return FALSE;
+        }
+        Address[Index] = (UINT8)Value;
+        if (Index != 3) {
+            if (Position == Span.Length || Span.Start[Position] != '.') {
+                return FALSE;
+            }
+            Position++;
+        }
+    }
+    UINT64 Value = 0;
+    if (Position != Span.Length) {
+        if (Port == NULL || Span.Start[Position] != ':') {
+            return FALSE;
+        }
+        DEVICE_PATH_SPAN<CHAR> Part = { Span.Start + Position + 1, Span.Length - Position - 1 };
+        if (!ParseNumber(Part, 0xFFFF, &Value)) {
+            return FALSE;
+        }
+    }
+    if (Port != NULL) {
+        *Port = (UINT16)Value;
+    }
+    return TRUE;
+}
+
+/**
+ * Decodes one code point, returning FALSE on malformed input
+ */
+static BOOLEAN ParseCodePoint (
+    IN OUT const CHAR16 **Position,
+    IN const CHAR16     *End,
+    OUT UINT32          *CodePoint
+) {
+    (VOID)End;
+    *CodePoint = *(*Position)++;
+    return TRUE;
+}
+
+static BOOLEAN ParseCodePoint (
+    IN OUT const CHAR8  **Position,
+    IN const CHAR8      *End,
+    OUT UINT32          *CodePoint
+) {
+    UINT8 Lead = (UINT8)*(*Position)++;
+    UINTN Trail;
+    UINT32 Value;
+    UINT32 Minimum;
+    if (Lead < 0x80) {
+        *CodePoint = Lead;
+        return TRUE;
+    } else if (Lead >= 0xC2 && Lead <= 0xDF) {
+        Trail = 1;
+        Value = Lead & 0x1F;
+        Minimum = 0x80;
+    } else if (Lead >= 0xE0 && Lead <= 0xEF) {
+        Trail = 2;
+        Value = Lead & 0x0F;
+        Minimum = 0x800;
+    } else if (Lead >= 0xF0 && Lead <= 0xF4) {
+        Trail = 3;
+        Value = Lead & 0x07;
+        Minimum = 0x10000;
+    } else {
+        return FALSE;
+    }
+    if ((UINTN)(End - *Position) < Trail) {
+        return FALSE;
+    }
+    for (UINTN Index = 0; Index < Trail; Index++) {
+        UINT8 Byte = (UINT8)*(*Position)++;
+        if ((Byte & 0xC0) != 0x80) {
+            return FALSE;
+        }
+        Value = (Value << 6) | (Byte & 0x3F);
+    }
+    if (Value < Minimum || Value > 0x10FFFF || (Value >= 0xD800 && Value <= 0xDFFF)) {
+        return FALSE;
+    }
+    *CodePoint = Value;
+    return TRUE;
+}
+
+template <typename CHAR>
+static EFI_STATUS ParseFilePath (
+    IN DEVICE_PATH_SPAN<CHAR>   Span,
+    IN OUT DEVICE_PATH_BINARY   *Binary
+) {
+    UINTN Start = BinaryBeginNode(Binary, EFI_DEVICE_PATH_MEDIA, EFI_DEVICE_PATH_MEDIA_FILE_PATH);
+    const CHAR *Position = Span.Start;
+    const CHAR *End = Span.Start + Span.Length;
+    while (Position < End) {
+        UINT32 CodePoint;
+        if (!ParseCodePoint(&Position, End, &CodePoint)) {
+            return EFI_INVALID_PARAMETER;
+        }
+        if (CodePoint >= 0x10000) {
+            CodePoint -= 0x10000;
+            BinaryPut16(Binary, 0xD800 | (CodePoint >> 10));
+            BinaryPut16(Binary, 0xDC00 | (CodePoint & 0x3FF));
+        } else {
+            BinaryPut16(Binary, CodePoint);
+        }
+    }
+    BinaryPut16(Binary, 0);
+    return BinaryEndNode(Binary, Start);
+}
+
+/**
+ * Parses one node of the form Name(Arguments)
+ */
+template <typename CHAR>
+static EFI_STATUS ParseNode (
+    IN DEVICE_PATH_SPAN<CHAR>   Name,
+    IN DEVICE_PATH_SPAN<CHAR>   Raw,
+    IN DEVICE_PATH_SPAN<CHAR>   *Arguments,
+    IN UINTN                    Count,
+    IN OUT DEVICE_PATH_BINARY   *Binary
+) {
+    UINT64 Value[DEVICE_PATH_TEXT_MAX_ARGUMENTS];
+    UINT8 Guid[DEVICE_PATH_GUID_SIZE];
+    UINTN Start;
+
+    //
+    // Generic forms
+    //
+    if (SpanIs(Name, "Path")) {
+        if (Count < 2 || Count > 3 || !ParseNumber(Arguments[0], 0xFF, &Value[0]) || !ParseNumber(Arguments[1], 0xFF, &Value[1])) {
+            return EFI_INVALID_PARAMETER;
+        }
+        if (Value[0] == EFI_DEVICE_PATH_END && Value[1] == EFI_DEVICE_PATH_END_ENTIRE) {
+            return EFI_INVALID_PARAMETER;
+        }
+        Start = BinaryBeginNode(Binary, (UINT8)Value[0], (UINT8)Value[1]);
+        if (Count == 3 && !ParseBytes(Arguments[2], 0xFFFF, Binary)) {
+            return EFI_INVALID_PARAMETER;
+        }
+        return BinaryEndNode(Binary, Start);
+    }
+    for (UINTN Index = 0; Index < sizeof(mGenericNames) / sizeof(mGenericNames[0]); Index++) {
+        if (SpanIs(Name, mGenericNames[Index].Name)) {
+            if (Count < 1 || Count > 2 || !ParseNumber(Arguments[0], 0xFF, &Value[0])) {
+                return EFI_INVALID_PARAMETER;
+            }
+            Start = BinaryBeginNode(Binary, mGenericNames[Index].Type, (UINT8)Value[0]);
+            if (Count == 2 && !ParseBytes(Arguments[1], 0xFFFF, Binary)) {
+                return EFI_INVALID_PARAMETER;
+            }
+            return BinaryEndNode(Binary, Start);
+        }
+    }
+
+    //
+    // Forms whose arguments are not all integers
+    //
+    UINT8 VendorType = 0;
+    UINT8 VendorSubType = 0;
+    if (SpanIs(Name, "VenHw")) {
+        VendorType = EFI_DEVICE_PATH_HARDWARE;
+        VendorSubType = EFI_DEVICE_PATH_HARDWARE_VENDOR;
+    } else if (SpanIs(Name, "VenMsg")) {
+        VendorType = EFI_DEVICE_PATH_MESSAGING;
+        VendorSubType = EFI_DEVICE_PATH_MESSAGING_VENDOR;
+    } else if (SpanIs(Name, "VenMedia")) {
+        VendorType = EFI_DEVICE_PATH_MEDIA;
+        VendorSubType = EFI_DEVICE_PATH_MEDIA_VENDOR;
+    }
+    if (VendorType != 0) {
+        if (Count < 1 || Count > 2 || !ParseGuid(Arguments[0], Guid)) {
+            return EFI_INVALID_PARAMETER;
+        }
+        Start = BinaryBeginNode(Binary, VendorType, VendorSubType);
+        BinaryPut(Binary, Guid, sizeof(Guid));
+        if (Count == 2 && !ParseBytes(Arguments[1], 0xFFFF, Binary)) {
+            return EFI_INVALID_PARAMETER;
+        }
+        return BinaryEndNode(Binary, Start);
+    }
+
+    UINT8 GuidSubType = 0;
+    if (SpanIs(Name, "Media")) {
+        GuidSubType = EFI_DEVICE_PATH_MEDIA_PROTOCOL;
+    } else if (SpanIs(Name, "FvFile")) {
+        GuidSubType = EFI_DEVICE_PATH_MEDIA_PIWG_FILE;
+    } else if (SpanIs(Name, "Fv")) {
+        GuidSubType = EFI_DEVICE_PATH_MEDIA_PIWG_VOLUME;
+    }
+    if (GuidSubType != 0) {
+        if (Count != 1 || !ParseGuid(Arguments[0], Guid)) {
+            return EFI_INVALID_PARAMETER;
+        }
+        Start = BinaryBeginNode(Binary, EFI_DEVICE_PATH_MEDIA, GuidSubType);
+        BinaryPut(Binary, Guid, sizeof(Guid));
+        return BinaryEndNode(Binary, Start);
+    }
+
+    if (SpanIs(Name, "Uri")) {
+        Start = BinaryBeginNode(Binary, EFI_DEVICE_PATH_MESSAGING, EFI_DEVICE_PATH_MESSAGING_URI);
+        for (UINTN Index = 0; Index < Raw.Length; Index++) {
+            if ((UINT32)Raw.Start[Index] > 0x7E) {
+                return EFI_INVALID_PARAMETER;
+            }
+            BinaryPut8(Binary, Raw.Start[Index]);
+        }
+        return BinaryEndNode(Binary, Start);
+    }
+
+    if (SpanIs(Name, "HD")) {
+        if (Count != 5 || !ParseNumber(Arguments[0], 0xFFFFFFFF, &Value[0]) || !ParseNumber(Arguments[3], ~(UINT64)0, &Value[3]) || !ParseNumber(Arguments[4], ~(UINT64)0, &Value[4])) {
+            return EFI_INVALID_PARAMETER;
+        }
+        memset(Guid, 0, sizeof(Guid));
+        UINT8 Format;
+        if (SpanIs(Arguments[1], "GPT")) {
+            Format = DEVICE_PATH_PARTITION_GPT;
+            if (!ParseGuid(Arguments[2], Guid)) {
+                return EFI_INVALID_PARAMETER;
+            }
+        } else if (SpanIs(Arguments[1], "MBR")) {
+            Format = DEVICE_PATH_PARTITION_MBR;
+            if (!ParseNumber(Arguments[2], 0xFFFFFFFF, &Value[2])) {
+                return EFI_INVALID_PARAMETER;
+            }
+            UINT32 Signature = (UINT32)Value[2];
+            memcpy(Guid, &Signature, sizeof(Signature));
+        } else {
+            return EFI_INVALID_PARAMETER;
+        }
+        Start = BinaryBeginNode(Binary, EFI_DEVICE_PATH_MEDIA, EFI_DEVICE_PATH_MEDIA_HARD_DRIVE);
+        BinaryPut32(Binary, Value[0]);
+        BinaryPut64(Binary, Value[3]);
+        BinaryPut64(Binary, Value[4]);
+        BinaryPut(Binary, Guid, sizeof(Guid));
+        BinaryPut8(Binary, Format);
+        BinaryPut8(Binary, Format == DEVICE_PATH_PARTITION_GPT ? DEVICE_PATH_SIGNATURE_GUID : DEVICE_PATH_SIGNATURE_MBR);
+        return BinaryEndNode(Binary, Start);
+    }
+
+    if (SpanIs(Name, "RamDisk")) {
+        if (Count != 4 || !ParseNumber(Arguments[0], ~(UINT64)0, &Value[0]) || !ParseNumber(Arguments[1], ~(UINT64)0, &Value[1]) || !ParseNumber(Arguments[2], 0xFFFF, &Value[2]) || !ParseGuid(Arguments[3], Guid)) {
+            return EFI_INVALID_PARAMETER;
+        }
+        Start = BinaryBeginNode(Binary, EFI_DEVICE_PATH_MEDIA, EFI_DEVICE_PATH_MEDIA_RAM);
+        BinaryPut64(Binary, Value[0]);
+        BinaryPut64(Binary, Value[1]);
+        BinaryPut(Binary, Guid, sizeof(Guid));
+        BinaryPut16(Binary, Value[2]);
+        return BinaryEndNode(Binary, Start);
+    }
+
+    if (SpanIs(Name, "Acpi")) {
+        if (Count != 2 || !ParseNumber(Arguments[1], 0xFFFFFFFF, &Value[1])) {
+            return EFI_INVALID_PARAMETER;
+        }
+        DEVICE_PATH_SPAN<CHAR> Hid = Arguments[0];
+        if (Hid.Length == 7 && Hid.Start[0] == 'P' && Hid.Start[1] == 'N' && Hid.Start[2] == 'P') {
+            Value[0] = 0;
+            for (UINTN Index = 3; Index < 7; Index++) {
+                INTN Digit = ParseHexDigit(Hid.Start[Index]);
+                if (Digit < 0) {
+                    return EFI_INVALID_PARAMETER;
+                }
+                Value[0] = (Value[0] << 4) | (UINT64)Digit;
+            }
+            Value[0] = (Value[0] << 16) | DEVICE_PATH_EISA_PNP;
+        } else if (!ParseNumber(Hid, 0xFFFFFFFF, &Value[0])) {
+            return EFI_INVALID_PARAMETER;
+        }
+        Start = BinaryBeginNode(Binary, EFI_DEVICE_PATH_ACPI, EFI_DEVICE_PATH_ACPI_ACPI);
+        BinaryPut32(Binary, Value[0]);
+        BinaryPut32(Binary, Value[1]);
+        return BinaryEndNode(Binary, Start);
+    }
+    for (UINTN Index = 0; Index < sizeof(mAcpiNames) / sizeof(mAcpiNames[0]); Index++) {
+        if (SpanIs(Name, mAcpiNames[Index].Name)) {
+            if (Count != 1 || !ParseNumber(Arguments[0], 0xFFFFFFFF, &Value[0])) {
+                return EFI_INVALID_PARAMETER;
+            }
+            Start = BinaryBeginNode(Binary, EFI_DEVICE_PATH_ACPI, EFI_DEVICE_PATH_ACPI_ACPI);
+            BinaryPut32(Binary, ((UINT32)mAcpiNames[Index].Device << 16) | DEVICE_PATH_EISA_PNP);
+            BinaryPut32(Binary, Value[0]);
+            return BinaryEndNode(Binary, Start);
+        }
+    }
+
+    if (SpanIs(Name, "Ata")) {
+        if (Count != 3 || !ParseNumber(Arguments[2], 0xFFFF, &Value[2])) {
+            return EFI_INVALID_PARAMETER;
+        }
+        if (SpanIs(Arguments[0], "Primary")) {
+            Value[0] = 0;
+        } else if (SpanIs(Arguments[0], "Secondary")) {
+            Value[0] = 1;
+        } else if (!ParseNumber(Arguments[0], 0xFF, &Value[0])) {
+            return EFI_INVALID_PARAMETER;
+        }
+        if (SpanIs(Arguments[1], "Master")) {
+            Value[1] = 0;
+        } else if (SpanIs(Arguments[1], "Slave")) {
+            Value[1] = 1;
+        } else if (!ParseNumber(Arguments[1], 0xFF, &Value[1])) {
+            return EFI_INVALID_PARAMETER;
+        }
+        Start = BinaryBeginNode(Binary, EFI_DEVICE_PATH_MESSAGING, EFI_DEVICE_PATH_MESSAGING_ATAPI);
+        BinaryPut8(Binary, Value[0]);
+        BinaryPut8(Binary, Value[1]);
+        BinaryPut16(Binary, Value[2]);
+        return BinaryEndNode(Binary, Start);
+    }
+
+    if (SpanIs(Name, "MAC")) {
+        if (Count != 2 || !ParseNumber(Arguments[1], 0xFF, &Value[1])) {
+            return EFI_INVALID_PARAMETER;
+        }
+        Start = BinaryBeginNode(Binary, EFI_DEVICE_PATH_MESSAGING, EFI_DEVICE_PATH_MESSAGING_MAC);
+        if (!ParseBytes(Arguments[0], 32, Binary)) {
+            return EFI_INVALID_PARAMETER;
+        }
+        for (UINTN Index = Arguments[0].Length / 2; Index < 32; Index++) {
+            BinaryPut8(Binary, 0);
+        }
+        BinaryPut8(Binary, Value[1]);
+        return BinaryEndNode(Binary, Start);
+    }
+
+    if (SpanIs(Name, "IPv4")) {
+        //
+        // Everything after RemoteIp is optional and defaults to zero
+        //
+        UINT8 Remote[4];
+        UINT8 Local[4] = { 0 };
+        UINT8 Gateway[4] = { 0 };
+        UINT8 Mask[4] = { 0 };
+        UINT16 RemotePort;
+        UINT16 LocalPort = 0;
+        if (Count < 1 || Count > 6 || !ParseIpv4(Arguments[0], Remote, &RemotePort) ||
+            (Count > 3 && !ParseIpv4(Arguments[3], Local, &LocalPort)) ||
+            (Count > 4 && !ParseIpv4(Arguments[4], Gateway, NULL)) ||
+            (Count > 5 && !ParseIpv4(Arguments[5], Mask, NULL))) {
+            return EFI_INVALID_PARAMETER;
+        }
+        Value[1] = 0;
+        if (Count > 1) {
+            if (SpanIs(Arguments[1], "TCP")) {
+                Value[1] = DEVICE_PATH_PROTOCOL_TCP;
+            } else if (SpanIs(Arguments[1], "UDP")) {
+                Value[1] = DEVICE_PATH_PROTOCOL_UDP;
+            } else if (!ParseNumber(Arguments[1], 0xFFFF, &Value[1])) {
+                return EFI_INVALID_PARAMETER;
+            }
+        }
+        Value[2] = 0;
+        if (Count > 2) {
+            if (SpanIs(Arguments[2], "Static")) {
+                Value[2] = 1;
+            } else if (!SpanIs(Arguments[2], "DHCP")) {
+                return EFI_INVALID_PARAMETER;
+            }
+        }
+        Start = BinaryBeginNode(Binary, EFI_DEVICE_PATH_MESSAGING, EFI_DEVICE_PATH_MESSAGING_IPV4);
+        BinaryPut(Binary, Local, sizeof(Local));
+        BinaryPut(Binary, Remote, sizeof(Remote));
+        BinaryPut16(Binary, LocalPort);
+        BinaryPut16(Binary, RemotePort);
+        BinaryPut16(Binary, Value[1]);
+        BinaryPut8(Binary, Value[2]);
+        BinaryPut(Binary, Gateway, sizeof(Gateway));
+        BinaryPut(Binary, Mask, sizeof(Mask));
+        return BinaryEndNode(Binary, Start);
+    }
+
+    if (SpanIs(Name, "NVMe")) {
+        if (Count != 2 || !ParseNumber(Arguments[0], 0xFFFFFFFF, &Value[0]) || Arguments[1].Length != 23) {
+            return EFI_INVALID_PARAMETER;
+        }
+        DEVICE_PATH_SPAN<CHAR> Eui = Arguments[1];
+        UINT8 Bytes[8];
+        for (UINTN Index = 0; Index < 8; Index++) {
+            INTN High = ParseHexDigit(Eui.Start[Index * 3]);
+            INTN Low = ParseHexDigit(Eui.Start[Index * 3 + 1]);
+            if (High < 0 || Low < 0 || (Index != 7 && Eui.Start[Index * 3 + 2] != '-')) {
+                return EFI_INVALID_PARAMETER;
+            }
+            Bytes[7 - Index] = (UINT8)((High << 4) | Low);
+        }
+        Start = BinaryBeginNode(Binary, EFI_DEVICE_PATH_MESSAGING, EFI_DEVICE_PATH_MESSAGING_NVME);
+        BinaryPut32(Binary, Value[0]);
+        BinaryPut(Binary, Bytes, sizeof(Bytes));
+        return BinaryEndNode(Binary, Start);
+    }
+
+    //
+    // Forms whose arguments are all integers, stored in order with the given widths
+    //
+    static const struct {
+        const char  *Name;
+        UINT8       Type;
+        UINT8       SubType;
+        UINT8       Widths[DEVICE_PATH_TEXT_MAX_ARGUMENTS];
+    } Integers[] = {
+        { "Pci", EFI_DEVICE_PATH_HARDWARE, EFI_DEVICE_PATH_HARDWARE_PCI, { 1, 1 } },
+        { "PcCard", EFI_DEVICE_PATH_HARDWARE, EFI_DEVICE_PATH_HARDWARE_PCCARD, { 1 } },
+        { "MemoryMapped", EFI_DEVICE_PATH_HARDWARE, EFI_DEVICE_PATH_HARDWARE_MEMORY_MAPPED, { 4, 8, 8 } },
+        { "Ctrl", EFI_DEVICE_PATH_HARDWARE, EFI_DEVICE_PATH_HARDWARE_CONTROLLER, { 4 } },
+        { "BMC", EFI_DEVICE_PATH_HARDWARE, EFI_DEVICE_PATH_HARDWARE_BMC, { 1, 8 } },
+        { "Scsi", EFI_DEVICE_PATH_MESSAGING, EFI_DEVICE_PATH_MESSAGING_SCSI, { 2, 2 } },
+        { "USB", EFI_DEVICE_PATH_MESSAGING, EFI_DEVICE_PATH_MESSAGING_USB, { 1, 1 } },
+        { "Usb", EFI_DEVICE_PATH_MESSAGING, EFI_DEVICE_PATH_MESSAGING_USB, { 1, 1 } },    // Printed by earlier versions
+        { "I2O", EFI_DEVICE_PATH_MESSAGING, EFI_DEVICE_PATH_MESSAGING_I2O, { 4 } },
+        { "UsbClass", EFI_DEVICE_PATH_MESSAGING, EFI_DEVICE_PATH_MESSAGING_USB_CLASS, { 2, 2, 1, 1, 1 } },
+        { "Unit", EFI_DEVICE_PATH_MESSAGING, EFI_DEVICE_PATH_MESSAGING_LOGICAL_UNIT, { 1 } },
+        { "Sata", EFI_DEVICE_PATH_MESSAGING, EFI_DEVICE_PATH_MESSAGING_SATA, { 2, 2, 2 } },
+        { "Vlan", EFI_DEVICE_PATH_MESSAGING, EFI_DEVICE_PATH_MESSAGING_VLAN, { 2 } },
+        { "UFS", EFI_DEVICE_PATH_MESSAGING, EFI_DEVICE_PATH_MESSAGING_UFS, { 1, 1 } },
+        { "SD", EFI_DEVICE_PATH_MESSAGING, EFI_DEVICE_PATH_MESSAGING_SD, { 1 } },
+        { "eMMC", EFI_DEVICE_PATH_MESSAGING, EFI_DEVICE_PATH_MESSAGING_EMMC, { 1 } },
+        { "CDROM", EFI_DEVICE_PATH_MEDIA, EFI_DEVICE_PATH_MEDIA_CD_ROM, { 4, 8, 8 } },
+        { "Offset", EFI_DEVICE_PATH_MEDIA, EFI_DEVICE_PATH_MEDIA_RELATIVE_OFFSET_RANGE, { 8, 8 } },
+    };
+    for (UINTN Index = 0; Index < sizeof(Integers) / sizeof(Integers[0]); Index++) {
+        if (!SpanIs(Name, Integers[Index].Name)) {
+            continue;
+        }
+
+        //
+        // Offset() carries a reserved zero before its two arguments
+        //
+        BOOLEAN Reserved = Integers[Index].Type == EFI_DEVICE_PATH_MEDIA && Integers[Index].SubType == EFI_DEVICE_PATH_MEDIA_RELATIVE_OFFSET_RANGE;
+        const UINT8 *Widths = Integers[Index].Widths;
+        UINTN Expected = 0;
+        while (Expected < DEVICE_PATH_TEXT_MAX_ARGUMENTS && Widths[Expected] != 0) {
+            Expected++;
+        }
+        if (Count != Expected) {
+            return EFI_INVALID_PARAMETER;
+        }
+        for (UINTN Argument = 0; Argument < Count; Argument++) {
+            UINT64 Maximum = Widths[Argument] == 8 ? ~(UINT64)0 : ((UINT64)1 << (Widths[Argument] * 8)) - 1;
+            if (!ParseNumber(Arguments[Argument], Maximum, &Value[Argument])) {
+                return EFI_INVALID_PARAMETER;
+            }
+        }
+
+        //
+        // Pci(Device,Function) stores Function first
+        //
+        if (Integers[Index].Type == EFI_DEVICE_PATH_HARDWARE && Integers[Index].SubType == EFI_DEVICE_PATH_HARDWARE_PCI) {
+            UINT64 Device = Value[0];
+            Value[0] = Value[1];
+            Value[1] = Device;
+        }
+
+        Start = BinaryBeginNode(Binary, Integers[Index].Type, Integers[Index].SubType);
+        if (Reserved) {
+            BinaryPut32(Binary, 0);
+        }
+        for (UINTN Argument = 0; Argument < Count; Argument++) {
+            BinaryPut(Binary, &Value[Argument], Widths[Argument]);
+        }
+        return BinaryEndNode(Binary, Start);
+    }
+
+    if (SpanIs(Name, "AcpiAdr")) {
+        if (Count == 0) {
+            return EFI_INVALID_PARAMETER;
+        }
+        Start = BinaryBeginNode(Binary, EFI_DEVICE_PATH_ACPI, EFI_DEVICE_PATH_ACPI_ADR);
+        for (UINTN Argument = 0; Argument < Count; Argument++) {
+            if (!ParseNumber(Arguments[Argument], 0xFFFFFFFF, &Value[Argument])) {
+                return EFI_INVALID_PARAMETER;
+            }
+            BinaryPut32(Binary, Value[Argument]);
+        }
+        return BinaryEndNode(Binary, Start);
+    }
+
+    return EFI_INVALID_PARAMETER;
+}
+
+/**
+ * Parses one node, either Name(Arguments) or a bare file path
+ */
+template <typename CHAR>
+static EFI_STATUS ParseSegment (
+    IN DEVICE_PATH_SPAN<CHAR>   Segment,
+    IN OUT DEVICE_PATH_BINARY   *Binary
+) {
+    UINTN Open = 0;
+    while (Open < Segment.Length && Segment.Start[Open] != '(') {
+        if (Segment.Start[Open] == ')') {
+            return EFI_INVALID_PARAMETER;
+        }
+        Open++;
+    }
+    if (Open == Segment.Length) {
+        return ParseFilePath(Segment, Binary);
+    }
+    if (Open == 0 || Segment.Start[Segment.Length - 1] != ')') {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    DEVICE_PATH_SPAN<CHAR> Name = { Segment.Start, Open };
+    DEVICE_PATH_SPAN<CHAR> Raw = { Segment.Start + Open + 1, Segment.Length - Open - 2 };
+    DEVICE_PATH_SPAN<CHAR> Arguments[DEVICE_PATH_TEXT_MAX_ARGUMENTS];
+    UINTN Count = 0;
+    BOOLEAN Split = !SpanIs(Name, "Uri");
+    if (Raw.Length != 0) {
+        Arguments[0].Start = Raw.Start;
+        Arguments[0].Length = 0;
+        Count = 1;
+        for (UINTN Index = 0; Index < Raw.Length; Index++) {
+            UINT32 Character = Raw.Start[Index];
+            if (Character == '(' || Character == ')') {
+                return EFI_INVALID_PARAMETER;
+            }
+            if (Character == ',' && Split) {
+                if (Count == DEVICE_PATH_TEXT_MAX_ARGUMENTS) {
+                    return EFI_INVALID_PARAMETER;
+                }
+                Arguments[Count].Start = Raw.Start + Index + 1;
+                Arguments[Count].Length = 0;
+                Count++;
+            } else {
+                Arguments[Count - 1].Length++;
+            }
+        }
+    }
+    return ParseNode(Name, Raw, Arguments, Count, Binary);
+}
+
+template <typename CHAR>
+static EFI_STATUS TextToDevicePathWorker (
+    IN const CHAR                   *Text,
+    OUT EFI_DEVICE_PATH_PROTOCOL    *Buffer OPTIONAL,
+    IN OUT UINTN                    *BufferSize
+) {
+    if (Text == NULL || BufferSize == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    DEVICE_PATH_BINARY Binary;
+    Binary.Buffer = (UINT8 *)Buffer;
+    Binary.Capacity = Buffer != NULL ? *BufferSize : 0;
+    Binary.Length = 0;
+
+    //
+    // Nodes are separated by '/' and instances by ',', both only outside parentheses.
+    // An instance may be empty, a node between two separators may not.
+    //
+    const CHAR *Segment = Text;
+    UINTN Depth = 0;
+    UINT32 Previous = 0;
+    for (const CHAR *Position = Text;; Position++) {
+        UINT32 Character = *Position;
+        if (Character == '(') {
+            Depth++;
+            continue;
+        }
+        if (Character == ')') {
+            if (Depth == 0) {
+                return EFI_INVALID_PARAMETER;
+            }
+            Depth--;
+            continue;
+        }
+        if (Character != 0 && (Depth != 0 || (Character != '/' && Character != ','))) {
+            continue;
+        }
+        if (Character == 0 && Depth != 0) {
+            return EFI_INVALID_PARAMETER;
+        }
+
+        DEVICE_PATH_SPAN<CHAR> Span = { Segment, (UINTN)(Position - Segment) };
+        if (Span.Length != 0) {
+            EFI_STATUS Status = ParseSegment(Span, &Binary);
+            if (Status != EFI_SUCCESS) {
+                return Status;
+            }
+        } else if (Character == '/' || Previous == '/') {
+            return EFI_INVALID_PARAMETER;
+        }
+
+        if (Character == 0) {
+            break;
+        }
+        if (Character == ',') {
+            UINTN Start = BinaryBeginNode(&Binary, EFI_DEVICE_PATH_END, EFI_DEVICE_PATH_END_INSTANCE);
+            BinaryEndNode(&Binary, Start);
+        }
+        Previous = Character;
+        Segment = Position + 1;
+    }
+    UINTN Start = BinaryBeginNode(&Binary, EFI_DEVICE_PATH_END, EFI_DEVICE_PATH_END_ENTIRE);
+    BinaryEndNode(&Binary, Start);
+
+    if (Binary.Length > Binary.Capacity) {
+        *BufferSize = Binary.Length;
+        return EFI_BUFFER_TOO_SMALL;
+    }
+    *BufferSize = Binary.Length;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS TextToDevicePath (
+    IN const CHAR16                 *Text,
+    OUT EFI_DEVICE_PATH_PROTOCOL    *Buffer OPTIONAL,
+    IN OUT UINTN                    *BufferSize
+) {
+    return TextToDevicePathWorker(Text, Buffer, BufferSize);
+}
+
+EFI_STATUS Utf8ToDevicePath (
+    IN const CHAR8                  *Text,
+    OUT EFI_DEVICE_PATH_PROTOCOL    *Buffer OPTIONAL,
+    IN OUT UINTN                    *BufferSize
+) {
+    return TextToDevicePathWorker(Text, Buffer, BufferSize);
+}
@@ -0,0 +1,408 @@
+#include <efi/load_option.h>
+#include <efi/device_path.h>
+#include <efi/guid.h>
+
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Variable name prefixes of each EFI_LOAD_OPTION_TYPE, followed by four upper case
+ * hex digits: UEFI Specification 2.10 Section 3.1
+ */
+static const struct {
+    const char  *Prefix;
+    UINTN       Length;
+} mLoadOptionPrefixes[LoadOptionTypeMax] = {
+    { "Boot", 4 },
+    { "Driver", 6 },
+    { "SysPrep", 7 },
+    { "PlatformRecovery", 16 },
+};
+
+/**
+ * Variable name buffer to start the walk with, in CHAR16
+ */
+#define LOAD_OPTION_NAME_LENGTH 32
+
+/**
+ * Option data buffer to start the walk with, in bytes
+ */
+#define LOAD_OPTION_DATA_SIZE 0x1000
+
+/**
+ * An option read by GetLoadOptions, before its data has found its final place
+ */
+typedef struct {
+    EFI_LOAD_OPTION_TYPE    Type;
+    UINT16                  OptionNumber;
+    UINTN                   Offset;
+    UINTN                   Size;
+} LOAD_OPTION_RECORD;
+
+/**
+ * Returns TRUE when List is whole device path nodes filling exactly Length bytes,
+ * the last of them an end-entire node
+ */
+static BOOLEAN LoadOptionIsFilePathList (
+    IN const UINT8  *List,
+    IN UINTN        Length
+) {
+    UINTN Offset = 0;
+    BOOLEAN End = FALSE;
+    while (Offset < Length) {
+        if (Length - Offset < sizeof(EFI_DEVICE_PATH_PROTOCOL)) {
+            return FALSE;
+        }
+        const EFI_DEVICE_PATH_PROTOCOL *Node = (const EFI_DEVICE_PATH_PROTOCOL *)(List + Offset);
+        UINTN NodeLength = DevicePathNodeLength(Node);
+        if (NodeLength < sizeof(EFI_DEVICE_PATH_PROTOCOL) || NodeLength > Length - Offset) {
+            return FALSE;
+        }
+        End = IsDevicePathEnd(Node);
+        Offset += NodeLength;
+    }
+    return End;
+}
+
+EFI_STATUS ParseLoadOption (
+    IN VOID                         *Buffer,
+    IN UINTN                        Size,
+    OUT EFI_EXPANDED_LOAD_OPTION    *Expanded
+) {
+    if (Buffer == NULL || Expanded == NULL || Size < sizeof(EFI_LOAD_OPTION)) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    UINT8 *Bytes = (UINT8 *)Buffer;
+    UINT16 FilePathListLength;
+    memcpy(&FilePathListLength, Bytes + offsetof(EFI_LOAD_OPTION, FilePathListLength), sizeof(FilePathListLength));
+
+    UINTN Offset = sizeof(EFI_LOAD_OPTION);
+    for (;;) {
+        if (Size - Offset < sizeof(CHAR16)) {
+            return EFI_INVALID_PARAMETER;
+        }
+        UINT16 Unit;
+        memcpy(&Unit, Bytes + Offset, sizeof(Unit));
+        Offset += sizeof(CHAR16);
+        if (Unit == CHAR_NULL) {
+            break;
+        }
+    }
+    UINTN DescriptionLength = Offset - sizeof(EFI_LOAD_OPTION);
+
+    if (FilePathListLength > Size - Offset || !LoadOptionIsFilePathList(Bytes + Offset, FilePathListLength)) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    Expanded->LoadOptionLength = Size;
+    Expanded->DescriptionLength = DescriptionLength;
+    Expanded->FilePathLength = FilePathListLength;
+    Expanded->OptionalDataLength = Size - Offset - FilePathListLength;
+    Expanded->LoadOption = (EFI_LOAD_OPTION *)Bytes;
+    Expanded->Description = (CHAR16 *)(Bytes + sizeof(EFI_LOAD_OPTION));
+    Expanded->FilePath = (EFI_DEVICE_PATH_PROTOCOL *)(Bytes + Offset);
+    Expanded->OptionalData = Expanded->OptionalDataLength != 0 ? Bytes + Offset + FilePathListLength : NULL;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS SerializeLoadOption (
+    IN UINT32                           Attributes,
+    IN const EFI_EXPANDED_LOAD_OPTION   *Expanded,
+    OUT VOID                            *Buffer OPTIONAL,
+    IN OUT UINTN                        *BufferSize
+) {
+    if (Expanded == NULL || BufferSize == NULL || Expanded->Description == NULL || Expanded->FilePath == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (Expanded->OptionalDataLength != 0 && Expanded->OptionalData == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    //
+    // The result must parse back to the same fields: exactly one terminator, at the end
+    //
+    UINTN DescriptionLength = Expanded->DescriptionLength;
+    if (DescriptionLength < sizeof(CHAR16) || DescriptionLength % sizeof(CHAR16) != 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+    const UINT8 *Description = (const UINT8 *)Expanded->Description;
+    for (UINTN Offset = 0; Offset < DescriptionLength; Offset += sizeof(CHAR16)) {
+        UINT16 Unit;
+        memcpy(&Unit, Description + Offset, sizeof(Unit));
+        if ((Unit == CHAR_NULL) != (Offset + sizeof(CHAR16) == DescriptionLength)) {
+            return EFI_INVALID_PARAMETER;
+        }
+    }
+    if (Expanded->FilePathLength > 0xFFFF || !LoadOptionIsFilePathList((const UINT8 *)Expanded->FilePath, Expanded->FilePathLength)) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    UINTN Size = sizeof(EFI_LOAD_OPTION) + DescriptionLength + Expanded->FilePathLength + Expanded->OptionalDataLength;
+    if (Buffer == NULL || *BufferSize < Size) {
+        *BufferSize = Size;
+        return EFI_BUFFER_TOO_SMALL;
+    }
+
+    UINT8 *Bytes = (UINT8 *)Buffer;
+    UINT16 FilePathListLength = (UINT16)Expanded->FilePathLength;
+    memcpy(Bytes + offsetof(EFI_LOAD_OPTION, Attributes), &Attributes, sizeof(Attributes));
+    memcpy(Bytes + offsetof(EFI_LOAD_OPTION, FilePathListLength), &FilePathListLength, sizeof(FilePathListLength));
+    Bytes += sizeof(EFI_LOAD_OPTION);
+    memcpy(Bytes, Description, DescriptionLength);
+    Bytes += DescriptionLength;
+    memcpy(Bytes, Expanded->FilePath, Expanded->FilePathLength);
+    Bytes += Expanded->FilePathLength;
+    if (Expanded->OptionalDataLength != 0) {
+        memcpy(Bytes, Expanded->OptionalData, Expanded->OptionalDataLength);
+    }
+    *BufferSize = Size;
+    return EFI_SUCCESS;
+}
+
+/**
+ * Recognises the load option variable names, returning FALSE for any other name
+ */
+static BOOLEAN LoadOptionMatchName (
+    IN const CHAR16             *Name,
+    IN UINT32                   TypeMask,
+    OUT EFI_LOAD_OPTION_TYPE    *Type,
+    OUT UINT16                  *OptionNumber
+) {
+    for (UINTN Index = 0; Index < LoadOptionTypeMax; Index++) {
+        if ((TypeMask & LOAD_OPTION_TYPE_MASK(Index)) == 0) {
+            continue;
+        }
+        const char *Prefix = mLoadOptionPrefixes[Index].Prefix;
+        UINTN Length = mLoadOptionPrefixes[Index].Length;
+        UINTN Position = 0;
+        while (Position < Length && Name[Position] == (CHAR16)Prefix[Position]) {
+            Position++;
+        }
+        if (Position != Length) {
+            continue;
+        }
+
+        UINT16 Number = 0;
+        for (UINTN Digit = 0; Digit < 4; Digit++) {
+            CHAR16 Character = Name[Length + Digit];
+            if (Character >= '0' && Character <= '9') {
+                Number = (UINT16)((Number << 4) | (Character - '0'));
+            } else if (Character >= 'A' && Character <= 'F') {
+                Number = (UINT16)((Number << 4) | (Character - 'A' + 10));
+            } else {
+                return FALSE;
+            }
+        }
+        if (Name[Length + 4] != CHAR_NULL) {
+            return FALSE;
+        }
+        *Type = (EFI_LOAD_OPTION_TYPE)Index;
+        *OptionNumber = Number;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/**
+ * Replaces *Buffer with a pool buffer of at least Needed bytes holding its first
+ * Used bytes
+ */
+static EFI_STATUS LoadOptionGrow (
+    IN EFI_BOOT_SERVICES    *BootServices,
+    IN OUT VOID             **Buffer,
+    IN UINTN                Used,
+    IN OUT UINTN            *Capacity,
+    IN UINTN                Needed
+) {
+    UINTN NewCapacity = *Capacity * 2;
+    if (NewCapacity < Needed) {
+        NewCapacity = Needed;
+    }
+    VOID *NewBuffer;
+    EFI_STATUS Status = BootServices->AllocatePool(EfiBootServicesData, NewCapacity, &NewBuffer);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    if (*Buffer != NULL) {
+        memcpy(NewBuffer, *Buffer, Used);
+        BootServices->FreePool(*Buffer);
+    }
+    *Buffer = NewBuffer;
+    *Capacity = NewCapacity;
+    return EFI_SUCCESS;
+}
+
+/**
+ * State of one GetLoadOptions walk, released by its caller whatever the outcome
+ */
+typedef struct {
+    CHAR16              *Name;
+    UINTN               NameCapacity;
+    UINT8               *Data;
+    UINTN               DataCapacity;
+    UINTN               DataUsed;
+    LOAD_OPTION_RECORD  *Records;
+    UINTN               RecordCapacity;
+    UINTN               RecordCount;
+} LOAD_OPTION_WALK;
+
+/**
+ * Walks the variable names once, reading each matching option straight after its name
+ */
+static EFI_STATUS LoadOptionWalk (
+    IN EFI_BOOT_SERVICES        *BootServices,
+    IN EFI_RUNTIME_SERVICES     *RuntimeServices,
+    IN UINT32                   TypeMask,
+    IN OUT LOAD_OPTION_WALK     *Walk
+) {
+    EFI_STATUS Status = LoadOptionGrow(BootServices, (VOID **)&Walk->Name, 0, &Walk->NameCapacity, LOAD_OPTION_NAME_LENGTH * sizeof(CHAR16));
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    Status = LoadOptionGrow(BootServices, (VOID **)&Walk->Data, 0, &Walk->DataCapacity, LOAD_OPTION_DATA_SIZE);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+
+    Walk->Name[0] = CHAR_NULL;
+    EFI_GUID VendorGuid;
+    memset(&VendorGuid, 0, sizeof(VendorGuid));
+    for (;;) {
+        UINTN NameSize = Walk->NameCapacity;
+        Status = RuntimeServices->GetNextVariableName(&NameSize, Walk->Name, &VendorGuid);
+        if (Status == EFI_BUFFER_TOO_SMALL) {
+            Status = LoadOptionGrow(BootServices, (VOID **)&Walk->Name, Walk->NameCapacity, &Walk->NameCapacity, NameSize);
+            if (Status != EFI_SUCCESS) {
+                return Status;
+            }
+            continue;
+        }
+        if (Status == EFI_NOT_FOUND) {
+            return EFI_SUCCESS;
+        }
+        if (Status != EFI_SUCCESS) {
+            return Status;
+        }
+
+        EFI_LOAD_OPTION_TYPE Type;
+        UINT16 OptionNumber;
+        if (!CompareGuid(&VendorGuid, &EFI_GLOBAL_VARIABLE_GUID) || !LoadOptionMatchName(Walk->Name, TypeMask, &Type, &OptionNumber)) {
+            continue;
+        }
+
+        UINTN DataSize;
+        for (;;) {
+            DataSize = Walk->DataCapacity - Walk->DataUsed;
+            Status = RuntimeServices->GetVariable(Walk->Name, &VendorGuid, NULL, &DataSize, Walk->Data + Walk->DataUsed);
+            if (Status != EFI_BUFFER_TOO_SMALL) {
+                break;
+            }
+            Status = LoadOptionGrow(BootServices, (VOID **)&Walk->Data, Walk->DataUsed, &Walk->DataCapacity, Walk->DataUsed + DataSize);
+            if (Status != EFI_SUCCESS) {
+                return Status;
+            }
+        }
+        if (Status != EFI_SUCCESS) {
+            return Status;
+        }
+
+        if (Walk->RecordCount == Walk->RecordCapacity / sizeof(LOAD_OPTION_RECORD)) {
+            Status = LoadOptionGrow(BootServices, (VOID **)&Walk->Records, Walk->RecordCount * sizeof(LOAD_OPTION_RECORD), &Walk->RecordCapacity, 16 * sizeof(LOAD_OPTION_RECORD));
+            if (Status != EFI_SUCCESS) {
+                return Status;
+            }
+        }
+
+        //
+        // Names arrive sorted within a type, so the insertion point is nearly always the end
+        //
+        UINTN Index = Walk->RecordCount++;
+        while (Index != 0 && (Walk->Records[Index - 1].Type > Type || (Walk->Records[Index - 1].Type == Type && Walk->Records[Index - 1].OptionNumber > OptionNumber))) {
+            Walk->Records[Index] = Walk->Records[Index - 1];
+            Index--;
+        }
+        Walk->Records[Index].Type = Type;
+        Walk->Records[Index].OptionNumber = OptionNumber;
+        Walk->Records[Index].Offset = Walk->DataUsed;
+        Walk->Records[Index].Size = DataSize;
+        Walk->DataUsed += DataSize;
+    }
+}
+
+/**
+ * Copies the options read by a walk into one allocation and parses them in place
+ */
+static EFI_STATUS LoadOptionBuildEntries (
+    IN EFI_BOOT_SERVICES        *BootServices,
+    IN EFI_MEMORY_TYPE          PoolType,
+    IN const LOAD_OPTION_WALK   *Walk,
+    OUT EFI_LOAD_OPTION_ENTRY   **Entries,
+    OUT UINTN                   *EntryCount
+) {
+    if (Walk->RecordCount == 0) {
+        return EFI_SUCCESS;
+    }
+
+    UINTN EntriesSize = Walk->RecordCount * sizeof(EFI_LOAD_OPTION_ENTRY);
+    EFI_LOAD_OPTION_ENTRY *Result;
+    EFI_STATUS Status = BootServices->AllocatePool(PoolType, EntriesSize + Walk->DataUsed, (VOID **)&Result);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+    UINT8 *Data = (UINT8 *)Result + EntriesSize;
+    memcpy(Data, Walk->Data, Walk->DataUsed);
+
+    UINTN Count = 0;
+    for (UINTN Index = 0; Index < Walk->RecordCount; Index++) {
+        const LOAD_OPTION_RECORD *Record = &Walk->Records[Index];
+        EFI_LOAD_OPTION_ENTRY *Entry = &Result[Count];
+        if (ParseLoadOption(Data + Record->Offset, Record->Size, &Entry->Option) != EFI_SUCCESS) {
+            continue;
+        }
+        Entry->Type = Record->Type;
+        Entry->OptionNumber = Record->OptionNumber;
+        memcpy(&Entry->Attributes, Data + Record->Offset + offsetof(EFI_LOAD_OPTION, Attributes), sizeof(Entry->Attributes));
+        Count++;
+    }
+    if (Count == 0) {
+        BootServices->FreePool(Result);
+        return EFI_SUCCESS;
+    }
+    *Entries = Result;
+    *EntryCount = Count;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS GetLoadOptions (
+    IN EFI_BOOT_SERVICES        *BootServices,
+    IN EFI_RUNTIME_SERVICES     *RuntimeServices,
+    IN EFI_MEMORY_TYPE          PoolType,
+    IN UINT32                   TypeMask,
+    OUT EFI_LOAD_OPTION_ENTRY   **Entries,
+    OUT UINTN                   *EntryCount
+) {
+    if (BootServices == NULL || RuntimeServices == NULL || Entries == NULL || EntryCount == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    *Entries = NULL;
+    *EntryCount = 0;
+
+    LOAD_OPTION_WALK Walk;
+    memset(&Walk, 0, sizeof(Walk));
+    EFI_STATUS Status = LoadOptionWalk(BootServices, RuntimeServices, TypeMask, &Walk);
+    if (Status == EFI_SUCCESS) {
+        Status = LoadOptionBuildEntries(BootServices, PoolType, &Walk, Entries, EntryCount);
+    }
+
+    if (Walk.Records != NULL) {
+        BootServices->FreePool(Walk.Records);
+    }
+    if (Walk.Data != NULL) {
+        BootServices->FreePool(Walk.Data);
+    }
+    if (Walk.Name != NULL) {
+        BootServices->FreePool(Walk.Name);
+    }
+    return Status;
+}
@@ -0,0 +1,460 @@
+#include <efi/mem.h>
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+/**
+ * Vector types for the kernels. Loads and stores go through memcpy, which compiles
+ * to a single unaligned move of the vector's width in the kernel's target.
+ */
+typedef UINT8 MEM_VECTOR_128 __attribute__((vector_size(16)));
+typedef UINT8 MEM_VECTOR_256 __attribute__((vector_size(32)));
+typedef UINT8 MEM_VECTOR_512 __attribute__((vector_size(64)));
+
+typedef VOID (*MEM_COPY_KERNEL) (
+    OUT UINT8       *Destination,
+    IN const UINT8  *Source,
+    IN UINTN        Length
+);
+
+typedef VOID (*MEM_SET_KERNEL) (
+    OUT UINT8   *Buffer,
+    IN UINTN    Size,
+    IN UINT8    Value
+);
+
+/**
+ * Copies up to 16 bytes with overlapping head and tail moves. Both are loaded
+ * before either is stored, so overlapping buffers are handled.
+ */
+static inline __attribute__((always_inline)) VOID MemCopySmall (
+    OUT UINT8       *Destination,
+    IN const UINT8  *Source,
+    IN UINTN        Length
+) {
+    if (Length >= 8) {
+        UINT64 Head;
+        UINT64 Tail;
+        memcpy(&Head, Source, sizeof(Head));
+        memcpy(&Tail, Source + Length - sizeof(Tail), sizeof(Tail));
+        memcpy(Destination, &Head, sizeof(Head));
+        memcpy(Destination + Length - sizeof(Tail), &Tail, sizeof(Tail));
+    } else if (Length >= 4) {
+        UINT32 Head;
+        UINT32 Tail;
+        memcpy(&Head, Source, sizeof(Head));
+        memcpy(&Tail, Source + Length - sizeof(Tail), sizeof(Tail));
+        memcpy(Destination, &Head, sizeof(Head));
+        memcpy(Destination + Length - sizeof(Tail), &Tail, sizeof(Tail));
+    } else if (Length >= 2) {
+        UINT16 Head;
+        UINT16 Tail;
+        memcpy(&Head, Source, sizeof(Head));
+        memcpy(&Tail, Source + Length - sizeof(Tail), sizeof(Tail));
+        memcpy(Destination, &Head, sizeof(Head));
+        memcpy(Destination + Length - sizeof(Tail), &Tail, sizeof(Tail));
+    } else if (Length == 1) {
+        *Destination = *Source;
+    }
+}
+
+static inline __attribute__((always_inline)) VOID MemSetSmall (
+    OUT UINT8   *Buffer,
+    IN UINTN    Size,
+    IN UINT8    Value
+) {
+    UINT64 Pattern = Value * 0x0101010101010101ULL;
+    if (Size >= 8) {
+        memcpy(Buffer, &Pattern, sizeof(UINT64));
+        memcpy(Buffer + Size - sizeof(UINT64), &Pattern, sizeof(UINT64));
+    } else if (Size >= 4) {
+        memcpy(Buffer, &Pattern, sizeof(UINT32));
+        memcpy(Buffer + Size - sizeof(UINT32), &Pattern, sizeof(UINT32));
+    } else if (Size >= 2) {
+        memcpy(Buffer, &Pattern, sizeof(UINT16));
+        memcpy(Buffer + Size - sizeof(UINT16), &Pattern, sizeof(UINT16));
+    } else if (Size == 1) {
+        *Buffer = Value;
+    }
+}
+
+/**
+ * Copies fewer than two vectors of VECTOR by halving the width until the head and
+ * tail moves cover Length
+ */
+template <typename VECTOR>
+static inline __attribute__((always_inline)) VOID MemCopyShort (
+    OUT UINT8       *Destination,
+    IN const UINT8  *Source,
+    IN UINTN        Length
+) {
+    if (Length >= sizeof(VECTOR)) {
+        VECTOR Head;
+        VECTOR Tail;
+        memcpy(&Head, Source, sizeof(Head));
+        memcpy(&Tail, Source + Length - sizeof(Tail), sizeof(Tail));
+        memcpy(Destination, &Head, sizeof(Head));
+        memcpy(Destination + Length - sizeof(Tail), &Tail, sizeof(Tail));
+    } else if constexpr (sizeof(VECTOR) == 64) {
+        MemCopyShort<MEM_VECTOR_256>(Destination, Source, Length);
+    } else if constexpr (sizeof(VECTOR) == 32) {
+        MemCopyShort<MEM_VECTOR_128>(Destination, Source, Length);
+    } else {
+        MemCopySmall(Destination, Source, Length);
+    }
+}
+
+template <typename VECTOR>
+static inline __attribute__((always_inline)) VOID MemSetShort (
+    OUT UINT8   *Buffer,
+    IN UINTN    Size,
+    IN UINT8    Value
+) {
+    if (Size >= sizeof(VECTOR)) {
+        VECTOR Fill = (VECTOR){} + Value;
+        memcpy(Buffer, &Fill, sizeof(Fill));
+        memcpy(Buffer + Size - sizeof(Fill), &Fill, sizeof(Fill));
+    } else if constexpr (sizeof(VECTOR) == 64) {
+        MemSetShort<MEM_VECTOR_256>(Buffer, Size, Value);
+    } else if constexpr (sizeof(VECTOR) == 32) {
+        MemSetShort<MEM_VECTOR_128>(Buffer, Size, Value);
+    } else {
+        MemSetSmall(Buffer, Size, Value);
+    }
+}
+
+/**
+ * Moves four vectors, loading all of them before storing any
+ */
+template <typename VECTOR>
+static inline __attribute__((always_inline)) VOID MemMoveBlocks (
+    OUT UINT8       *Destination,
+    IN const UINT8  *Source
+) {
+    VECTOR Block0;
+    VECTOR Block1;
+    VECTOR Block2;
+    VECTOR Block3;
+    memcpy(&Block0, Source, sizeof(VECTOR));
+    memcpy(&Block1, Source + sizeof(VECTOR), sizeof(VECTOR));
+    memcpy(&Block2, Source + 2 * sizeof(VECTOR), sizeof(VECTOR));
+    memcpy(&Block3, Source + 3 * sizeof(VECTOR), sizeof(VECTOR));
+    memcpy(Destination, &Block0, sizeof(VECTOR));
+    memcpy(Destination + sizeof(VECTOR), &Block1, sizeof(VECTOR));
+    memcpy(Destination + 2 * sizeof(VECTOR), &Block2, sizeof(VECTOR));
+    memcpy(Destination + 3 * sizeof(VECTOR), &Block3, sizeof(VECTOR));
+}
+
+/**
+ * Copies more than two and up to eight vectors as overlapping runs from the start
+ * and the end, all loaded before any is stored
+ */
+template <typename VECTOR>
+static inline __attribute__((always_inline)) VOID MemCopyMedium (
+    OUT UINT8       *Destination,
+    IN const UINT8  *Source,
+    IN UINTN        Length
+) {
+    const UINTN Width = sizeof(VECTOR);
+    VECTOR Head0;
+    VECTOR Head1;
+    VECTOR Tail0;
+    VECTOR Tail1;
+    memcpy(&Head0, Source, Width);
+    memcpy(&Head1, Source + Width, Width);
+    memcpy(&Tail0, Source + Length - 2 * Width, Width);
+    memcpy(&Tail1, Source + Length - Width, Width);
+    if (Length <= 4 * Width) {
+        memcpy(Destination, &Head0, Width);
+        memcpy(Destination + Width, &Head1, Width);
+        memcpy(Destination + Length - 2 * Width, &Tail0, Width);
+        memcpy(Destination + Length - Width, &Tail1, Width);
+        return;
+    }
+
+    VECTOR Head2;
+    VECTOR Head3;
+    VECTOR Tail2;
+    VECTOR Tail3;
+    memcpy(&Head2, Source + 2 * Width, Width);
+    memcpy(&Head3, Source + 3 * Width, Width);
+    memcpy(&Tail2, Source + Length - 4 * Width, Width);
+    memcpy(&Tail3, Source + Length - 3 * Width, Width);
+    memcpy(Destination, &Head0, Width);
+    memcpy(Destination + Width, &Head1, Width);
+    memcpy(Destination + 2 * Width, &Head2, Width);
+    memcpy(Destination + 3 * Width, &Head3, Width);
+    memcpy(Destination + Length - 4 * Width, &Tail2, Width);
+    memcpy(Destination + Length - 3 * Width, &Tail3, Width);
+    memcpy(Destination + Length - 2 * Width, &Tail0, Width);
+    memcpy(Destination + Length - Width, &Tail1, Width);
+}
+
+/**
+ * Copies with aligned vector stores between an unaligned head and tail, which are
+ * loaded up front. The loop runs forwards unless Destination overlaps the end of
+ * Source, in which case it runs backwards.
+ */
+template <typename VECTOR>
+static inline __attribute__((always_inline)) VOID MemCopyVector (
+    OUT UINT8       *Destination,
+    IN const UINT8  *Source,
+    IN UINTN        Length
+) {
+    const UINTN Width = sizeof(VECTOR);
+    if (Length <= 2 * Width) {
+        MemCopyShort<VECTOR>(Destination, Source, Length);
+        return;
+    }
+    if (Length <= 8 * Width) {
+        MemCopyMedium<VECTOR>(Destination, Source, Length);
+        return;
+    }
+    if (Destination == Source) {
+        return;
+    }
+
+    VECTOR Head;
+    VECTOR Tail;
+    VECTOR Block;
+    memcpy(&Head, Source, Width);
+    memcpy(&Tail, Source + Length - Width, Width);
+
+    if (Destination < Source || Destination >= Source + Length) {
+        UINTN Skip = Width - ((UINTN)Destination & (Width - 1));
+        UINT8 *Target = Destination + Skip;
+        const UINT8 *From = Source + Skip;
+        UINTN Remaining = Length - Skip;
+        while (Remaining > 4 * Width) {
+            MemMoveBlocks<VECTOR>(Target, From);
+            Target += 4 * Width;
+            From += 4 * Width;
+            Remaining -= 4 * Width;
+        }
+        while (Remaining > Width) {
+            memcpy(&Block, From, Width);
+            memcpy(Target, &Block, Width);
+            Target += Width;
+            From += Width;
+            Remaining -= Width;
+        }
+    } else {
+        UINTN Skip = (UINTN)(Destination + Length) & (Width - 1);
+        if (Skip == 0) {
+            Skip = Width;
+        }
+        UINT8 *Target = Destination + Length - Skip;
+        const UINT8 *From = Source + Length - Skip;
+        UINTN Remaining = Length - Skip;
+        while (Remaining > 4 * Width) {
+            Target -= 4 * Width;
+            From -= 4 * Width;
+            MemMoveBlocks<VECTOR>(Target, From);
+            Remaining -= 4 * Width;
+        }
+        while (Remaining > Width) {
+            Target -= Width;
+            From -= Width;
+            memcpy(&Block, From, Width);
+            memcpy(Target, &Block, Width);
+            Remaining -= Width;
+        }
+    }
+
+    memcpy(Destination + Length - Width, &Tail, Width);
+    memcpy(Destination, &Head, Width);
+}
+
+template <typename VECTOR>
+static inline __attribute__((always_inline)) VOID MemSetVector (
+    OUT UINT8   *Buffer,
+    IN UINTN    Size,
+    IN UINT8    Value
+) {
+    const UINTN Width = sizeof(VECTOR);
+    if (Size <= 2 * Width) {
+        MemSetShort<VECTOR>(Buffer, Size, Value);
+        return;
+    }
+
+    VECTOR Fill = (VECTOR){} + Value;
+    memcpy(Buffer, &Fill, Width);
+    memcpy(Buffer + Size - Width, &Fill, Width);
+
+    UINT8 *Target = Buffer + Width - ((UINTN)Buffer & (Width - 1));
+    UINT8 *End = Buffer + Size - Width;
+    while (Target + 4 * Width <= End) {
+        memcpy(Target, &Fill, Width);
+        memcpy(Target + Width, &Fill, Width);
+        memcpy(Target + 2 * Width, &Fill, Width);
+        memcpy(Target + 3 * Width, &Fill, Width);
+        Target += 4 * Width;
+    }
+    while (Target < End) {
+        memcpy(Target, &Fill, Width);
+        Target += Width;
+    }
+}
+
+static VOID MemCopy128 (
+    OUT UINT8       *Destination,
+    IN const UINT8  *Source,
+    IN UINTN        Length
+) {
+    MemCopyVector<MEM_VECTOR_128>(Destination, Source, Length);
+}
+
+static VOID MemSet128 (
+    OUT UINT8   *Buffer,
+    IN UINTN    Size,
+    IN UINT8    Value
+) {
+    MemSetVector<MEM_VECTOR_128>(Buffer, Size, Value);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+static VOID MemCopy256 (
+    OUT UINT8       *Destination,
+    IN const UINT8  *Source,
+    IN UINTN        Length
+) {
+    MemCopyVector<MEM_VECTOR_256>(Destination, Source, Length);
+}
+
+__attribute__((target("avx2")))
+static VOID MemSet256 (
+    OUT UINT8   *Buffer,
+    IN UINTN    Size,
+    IN UINT8    Value
+) {
+    MemSetVector<MEM_VECTOR_256>(Buffer, Size, Value);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static VOID MemCopy512 (
+    OUT UINT8       *Destination,
+    IN const UINT8  *Source,
+    IN UINTN        Length
+) {
+    MemCopyVector<MEM_VECTOR_512>(Destination, Source, Length);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static VOID MemSet512 (
+    OUT UINT8   *Buffer,
+    IN UINTN    Size,
+    IN UINT8    Value
+) {
+    MemSetVector<MEM_VECTOR_512>(Buffer, Size, Value);
+}
+#endif
+
+static VOID MemCopyResolve (
+    OUT UINT8       *Destination,
+    IN const UINT8  *Source,
+    IN UINTN        Length
+);
+
+static VOID MemSetResolve (
+    OUT UINT8   *Buffer,
+    IN UINTN    Size,
+    IN UINT8    Value
+);
+
+/**
+ * The kernels start out as resolvers that pick the real kernels on first use and
+ * patch themselves out, so later calls pay one indirect call and no guard
+ */
+static MEM_COPY_KERNEL  mCopyKernel = MemCopyResolve;
+static MEM_SET_KERNEL   mSetKernel = MemSetResolve;
+static UINTN            mRepThreshold = ~(UINTN)0;  // Smallest block handed to rep movsb / rep stosb
+
+static VOID MemSelectKernels (
+    VOID
+) {
+    MEM_COPY_KERNEL Copy = MemCopy128;
+    MEM_SET_KERNEL Set = MemSet128;
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        Copy = MemCopy512;
+        Set = MemSet512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        Copy = MemCopy256;
+        Set = MemSet256;
+    }
+
+    //
+    // Below a couple of KiB the vector loop wins even with fast short rep movsb;
+    // plain ERMS needs larger blocks still to amortise its startup cost
+    //
+    UINT32 Eax;
+    UINT32 Ebx;
+    UINT32 Ecx;
+    UINT32 Edx;
+    if (__get_cpuid_count(7, 0, &Eax, &Ebx, &Ecx, &Edx)) {
+        if ((Edx & (1 << 4)) != 0) {
+            mRepThreshold = 2048;
+        } else if ((Ebx & (1 << 9)) != 0) {
+            mRepThreshold = 4096;
+        }
+    }
+#endif
+    mCopyKernel = Copy;
+    mSetKernel = Set;
+}
+
+static VOID MemCopyResolve (
+    OUT UINT8       *Destination,
+    IN const UINT8  *Source,
+    IN UINTN        Length
+) {
+    MemSelectKernels();
+    mCopyKernel(Destination, Source, Length);
+}
+
+static VOID MemSetResolve (
+    OUT UINT8   *Buffer,
+    IN UINTN    Size,
+    IN UINT8    Value
+) {
+    MemSelectKernels();
+    mSetKernel(Buffer, Size, Value);
+}
+
+VOID CopyMem (
+    OUT VOID        *Destination,
+    IN const VOID   *Source,
+    IN UINTN        Length
+) {
+    UINT8 *Target = (UINT8 *)Destination;
+    const UINT8 *From = (const UINT8 *)Source;
+#if defined(__x86_64__) || defined(__i386__)
+    //
+    // rep movsb only runs forwards and slows down on overlap, so it is kept to disjoint buffers
+    //
+    if (Length >= mRepThreshold && (Target + Length <= From || From + Length <= Target)) {
+        __asm__ volatile ("rep movsb" : "+D" (Target), "+S" (From), "+c" (Length) : : "memory");
+        return;
+    }
+#endif
+    mCopyKernel(Target, From, Length);
+}
+
+VOID SetMem (
+    OUT VOID    *Buffer,
+    IN UINTN    Size,
+    IN UINT8    Value
+) {
+    UINT8 *Target = (UINT8 *)Buffer;
+#if defined(__x86_64__) || defined(__i386__)
+    if (Size >= mRepThreshold) {
+        __asm__ volatile ("rep stosb" : "+D" (Target), "+c" (Size) : "a" (Value) : "memory");
+        return;
+    }
+#endif
+    mSetKernel(Target, Size, Value);
+}
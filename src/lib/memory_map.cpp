@@ -0,0 +1,233 @@
+#include <efi/memory_map.h>
+
+#include <string.h>
+
+/**
+ * Exchanges two descriptors of any stride through a small bounce buffer
+ */
+static VOID MemoryMapSwap (
+    IN const EFI_MEMORY_MAP_VIEW    *View,
+    IN UINTN                        First,
+    IN UINTN                        Second
+) {
+    UINT8 *Left = (UINT8 *)MemoryMapViewAt(View, First);
+    UINT8 *Right = (UINT8 *)MemoryMapViewAt(View, Second);
+    UINT8 Bounce[64];
+    for (UINTN Offset = 0; Offset < View->DescriptorSize; Offset += sizeof(Bounce)) {
+        UINTN Chunk = View->DescriptorSize - Offset < sizeof(Bounce) ? View->DescriptorSize - Offset : sizeof(Bounce);
+        memcpy(Bounce, Left + Offset, Chunk);
+        memcpy(Left + Offset, Right + Offset, Chunk);
+        memcpy(Right + Offset, Bounce, Chunk);
+    }
+}
+
+static VOID MemoryMapSiftDown (
+    IN const EFI_MEMORY_MAP_VIEW    *View,
+    IN UINTN                        Root,
+    IN UINTN                        Count
+) {
+    for (;;) {
+        UINTN Largest = Root;
+        UINTN Child = 2 * Root + 1;
+        for (UINTN Index = Child; Index < Count && Index <= Child + 1; Index++) {
+            if (MemoryMapViewAt(View, Index)->PhysicalStart > MemoryMapViewAt(View, Largest)->PhysicalStart) {
+                Largest = Index;
+            }
+        }
+        if (Largest == Root) {
+            return;
+        }
+        MemoryMapSwap(View, Root, Largest);
+        Root = Largest;
+    }
+}
+
+EFI_STATUS MemoryMapViewInitialize (
+    OUT EFI_MEMORY_MAP_VIEW     *View,
+    IN EFI_MEMORY_DESCRIPTOR    *Map,
+    IN UINTN                    MapSize,
+    IN UINTN                    DescriptorSize,
+    IN UINT32                   DescriptorVersion
+) {
+    if (View == NULL || (Map == NULL && MapSize != 0)) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (DescriptorSize < sizeof(EFI_MEMORY_DESCRIPTOR) || MapSize % DescriptorSize != 0) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (DescriptorVersion != EFI_MEMORY_DESCRIPTOR_VERSION) {
+        return EFI_UNSUPPORTED;
+    }
+
+    View->Map = Map;
+    View->MapSize = MapSize;
+    View->DescriptorSize = DescriptorSize;
+    View->DescriptorVersion = DescriptorVersion;
+    return EFI_SUCCESS;
+}
+
+VOID MemoryMapSort (
+    IN OUT EFI_MEMORY_MAP_VIEW *View
+) {
+    UINTN Count = MemoryMapViewCount(View);
+    UINTN Index = 1;
+    while (Index < Count && MemoryMapViewAt(View, Index - 1)->PhysicalStart <= MemoryMapViewAt(View, Index)->PhysicalStart) {
+        Index++;
+    }
+    if (Index >= Count) {
+        return;
+    }
+
+    //
+    // Heapsort: in place and without allocating, since descriptors cannot be moved
+    // as fixed-size elements and the caller may already be past ExitBootServices
+    //
+    for (Index = Count / 2; Index > 0; Index--) {
+        MemoryMapSiftDown(View, Index - 1, Count);
+    }
+    for (Index = Count - 1; Index > 0; Index--) {
+        MemoryMapSwap(View, 0, Index);
+        MemoryMapSiftDown(View, 0, Index);
+    }
+}
+
+UINTN MemoryMapCoalesce (
+    IN OUT EFI_MEMORY_MAP_VIEW *View
+) {
+    UINTN Count = MemoryMapViewCount(View);
+    if (Count == 0) {
+        return 0;
+    }
+
+    UINTN Last = 0;
+    for (UINTN Index = 1; Index < Count; Index++) {
+        EFI_MEMORY_DESCRIPTOR *Previous = MemoryMapViewAt(View, Last);
+        EFI_MEMORY_DESCRIPTOR *Current = MemoryMapViewAt(View, Index);
+        if (Current->Type == Previous->Type && Current->Attribute == Previous->Attribute &&
+            Current->PhysicalStart == Previous->PhysicalStart + EFI_PAGES_TO_SIZE(Previous->NumberOfPages)) {
+            Previous->NumberOfPages += Current->NumberOfPages;
+            continue;
+        }
+        Last++;
+        if (Last != Index) {
+            memcpy(MemoryMapViewAt(View, Last), Current, View->DescriptorSize);
+        }
+    }
+
+    View->MapSize = (Last + 1) * View->DescriptorSize;
+    return Last + 1;
+}
+
+VOID MemoryMapTotalPages (
+    IN const EFI_MEMORY_MAP_VIEW    *View,
+    OUT UINT64                      Pages[EfiMaxMemoryType]
+) {
+    memset(Pages, 0, EfiMaxMemoryType * sizeof(UINT64));
+    UINTN Count = MemoryMapViewCount(View);
+    for (UINTN Index = 0; Index < Count; Index++) {
+        const EFI_MEMORY_DESCRIPTOR *Descriptor = MemoryMapViewAt(View, Index);
+        if (Descriptor->Type < EfiMaxMemoryType) {
+            Pages[Descriptor->Type] += Descriptor->NumberOfPages;
+        }
+    }
+}
+
+EFI_STATUS MemoryMapLargestFreeBlock (
+    IN const EFI_MEMORY_MAP_VIEW    *View,
+    IN EFI_PHYSICAL_ADDRESS         MaxAddress,
+    OUT EFI_PHYSICAL_ADDRESS        *Start,
+    OUT UINT64                      *Pages
+) {
+    if (View == NULL || Start == NULL || Pages == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    //
+    // Pages wholly at or below MaxAddress end at this page number, exclusive
+    //
+    UINT64 LimitPage = (MaxAddress >> EFI_PAGE_SHIFT) + ((MaxAddress & EFI_PAGE_MASK) == EFI_PAGE_MASK ? 1 : 0);
+    UINT64 BestPages = 0;
+    EFI_PHYSICAL_ADDRESS BestStart = 0;
+
+    UINTN Count = MemoryMapViewCount(View);
+    for (UINTN Index = 0; Index < Count; Index++) {
+        const EFI_MEMORY_DESCRIPTOR *Descriptor = MemoryMapViewAt(View, Index);
+        if (Descriptor->Type != EfiConventionalMemory) {
+            continue;
+        }
+        UINT64 FirstPage = Descriptor->PhysicalStart >> EFI_PAGE_SHIFT;
+        if (FirstPage >= LimitPage) {
+            continue;
+        }
+        UINT64 Available = Descriptor->NumberOfPages;
+        if (Available > LimitPage - FirstPage) {
+            Available = LimitPage - FirstPage;
+        }
+        if (Available > BestPages) {
+            BestPages = Available;
+            BestStart = Descriptor->PhysicalStart;
+        }
+    }
+
+    if (BestPages == 0) {
+        return EFI_NOT_FOUND;
+    }
+    *Start = BestStart;
+    *Pages = BestPages;
+    return EFI_SUCCESS;
+}
+
+EFI_STATUS ExitBootServicesWithMemoryMap (
+    IN EFI_BOOT_SERVICES        *BootServices,
+    IN EFI_HANDLE               ImageHandle,
+    IN EFI_MEMORY_TYPE          BufferType,
+    OUT EFI_MEMORY_DESCRIPTOR   **MemoryMap,
+    OUT UINTN                   *MemoryMapSize,
+    OUT UINTN                   *DescriptorSize,
+    OUT UINT32                  *DescriptorVersion
+) {
+    if (BootServices == NULL || MemoryMap == NULL || MemoryMapSize == NULL || DescriptorSize == NULL || DescriptorVersion == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    UINTN Size = 0;
+    UINTN MapKey = 0;
+    EFI_STATUS Status = BootServices->GetMemoryMap(&Size, NULL, &MapKey, DescriptorSize, DescriptorVersion);
+    if (Status != EFI_BUFFER_TOO_SMALL) {
+        return Status == EFI_SUCCESS ? (EFI_STATUS)EFI_DEVICE_ERROR : Status;
+    }
+
+    UINTN Capacity = Size + EFI_MEMORY_MAP_SLACK_DESCRIPTORS * *DescriptorSize;
+    EFI_MEMORY_DESCRIPTOR *Buffer = NULL;
+    Status = BootServices->AllocatePool(BufferType, Capacity, (VOID **)&Buffer);
+    if (Status != EFI_SUCCESS) {
+        return Status;
+    }
+
+    //
+    // From here on nothing may allocate, otherwise the key would go stale again
+    //
+    for (UINTN Attempt = 0; Attempt < 2; Attempt++) {
+        Size = Capacity;
+        Status = BootServices->GetMemoryMap(&Size, Buffer, &MapKey, DescriptorSize, DescriptorVersion);
+        if (Status != EFI_SUCCESS) {
+            break;
+        }
+        Status = BootServices->ExitBootServices(ImageHandle, MapKey);
+        if (Status != EFI_INVALID_PARAMETER) {
+            break;
+        }
+    }
+
+    if (Status != EFI_SUCCESS) {
+        //
+        // ExitBootServices did not complete, so the buffer can still be returned
+        //
+        BootServices->FreePool(Buffer);
+        return Status;
+    }
+
+    *MemoryMap = Buffer;
+    *MemoryMapSize = Size;
+    return EFI_SUCCESS;
+}
@@ -0,0 +1,253 @@
+#include <efi/pe.h>
+
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Offset of the optional header from the start of EFI_IMAGE_NT_HEADERS64
+ */
+#define PE_COFF_OPTIONAL_HEADER_OFFSET offsetof(EFI_IMAGE_NT_HEADERS64, OptionalHeader)
+
+/**
+ * Largest offset a relocation entry can hold, plus the widest fixup
+ */
+#define PE_COFF_RELOCATION_REACH (0x1000 + sizeof(UINT64))
+
+/**
+ * Returns the bytes of Section that occupy the image and, in *RawSize, how many of
+ * them come from the file
+ */
+static UINT32 PeCoffSectionExtent (
+    IN const EFI_IMAGE_SECTION_HEADER   &Section,
+    OUT UINT32                          *RawSize
+) {
+    UINT32 Extent = Section.VirtualSize != 0 ? Section.VirtualSize : Section.SizeOfRawData;
+    *RawSize = Section.SizeOfRawData < Extent ? Section.SizeOfRawData : Extent;
+    return Extent;
+}
+
+EFI_STATUS PeCoffGetImageInfo (
+    IN const VOID               *Source,
+    IN UINTN                    SourceSize,
+    OUT EFI_PE_COFF_IMAGE_INFO  *Info
+) {
+    if (Source == NULL || Info == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    //
+    // The DOS stub is optional; without it the PE header starts the file
+    //
+    const UINT8 *Bytes = (const UINT8 *)Source;
+    UINT64 HeaderOffset = 0;
+    EFI_IMAGE_DOS_HEADER Dos;
+    if (SourceSize >= sizeof(Dos)) {
+        memcpy(&Dos, Bytes, sizeof(Dos));
+        if (Dos.Magic == EFI_IMAGE_DOS_SIGNATURE) {
+            HeaderOffset = Dos.NewHeaderOffset;
+        }
+    }
+
+    EFI_IMAGE_NT_HEADERS64 Headers;
+    UINT64 MinimumHeaders = PE_COFF_OPTIONAL_HEADER_OFFSET + offsetof(EFI_IMAGE_OPTIONAL_HEADER64, DataDirectory);
+    if (HeaderOffset + MinimumHeaders > SourceSize) {
+        return EFI_LOAD_ERROR;
+    }
+    memcpy(&Headers, Bytes + HeaderOffset, PE_COFF_OPTIONAL_HEADER_OFFSET + sizeof(UINT16));
+    if (Headers.Signature != EFI_IMAGE_NT_SIGNATURE) {
+        return EFI_LOAD_ERROR;
+    }
+    if (Headers.OptionalHeader.Magic == EFI_IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+        return EFI_UNSUPPORTED;
+    }
+
+    UINT32 OptionalSize = Headers.FileHeader.SizeOfOptionalHeader;
+    UINT64 SectionTableOffset = HeaderOffset + PE_COFF_OPTIONAL_HEADER_OFFSET + OptionalSize;
+    if (Headers.OptionalHeader.Magic != EFI_IMAGE_NT_OPTIONAL_HDR64_MAGIC || OptionalSize < offsetof(EFI_IMAGE_OPTIONAL_HEADER64, DataDirectory) || SectionTableOffset > SourceSize) {
+        return EFI_LOAD_ERROR;
+    }
+    memset(&Headers.OptionalHeader, 0, sizeof(Headers.OptionalHeader));
+    memcpy(&Headers.OptionalHeader, Bytes + HeaderOffset + PE_COFF_OPTIONAL_HEADER_OFFSET, OptionalSize < sizeof(Headers.OptionalHeader) ? OptionalSize : sizeof(Headers.OptionalHeader));
+
+    const EFI_IMAGE_OPTIONAL_HEADER64 &Optional = Headers.OptionalHeader;
+    UINT64 DirectoryEnd = offsetof(EFI_IMAGE_OPTIONAL_HEADER64, DataDirectory) + (UINT64)Optional.NumberOfRvaAndSizes * sizeof(EFI_IMAGE_DATA_DIRECTORY);
+    if (Optional.NumberOfRvaAndSizes > EFI_IMAGE_NUMBER_OF_DIRECTORY_ENTRIES || DirectoryEnd > OptionalSize) {
+        return EFI_LOAD_ERROR;
+    }
+
+    //
+    // The headers, section table included, must lie within the file and the image
+    //
+    UINT64 SectionTableEnd = SectionTableOffset + (UINT64)Headers.FileHeader.NumberOfSections * sizeof(EFI_IMAGE_SECTION_HEADER);
+    if (Optional.SizeOfImage == 0 || Optional.SizeOfHeaders > Optional.SizeOfImage || Optional.SizeOfHeaders > SourceSize || SectionTableEnd > Optional.SizeOfHeaders) {
+        return EFI_LOAD_ERROR;
+    }
+    if (Optional.SectionAlignment == 0 || (Optional.SectionAlignment & (Optional.SectionAlignment - 1)) != 0) {
+        return EFI_LOAD_ERROR;
+    }
+    if (Optional.AddressOfEntryPoint >= Optional.SizeOfImage) {
+        return EFI_LOAD_ERROR;
+    }
+
+    UINT64 End = Optional.SizeOfHeaders;
+    for (UINT16 Index = 0; Index < Headers.FileHeader.NumberOfSections; Index++) {
+        EFI_IMAGE_SECTION_HEADER Section;
+        memcpy(&Section, Bytes + SectionTableOffset + Index * sizeof(Section), sizeof(Section));
+        UINT32 RawSize;
+        UINT64 Extent = PeCoffSectionExtent(Section, &RawSize);
+        if (Section.VirtualAddress < End || Section.VirtualAddress + Extent > Optional.SizeOfImage) {
+            return EFI_LOAD_ERROR;
+        }
+        if (RawSize != 0 && (UINT64)Section.PointerToRawData + RawSize > SourceSize) {
+            return EFI_LOAD_ERROR;
+        }
+        End = Section.VirtualAddress + Extent;
+    }
+
+    EFI_IMAGE_DATA_DIRECTORY Relocations = {};
+    if (Optional.NumberOfRvaAndSizes > EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC) {
+        Relocations = Optional.DataDirectory[EFI_IMAGE_DIRECTORY_ENTRY_BASERELOC];
+        if (Relocations.Size == 0) {
+            Relocations.VirtualAddress = 0;
+        } else if ((UINT64)Relocations.VirtualAddress + Relocations.Size > Optional.SizeOfImage) {
+            return EFI_LOAD_ERROR;
+        }
+    }
+
+    Info->Machine = Headers.FileHeader.Machine;
+    Info->Subsystem = Optional.Subsystem;
+    Info->Characteristics = Headers.FileHeader.Characteristics;
+    Info->NumberOfSections = Headers.FileHeader.NumberOfSections;
+    Info->HeaderOffset = (UINT32)HeaderOffset;
+    Info->SectionTableOffset = (UINT32)SectionTableOffset;
+    Info->SizeOfHeaders = Optional.SizeOfHeaders;
+    Info->SizeOfImage = Optional.SizeOfImage;
+    Info->SectionAlignment = Optional.SectionAlignment;
+    Info->AddressOfEntryPoint = Optional.AddressOfEntryPoint;
+    Info->ImageBase = Optional.ImageBase;
+    Info->Relocations = Relocations;
+    return EFI_SUCCESS;
+}
+
+VOID PeCoffLoadImage (
+    IN const VOID                   *Source,
+    IN const EFI_PE_COFF_IMAGE_INFO *Info,
+    OUT VOID                        *Image
+) {
+    const UINT8 *Bytes = (const UINT8 *)Source;
+    UINT8 *Destination = (UINT8 *)Image;
+
+    //
+    // Sections ascend without overlapping, so one sweep copies each one and
+    // zeroes the gap before it and its tail beyond the raw data
+    //
+    memcpy(Destination, Bytes, Info->SizeOfHeaders);
+    UINT32 End = Info->SizeOfHeaders;
+    for (UINT16 Index = 0; Index < Info->NumberOfSections; Index++) {
+        EFI_IMAGE_SECTION_HEADER Section;
+        memcpy(&Section, Bytes + Info->SectionTableOffset + Index * sizeof(Section), sizeof(Section));
+        UINT32 RawSize;
+        UINT32 Extent = PeCoffSectionExtent(Section, &RawSize);
+
+        memset(Destination + End, 0, Section.VirtualAddress - End);
+        if (RawSize != 0) {
+            memcpy(Destination + Section.VirtualAddress, Bytes + Section.PointerToRawData, RawSize);
+        }
+        memset(Destination + Section.VirtualAddress + RawSize, 0, Extent - RawSize);
+        End = Section.VirtualAddress + Extent;
+    }
+    memset(Destination + End, 0, Info->SizeOfImage - End);
+}
+
+EFI_STATUS PeCoffRelocateImage (
+    IN OUT VOID                     *Image,
+    IN const EFI_PE_COFF_IMAGE_INFO *Info,
+    IN UINT64                       NewBase,
+    OUT UINTN                       *FixupCount OPTIONAL
+) {
+    if (Image == NULL || Info == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+    if (FixupCount != NULL) {
+        *FixupCount = 0;
+    }
+
+    UINT64 Delta = NewBase - Info->ImageBase;
+    if (Delta == 0) {
+        return EFI_SUCCESS;
+    }
+    if ((Info->Characteristics & EFI_IMAGE_FILE_RELOCS_STRIPPED) != 0) {
+        return EFI_LOAD_ERROR;
+    }
+
+    UINT8 *Bytes = (UINT8 *)Image;
+    UINTN Fixups = 0;
+    UINT32 Offset = Info->Relocations.VirtualAddress;
+    UINT32 DirectoryEnd = Info->Relocations.VirtualAddress + Info->Relocations.Size;
+    while (Offset < DirectoryEnd) {
+        EFI_IMAGE_BASE_RELOCATION Block;
+        if (DirectoryEnd - Offset < sizeof(Block)) {
+            return EFI_LOAD_ERROR;
+        }
+        memcpy(&Block, Bytes + Offset, sizeof(Block));
+        if (Block.SizeOfBlock < sizeof(Block) || Block.SizeOfBlock > DirectoryEnd - Offset || Block.VirtualAddress >= Info->SizeOfImage) {
+            return EFI_LOAD_ERROR;
+        }
+
+        //
+        // A block whose whole reach lies inside the image needs no check per entry,
+        // which is every block but possibly the last page's
+        //
+        UINT8 *Page = Bytes + Block.VirtualAddress;
+        UINT32 Room = Info->SizeOfImage - Block.VirtualAddress;
+        BOOLEAN Contained = Room >= PE_COFF_RELOCATION_REACH;
+        const UINT8 *Entries = Bytes + Offset + sizeof(Block);
+        UINTN Count = (Block.SizeOfBlock - sizeof(Block)) / sizeof(UINT16);
+        for (UINTN Index = 0; Index < Count; Index++) {
+            UINT16 Value;
+            memcpy(&Value, Entries + Index * sizeof(UINT16), sizeof(Value));
+            UINT32 Type = Value >> 12;
+            UINT32 At = Value & 0xFFF;
+            UINT8 *Fixup = Page + At;
+
+            if (Type == EFI_IMAGE_REL_BASED_DIR64) {
+                if (!Contained && At + sizeof(UINT64) > Room) {
+                    return EFI_LOAD_ERROR;
+                }
+                UINT64 Address;
+                memcpy(&Address, Fixup, sizeof(Address));
+                Address += Delta;
+                memcpy(Fixup, &Address, sizeof(Address));
+            } else if (Type == EFI_IMAGE_REL_BASED_HIGHLOW) {
+                if (!Contained && At + sizeof(UINT32) > Room) {
+                    return EFI_LOAD_ERROR;
+                }
+                UINT32 Address;
+                memcpy(&Address, Fixup, sizeof(Address));
+                Address += (UINT32)Delta;
+                memcpy(Fixup, &Address, sizeof(Address));
+            } else if (Type == EFI_IMAGE_REL_BASED_HIGH || Type == EFI_IMAGE_REL_BASED_LOW) {
+                if (!Contained && At + sizeof(UINT16) > Room) {
+                    return EFI_LOAD_ERROR;
+                }
+                UINT16 Address;
+                memcpy(&Address, Fixup, sizeof(Address));
+                Address += Type == EFI_IMAGE_REL_BASED_HIGH ? (UINT16)(Delta >> 16) : (UINT16)Delta;
+                memcpy(Fixup, &Address, sizeof(Address));
+            } else if (Type == EFI_IMAGE_REL_BASED_ABSOLUTE) {
+                continue;
+            } else {
+                return EFI_UNSUPPORTED;
+            }
+            Fixups++;
+        }
+        Offset += Block.SizeOfBlock;
+    }
+
+    UINT8 *ImageBase = Bytes + Info->HeaderOffset + PE_COFF_OPTIONAL_HEADER_OFFSET + offsetof(EFI_IMAGE_OPTIONAL_HEADER64, ImageBase);
+    memcpy(ImageBase, &NewBase, sizeof(NewBase));
+    if (FixupCount != NULL) {
+        *FixupCount = Fixups;
+    }
+    return EFI_SUCCESS;
+}
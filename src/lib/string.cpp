@@ -0,0 +1,408 @@
+#include <efi/string.h>
+
+#include <string.h>
+
+/**
+ * Unicode code points used by the transcoders
+ */
+#define REPLACEMENT_CHARACTER   0xFFFD
+#define HIGH_SURROGATE_FIRST    0xD800
+#define LOW_SURROGATE_FIRST     0xDC00
+#define SURROGATE_LAST          0xDFFF
+#define MAX_CODE_POINT          0x10FFFF
+
+/**
+ * Vector types for the kernels: eight code units or sixteen bytes, which every
+ * 64-bit host has without runtime dispatch. Strings in this API are names of a few
+ * dozen code units, too short to fill wider vectors. Comparisons yield STR_MASK,
+ * with every bit of a lane set where the comparison holds.
+ */
+typedef UINT16  STR_VECTOR      __attribute__((vector_size(16), aligned(2), may_alias));
+typedef UINT8   STR_BYTES       __attribute__((vector_size(16), aligned(1), may_alias));
+typedef INT16   STR_MASK        __attribute__((vector_size(16)));
+typedef UINT8   STR_NARROW      __attribute__((vector_size(8)));
+typedef UINT16  STR_WIDE        __attribute__((vector_size(32)));
+
+#define STR_LANES       (sizeof(STR_VECTOR) / sizeof(CHAR16))
+#define STR_PAGE_SIZE   4096
+
+/**
+ * Returns TRUE when a vector load at Address stays within its page, so that the
+ * kernels may read past a terminator without faulting
+ */
+static inline BOOLEAN StrVectorFits (
+    IN const VOID *Address
+) {
+    return ((UINTN)Address & (STR_PAGE_SIZE - 1)) <= STR_PAGE_SIZE - sizeof(STR_VECTOR);
+}
+
+static inline BOOLEAN StrAnyLane (
+    IN STR_MASK Mask
+) {
+    UINT64 Half[2];
+    memcpy(Half, &Mask, sizeof(Half));
+    return (Half[0] | Half[1]) != 0;
+}
+
+/**
+ * Returns the number of lanes set in Mask: the multiply sums the low bit of each
+ * lane of a half into its top lane
+ */
+static inline UINTN StrCountLanes (
+    IN STR_MASK Mask
+) {
+    const UINT64 LaneBits = 0x0001000100010001;
+    UINT64 Half[2];
+    memcpy(Half, &Mask, sizeof(Half));
+    return (UINTN)((((Half[0] & LaneBits) * LaneBits) >> 48) + (((Half[1] & LaneBits) * LaneBits) >> 48));
+}
+
+/**
+ * Returns the index of the first lane set in Mask, or STR_LANES when none is. UEFI
+ * hosts are little-endian, so lane 0 is the low bits of the first half.
+ */
+static inline UINTN StrFirstLane (
+    IN STR_MASK Mask
+) {
+    UINT64 Half[2];
+    memcpy(Half, &Mask, sizeof(Half));
+    if (Half[0] != 0) {
+        return (UINTN)__builtin_ctzll(Half[0]) / 16;
+    }
+    if (Half[1] != 0) {
+        return STR_LANES / 2 + (UINTN)__builtin_ctzll(Half[1]) / 16;
+    }
+    return STR_LANES;
+}
+
+/**
+ * CharToUpper for every lane
+ */
+static inline STR_VECTOR StrUpperVector (
+    IN STR_VECTOR Units
+) {
+    STR_MASK Lower = ((Units - u'a') < 26) | (((Units - 0xE0) <= 0x1E) & (Units != 0xF7));
+    return Units - ((STR_VECTOR)Lower & 0x20);
+}
+
+CHAR16 CharToUpper (
+    IN CHAR16 Char
+) {
+    if ((Char >= u'a' && Char <= u'z') || (Char >= 0xE0 && Char <= 0xFE && Char != 0xF7)) {
+        return (CHAR16)(Char - 0x20);
+    }
+    return Char;
+}
+
+//
+// The string kernels read whole vectors that may extend past the terminator into
+// the rest of its page, which is not part of the object as far as AddressSanitizer
+// knows
+//
+
+__attribute__((no_sanitize_address))
+UINTN StrLen (
+    IN const CHAR16 *String
+) {
+    const CHAR16 *End = String;
+    while (TRUE) {
+        if (StrVectorFits(End)) {
+            UINTN Lane = StrFirstLane(*(const STR_VECTOR *)End == 0);
+            End += Lane;
+            if (Lane < STR_LANES) {
+                break;
+            }
+        } else if (*End == 0) {
+            break;
+        } else {
+            End++;
+        }
+    }
+    return (UINTN)(End - String);
+}
+
+UINTN StrSize (
+    IN const CHAR16 *String
+) {
+    return (StrLen(String) + 1) * sizeof(CHAR16);
+}
+
+__attribute__((no_sanitize_address))
+INTN StrCmp (
+    IN const CHAR16 *First,
+    IN const CHAR16 *Second
+) {
+    while (TRUE) {
+        if (StrVectorFits(First) && StrVectorFits(Second)) {
+            STR_VECTOR Left = *(const STR_VECTOR *)First;
+            STR_VECTOR Right = *(const STR_VECTOR *)Second;
+            UINTN Lane = StrFirstLane((Left != Right) | (Left == 0));
+            if (Lane < STR_LANES) {
+                return (INTN)First[Lane] - (INTN)Second[Lane];
+            }
+            First += STR_LANES;
+            Second += STR_LANES;
+        } else if (*First == 0 || *First != *Second) {
+            return (INTN)*First - (INTN)*Second;
+        } else {
+            First++;
+            Second++;
+        }
+    }
+}
+
+__attribute__((no_sanitize_address))
+INTN StriCmp (
+    IN const CHAR16 *First,
+    IN const CHAR16 *Second
+) {
+    while (TRUE) {
+        if (StrVectorFits(First) && StrVectorFits(Second)) {
+            STR_VECTOR Left = *(const STR_VECTOR *)First;
+            STR_VECTOR Right = *(const STR_VECTOR *)Second;
+            UINTN Lane = StrFirstLane((StrUpperVector(Left) != StrUpperVector(Right)) | (Left == 0));
+            if (Lane < STR_LANES) {
+                return (INTN)CharToUpper(First[Lane]) - (INTN)CharToUpper(Second[Lane]);
+            }
+            First += STR_LANES;
+            Second += STR_LANES;
+        } else if (*First == 0 || CharToUpper(*First) != CharToUpper(*Second)) {
+            return (INTN)CharToUpper(*First) - (INTN)CharToUpper(*Second);
+        } else {
+            First++;
+            Second++;
+        }
+    }
+}
+
+static inline UINTN Utf8EncodedLength (
+    IN UINT32 CodePoint
+) {
+    if (CodePoint < 0x80) {
+        return 1;
+    }
+    if (CodePoint < 0x800) {
+        return 2;
+    }
+    if (CodePoint < 0x10000) {
+        return 3;
+    }
+    return 4;
+}
+
+static inline VOID Utf8Encode (
+    IN UINT32   CodePoint,
+    OUT CHAR8   *Utf8
+) {
+    UINT8 *Out = (UINT8 *)Utf8;
+    if (CodePoint < 0x80) {
+        Out[0] = (UINT8)CodePoint;
+    } else if (CodePoint < 0x800) {
+        Out[0] = (UINT8)(0xC0 | (CodePoint >> 6));
+        Out[1] = (UINT8)(0x80 | (CodePoint & 0x3F));
+    } else if (CodePoint < 0x10000) {
+        Out[0] = (UINT8)(0xE0 | (CodePoint >> 12));
+        Out[1] = (UINT8)(0x80 | ((CodePoint >> 6) & 0x3F));
+        Out[2] = (UINT8)(0x80 | (CodePoint & 0x3F));
+    } else {
+        Out[0] = (UINT8)(0xF0 | (CodePoint >> 18));
+        Out[1] = (UINT8)(0x80 | ((CodePoint >> 12) & 0x3F));
+        Out[2] = (UINT8)(0x80 | ((CodePoint >> 6) & 0x3F));
+        Out[3] = (UINT8)(0x80 | (CodePoint & 0x3F));
+    }
+}
+
+EFI_STATUS Char16ToUtf8 (
+    IN const CHAR16 *String,
+    IN UINTN        Length,
+    OUT CHAR8       *Utf8 OPTIONAL,
+    IN OUT UINTN    *Utf8Length,
+    IN UINT32       Flags
+) {
+    if ((String == NULL && Length != 0) || Utf8Length == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    UINTN Capacity = Utf8 == NULL ? 0 : *Utf8Length;
+    UINTN Needed = 0;
+    UINTN Index = 0;
+    while (Index < Length) {
+        //
+        // A block without surrogates encodes unit by unit, and its size is the
+        // count of units above each encoding boundary. A block with one is left to
+        // the code point loop.
+        //
+        UINTN BlockEnd = Index + 1;
+        if (Length - Index >= STR_LANES) {
+            STR_VECTOR Units;
+            memcpy(&Units, String + Index, sizeof(Units));
+            if (!StrAnyLane((Units & 0xF800) == HIGH_SURROGATE_FIRST)) {
+                STR_MASK Wide = Units >= 0x80;
+                UINTN Encoded = STR_LANES;
+                if (StrAnyLane(Wide)) {
+                    Encoded += StrCountLanes(Wide) + StrCountLanes(Units >= 0x800);
+                }
+                if (Needed + Encoded <= Capacity) {
+                    if (Encoded == STR_LANES) {
+                        STR_NARROW Ascii = __builtin_convertvector(Units, STR_NARROW);
+                        memcpy(Utf8 + Needed, &Ascii, sizeof(Ascii));
+                    } else {
+                        CHAR8 *Out = Utf8 + Needed;
+                        for (UINTN Lane = 0; Lane < STR_LANES; Lane++) {
+                            Utf8Encode(Units[Lane], Out);
+                            Out += Utf8EncodedLength(Units[Lane]);
+                        }
+                    }
+                }
+                Needed += Encoded;
+                Index += STR_LANES;
+                continue;
+            }
+            BlockEnd = Index + STR_LANES;
+        }
+
+        for (; Index < BlockEnd; Index++) {
+            UINT32 CodePoint = String[Index];
+            if (CodePoint >= HIGH_SURROGATE_FIRST && CodePoint <= SURROGATE_LAST) {
+                UINT32 Low = Index + 1 < Length ? String[Index + 1] : 0;
+                if (CodePoint < LOW_SURROGATE_FIRST && Low >= LOW_SURROGATE_FIRST && Low <= SURROGATE_LAST) {
+                    CodePoint = 0x10000 + ((CodePoint - HIGH_SURROGATE_FIRST) << 10) + (Low - LOW_SURROGATE_FIRST);
+                    Index++;
+                } else if ((Flags & UTF_REPLACE_INVALID) != 0) {
+                    CodePoint = REPLACEMENT_CHARACTER;
+                } else {
+                    return EFI_INVALID_PARAMETER;
+                }
+            }
+
+            UINTN Encoded = Utf8EncodedLength(CodePoint);
+            if (Needed + Encoded <= Capacity) {
+                Utf8Encode(CodePoint, Utf8 + Needed);
+            }
+            Needed += Encoded;
+        }
+    }
+
+    EFI_STATUS Status = Needed > Capacity ? EFI_BUFFER_TOO_SMALL : EFI_SUCCESS;
+    *Utf8Length = Needed;
+    return Status;
+}
+
+/**
+ * Decodes one UTF-8 sequence, returning its length or 0 when malformed
+ */
+static inline UINTN Utf8Decode (
+    IN const UINT8  *Utf8,
+    IN UINTN        Length,
+    OUT UINT32      *CodePoint
+) {
+    UINT8 Lead = Utf8[0];
+    if (Lead < 0x80) {
+        *CodePoint = Lead;
+        return 1;
+    }
+
+    UINTN Size;
+    UINT32 Value;
+    UINT32 Minimum;
+    if ((Lead & 0xE0) == 0xC0) {
+        Size = 2;
+        Value = Lead & 0x1F;
+        Minimum = 0x80;
+    } else if ((Lead & 0xF0) == 0xE0) {
+        Size = 3;
+        Value = Lead & 0x0F;
+        Minimum = 0x800;
+    } else if ((Lead & 0xF8) == 0xF0) {
+        Size = 4;
+        Value = Lead & 0x07;
+        Minimum = 0x10000;
+    } else {
+        return 0;
+    }
+
+    if (Size > Length) {
+        return 0;
+    }
+    for (UINTN Index = 1; Index < Size; Index++) {
+        if ((Utf8[Index] & 0xC0) != 0x80) {
+            return 0;
+        }
+        Value = (Value << 6) | (Utf8[Index] & 0x3F);
+    }
+
+    if (Value < Minimum || Value > MAX_CODE_POINT || (Value >= HIGH_SURROGATE_FIRST && Value <= SURROGATE_LAST)) {
+        return 0;
+    }
+    *CodePoint = Value;
+    return Size;
+}
+
+EFI_STATUS Utf8ToChar16 (
+    IN const CHAR8  *Utf8,
+    IN UINTN        Length,
+    OUT CHAR16      *String OPTIONAL,
+    IN OUT UINTN    *StringLength,
+    IN UINT32       Flags
+) {
+    if ((Utf8 == NULL && Length != 0) || StringLength == NULL) {
+        return EFI_INVALID_PARAMETER;
+    }
+
+    const UINT8 *Bytes = (const UINT8 *)Utf8;
+    UINTN Capacity = String == NULL ? 0 : *StringLength;
+    UINTN Needed = 0;
+    UINTN Index = 0;
+    while (Index < Length) {
+        //
+        // An ASCII block widens in place. Any other block is decoded sequence by
+        // sequence up to its end, the last sequence possibly running past it.
+        //
+        UINTN BlockEnd = Index + 1;
+        if (Length - Index >= sizeof(STR_BYTES)) {
+            STR_BYTES Block;
+            memcpy(&Block, Bytes + Index, sizeof(Block));
+            if (!StrAnyLane((STR_MASK)(Block & 0x80))) {
+                if (Needed + sizeof(Block) <= Capacity) {
+                    STR_WIDE Units = __builtin_convertvector(Block, STR_WIDE);
+                    memcpy(String + Needed, &Units, sizeof(Units));
+                }
+                Needed += sizeof(Block);
+                Index += sizeof(Block);
+                continue;
+            }
+            BlockEnd = Index + sizeof(Block);
+        }
+
+        while (Index < BlockEnd) {
+            UINT32 CodePoint;
+            UINTN Size = Utf8Decode(Bytes + Index, Length - Index, &CodePoint);
+            if (Size == 0) {
+                if ((Flags & UTF_REPLACE_INVALID) == 0) {
+                    return EFI_INVALID_PARAMETER;
+                }
+                CodePoint = REPLACEMENT_CHARACTER;
+                Size = 1;
+            }
+            Index += Size;
+
+            if (CodePoint >= 0x10000) {
+                if (Needed + 2 <= Capacity) {
+                    CodePoint -= 0x10000;
+                    String[Needed] = (CHAR16)(HIGH_SURROGATE_FIRST + (CodePoint >> 10));
+                    String[Needed + 1] = (CHAR16)(LOW_SURROGATE_FIRST + (CodePoint & 0x3FF));
+                }
+                Needed += 2;
+            } else {
+                if (Needed < Capacity) {
+                    String[Needed] = (CHAR16)CodePoint;
+                }
+                Needed++;
+            }
+        }
+    }
+
+    EFI_STATUS Status = Needed > Capacity ? EFI_BUFFER_TOO_SMALL : EFI_SUCCESS;
+    *StringLength = Needed;
+    return Status;
+}